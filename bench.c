@@ -0,0 +1,619 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	benchmark of library internals, build with
+
+	gcc -O2 bench.c id3*.c -lm -lpthread -o id3_bench
+
+	id3_bench [knob=value ...] runs every phase on a synthetic dataset, knobs are
+		rows		samples ( default 100000 )
+		attrs		attribute columns ( default 8 )
+		card		distinct values of each attribute, a comma separated list is
+					repeated over columns ( default 10 )
+		classes		distinct classes ( default 3 )
+		noise		percent of samples with a random class ( default 5 )
+		dup			percent of samples copying a previous one ( default 0 )
+		numeric		first attributes holding numbers, split by thresholds ( default 0 )
+		seed		seed of generator, same knobs and seed give the same dataset ( default 1 )
+		threads		training threads ( default 1 )
+		trees		trees of a bagged forest, rules are not extracted from forests ( default 1 )
+		folds		folds of a cross validation of a grid of depth limits and minimum leaf
+					sizes, 0 skips it ( default 0 )
+		stats		1 prints statistics of training and rule extraction as JSON ( default 0 )
+	id3_bench scale checks that encoding scales linearly in the number of rows
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+#define	BENCH_COLS			5			// attributes + class
+#define	BENCH_CARD			20000		// distinct strings for each attribute column
+#define	BENCH_CLASSES		4			// distinct classes
+#define	BENCH_MAX_ROWS		1600000
+
+// attributes deciding class of a generated sample, the others are irrelevant
+#define	BENCH_RULE_ATTRS	4
+
+// grid of cross validation: depth limits ( 0 for none ) times minimum leaf sizes
+static const long		bench_depths[]	= { 2, 4, 8, 0 };
+static const long		bench_leaves[]	= { 1, 5, 25 };
+
+#define	BENCH_DEPTHS		( long )( sizeof( bench_depths ) / sizeof( bench_depths[ 0 ] ) )
+#define	BENCH_LEAVES		( long )( sizeof( bench_leaves ) / sizeof( bench_leaves[ 0 ] ) )
+
+/*
+	knobs of synthetic dataset
+*/
+typedef struct bench_knobs_tag {
+	long				rows;
+	long				attrs;
+	long				*card;			// distinct values of each attribute
+	long				classes;
+	long				noise;			// percent of samples with random class
+	long				dup;			// percent of duplicated samples
+	long				numeric;		// first attributes that are numeric
+	unsigned long		seed;
+	long				threads;
+	long				trees;
+	long				folds;			// folds of cross validation, 0 for none
+	long				stats;			// print library statistics
+} bench_knobs_t;
+
+/*
+	synthetic dataset: cells point to the distinct strings of their column
+*/
+typedef struct bench_data_tag {
+	long				cols;
+	long				rows;
+	char				**names;		// distinct strings of all columns
+	char				**data;			// rows * cols cells
+	char				**column_names;
+} bench_data_t;
+
+/*
+	wall clock in seconds
+*/
+static double bench_now( void )
+{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+	peak resident memory in MB since last bench_start, from VmHWM of process; where
+	it cannot be reset ( no /proc ) this is the peak of process so far
+*/
+static double bench_peak( void )
+{
+	struct rusage		usage;
+	FILE				*fp				= NULL;
+	char				line[ 256 ];
+	long				kb				= -1;
+
+	if( ( fp = fopen( "/proc/self/status", "r" ) ) != NULL ) {
+		while( kb < 0 && fgets( line, sizeof( line ), fp ) != NULL ) {
+			if( sscanf( line, "VmHWM: %ld", &kb ) != 1 ) {
+				kb = -1;
+			}
+		}
+		fclose( fp );
+	}
+	if( kb < 0 ) {
+		getrusage( RUSAGE_SELF, &usage );
+		kb = usage.ru_maxrss;
+	}
+
+	return kb / 1024.0;
+}
+
+/*
+	start of a phase: peak resident memory is reset to current resident memory, so that
+	each phase reports its own peak, then wall clock in seconds
+*/
+static double bench_start( void )
+{
+	FILE				*fp				= NULL;
+
+	if( ( fp = fopen( "/proc/self/clear_refs", "w" ) ) != NULL ) {
+		fputs( "5", fp );
+		fclose( fp );
+	}
+
+	return bench_now();
+}
+
+/*
+	next number of generator, 31 random bits
+*/
+static long bench_rand( unsigned long *seed )
+{
+	*seed = *seed * 6364136223846793005ul + 1442695040888963407ul;
+	return ( long )( *seed >> 33 );
+}
+
+/*
+	generate a dataset from knobs: class is a function of first attributes, noise
+	replaces it with a random class and duplicated samples copy a previous sample
+	returns 0 or -1 on memory error
+*/
+static int bench_generate( bench_data_t *bd, const bench_knobs_t *knobs )
+{
+	unsigned long		seed			= knobs->seed;
+	long				cols			= knobs->attrs + 1;
+	long				tot_names		= knobs->classes;
+	long				*first			= NULL;		// first string of each column
+	char				**row			= NULL;
+	unsigned long		hash;
+	long				i, col, from;
+
+	memset( bd, 0, sizeof( bench_data_t ) );
+	bd->cols	= cols;
+	bd->rows	= knobs->rows;
+
+	for( col = 0; col < knobs->attrs; col++ ) {
+		tot_names += knobs->card[ col ];
+	}
+	first				= malloc( sizeof( long ) * cols );
+	bd->names			= calloc( tot_names, sizeof( char* ) );
+	bd->column_names	= calloc( cols, sizeof( char* ) );
+	bd->data			= malloc( sizeof( char* ) * cols * knobs->rows );
+	if( first == NULL || bd->names == NULL || bd->column_names == NULL || bd->data == NULL ) {
+		free( first );
+		return -1;
+	}
+
+	// distinct strings of each column
+	for( col = 0, i = 0; col < cols; col++ ) {
+		first[ col ] = i;
+		for( from = 0; from < ( col < knobs->attrs ? knobs->card[ col ] : knobs->classes ); from++, i++ ) {
+			if( ( bd->names[ i ] = malloc( 48 ) ) == NULL ) {
+				free( first );
+				return -1;
+			}
+			if( col < knobs->numeric ) {
+				sprintf( bd->names[ i ], "%ld.%02ld", from / 100, from % 100 );
+			} else if( col < knobs->attrs ) {
+				sprintf( bd->names[ i ], "a%ld_v%ld", col, from );
+			} else {
+				sprintf( bd->names[ i ], "class%ld", from );
+			}
+		}
+		bd->column_names[ col ] = bd->names[ first[ col ] ];
+	}
+
+	for( i = 0; i < knobs->rows; i++ ) {
+		row = bd->data + i * cols;
+
+		// copy of a previous sample
+		if( i > 0 && bench_rand( &seed ) % 100 < knobs->dup ) {
+			from = bench_rand( &seed ) % i;
+			memcpy( row, bd->data + from * cols, sizeof( char* ) * cols );
+			continue;
+		}
+
+		hash = knobs->seed;
+		for( col = 0; col < knobs->attrs; col++ ) {
+			from		= bench_rand( &seed ) % knobs->card[ col ];
+			row[ col ]	= bd->names[ first[ col ] + from ];
+			if( col < BENCH_RULE_ATTRS ) {
+				hash = ( hash ^ from ) * 0x100000001b3ul;
+			}
+		}
+		hash ^= hash >> 29;
+		from = ( bench_rand( &seed ) % 100 < knobs->noise ) ? bench_rand( &seed ) % knobs->classes : ( long )( hash % knobs->classes );
+		row[ knobs->attrs ] = bd->names[ first[ knobs->attrs ] + from ];
+	}
+
+	free( first );
+
+	return 0;
+}
+
+static void bench_free( bench_data_t *bd, const bench_knobs_t *knobs )
+{
+	long				tot_names		= knobs->classes;
+	long				i;
+
+	for( i = 0; i < knobs->attrs; i++ ) {
+		tot_names += knobs->card[ i ];
+	}
+	for( i = 0; bd->names != NULL && i < tot_names; i++ ) {
+		free( bd->names[ i ] );
+	}
+	free( bd->names );
+	free( bd->column_names );
+	free( bd->data );
+}
+
+/*
+	sink counting rules
+*/
+static int bench_rule( const id3_rule_t *rule, void *arg )
+{
+	( void )rule;
+	*( long* )arg += 1;
+
+	return 0;
+}
+
+/*
+	one line of report: time, throughput in units per second and peak memory
+*/
+static void bench_report( const char *phase, double elapsed, double units, const char *unit )
+{
+	printf( "%-12s %12.2f %14.3f %-8s %10.1f\n", phase, elapsed * 1e3, units / elapsed / 1e6, unit, bench_peak() );
+}
+
+/*
+	cross validation of the grid of depth limits and minimum leaf sizes on an encoded
+	dataset, accuracy and times of each point are printed
+	returns 0 or -1 on error
+*/
+static int bench_cv( const bench_knobs_t *knobs, const id3_data_t *data, const id3_params_t *params )
+{
+	id3_cv_point_t		points[ BENCH_DEPTHS * BENCH_LEAVES ];
+	id3_params_t		cv_params		= *params;
+	double				start;
+	long				i;
+
+	for( i = 0; i < BENCH_DEPTHS * BENCH_LEAVES; i++ ) {
+		points[ i ].max_depth	= bench_depths[ i % BENCH_DEPTHS ];
+		points[ i ].min_leaf	= bench_leaves[ i / BENCH_DEPTHS ];
+	}
+	cv_params.trees		= 1;
+	cv_params.stats		= NULL;
+	start = bench_start();
+	if( id3_cross_validate_data( data, knobs->folds, points, BENCH_DEPTHS * BENCH_LEAVES, &cv_params ) != 0 ) {
+		return -1;
+	}
+	bench_report( "cross valid", bench_now() - start, knobs->rows * BENCH_DEPTHS * BENCH_LEAVES, "Mrows/s" );
+
+	printf( "\n%-12s %9s %10s %14s %14s\n", "max_depth", "min_leaf", "accuracy", "train (ms)", "predict (ms)" );
+	for( i = 0; i < BENCH_DEPTHS * BENCH_LEAVES; i++ ) {
+		printf( "%-12ld %9ld %10.4f %14.2f %14.2f\n", points[ i ].max_depth, points[ i ].min_leaf, points[ i ].accuracy,
+			points[ i ].train_wall * 1e3, points[ i ].predict_wall * 1e3 );
+	}
+
+	return 0;
+}
+
+/*
+	run every phase on a generated dataset: encoding, tree building, rule extraction
+	and prediction; peak memory is the high water mark of process during each phase
+*/
+static int bench_phases( const bench_knobs_t *knobs )
+{
+	bench_data_t		bd;
+	id3_data_t			data;
+	id3_params_t		params;
+	id3_stats_t			stats;
+	id3_model_t			*model			= NULL;
+	FILE				*fp				= NULL;
+	long				*codes			= NULL;
+	long				*classes		= NULL;
+	char				*numeric		= NULL;
+	long				tot_rules		= 0;
+	double				start;
+	long				i, col;
+	int					result			= -1;
+
+	memset( &data, 0, sizeof( id3_data_t ) );
+	id3_params_init( &params );
+	params.threads	= knobs->threads;
+	params.trees	= knobs->trees;
+	if( knobs->stats ) {
+		params.stats = &stats;
+	}
+	if( knobs->numeric > 0 ) {
+		if( ( numeric = calloc( knobs->attrs + 1, 1 ) ) == NULL ) {
+			return -1;
+		}
+		memset( numeric, 1, knobs->numeric < knobs->attrs ? knobs->numeric : knobs->attrs );
+		params.numeric = numeric;
+	}
+
+	printf( "dataset: %ld rows, %ld attributes, cardinality %ld", knobs->rows, knobs->attrs, knobs->card[ 0 ] );
+	for( col = 1; col < knobs->attrs; col++ ) {
+		printf( ",%ld", knobs->card[ col ] );
+	}
+	printf( ", %ld classes, noise %ld%%, duplicates %ld%%, numeric %ld, seed %lu, threads %ld, trees %ld, folds %ld\n\n",
+		knobs->classes, knobs->noise, knobs->dup, knobs->numeric, knobs->seed, knobs->threads, knobs->trees, knobs->folds );
+	printf( "%-12s %12s %23s %10s\n", "phase", "time (ms)", "throughput", "peak (MB)" );
+
+	do {
+		start = bench_start();
+		if( bench_generate( &bd, knobs ) != 0 ) {
+			break;
+		}
+		bench_report( "generate", bench_now() - start, knobs->rows, "Mrows/s" );
+
+		start = bench_start();
+		if( id3_encode( &data.ds, bd.data, bd.cols, bd.rows ) != 0 ) {
+			break;
+		}
+		bench_report( "encode", bench_now() - start, knobs->rows, "Mrows/s" );
+
+		// tree is built on encoded dataset and compiled into model
+		data.column_names = bd.column_names;
+		start = bench_start();
+		if( id3_train_data( &model, &data, &params ) != 0 ) {
+			break;
+		}
+		bench_report( "build", bench_now() - start, knobs->rows, "Mrows/s" );
+
+		// a forest has no rules of its own
+		if( knobs->trees <= 1 ) {
+			start = bench_start();
+			if( id3_export_rules( model, bench_rule, &tot_rules ) != 0 ) {
+				break;
+			}
+			bench_report( "rules", bench_now() - start, tot_rules, "Mrules/s" );
+
+			if( ( fp = fopen( "/dev/null", "w" ) ) != NULL ) {
+				start = bench_start();
+				id3_write_rules( model, fp, ID3_RULES_TEXT );
+				bench_report( "rules text", bench_now() - start, tot_rules, "Mrules/s" );
+				fclose( fp );
+			}
+		}
+
+		// prediction of training samples, already translated into codes
+		codes	= malloc( sizeof( long ) * knobs->attrs * knobs->rows + 1 );
+		classes	= malloc( sizeof( long ) * knobs->rows + 1 );
+		if( codes == NULL || classes == NULL ) {
+			break;
+		}
+		memset( classes, 0, sizeof( long ) * knobs->rows );
+		for( i = 0; i < knobs->rows; i++ ) {
+			for( col = 0; col < knobs->attrs; col++ ) {
+				codes[ i * knobs->attrs + col ] = ds_code( &data.ds, col, i );
+			}
+		}
+		start = bench_start();
+		if( id3_predict_codes( model, codes, knobs->rows, classes ) != 0 ) {
+			break;
+		}
+		bench_report( "predict", bench_now() - start, knobs->rows, "Mrows/s" );
+
+		start = bench_start();
+		if( id3_predict_batch( model, bd.data, knobs->rows, classes ) != 0 ) {
+			break;
+		}
+		bench_report( "predict str", bench_now() - start, knobs->rows, "Mrows/s" );
+
+		// folds and grid points share the encoded dataset
+		if( knobs->folds > 1 && bench_cv( knobs, &data, &params ) != 0 ) {
+			break;
+		}
+
+		printf( "\n%ld rules, flat tree %ld words\n", tot_rules, model->flat.size );
+		if( knobs->stats ) {
+			id3_stats_json( &stats, stdout );
+		}
+		result = 0;
+	} while( 0 );
+
+	free( codes );
+	free( classes );
+	free( numeric );
+	id3_destroy( model );
+	dataset_free( &data.ds );
+	bench_free( &bd, knobs );
+
+	return result;
+}
+/*
+	encoding of string dataset must scale linearly in the number of rows,
+	whatever the number of distinct strings of each column
+*/
+static int bench_encode( void )
+{
+	char				**names			= NULL;
+	char				**data			= NULL;
+	dataset_t			dataset;
+	double				start, elapsed;
+	unsigned long		seed			= 12345;
+	long				rows, i, col, card;
+
+	// distinct strings of each column, cells only point to them
+	names	= malloc( sizeof( char* ) * BENCH_COLS * BENCH_CARD );
+	data	= malloc( sizeof( char* ) * BENCH_COLS * BENCH_MAX_ROWS );
+	if( names == NULL || data == NULL ) {
+		free( names );
+		free( data );
+		return -1;
+	}
+	for( col = 0; col < BENCH_COLS; col++ ) {
+		for( i = 0; i < BENCH_CARD; i++ ) {
+			names[ col * BENCH_CARD + i ] = malloc( 24 );
+			sprintf( names[ col * BENCH_CARD + i ], "col%ld_value%ld", col, i );
+		}
+	}
+	for( i = 0; i < BENCH_COLS * BENCH_MAX_ROWS; i++ ) {
+		seed	= seed * 6364136223846793005ul + 1442695040888963407ul;
+		col		= i % BENCH_COLS;
+		card	= ( col == BENCH_COLS - 1 ) ? BENCH_CLASSES : BENCH_CARD;
+		data[ i ] = names[ col * BENCH_CARD + ( seed >> 33 ) % card ];
+	}
+
+	printf( "encode: %d columns, %d distinct strings per attribute column\n", BENCH_COLS, BENCH_CARD );
+	printf( "%10s %12s %12s\n", "rows", "time (ms)", "ns / row" );
+	for( rows = BENCH_MAX_ROWS / 16; rows <= BENCH_MAX_ROWS; rows *= 2 ) {
+		start 	= bench_now();
+		if( id3_encode( &dataset, data, BENCH_COLS, rows ) != 0 ) {
+			break;
+		}
+		elapsed	= bench_now() - start;
+
+		printf( "%10ld %12.2f %12.1f\n", rows, elapsed * 1e3, elapsed * 1e9 / rows );
+
+		dataset_free( &dataset );
+	}
+
+	for( i = 0; i < BENCH_COLS * BENCH_CARD; i++ ) {
+		free( names[ i ] );
+	}
+	free( names );
+	free( data );
+
+	return 0;
+}
+
+/*
+	set a knob from a name=value argument
+	returns 0 or -1 on unknown knob or wrong value
+*/
+static int bench_knob( bench_knobs_t *knobs, const char *arg, long **card, long *tot_card )
+{
+	const char			*value		= strchr( arg, '=' );
+	char				*end		= NULL;
+	void				*ptr		= NULL;
+	long				number;
+
+	if( value == NULL ) {
+		return -1;
+	}
+	value += 1;
+
+	// cardinality is a list of numbers
+	if( !strncmp( arg, "card=", 5 ) ) {
+		*tot_card = 0;
+		do {
+			number = strtol( value, &end, 10 );
+			if( end == value || number < 1 || ( ptr = realloc( *card, sizeof( long ) * ( *tot_card + 1 ) ) ) == NULL ) {
+				return -1;
+			}
+			*card					= ptr;
+			( *card )[ *tot_card ]	= number;
+			*tot_card				+= 1;
+			value					= end + 1;
+		} while( *end == ',' );
+		return *end == '\0' ? 0 : -1;
+	}
+
+	number = strtol( value, &end, 10 );
+	if( end == value || *end != '\0' || number < 0 ) {
+		return -1;
+	}
+	if( !strncmp( arg, "rows=", 5 ) ) {
+		knobs->rows = number;
+	} else if( !strncmp( arg, "attrs=", 6 ) && number > 0 ) {
+		knobs->attrs = number;
+	} else if( !strncmp( arg, "classes=", 8 ) && number > 0 ) {
+		knobs->classes = number;
+	} else if( !strncmp( arg, "noise=", 6 ) && number <= 100 ) {
+		knobs->noise = number;
+	} else if( !strncmp( arg, "dup=", 4 ) && number <= 100 ) {
+		knobs->dup = number;
+	} else if( !strncmp( arg, "numeric=", 8 ) ) {
+		knobs->numeric = number;
+	} else if( !strncmp( arg, "seed=", 5 ) ) {
+		knobs->seed = number;
+	} else if( !strncmp( arg, "threads=", 8 ) ) {
+		knobs->threads = number;
+	} else if( !strncmp( arg, "trees=", 6 ) && number > 0 ) {
+		knobs->trees = number;
+	} else if( !strncmp( arg, "folds=", 6 ) && number != 1 ) {
+		knobs->folds = number;
+	} else if( !strncmp( arg, "stats=", 6 ) ) {
+		knobs->stats = number;
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+int main( int argc, char **argv )
+{
+	bench_knobs_t		knobs;
+	long				default_card	= 10;
+	long				*card			= NULL;
+	long				tot_card		= 0;
+	long				i;
+	int					result			= 0;
+
+	if( argc == 2 && !strcmp( argv[ 1 ], "scale" ) ) {
+		if( bench_encode() != 0 ) {
+			printf( "Error memory allocation\n" );
+			return 1;
+		}
+		return 0;
+	}
+
+	knobs.rows		= 100000;
+	knobs.attrs		= 8;
+	knobs.classes	= 3;
+	knobs.noise		= 5;
+	knobs.dup		= 0;
+	knobs.numeric	= 0;
+	knobs.seed		= 1;
+	knobs.threads	= 1;
+	knobs.trees		= 1;
+	knobs.folds		= 0;
+	knobs.stats		= 0;
+	for( i = 1; i < argc; i++ ) {
+		if( bench_knob( &knobs, argv[ i ], &card, &tot_card ) != 0 ) {
+			printf( "Wrong knob %s\n", argv[ i ] );
+			free( card );
+			return 1;
+		}
+	}
+	if( card == NULL ) {
+		card		= &default_card;
+		tot_card	= 1;
+	}
+
+	// list of cardinalities is repeated over attributes
+	if( ( knobs.card = malloc( sizeof( long ) * knobs.attrs ) ) == NULL ) {
+		result = -1;
+	}
+	for( i = 0; result == 0 && i < knobs.attrs; i++ ) {
+		knobs.card[ i ] = card[ i % tot_card ];
+	}
+	if( card != &default_card ) {
+		free( card );
+	}
+
+	if( result != 0 || bench_phases( &knobs ) != 0 ) {
+		printf( "Error memory allocation\n" );
+		result = 1;
+	}
+	free( knobs.card );
+
+	return result;
+}
@@ -0,0 +1,382 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	self check of the ways a tree is trained, build with
+
+	gcc -O2 check.c id3*.c -lm -lpthread -o id3_check
+
+	id3_check trains seeded datasets ( categorical, with many duplicate rows and with
+	numeric columns ) serially and compares the flat tree of every other way of training
+	them with it: several threads, rows added by id3_update, out of core at a small
+	memory budget, worker processes holding shards of rows and a save / load round trip.
+	Exit status is 1 if any tree differs or any training fails
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+#define	CHECK_THREADS		4
+#define	CHECK_UPDATES		4			// batches of rows added by id3_update
+#define	CHECK_WORKERS		3			// worker processes, each one holds a shard
+#define	CHECK_MEMORY		( 128L << 10 )	// memory budget of out of core training
+
+/*
+	seeded dataset: class is a function of first attributes, noise replaces it with a
+	random class and duplicated samples copy a previous sample
+*/
+typedef struct check_set_tag {
+	const char			*name;
+	long				rows;
+	long				attrs;
+	long				card;			// distinct values of each attribute
+	long				classes;
+	long				noise;			// percent of samples with random class
+	long				dup;			// percent of duplicated samples
+	long				numeric;		// first attributes that are numeric
+	unsigned long		seed;
+} check_set_t;
+
+static const check_set_t	check_sets[]	= {
+	{ "categorical",	20000,	8,	7,	3,	5,	0,	0,	1 },
+	{ "duplicates",		20000,	6,	3,	3,	5,	70,	0,	2 },
+	{ "numeric",		20000,	6,	40,	4,	5,	0,	2,	3 },
+};
+
+#define	CHECK_SETS			( long )( sizeof( check_sets ) / sizeof( check_sets[ 0 ] ) )
+
+/*
+	next number of generator, 31 random bits
+*/
+static long check_rand( unsigned long *seed )
+{
+	*seed = *seed * 6364136223846793005ul + 1442695040888963407ul;
+	return ( long )( *seed >> 33 );
+}
+
+/*
+	generate cells of a dataset ( rows * ( attrs + 1 ) strings ) and column names
+	returns 0 or -1 on memory error
+*/
+static int check_generate( const check_set_t *set, char ***data, char ***names )
+{
+	unsigned long		seed			= set->seed;
+	long				cols			= set->attrs + 1;
+	char				**row			= NULL;
+	char				cell[ 48 ];
+	unsigned long		hash;
+	long				i, col, value;
+
+	*data	= calloc( set->rows * cols, sizeof( char* ) );
+	*names	= calloc( cols, sizeof( char* ) );
+	if( *data == NULL || *names == NULL ) {
+		return -1;
+	}
+	for( col = 0; col < cols; col++ ) {
+		sprintf( cell, col < set->attrs ? "attr%ld" : "class", col );
+		if( ( ( *names )[ col ] = strdup( cell ) ) == NULL ) {
+			return -1;
+		}
+	}
+
+	for( i = 0; i < set->rows; i++ ) {
+		row = *data + i * cols;
+
+		// copy of a previous sample
+		if( i > 0 && check_rand( &seed ) % 100 < set->dup ) {
+			value = check_rand( &seed ) % i;
+			for( col = 0; col < cols; col++ ) {
+				if( ( row[ col ] = strdup( ( *data )[ value * cols + col ] ) ) == NULL ) {
+					return -1;
+				}
+			}
+			continue;
+		}
+
+		hash = set->seed;
+		for( col = 0; col < set->attrs; col++ ) {
+			value = check_rand( &seed ) % set->card;
+			if( col < set->numeric ) {
+				sprintf( cell, "%ld.%02ld", value / 4, value % 4 * 25 );
+			} else {
+				sprintf( cell, "a%ld_v%ld", col, value );
+			}
+			hash = ( hash ^ value ) * 0x100000001b3ul;
+			if( ( row[ col ] = strdup( cell ) ) == NULL ) {
+				return -1;
+			}
+		}
+		hash ^= hash >> 29;
+		value = ( check_rand( &seed ) % 100 < set->noise ) ? check_rand( &seed ) % set->classes : ( long )( hash % set->classes );
+		sprintf( cell, "class%ld", value );
+		if( ( row[ set->attrs ] = strdup( cell ) ) == NULL ) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+	write rows from first to end of a dataset as CSV with a header line
+	returns 0 or -1 if file cannot be written
+*/
+static int check_write( const char *path, char **data, char **names, long cols, long first, long end )
+{
+	FILE				*fp				= fopen( path, "w" );
+	long				i, col;
+
+	if( fp == NULL ) {
+		return -1;
+	}
+	for( col = 0; col < cols; col++ ) {
+		fprintf( fp, "%s%c", names[ col ], col < cols - 1 ? ',' : '\n' );
+	}
+	for( i = first; i < end; i++ ) {
+		for( col = 0; col < cols; col++ ) {
+			fprintf( fp, "%s%c", data[ i * cols + col ], col < cols - 1 ? ',' : '\n' );
+		}
+	}
+
+	return ( fclose( fp ) == 0 ) ? 0 : -1;
+}
+
+/*
+	compare flat tree of a model with the reference one and print the outcome
+	returns 0 if they are the same, 1 otherwise
+*/
+static int check_same( const char *set, const char *what, int result, const id3_model_t *model, const id3_model_t *reference )
+{
+	int					same;
+
+	same = ( result == 0 && model != NULL && model->flat.size == reference->flat.size && model->flat.root == reference->flat.root &&
+		!memcmp( model->flat.nodes, reference->flat.nodes, sizeof( int32_t ) * model->flat.size ) );
+	if( result != 0 ) {
+		printf( "%-12s %-24s FAILED (%d)\n", set, what, result );
+	} else {
+		printf( "%-12s %-24s %s\n", set, what, same ? "same" : "DIFFERENT" );
+	}
+
+	return !same;
+}
+
+/*
+	train on shards of a dataset held by worker processes, one file of rows each
+	returns value of id3_train_workers, -2 if a worker fails
+*/
+static int check_workers( id3_model_t **model, const char *dir, const id3_params_t *params )
+{
+	char				paths[ CHECK_WORKERS ][ 512 ];
+	char				addresses[ CHECK_WORKERS ][ 512 ];
+	const char			*list[ CHECK_WORKERS ];
+	id3_data_t			*data			= NULL;
+	pid_t				pids[ CHECK_WORKERS ];
+	long				worker;
+	int					status, result;
+
+	for( worker = 0; worker < CHECK_WORKERS; worker++ ) {
+		sprintf( paths[ worker ], "%s/shard%ld.csv", dir, worker );
+		sprintf( addresses[ worker ], "unix:%s/worker%ld.sock", dir, worker );
+		list[ worker ] = addresses[ worker ];
+		if( ( pids[ worker ] = fork() ) == 0 ) {
+			if( id3_data_load( &data, paths[ worker ], ',', -1 ) != 0 ) {
+				_exit( 1 );
+			}
+			result = id3_worker_serve( data, addresses[ worker ] );
+			id3_data_destroy( data );
+			_exit( result != 0 );
+		}
+	}
+
+	result = id3_train_workers( model, list, CHECK_WORKERS, params );
+	for( worker = 0; worker < CHECK_WORKERS; worker++ ) {
+		if( pids[ worker ] < 0 || waitpid( pids[ worker ], &status, 0 ) < 0 || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+			result = ( result != 0 ) ? result : -2;
+		}
+		sprintf( paths[ worker ], "%s/worker%ld.sock", dir, worker );
+		unlink( paths[ worker ] );
+	}
+
+	return result;
+}
+
+/*
+	train a dataset every way and compare each tree with the serial one
+	returns number of differences, -1 on memory error
+*/
+static int check_set( const check_set_t *set, const char *dir )
+{
+	id3_params_t		params;
+	id3_stats_t			stats;
+	id3_model_t			*reference		= NULL;
+	id3_model_t			*model			= NULL;
+	char				**data			= NULL;
+	char				**names			= NULL;
+	char				*numeric		= NULL;
+	char				path[ 512 ];
+	long				cols			= set->attrs + 1;
+	long				first, end, worker, i;
+	int					result, errors	= 0;
+
+	if( check_generate( set, &data, &names ) != 0 || ( numeric = calloc( cols, 1 ) ) == NULL ) {
+		errors = -1;
+	}
+	for( i = 0; errors == 0 && i < set->numeric; i++ ) {
+		numeric[ i ] = 1;
+	}
+	id3_params_init( &params );
+	params.numeric	= set->numeric > 0 ? numeric : NULL;
+	params.stats	= &stats;
+	memset( &stats, 0, sizeof( id3_stats_t ) );
+	if( errors == 0 && ( result = id3_train( &reference, data, cols, set->rows, names, &params ) ) != 0 ) {
+		printf( "%-12s %-24s FAILED (%d)\n", set->name, "serial", result );
+		errors = 1;
+	}
+	params.stats = NULL;
+
+	// duplicate rows are collapsed by the serial training, the other ways are checked
+	// against it
+	if( errors == 0 && set->dup > 0 && stats.unique_rows >= set->rows ) {
+		printf( "%-12s %-24s NOT COLLAPSED\n", set->name, "serial" );
+		errors += 1;
+	}
+
+	if( errors == 0 ) {
+		params.threads	= CHECK_THREADS;
+		result			= id3_train( &model, data, cols, set->rows, names, &params );
+		errors			+= check_same( set->name, "threads", result, model, reference );
+		params.threads	= 1;
+		id3_destroy( model );
+		model = NULL;
+	}
+
+	// rows after the first batch are added in batches, numeric columns cannot be updated
+	if( errors == 0 && set->numeric == 0 ) {
+		params.update	= 1;
+		end				= set->rows / CHECK_UPDATES;
+		result			= id3_train( &model, data, cols, end, names, &params );
+		for( i = 1; result == 0 && i < CHECK_UPDATES; i++ ) {
+			first	= end;
+			end		= ( i == CHECK_UPDATES - 1 ) ? set->rows : set->rows * ( i + 1 ) / CHECK_UPDATES;
+			result	= id3_update( model, data + first * cols, end - first );
+		}
+		errors			+= check_same( set->name, "update", result, model, reference );
+		params.update	= 0;
+		id3_destroy( model );
+		model = NULL;
+	}
+
+	// out of core training reads the whole file, workers hold a shard of it each
+	for( worker = 0; errors >= 0 && worker < CHECK_WORKERS; worker++ ) {
+		sprintf( path, "%s/shard%ld.csv", dir, worker );
+		if( check_write( path, data, names, cols, set->rows * worker / CHECK_WORKERS, set->rows * ( worker + 1 ) / CHECK_WORKERS ) != 0 ) {
+			printf( "%-12s cannot write %s\n", set->name, path );
+			errors += 1;
+		}
+	}
+	sprintf( path, "%s/%s.csv", dir, set->name );
+	if( errors >= 0 && check_write( path, data, names, cols, 0, set->rows ) != 0 ) {
+		printf( "%-12s cannot write %s\n", set->name, path );
+		errors += 1;
+	}
+	if( errors >= 0 && reference != NULL ) {
+		params.memory	= CHECK_MEMORY;
+		params.spill_dir	= dir;
+		result			= id3_train_file( &model, path, ',', -1, &params );
+		errors			+= check_same( set->name, "out of core", result, model, reference );
+		id3_destroy( model );
+		model = NULL;
+
+		result			= check_workers( &model, dir, &params );
+		errors			+= check_same( set->name, "workers", result, model, reference );
+		id3_destroy( model );
+		model = NULL;
+	}
+	unlink( path );
+	for( worker = 0; worker < CHECK_WORKERS; worker++ ) {
+		sprintf( path, "%s/shard%ld.csv", dir, worker );
+		unlink( path );
+	}
+
+	if( errors >= 0 && reference != NULL ) {
+		sprintf( path, "%s/%s.id3", dir, set->name );
+		result = id3_model_save( reference, path );
+		if( result == 0 ) {
+			result = id3_model_load( &model, path );
+		}
+		errors += check_same( set->name, "save / load", result, model, reference );
+		id3_destroy( model );
+		unlink( path );
+	}
+
+	id3_destroy( reference );
+	for( i = 0; data != NULL && i < set->rows * cols; i++ ) {
+		free( data[ i ] );
+	}
+	for( i = 0; names != NULL && i < cols; i++ ) {
+		free( names[ i ] );
+	}
+	free( data );
+	free( names );
+	free( numeric );
+
+	return errors;
+}
+
+int main( void )
+{
+	const char			*tmp			= getenv( "TMPDIR" );
+	char				dir[ 256 ];
+	long				i;
+	int					errors			= 0;
+	int					result;
+
+	snprintf( dir, sizeof( dir ), "%s/id3_check_XXXXXX", ( tmp != NULL && *tmp ) ? tmp : "/tmp" );
+	if( mkdtemp( dir ) == NULL ) {
+		printf( "Cannot create %s\n", dir );
+		return 1;
+	}
+	for( i = 0; i < CHECK_SETS; i++ ) {
+		if( ( result = check_set( check_sets + i, dir ) ) < 0 ) {
+			printf( "Error memory allocation\n" );
+			errors += 1;
+		} else {
+			errors += result;
+		}
+	}
+	rmdir( dir );
+
+	printf( "%s\n", errors ? "FAILED" : "all trees are the same" );
+	return errors ? 1 : 0;
+}
@@ -31,8 +31,14 @@
 #include <string.h>
 #include <stdarg.h>
 #include <math.h>
+#include <unistd.h>
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+	#include <immintrin.h>
+	#define	ID3_AVX2
+#endif
 
 #include "id3.h"
+#include "id3_int.h"
 
 // uncomment / comment define to enable / disable fully verbose debug
 //#define DO_DEBUG
@@ -43,742 +49,1620 @@
 	#define	DEBUG(...) do{}while(0);
 #endif
 
-
-/*
-    string / value data
-*/
-struct dsinfo_t {
-    char            	*name;
-    long            	value;
-	long				column;
-    struct dsinfo_t   	*next;
-    struct dsinfo_t   	*prev;
-} dsinfo_t;
-
-/*
-	node data
-*/
-typedef struct node_tag {
-	long				winvalue;
-	long				tot_attrib;
-	long				*avail_attrib;
-	long				tot_samples;
-	long				*samples;
-	long				tot_nodes;
-	struct node_tag	*nodes;
-} node_t;
-
-/*
-	first scan of decision tree to gather information about max depth of branches and
-	about maximum number of created rules
-*/
-static void scan_tree( node_t *node, long *max_depth, long *max_rules  )
-{
-	static int depth = 0;
-	int j, i;
-
-	// this is a recursive funcion, if node is null return to upper level
-	if( node != NULL ) {
-        // increase current depth
-		depth += 1;
-		// store max branches' depth
-		if( depth > *max_depth ) {
-            *max_depth = depth;
+
+// nodes with fewer samples are built inline by the worker that split their parent,
+// bigger ones are queued on thread pool as independent subtrees
+#define	PARALLEL_MIN_SAMPLES	2048
+
+// nodes with at least these samples have their attributes evaluated by several workers
+#define	SPLIT_MIN_SAMPLES		65536
+
+struct train_tag;
+struct build_tag;
+
+/*
+	read codes of a contiguous run of rows of a column
+*/
+typedef void ( *load_func_t )( const void *column, int width, long first, long tot, uint32_t *codes );
+
+/*
+	count value x class cells of an attribute from bitmaps of a node, words first..last
+*/
+typedef void ( *bits_func_t )( struct build_tag *bld, long attrib, long first, long last );
+
+/*
+	build bitmaps of values of a column from word first on
+*/
+typedef void ( *fill_func_t )( const uint8_t *codes, long rows, long tot_values, uint64_t *bits, long tot_words, long first );
+
+/*
+	range of attributes of a node evaluated by a worker of thread pool
+*/
+typedef struct split_tag {
+	struct build_tag	*bld;			// worker owning node, count tables are its own
+	const node_t		*node;
+	const long			*attribs;		// attributes to evaluate
+	long				tot_attribs;
+	double				entropy_set;
+} split_t;
+
+/*
+	training state of a worker; scratch buffers are allocated once and reused by split
+	evaluation of each node built by the worker
+*/
+typedef struct build_tag {
+	const dataset_t		*ds;
+	struct train_tag	*train;			// state shared by all workers
+	long				worker;			// index of worker into thread pool
+	long				tot_attrib;		// attributes ( cols - 1 )
+	long				tot_classes;
+	long				*voffset;		// first value of each attribute into scratch tables
+	long				*counts;		// value x class table of each attribute
+	long				*totals;		// samples of each value of each attribute
+	long				*present;		// values found at current node for each attribute
+	long				*tot_present;	// number of values found for each attribute
+	long				*class_counts;	// samples of each class
+	long				tot_weight;		// samples of current node, weights of its rows summed
+	long				*attribs;		// attributes evaluated at current node
+	double				*gains;			// info gain of each attribute
+	long				*thresholds;	// best threshold of each numeric attribute, -1 if none
+	long				*position;		// write position of each child while partitioning
+	long				*sorted;		// samples of a node grouped by value while partitioning
+	char				*avail;			// attributes still available along current branch
+	split_t				*splits;		// attribute ranges of a node evaluated in parallel
+	load_func_t			load;			// code reading kernel chosen for this cpu
+	bits_func_t			count_bits;		// bitmap counting kernel chosen for this cpu
+	uint64_t			*node_bits;		// samples of current node as a bitmap
+	char				*use_bits;		// attributes of current node counted by bitmaps
+	arena_t				arena;			// memory of tree nodes created by the worker
+	long				depth;			// depth of node being built
+	id3_stats_t			stats;			// counters and timers of the worker
+} build_t;
+
+/*
+	state shared by workers building a tree
+*/
+typedef struct train_tag {
+	const dataset_t		*ds;
+	pool_t				*pool;			// NULL for serial training
+	build_t				*builds;		// state of each worker
+	long				tot_builds;
+	long				*samples;		// sample index buffer, nodes own a slice of it
+	uint64_t			*bitmaps;		// samples of each value of low cardinality attributes and
+										// of each class, NULL if there are no such attributes
+	long				*boffset;		// first bitmap of each column, -1 for columns without
+	long				tot_words;		// words of each bitmap
+	const double *const	*numbers;		// code -> number of numeric attributes, NULL if none is
+	long				**lists;		// samples of each numeric attribute sorted by value, NULL for
+										// other attributes; a node owns the slice at the offset of its
+										// samples into sample buffer, children keep order of parent
+	uint32_t			*child_of;		// child of each sample of a node being partitioned
+	long				features;		// attributes drawn at random at each node, 0 if all are evaluated
+	uint64_t			seed;			// seed of random draws of attributes
+	long				max_depth;		// depth of terminal nodes of majority class, 0 for no limit
+	long				min_leaf;		// samples each child of a split needs at least, 0 or 1 for
+										// no limit
+	int					error;			// set by a worker on memory error
+	int					timed;			// phases of nodes are timed ( statistics enabled )
+} train_t;
+
+/*
+	subtree queued on thread pool, it carries attributes available along its branch
+*/
+typedef struct subtree_tag {
+	train_t				*train;
+	node_t				*node;
+	long				depth;
+	char				avail[];
+} subtree_t;
+
+// samples processed together by split evaluation: their class codes are read once
+// and kept in cache while each attribute column is counted
+#define	COUNT_BLOCK		256
+
+// attributes with few values get a bitmap of samples for each value, classes too
+// when they are few: cells of count tables are then popcounts of bitmap ANDs.
+// Columns with bitmaps have 1 byte codes
+#define	BITMAP_MAX_VALUES		16
+#define	BITMAP_MIN_ROWS			4096
+
+// words of bitmaps counted together, class bitmaps stay in cache across values
+#define	BITMAP_BLOCK			256
+
+// a node counts an attribute by bitmaps when words x cells of its span are at most
+// its samples ( a word AND + popcount costs about as much as reading a sample )
+#define	BITMAP_RATIO			1
+
+/*
+	read codes of a contiguous run of rows, portable kernel
+*/
+static void load_codes( const void *column, int width, long first, long tot, uint32_t *codes )
+{
+	long				k;
+
+	switch( width ) {
+	case 1:
+		for( k = 0; k < tot; k++ ) {
+			codes[ k ] = ( ( const uint8_t* )column )[ first + k ];
 		}
-		// store max number of found rules
-		if( node->tot_nodes == 0 ) {
-            *max_rules += 1;
+		break;
+	case 2:
+		for( k = 0; k < tot; k++ ) {
+			codes[ k ] = ( ( const uint16_t* )column )[ first + k ];
 		}
+		break;
+	default:
+		memcpy( codes, ( const uint32_t* )column + first, sizeof( uint32_t ) * tot );
+		break;
+	}
+}
+
+#ifdef ID3_AVX2
+/*
+	read codes of a contiguous run of rows, 8 codes are widened at a time
+*/
+__attribute__(( target( "avx2" ) ))
+static void load_codes_avx2( const void *column, int width, long first, long tot, uint32_t *codes )
+{
+	long				k				= 0;
 
-		j = 0;
-		while( j < node->tot_nodes ) {
-            // go deep...
-			scan_tree( node->nodes+j, max_depth, max_rules );
-            // decrease current depth
-			depth -= 1;
-			++j;
+	switch( width ) {
+	case 1:
+		for( ; k + 8 <= tot; k += 8 ) {
+			_mm256_storeu_si256( ( __m256i* )( codes + k ),
+				_mm256_cvtepu8_epi32( _mm_loadl_epi64( ( const __m128i* )( ( const uint8_t* )column + first + k ) ) ) );
+		}
+		break;
+	case 2:
+		for( ; k + 8 <= tot; k += 8 ) {
+			_mm256_storeu_si256( ( __m256i* )( codes + k ),
+				_mm256_cvtepu16_epi32( _mm_loadu_si128( ( const __m128i* )( ( const uint16_t* )column + first + k ) ) ) );
 		}
+		break;
 	}
+	load_codes( column, width, first + k, tot - k, codes + k );
 }
+#endif
 
 /*
-	second scan of decision tree to gather rules for each class
+	choose kernel reading contiguous codes by features of running cpu
 */
-static void scan_rules( node_t *node, long class_id, long *depth, long *path, long maxdepth, long *table, long *tid )
+static load_func_t load_select( void )
 {
-	int j, i;
-
-	// this is a recursive funcion, if node is null returns to upper level
-	if( node != NULL ) {
-        // increase depth
-		*depth += 1;
+#ifdef ID3_AVX2
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "avx2" ) ) {
+		return load_codes_avx2;
+	}
+#endif
+	return load_codes;
+}
+
+/*
+	bitmap counting kernel: samples of node and of each value are ANDed a word at a time,
+	popcounts with class bitmaps give cells of all classes but last one, which is the
+	difference from value total; values are found in code order
+*/
+static inline __attribute__(( always_inline )) void count_bits_body( build_t *bld, long attrib, long first, long last )
+{
+	const train_t		*train			= bld->train;
+	long				tot_words		= train->tot_words;
+	long				tot_classes		= bld->tot_classes;
+	long				tot_values		= DS_VALUES( bld->ds, attrib );
+	const uint64_t		*node_bits		= bld->node_bits;
+	const uint64_t		*class_bits		= train->bitmaps + train->boffset[ bld->ds->cols - 1 ] * tot_words;
+	const uint64_t		*value_bits		= NULL;
+	long				*counts			= bld->counts + bld->voffset[ attrib ] * tot_classes;
+	long				*totals			= bld->totals + bld->voffset[ attrib ];
+	long				*present		= bld->present + bld->voffset[ attrib ];
+	long				cells[ BITMAP_MAX_VALUES ];
+	long				tot_present		= 0;
+	long				block, end, value, total, w, k;
+	uint64_t			bits;
+
+	for( block = first; block <= last; block += BITMAP_BLOCK ) {
+		end = ( last + 1 - block < BITMAP_BLOCK ) ? last + 1 : block + BITMAP_BLOCK;
+		for( value = 0; value < tot_values; value++ ) {
+			value_bits	= train->bitmaps + ( train->boffset[ attrib ] + value ) * tot_words;
+			total		= 0;
+			memset( cells, 0, sizeof( long ) * tot_classes );
+			for( w = block; w < end; w++ ) {
+				bits	= node_bits[ w ] & value_bits[ w ];
+				total	+= __builtin_popcountll( bits );
+				for( k = 0; k + 1 < tot_classes; k++ ) {
+					cells[ k ] += __builtin_popcountll( bits & class_bits[ k * tot_words + w ] );
+				}
+			}
+			totals[ value ] += total;
+			for( k = 0; k + 1 < tot_classes; k++ ) {
+				counts[ value * tot_classes + k ] += cells[ k ];
+			}
+		}
+	}
 
-		// update current path
-		*( path + ( *depth - 1 ) ) = node->winvalue;
+	for( value = 0; value < tot_values; value++ ) {
+		total = totals[ value ];
+		for( k = 0; k + 1 < tot_classes; k++ ) {
+			total -= counts[ value * tot_classes + k ];
+		}
+		counts[ value * tot_classes + tot_classes - 1 ] = total;
+		if( totals[ value ] > 0 ) {
+			present[ tot_present++ ] = value;
+		}
+	}
+	bld->tot_present[ attrib ] = tot_present;
+}
 
-		// check if this is the last node of the branch
-		if( node->tot_nodes == 0 && node->winvalue == class_id ) {
+static void count_bits( build_t *bld, long attrib, long first, long last )
+{
+	count_bits_body( bld, attrib, first, last );
+}
 
-			for( i = 0; i < *( depth )-1; i++ ) {
-				*( table + ( ( *tid ) * maxdepth ) + i ) = path[ i ];
-			}
-            *( tid ) +=1;
+#ifdef ID3_AVX2
+__attribute__(( target( "popcnt" ) ))
+static void count_bits_popcnt( build_t *bld, long attrib, long first, long last )
+{
+	count_bits_body( bld, attrib, first, last );
+}
+#endif
+
+/*
+	choose bitmap counting kernel by features of running cpu
+*/
+static bits_func_t bits_select( void )
+{
+#ifdef ID3_AVX2
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "popcnt" ) ) {
+		return count_bits_popcnt;
+	}
+#endif
+	return count_bits;
+}
+
+/*
+	read codes of a block of samples; samples of a node are always in increasing order
+	( partition keeps their order ) so a block spanning as many rows as its samples is
+	a contiguous run, as all blocks of root node are, and is read with vector loads
+*/
+static void gather_codes( const build_t *bld, long col, const long *block, long tot, uint32_t *codes )
+{
+	const void			*column			= bld->ds->columns[ col ];
+	long				k;
+
+	if( block[ tot - 1 ] - block[ 0 ] == tot - 1 ) {
+		bld->load( column, bld->ds->widths[ col ], block[ 0 ], tot, codes );
+		return;
+	}
+	switch( bld->ds->widths[ col ] ) {
+	case 1:
+		for( k = 0; k < tot; k++ ) {
+			codes[ k ] = ( ( const uint8_t* )column )[ block[ k ] ];
 		}
-
-        // scan every possible branch of this node
-		j = 0;
-		while( j < node->tot_nodes ) {
-            // scan branch
-			scan_rules( node->nodes+j, class_id, depth, path, maxdepth, table, tid );
-            // decrease current depth
-			*depth -= 1;
-			// go to next branch
-			++j;
-		}
-	}
-}
-
-/*
-	extract rules from decision tree
-*/
-static void explain_rules( node_t *node, long cols, struct dsinfo_t *info, char **column_names, long maxdepth, long maxrules )
-{
-	struct dsinfo_t 	*infoptr 		= info;
-	struct dsinfo_t 	*infoptr2 		= NULL;
-	long				*rules_table	= NULL;
-	long				tableins_id		= 0;
-	long				rulestable_sz	= 0;
-	long				*temp_path		= NULL;
-	long				attrb			= 0;
-	long				attrb_id		= 0;
-	long				*attrb_name		= 0;
-	long				depth			= 0;
-	long				i, j, k;
-
-	// allocate memory for rules
-	rulestable_sz 	= sizeof( long ) * maxdepth * maxrules;
-	rules_table 	= malloc( rulestable_sz );
-	temp_path 		= malloc( sizeof( long ) * maxdepth );
-
-	printf( "Found rules:\n\n");
-	while( infoptr->next != NULL ) {
-		if( infoptr->column == ( cols - 1 ) ) {
-			printf( "Class %s\n", infoptr->name );
-
-			i = 0;
-			while( i < ( maxdepth * maxrules ) ) {
-				*( rules_table + i ) = -1;
-				++i;
-			}
-
-			for( i = 0; i < maxdepth; i++ )	{
-                temp_path[ i ] = -1;
-			}
-			depth 		= 0;
-			tableins_id = 0;
-
-			scan_rules( node, infoptr->value, &depth, temp_path, maxdepth, rules_table, &tableins_id );
-
-			/*
-				Class (4): NO
-								-1  0  2 -1
-								-1  8  5 -1
-								-1 -1 -1 -1
-								-1 -1 -1 -1
-								-1 -1 -1 -1
-				Class (7): YES
-								-1  0 11 -1
-								-1  6 -1 -1
-								-1  8  3 -1
-								-1 -1 -1 -1
-								-1 -1 -1 -1
-			*/
-			// print found rules for current class
-			printf("\t\t");
-			for( i = 0; i < maxrules; i++ ) {
-				for( j = 0; j < (maxdepth-1); j++ ) {
-					attrb = *( rules_table + i * maxdepth + j );
-					if( attrb >= 0 ) {
-						attrb_id 	= 0;
-						infoptr2 	= info;
-						while( infoptr2 != NULL ) {
-							if( attrb == infoptr2->value ) {
-								attrb_id 	= infoptr2->column;
-								attrb_name 	= infoptr2->name;
-								break;
-							}
-							infoptr2 = infoptr2->next;
-						}
-
-						printf( "if %s = %s ", column_names[ attrb_id ], attrb_name );
-						if( *( rules_table + i * maxdepth + j + 1 ) >= 0 ) {
-                            printf( "and " );
-						} else {
-                            printf( "\n\t\t" );
-						}
+		break;
+	case 2:
+		for( k = 0; k < tot; k++ ) {
+			codes[ k ] = ( ( const uint16_t* )column )[ block[ k ] ];
+		}
+		break;
+	default:
+		for( k = 0; k < tot; k++ ) {
+			codes[ k ] = ( ( const uint32_t* )column )[ block[ k ] ];
+		}
+		break;
+	}
+}
+
+/*
+	count samples of each class, it is enough to know if a node must be split; weighted
+	rows count as many samples as they stand for
+*/
+static void count_classes( build_t *bld, const long *samples, long totsamples )
+{
+	const dataset_t		*ds				= bld->ds;
+	long				classcol		= ds->cols - 1;
+	long				i;
+
+	bld->tot_weight = totsamples;
+	if( ds->weights != NULL ) {
+		for( i = 0, bld->tot_weight = 0; i < totsamples; i++ ) {
+			bld->class_counts[ ds_code( ds, classcol, samples[ i ] ) ] += ds->weights[ samples[ i ] ];
+			bld->tot_weight += ds->weights[ samples[ i ] ];
+		}
+		return;
+	}
+	for( i = 0; i < totsamples; i++ ) {
+		bld->class_counts[ ds_code( ds, classcol, samples[ i ] ) ] += 1;
+	}
+}
+
+/*
+	split evaluation kernel: a single pass over samples of a node fills value x class
+	count tables of given attributes. When node has many samples compared to values of
+	an attribute, the whole catalog is likely found: only value x class cells are counted
+	and totals of values are summed from them at the end. Weighted rows add their weight
+	- bld:			training state
+	- attribs:		attributes to count
+	- tot_attribs:	number of attributes to count
+	- samples:		sample array
+	- totsamples:	total samples
+*/
+static void count_samples( build_t *bld, const long *attribs, long tot_attribs, const long *samples, long totsamples )
+{
+	const dataset_t		*ds				= bld->ds;
+	long				tot_classes		= bld->tot_classes;
+	long				classcol		= ds->cols - 1;
+	uint32_t			classes[ COUNT_BLOCK ];
+	uint32_t			values[ COUNT_BLOCK ];
+	long				weights[ COUNT_BLOCK ];
+	const long			*block			= NULL;
+	long				*counts, *totals, *present;
+	long				tot_present;
+	long				attrib, value;
+	long				tot, i, j, k;
+
+	for( i = 0; i < totsamples; i += COUNT_BLOCK ) {
+		block	= samples + i;
+		tot		= ( totsamples - i < COUNT_BLOCK ) ? totsamples - i : COUNT_BLOCK;
+
+		// class of each sample of the block
+		gather_codes( bld, classcol, block, tot, classes );
+		for( k = 0; ds->weights != NULL && k < tot; k++ ) {
+			weights[ k ] = ds->weights[ block[ k ] ];
+		}
+
+		// count every attribute on the same block
+		for( j = 0; j < tot_attribs; j++ ) {
+			attrib		= attribs[ j ];
+			if( bld->use_bits[ attrib ] || bld->train->lists[ attrib ] != NULL ) {
+				continue;
+			}
+			counts		= bld->counts + bld->voffset[ attrib ] * tot_classes;
+			totals		= bld->totals + bld->voffset[ attrib ];
+			present		= bld->present + bld->voffset[ attrib ];
+			tot_present	= bld->tot_present[ attrib ];
+
+			gather_codes( bld, attrib, block, tot, values );
+			if( ds->weights != NULL ) {
+				for( k = 0; k < tot; k++ ) {
+					value = values[ k ];
+					if( totals[ value ] == 0 ) {
+						present[ tot_present++ ] = value;
 					}
+					totals[ value ]								+= weights[ k ];
+					counts[ value * tot_classes + classes[ k ] ]	+= weights[ k ];
+				}
+				bld->tot_present[ attrib ] = tot_present;
+				continue;
+			}
+			if( totsamples >= DS_VALUES( ds, attrib ) * tot_classes ) {
+				for( k = 0; k < tot; k++ ) {
+					counts[ values[ k ] * tot_classes + classes[ k ] ] += 1;
 				}
+				continue;
+			}
+			for( k = 0; k < tot; k++ ) {
+				value = values[ k ];
+				if( totals[ value ]++ == 0 ) {
+					present[ tot_present++ ] = value;
+				}
+				counts[ value * tot_classes + classes[ k ] ] += 1;
+			}
+			bld->tot_present[ attrib ] = tot_present;
+		}
+	}
+
+	// totals and found values of attributes counted by cells
+	for( j = 0; j < tot_attribs; j++ ) {
+		attrib = attribs[ j ];
+		if( bld->use_bits[ attrib ] || bld->train->lists[ attrib ] != NULL || ds->weights != NULL ||
+			totsamples < DS_VALUES( ds, attrib ) * tot_classes ) {
+			continue;
+		}
+		counts		= bld->counts + bld->voffset[ attrib ] * tot_classes;
+		totals		= bld->totals + bld->voffset[ attrib ];
+		present		= bld->present + bld->voffset[ attrib ];
+		tot_present	= 0;
+		for( value = 0; value < DS_VALUES( ds, attrib ); value++ ) {
+			for( k = 0; k < tot_classes; k++ ) {
+				totals[ value ] += counts[ value * tot_classes + k ];
+			}
+			if( totals[ value ] > 0 ) {
+				present[ tot_present++ ] = value;
 			}
-			printf("\n");
 		}
-		infoptr = infoptr->next;
+		bld->tot_present[ attrib ] = tot_present;
 	}
+}
+
+/*
+	compare two values for qsort
+*/
+static int cmp_long( const void *a, const void *b )
+{
+	long				x = *( const long* )a;
+	long				y = *( const long* )b;
 
-	free( temp_path );
-	free( rules_table );
+	return ( x > y ) - ( x < y );
 }
 
 /*
-	calculate entropy of sample
-	- data: 		pointer to database
-	- cols:			number of columns (attributes + class)
-	- sample:		sample array
+	calculate entropy of sample from its class counts
+	- class_counts:	samples of each class
+	- tot_classes:	total classes
 	- totsamples:	total samples
-	- info:			class / attributes information
 */
-static double calc_entropy_set( long *data, long cols, long *samples, long totsamples, struct dsinfo_t *info )
+double calc_entropy_set( const long *class_counts, long tot_classes, long totsamples )
 {
-	double 			entropy		= 0;
+	double 				entropy		= 0;
 	double				part		= 0;
-	long				total		= 0;
-	struct dsinfo_t  	*infoptr	= NULL;
 	long				j;
 
-	// search index of classes
-	infoptr = info;
-	while( infoptr != NULL ) {
-		// when we found a class...
-		if( infoptr->column == ( cols - 1 ) ) {
-            // calculate entropy of database sample
-			total = 0;
-			for( j = 0; j < totsamples; j++ )
-				if( data[ samples[ j ]*cols + cols - 1 ] == infoptr->value ) {
-                    ++total;
-				}
-			// calculate rate
-			if( total > 0 && totsamples > 0 ) {
-				part	= (double)total / (double)totsamples;
-				// sum class entropy to total entropy according to formula
-				// Entropy = -p(I) log2( p(I) )
-				entropy += ( -part * log2(part) );
-			}
+	for( j = 0; j < tot_classes; j++ ) {
+		// calculate rate
+		if( class_counts[ j ] > 0 && totsamples > 0 ) {
+			part	= (double)class_counts[ j ] / (double)totsamples;
+			// sum class entropy to total entropy according to formula
+			// Entropy = -p(I) log2( p(I) )
+			entropy += ( -part * log2(part) );
 		}
-		// proceed research
-		infoptr = infoptr->next;
 	}
 
 	return entropy;
 }
 
 /*
-	calculate info gain for each attribute
+	calculate info gain of an attribute ( without entropy of set ) from its value x class
+	count table; present values must be in code order so that every engine counting the
+	same samples gets the same result
+	- counts:		samples of each value x class
+	- totals:		samples of each value
+	- present:		values with samples, in increasing order
 */
-static double calc_attrib_gain( long *data, long cols, long *samples, long totsamples, struct dsinfo_t *info, long attrib )
+double calc_counts_gain( const long *counts, const long *totals, const long *present, long tot_present, long tot_classtype, long totsamples )
 {
-	struct dsinfo_t  	*infoptr 		= NULL;
-	long				tot_attribtype 	= 0;
-	long				tot_classtype	= 0;
 	double 			    gain 			= 0;
 	double				vpcgain			= 0;
 	double				part			= 0;
-	long				size			= 0;
-	long				attrvalue		= 0;
-	long				*classlist		= NULL;
-	long				i = 0, j, k;
-
-	struct vpc_t {
-		long			class_id;
-		long			tot_found;
-	};
-
-	struct gdata_t {
-		long			value;
-		long			tot_found;
-		struct vpc_t	*vpc;
-	};
-	struct gdata_t		*gdata, *gdataptr;
-	struct	vpc_t		*vpcptr;
-
-	// calculate total possible values for attributes and classes
-	infoptr = info;
-	while( infoptr != NULL ) {
-		// sum of all possible values of attribute
-		if( infoptr->column == attrib ) {
-            ++tot_attribtype;
-		}
-		// sum of all possible values of class
-		if( infoptr->column == ( cols - 1 ) ) {
-            ++tot_classtype;
-		}
-		// proceed research
-		infoptr = infoptr->next;
-	}
-
-	// classlist array contains all possible classes
-	classlist = malloc( sizeof( long ) * tot_classtype );
-	infoptr = info , i = 0;
-	while( infoptr != NULL ) {
-		if( infoptr->column == ( cols - 1 ) ) {
-            *( classlist + i++ ) = infoptr->value;
-		}
-		infoptr = infoptr->next;
-	}
-
-	// allocate memory for structure of each type of value of attribute
-	size 	= sizeof( struct gdata_t ) * tot_attribtype;
-	gdata 	= malloc( size );
-	memset( gdata, 0, size );
-
-	// initialize structure for each attribute's value
-	i = 0, infoptr = info;
-	while( infoptr != NULL ) {
-		if( infoptr->column == attrib ) {
-			gdataptr 				= gdata + i;
-			gdataptr->value 		= infoptr->value;
-			gdataptr->tot_found 	= 0;
-
-			size = sizeof( struct vpc_t ) * tot_classtype;
-			gdataptr->vpc 			= malloc( size );
-
-			for( j = 0; j < tot_classtype; j++ ) {
-				vpcptr 				= gdataptr->vpc + j;
-				vpcptr->class_id	= *( classlist + j );
-				vpcptr->tot_found	= 0;
-			}
-			++i;
-		}
-		// go on with search
-		infoptr = infoptr->next;
-	}
-
-	// collect sample data about number of values for each attribute; moreover we calculate
-	// how many value belong to a class or to another class
-	for( i = 0; i < totsamples; i++ ) {
-		for( j = 0; j < tot_attribtype; j++ ) {
-			gdataptr = gdata + j;
-			if( gdataptr->value == data[ samples[ i ]*cols + attrib ] ) {
-				gdataptr->tot_found += 1;
-				for( k = 0; k < tot_classtype; k++ ) {
-					vpcptr = gdataptr->vpc;
-					if( data[ samples[ i ]*cols + cols - 1 ] == ( vpcptr+k )->class_id )
-							( vpcptr+k )->tot_found += 1;
-				}
-			}
-		}
-	}
+	long				i, j, value;
 
 	// calculate information gain
-	for( i = 0; i < tot_attribtype; i++ ) {
-		gdataptr 	= gdata + i;
+	for( i = 0; i < tot_present; i++ ) {
+		value 		= present[ i ];
 		vpcgain		= 0;
 
 		for( j = 0; j < tot_classtype; j++ ) {
-			vpcptr 	= 	gdataptr->vpc + j;
-			if( vpcptr->tot_found > 0 && gdataptr->tot_found > 0 ) {
-				part	= 	(double)vpcptr->tot_found / (double)gdataptr->tot_found;
+			if( counts[ value * tot_classtype + j ] > 0 ) {
+				part	= 	(double)counts[ value * tot_classtype + j ] / (double)totals[ value ];
 				vpcgain +=	( -( part ) * log2( part ) );
 			}
  		}
-		if( gdataptr->tot_found > 0 && totsamples > 0 ) {
-			part	= (double) gdataptr->tot_found / (double) totsamples;
+		if( totsamples > 0 ) {
+			part	= (double) totals[ value ] / (double) totsamples;
 			gain 	+= ( -( part ) * vpcgain );
 		}
 	}
 
-	// free all allocated memory
-	for( i = 0; i < tot_attribtype; i++ ) {
-		gdataptr = gdata + i;
-		free( gdataptr->vpc );
-	}
-	free( gdata );
-	free( classlist );
-
 	return 	gain;
 }
 
 /*
-	create tree nodes
+	calculate info gain of an attribute from count tables of a node; values are visited
+	in code order so that result does not depend on order of samples
 */
-static void create_leaves( node_t *node, long *data, long cols, long rows, struct dsinfo_t *info )
+static double calc_attrib_gain( build_t *bld, long attrib, long totsamples )
 {
-	struct dsinfo_t  	*infoptr 		= NULL;
-	double 			    entropy_set 	= 0;
-	double				*gains			= NULL;
-	double				max_gain		= 0;
-	long				max_gain_id		= 0;
-	long				gbuf_sz			= 0;
-	long				max_attr_values	= 0;
-	long				tot_new_samples	= 0;
-	long				tot_avattrib	= 0;
-	long				*sampleptr		= NULL;
-	node_t				*node_ptr		= NULL;
-	node_t				*new_node		= NULL;
-	long				j, i;
-
-	struct smplid_t
-	{
-		long 				value;
-		struct smplid_t 	*next;
-		struct smplid_t 	*prev;
-	};
-
-	struct smplid_t	*samplelist		= NULL;
-	struct smplid_t	*samplelistptr	= NULL;
-	struct smplid_t	*samplelistprv	= NULL;
-
-
-	DEBUG( "Current node @ %p:\n", node );
-	DEBUG( "\twinvalue        : %d\n", node->winvalue );
-	DEBUG( "\ttot_samples     : %d\n", node->tot_samples );
-	DEBUG( "\tsamples         : " );
-	for( i = 0; i < node->tot_samples; i++ )
-		DEBUG( "%-2d ", node->samples[ i ] );
-	DEBUG( "\n\ttot_attrib      : %d (%d %d %d %d )\n", node->tot_attrib, node->avail_attrib[0],node->avail_attrib[1],node->avail_attrib[2],node->avail_attrib[3] );
-	DEBUG( "\ttot_nodes       : %d\n", node->tot_nodes );
-	DEBUG( "\tnodes           @ %p\n", node->nodes );
+	long				tot_classtype	= bld->tot_classes;
+	long				tot_present		= bld->tot_present[ attrib ];
+	long				*counts			= bld->counts + bld->voffset[ attrib ] * tot_classtype;
+	long				*totals			= bld->totals + bld->voffset[ attrib ];
+	long				*present		= bld->present + bld->voffset[ attrib ];
+	long				i, value;
+
+	// few values found compared to catalog: sort them, otherwise scan the whole catalog
+	if( tot_present * 8 < DS_VALUES( bld->ds, attrib ) ) {
+		qsort( present, tot_present, sizeof( long ), cmp_long );
+	} else {
+		for( value = 0, i = 0; value < DS_VALUES( bld->ds, attrib ); value++ ) {
+			if( totals[ value ] > 0 ) {
+				present[ i++ ] = value;
+			}
+		}
+	}
 
+	return calc_counts_gain( counts, totals, present, tot_present, tot_classtype, totsamples );
+}
 
-	// calulate entropy of samples part
-	entropy_set = calc_entropy_set( data, cols, node->samples, node->tot_samples, info );
+/*
+	threshold search of a numeric attribute: samples of node sorted by value are walked
+	once moving them from right to left side, every change of value is a candidate
+	threshold and its gain comes from the two rows table of left and right side ( first
+	two rows of attribute's count table ). Lowest threshold wins ties; class counts of
+	node must be in class_counts. Weighted rows move their weight; thresholds leaving
+	less than min_leaf samples on a side are not candidates. Rows of both sides of best
+	threshold are left in totals as partition_samples expects them
+	returns info gain of best threshold, thresholds[ attrib ] is -1 if there is none
+*/
+static double eval_threshold( build_t *bld, long attrib, const node_t *node, double entropy_set )
+{
+	const dataset_t		*ds				= bld->ds;
+	const double		*numbers		= bld->train->numbers[ attrib ];
+	const long			*list			= bld->train->lists[ attrib ] + ( node->samples - bld->train->samples );
+	const long			*weights		= ds->weights;
+	long				tot_classes		= bld->tot_classes;
+	long				classcol		= ds->cols - 1;
+	long				*counts			= bld->counts + bld->voffset[ attrib ] * tot_classes;
+	long				*totals			= bld->totals + bld->voffset[ attrib ];
+	long				*present		= bld->present + bld->voffset[ attrib ];
+	double				max_gain		= 0;
+	double				gain, value, next;
+	long				best			= -1;
+	long				best_left		= 0;
+	long				left			= 0;
+	long				min_leaf		= bld->train->min_leaf;
+	long				weight, i, k;
+
+	present[ 0 ]				= 0;
+	present[ 1 ]				= 1;
+	bld->tot_present[ attrib ]	= 2;
+
+	value = numbers[ ds_code( ds, attrib, list[ 0 ] ) ];
+	for( i = 0; i < node->tot_samples - 1; i++ ) {
+		weight = ( weights != NULL ) ? weights[ list[ i ] ] : 1;
+		counts[ ds_code( ds, classcol, list[ i ] ) ] += weight;
+		left += weight;
+		next = numbers[ ds_code( ds, attrib, list[ i + 1 ] ) ];
+		if( next == value ) {
+			continue;
+		}
+		value = next;
+		if( left < min_leaf || bld->tot_weight - left < min_leaf ) {
+			continue;
+		}
+		totals[ 0 ] = left;
+		totals[ 1 ] = bld->tot_weight - left;
+		for( k = 0; k < tot_classes; k++ ) {
+			counts[ tot_classes + k ] = bld->class_counts[ k ] - counts[ k ];
+		}
+		gain = calc_counts_gain( counts, totals, present, 2, tot_classes, bld->tot_weight );
+		if( best < 0 || gain > max_gain ) {
+			max_gain	= gain;
+			best		= ds_code( ds, attrib, list[ i ] );
+			best_left	= i + 1;
+		}
+	}
+	totals[ 0 ]						= best_left;
+	totals[ 1 ]						= node->tot_samples - best_left;
+	bld->thresholds[ attrib ]		= best;
 
-	DEBUG( "Entropy set = %3.6f\n", entropy_set );
-
-	// value of entropy_set is crucial for deciding to proceed in branches creation:
-	// if zero it means that examined samples are perfectly classified, if one samples
-	// have no rules (are totally random); if the value is between zero and one we must
-	// proceed and calculate the Gain for each available attribute
-	if( entropy_set == 0.000f )	{
+	return entropy_set + max_gain;
+}
 
-		node->nodes 				= malloc( sizeof( node_t ) );
-		node->tot_nodes				= 1;
-		node->nodes->tot_nodes 		= 0;
-		node->nodes->winvalue 		= data[ node->samples[ 0 ] * cols + cols - 1 ];
-
-		node->nodes->tot_attrib		= 0;
-		node->nodes->avail_attrib	= NULL;
-		node->nodes->tot_samples	= 0;
-		node->nodes->samples		= NULL;
-		node->nodes->nodes			= NULL;
-
-		DEBUG( "\t\t\tTerminal node @ %p:\n", node->nodes );
-		DEBUG( "\t\t\twinvalue        : %d\n", node->nodes->winvalue );
-		DEBUG( "\t\t\ttot_samples     : %d\n", node->nodes->tot_samples );
-		DEBUG( "\t\t\ttot_attrib      : %d\n", node->nodes->tot_attrib );
-		DEBUG( "\t\t\ttot_nodes       : %d\n", node->nodes->tot_nodes );
-		DEBUG( "\t\t\tnodes           @ %p\n", node->nodes->nodes );
-	} else if( entropy_set == 1 ) {
-		// totally random data = no rule at all
-	} else {
-		// calculate total number of available attributes
-		tot_avattrib = 0;
-		for( j = 0; j < ( cols - 1 ); j++ ) {
-			if( node->avail_attrib[ j ] == 1 ) {
-                tot_avattrib += 1;
-			}
+/*
+	group samples of a node by value of split attribute: value totals of count tables give
+	position of each child inside node's slice of shared sample index buffer, then samples
+	are moved there keeping their order, so children samples are slices of parent's one.
+	With numeric attributes the value of each sample is kept for partition_lists
+*/
+static void partition_samples( build_t *bld, node_t *node, long attrib )
+{
+	const double		*numbers		= NULL;
+	uint32_t			*child_of		= bld->train->child_of;
+	long				*totals			= bld->totals + bld->voffset[ attrib ];
+	long				*position		= bld->position;
+	long				start			= 0;
+	long				i, value;
+
+	// weighted totals of values are rows once counted again
+	if( bld->ds->weights != NULL && node->threshold < 0 ) {
+		for( i = 0; i < node->tot_nodes; i++ ) {
+			totals[ node->nodes[ i ].winvalue ] = 0;
 		}
+		for( i = 0; i < node->tot_samples; i++ ) {
+			totals[ ds_code( bld->ds, attrib, node->samples[ i ] ) ] += 1;
+		}
+	}
+	for( i = 0; i < node->tot_nodes; i++ ) {
+		value							= node->nodes[ i ].winvalue;
+		node->nodes[ i ].samples		= node->samples + start;
+		node->nodes[ i ].tot_samples	= totals[ value ];
+		position[ value ]				= start;
+		start							+= totals[ value ];
+	}
 
-		DEBUG( "\tCalculate entropy for each attribute ( total available %d )\n", tot_avattrib );
-		// se c'e' piu' di un attributo disponibile
-		if( tot_avattrib > 0 ) {
-			// allocate memory for each attribute's gain
-			gains = malloc( sizeof( double ) * ( cols - 1 ) );
-			for( i = 0; i < ( cols - 1 ); i++ ) {
-                gains[ i ] = 0;
-			}
-            // calculate gain for each attribute
-			for( j = 0; j < ( cols - 1 ); j++ )
-				if( node->avail_attrib[ j ] == 1 ) {
-					gains[ j ] = entropy_set + calc_attrib_gain( data, cols, node->samples, node->tot_samples, info, j );
-					DEBUG( "\tInfo Gain for attribute %d = %3.3f\n", j, gains[ j ] );
-				}
-			// find highest value
-			for( j = 0; j < ( cols - 1 ); j++ ) {
-				if( gains[ j ] > max_gain ) {
-					max_gain	= gains[ j ];
-					max_gain_id = j;
-				}
-			}
-
-			// calcola il numero massimo possibile di valori per l'attributo vincente
-			// calculate maximum number of values for winning attribute
-			max_attr_values = 0;
-			infoptr 		= info;
-			while( infoptr != NULL ) {
-				if( infoptr->column == max_gain_id ) {
-                    ++max_attr_values;
-				}
-				infoptr = infoptr->next;
+	if( child_of == NULL ) {
+		for( i = 0; i < node->tot_samples; i++ ) {
+			value = ds_code( bld->ds, attrib, node->samples[ i ] );
+			bld->sorted[ position[ value ]++ ] = node->samples[ i ];
+		}
+	} else {
+		numbers = ( node->threshold >= 0 ) ? bld->train->numbers[ attrib ] : NULL;
+		for( i = 0; i < node->tot_samples; i++ ) {
+			value = ds_code( bld->ds, attrib, node->samples[ i ] );
+			if( numbers != NULL ) {
+				value = ( numbers[ value ] > numbers[ node->threshold ] );
 			}
-			DEBUG( "\tAttribute %d has maximum IG (%3.3f) and %d type of values\n", max_gain_id, max_gain, max_attr_values );
+			child_of[ node->samples[ i ] ]		= value;
+			bld->sorted[ position[ value ]++ ]	= node->samples[ i ];
+		}
+	}
+	memcpy( node->samples, bld->sorted, sizeof( long ) * node->tot_samples );
+}
 
-			// create node for each possible attribute value
-			// number of nodes is equel to all possible values for this attribute
-			node->nodes 	= ( node_t* ) malloc( sizeof( node_t ) * max_attr_values );
-			node->tot_nodes = max_attr_values;
-			DEBUG( "\tAllocate memory for %d nodes @ %p\n", max_attr_values, node->nodes );
+/*
+	move sorted samples of each numeric attribute into slices of children, in the same
+	way as partition_samples: sorted order is kept and no sort is needed below root
+*/
+static void partition_lists( build_t *bld, node_t *node )
+{
+	const train_t		*train			= bld->train;
+	long				*position		= bld->position;
+	long				*list			= NULL;
+	long				i, attrib;
+
+	for( attrib = 0; attrib < bld->tot_attrib; attrib++ ) {
+		if( train->lists[ attrib ] == NULL ) {
+			continue;
+		}
+		list = train->lists[ attrib ] + ( node->samples - train->samples );
+		for( i = 0; i < node->tot_nodes; i++ ) {
+			position[ node->nodes[ i ].winvalue ] = node->nodes[ i ].samples - node->samples;
+		}
+		for( i = 0; i < node->tot_samples; i++ ) {
+			bld->sorted[ position[ train->child_of[ list[ i ] ] ]++ ] = list[ i ];
+		}
+		memcpy( list, bld->sorted, sizeof( long ) * node->tot_samples );
+	}
+}
 
-			infoptr 		= info;
-			j = 0;
-			while( infoptr != NULL ) {
-				if( infoptr->column == max_gain_id ) {
-					DEBUG( "\t\tSetup node value %d for attribute %d\n", infoptr->value, max_gain_id );
+/*
+	clear count tables used by a node, only values found at node are touched
+*/
+static void reset_counts( build_t *bld, long tot_attribs )
+{
+	long				tot_classes		= bld->tot_classes;
+	long				attrib, value;
+	long				i, j;
+
+	for( j = 0; j < tot_attribs; j++ ) {
+		attrib = bld->attribs[ j ];
+		for( i = 0; i < bld->tot_present[ attrib ]; i++ ) {
+			value = bld->voffset[ attrib ] + bld->present[ bld->voffset[ attrib ] + i ];
+			bld->totals[ value ] = 0;
+			memset( bld->counts + value * tot_classes, 0, sizeof( long ) * tot_classes );
+		}
+		bld->tot_present[ attrib ] = 0;
+	}
+	memset( bld->class_counts, 0, sizeof( long ) * tot_classes );
+}
 
-					node_ptr 	= node->nodes;
-					node_ptr 	+= j;
-					DEBUG( "\t\t\tnode_ptr = %p ( j = %d )\n", node_ptr, j );
+/*
+	allocate split evaluation scratch for a dataset, numeric attributes only need the two
+	rows of a threshold in count tables
+*/
+static int build_init( build_t *bld, train_t *train )
+{
+	const dataset_t		*ds				= train->ds;
+	long				tot_values		= 0;
+	long				max_values		= 2;
+	long				j;
 
-					tot_new_samples = 0;
-
-					// search for nodes those matching with infoptr->value, calculate total and store in tot_sample
-					for( i = 0; i < node->tot_samples; i++ ) {
-						if( data[ node->samples[ i ] * cols + max_gain_id ] == infoptr->value ) {
-							if( samplelist == NULL ) {
-								samplelist 				= malloc( sizeof( struct smplid_t ) );
-								samplelist->value 		= node->samples[ i ];
-								samplelist->next		= NULL;
-								samplelist->prev		= NULL;
-							} else {
-								samplelistptr				= samplelist;
-								while( samplelistptr->next != NULL ) samplelistptr = samplelistptr->next;
-								samplelistptr->next			= malloc( sizeof( struct smplid_t ) );
-								samplelistptr->next->prev 	= samplelistptr;
-								samplelistptr 				= samplelistptr->next;
-								samplelistptr->value 		= node->samples[ i ];
-								samplelistptr->next			= NULL;
-							}
-							tot_new_samples += 1;
-						}
-					}
+	memset( bld, 0, sizeof( build_t ) );
+	bld->ds				= ds;
+	bld->train			= train;
+	bld->tot_attrib		= ds->cols - 1;
+	bld->tot_classes	= DS_VALUES( ds, ds->cols - 1 );
 
-					node_ptr->winvalue		= infoptr->value;
-					node_ptr->tot_nodes 	= 0;
-					node_ptr->tot_samples 	= tot_new_samples;
-					node_ptr->samples		= malloc( sizeof( long ) * tot_new_samples );
-					sampleptr				= node_ptr->samples;
+	if( ( bld->voffset = malloc( sizeof( long ) * ( ds->cols ) ) ) == NULL ) {
+		return -1;
+	}
+	for( j = 0; j < bld->tot_attrib; j++ ) {
+		bld->voffset[ j ] 	= tot_values;
+		if( train->lists[ j ] != NULL ) {
+			tot_values		+= 2;
+			continue;
+		}
+		tot_values			+= DS_VALUES( ds, j );
+		if( DS_VALUES( ds, j ) > max_values ) {
+			max_values = DS_VALUES( ds, j );
+		}
+	}
+	bld->voffset[ j ] = tot_values;
+
+	bld->counts			= calloc( tot_values * bld->tot_classes + 1, sizeof( long ) );
+	bld->totals			= calloc( tot_values + 1, sizeof( long ) );
+	bld->present		= malloc( sizeof( long ) * ( tot_values + 1 ) );
+	bld->tot_present	= calloc( ds->cols, sizeof( long ) );
+	bld->class_counts	= calloc( bld->tot_classes + 1, sizeof( long ) );
+	bld->attribs		= malloc( sizeof( long ) * ds->cols );
+	bld->gains			= malloc( sizeof( double ) * ds->cols );
+	bld->thresholds		= malloc( sizeof( long ) * ds->cols );
+	bld->position		= malloc( sizeof( long ) * ( max_values + 1 ) );
+	bld->sorted			= malloc( sizeof( long ) * ( ds->rows + 1 ) );
+	bld->avail			= malloc( ds->cols );
+	bld->splits			= malloc( sizeof( split_t ) * ds->cols );
+	bld->use_bits		= calloc( ds->cols, 1 );
+	bld->load			= load_select();
+	bld->count_bits		= bits_select();
+	arena_init( &bld->arena, 64 * 1024 );
+	bld->stats.bytes_allocated	= sizeof( long ) * ( 4 * ds->cols + tot_values * bld->tot_classes + 1 + 2 * ( tot_values + 1 ) +
+		bld->tot_classes + 1 + max_values + 1 + ds->rows + 1 ) + ( sizeof( double ) + 1 + sizeof( split_t ) ) * ds->cols;
+	if( bld->counts == NULL || bld->totals == NULL || bld->present == NULL || bld->tot_present == NULL ||
+		bld->class_counts == NULL || bld->attribs == NULL || bld->gains == NULL || bld->thresholds == NULL ||
+		bld->position == NULL || bld->sorted == NULL ||
+		bld->avail == NULL || bld->splits == NULL || bld->use_bits == NULL ) {
+		return -1;
+	}
 
-					samplelistptr			= samplelist;
-					while( samplelistptr != NULL ) {
-						*( sampleptr++ ) 	= samplelistptr->value;
-						samplelistptr 		= samplelistptr->next;
-					}
-
-					// we can destroy temporary list once we have inserted index of new sample into array
-					samplelistptr			= samplelist;
-					samplelistprv			= samplelist;
-					while( samplelistptr != NULL ) {
-						samplelistprv = samplelistptr->next;
-						free( samplelistptr );
-						samplelistptr = samplelistprv;
-					}
-					samplelist = NULL;
+	return 0;
+}
 
-					node_ptr->tot_attrib 	= ( cols - 1 );
-					node_ptr->avail_attrib	= malloc( sizeof( long ) * ( cols - 1 ) );
+/*
+	release split evaluation scratch
+*/
+static void build_free( build_t *bld )
+{
+	free( bld->voffset );
+	free( bld->counts );
+	free( bld->totals );
+	free( bld->present );
+	free( bld->tot_present );
+	free( bld->class_counts );
+	free( bld->attribs );
+	free( bld->gains );
+	free( bld->thresholds );
+	free( bld->position );
+	free( bld->sorted );
+	free( bld->avail );
+	free( bld->splits );
+	free( bld->use_bits );
+	free( bld->node_bits );
+	arena_free( &bld->arena );
+	memset( bld, 0, sizeof( build_t ) );
+}
 
-					for( i = 0; i < cols-1; i++ ) {
-                        node_ptr->avail_attrib[ i ] = node->avail_attrib[ i ];
-					}
-					node_ptr->avail_attrib[ max_gain_id ] = 0;
+/*
+	count samples of a node for a range of attributes and calculate their info gain
+*/
+static void eval_attribs( build_t *bld, const long *attribs, long tot_attribs, const node_t *node, double entropy_set )
+{
+	long				first			= node->samples[ 0 ] >> 6;
+	long				last			= node->samples[ node->tot_samples - 1 ] >> 6;
+	long				tot_lists		= 0;
+	long				i, j;
+
+	// attributes counted by bitmaps, the others by a pass over samples; numeric ones
+	// walk their sorted samples
+	for( i = 0; i < tot_attribs; i++ ) {
+		if( bld->use_bits[ attribs[ i ] ] ) {
+			bld->count_bits( bld, attribs[ i ], first, last );
+		} else if( bld->train->lists[ attribs[ i ] ] == NULL ) {
+			tot_lists += 1;
+		}
+	}
+	if( tot_lists > 0 ) {
+		count_samples( bld, attribs, tot_attribs, node->samples, node->tot_samples );
+	}
+	for( i = 0; i < tot_attribs; i++ ) {
+		j = attribs[ i ];
+		if( bld->train->lists[ j ] != NULL ) {
+			bld->gains[ j ] = eval_threshold( bld, j, node, entropy_set );
+		} else {
+			bld->gains[ j ] = entropy_set + calc_attrib_gain( bld, j, bld->tot_weight );
+		}
+		DEBUG( "\tInfo Gain for attribute %d = %3.3f\n", j, bld->gains[ j ] );
+	}
+}
 
-					DEBUG( "\t\t\tnode_ptr->winvalue    : %d\n", node_ptr->winvalue );
-					DEBUG( "\t\t\tnode_ptr->tot_samples : %d\n", node_ptr->tot_samples );
-					DEBUG( "\t\t\tnode_ptr->samples     : %p\n", node_ptr->samples );
+/*
+	evaluate a range of attributes on a worker of thread pool
+*/
+static void run_split( void *arg, long worker )
+{
+	split_t				*split			= arg;
 
-					// recursively create child nodes
-					if( node_ptr->tot_samples > 0 ) {
-                        create_leaves( node_ptr, data, cols, rows, info );
-					}
-					++j;
-				}
-				infoptr = infoptr->next;
-			}
-			free( gains );
-		} else {
-			node->nodes 				= malloc( sizeof( node_t ) );
-			node->tot_nodes				= 1;
-			node->nodes->tot_nodes 		= 0;
-			node->nodes->winvalue 		= data[ node->samples[ 0 ] * cols + cols - 1 ];
+	( void )worker;
+	eval_attribs( split->bld, split->attribs, split->tot_attribs, split->node, split->entropy_set );
+}
 
-			node->nodes->tot_attrib		= 0;
-			node->nodes->avail_attrib	= NULL;
-			node->nodes->tot_samples	= 0;
-			node->nodes->samples		= NULL;
-			node->nodes->nodes			= NULL;
+/*
+	choose how each attribute of a node is counted: bitmaps cost a word operation for
+	each cell and word spanned by node, a pass over samples a few operations for each
+	sample; when an attribute goes to bitmaps samples of node are turned into a bitmap
+*/
+static void bits_node( build_t *bld, const node_t *node, long tot_attribs )
+{
+	const train_t		*train			= bld->train;
+	long				first			= node->samples[ 0 ] >> 6;
+	long				last			= node->samples[ node->tot_samples - 1 ] >> 6;
+	long				cost;
+	int					found			= 0;
+	long				attrib, i;
+
+	for( i = 0; i < tot_attribs; i++ ) {
+		attrib					= bld->attribs[ i ];
+		cost					= ( last - first + 1 ) * DS_VALUES( bld->ds, attrib ) * bld->tot_classes;
+		bld->use_bits[ attrib ]	= ( train->bitmaps != NULL && train->boffset[ attrib ] >= 0 &&
+			cost <= node->tot_samples * BITMAP_RATIO );
+		found					|= bld->use_bits[ attrib ];
+	}
+	if( !found ) {
+		return;
+	}
 
-			DEBUG( "\t\t\tTerminal node @ %p:\n", node->nodes );
-			DEBUG( "\t\t\twinvalue        : %d\n", node->nodes->winvalue );
-			DEBUG( "\t\t\ttot_samples     : %d\n", node->nodes->tot_samples );
-			DEBUG( "\t\t\ttot_attrib      : %d\n", node->nodes->tot_attrib );
-			DEBUG( "\t\t\ttot_nodes       : %d\n", node->nodes->tot_nodes );
-			DEBUG( "\t\t\tnodes           @ %p\n", node->nodes->nodes );
-		}
+	memset( bld->node_bits + first, 0, sizeof( uint64_t ) * ( last - first + 1 ) );
+	for( i = 0; i < node->tot_samples; i++ ) {
+		bld->node_bits[ node->samples[ i ] >> 6 ] |= ( uint64_t )1 << ( node->samples[ i ] & 63 );
 	}
 }
 
 /*
-	try to find dataset rules
+	calculate info gain of available attributes of a node; attributes own disjoint parts
+	of count tables, so a big node splits them in ranges evaluated by several workers
+	and gains are the same of a serial evaluation
+	returns 0 or -1 on memory error
 */
-int id3_get_rules( char **data, long cols, long rows, char **column_names )
+static int eval_split( build_t *bld, const node_t *node, long tot_attribs, double entropy_set )
 {
-    long				*dataset		= NULL;     // pointer to dataset copy with numbers instead of strings
-	unsigned long		dataset_size    = 0;        // dataset size (columns * rows)
-	struct dsinfo_t  	*infolist		= NULL;     // pointer to dynamic list string/value
-	struct dsinfo_t  	*insptr 		= NULL;     // insertion pointer while creating string/value list
-	struct dsinfo_t  	*prvptr 		= NULL;
-	struct dsinfo_t  	*prvass 		= NULL;
-	char				label_found		= 0;        // label found flag
-	char				infolisterror	= 0;        // memory error flag
-	long				string_id		= 0;        // current string index
-	long				assign_id		= 0;
-	node_t		        *root			= NULL;     // root node
-	long				tree_max_depth	= 0;
-	long				tree_max_rules	= 0;
+	pool_t				*pool			= bld->train->pool;
+	pool_group_t		group;
+	split_t				*split			= NULL;
+	long				tot_splits		= 1;
+	long				first			= 0;
 	int					result			= 0;
-	int 				i = 0, j = 0, col = 0;
+	long				i;
 
-	DEBUG( "ID3 Init: cols = %d rows = %d dataset %p\n", cols, rows, data );
+	bits_node( bld, node, tot_attribs );
+	if( pool != NULL && node->tot_samples >= SPLIT_MIN_SAMPLES ) {
+		tot_splits = pool_workers( pool );
+		if( tot_splits > tot_attribs ) {
+			tot_splits = tot_attribs;
+		}
+	}
+	if( tot_splits <= 1 ) {
+		eval_attribs( bld, bld->attribs, tot_attribs, node, entropy_set );
+		return 0;
+	}
 
-	do {
-        // integer values comparison is faster than string comparison,
-        // we create a copy of dataset with unique numbers instead of strings
-		// calculate size of dataset
-		dataset_size = sizeof( long ) * cols * rows;
+	for( i = 0; i < tot_splits; i++ ) {
+		split				= bld->splits + i;
+		first				= tot_attribs * i / tot_splits;
+		split->bld			= bld;
+		split->node			= node;
+		split->attribs		= bld->attribs + first;
+		split->tot_attribs	= tot_attribs * ( i + 1 ) / tot_splits - first;
+		split->entropy_set	= entropy_set;
+	}
 
-		// allocate memory for dataset copy
-		if( ( dataset = malloc( dataset_size ) ) == NULL ) {
-			result = -2;
+	// first range is evaluated by calling worker, the others wait for idle workers
+	memset( &group, 0, sizeof( pool_group_t ) );
+	for( i = 1; i < tot_splits; i++ ) {
+		if( pool_submit( pool, bld->worker, &group, run_split, bld->splits + i ) != 0 ) {
+			result = -1;
 			break;
 		}
-		// reset dataset
-		memset( dataset, 0, dataset_size );
-
-		// full scan of original dataset (with strings) to gather all information to create a list of unique id for each string
-		i = 0, col = 0;
-		while( i < ( cols * rows ) ) {
-			// se infolist e' NULL significa che l'elemento va ovviamente inserito nella lista
-			insptr = NULL;
-			// if infolist is NULL the list is empty
-			if( infolist == NULL ) {
-                // create the 1st element of the list
-				infolist = malloc( sizeof( struct dsinfo_t ) );
-				// check memory allocation error
-				if( infolist == NULL ) {
-					infolisterror = 1;
-					break;
-				}
-				// insertion pointer points to the 1st item of the list
-				insptr		= infolist;
-				prvass		= NULL;
-			} else {
-                // if list is not empty we must search if any of already found items matches with current string (data[ i ])
-				insptr 		= infolist;
-				prvptr		= infolist;
-				label_found	= 0;
-				do {
-                    // if we found a match...
-					if( !strcmp( insptr->name, data[ i ] ) ) {
-                        // set match found flag
-						label_found = 1;
-						// get value to insert into copy table
-						assign_id	= insptr->value;
-                        // we must not insert any new item into the list
-						insptr		= NULL;
-						break;
-					}
-					// continue with next item
-					prvptr	= insptr;
-					insptr 	= insptr->next;
-				} while( insptr != NULL );
-
-				// if we didn't found any match into the list...
-				if( label_found == 0 ) {
-                    // create a new item in the list
-					prvptr->next 	= malloc( sizeof( struct dsinfo_t ) );
-                    // check memory error
-					if( prvptr->next == NULL ) {
-						infolisterror = 1;
-						break;
-					}
-					// set pointer where we must create a new item
-					insptr			= prvptr->next;
-					prvass			= prvptr;
-				}
-			}
-			// insptr points to an already allocated memory for the new item of the list
-			if( insptr != NULL ) {
-                // insert value related to string
-				assign_id		= string_id;
-				// allocate memory to keep the string
-				insptr->name 	= malloc( sizeof( char )*strlen( data[ i ] ) + 1 );
-                // check memory error
-				if( insptr->name == NULL ) {
-					infolisterror = 1;
-					break;
+	}
+	run_split( bld->splits, bld->worker );
+	// queued ranges use count tables of this worker: wait for them even on error
+	pool_wait_group( pool, bld->worker, &group );
+
+	return result;
+}
+
+static int create_leaves( node_t *node, build_t *bld );
+
+/*
+	draw features of the available attributes of a node at random, keeping their order;
+	draws depend on seed and on node only ( its first sample, size and depth ), so the
+	tree is the same for any number of threads
+	returns number of attributes left in attribs
+*/
+static long draw_attribs( build_t *bld, const node_t *node, long tot_attribs )
+{
+	uint64_t			state			= bld->train->seed;
+	long				need			= bld->train->features;
+	long				tot				= 0;
+	long				i;
+
+	if( need <= 0 || tot_attribs <= need ) {
+		return tot_attribs;
+	}
+	state ^= ( ( uint64_t )node->samples[ 0 ] << 24 ) ^ ( ( uint64_t )bld->depth << 56 ) ^ ( uint64_t )node->tot_samples;
+
+	// selection sampling: an attribute is kept with probability needed / left
+	for( i = 0; i < tot_attribs && need > 0; i++ ) {
+		if( ( long )( random_next( &state ) % ( uint64_t )( tot_attribs - i ) ) < need ) {
+			bld->attribs[ tot++ ]	= bld->attribs[ i ];
+			need					-= 1;
+		}
+	}
+
+	return tot;
+}
+
+/*
+	majority class of a node from class_counts, lowest class on ties
+*/
+static long majority_class( const build_t *bld )
+{
+	long				class_id		= 0;
+	long				k;
+
+	for( k = 1; k < bld->tot_classes; k++ ) {
+		if( bld->class_counts[ k ] > bld->class_counts[ class_id ] ) {
+			class_id = k;
+		}
+	}
+
+	return class_id;
+}
+
+/*
+	class of a node that cannot be split: class of its first sample, majority class when
+	min_leaf is set ( a split may have been refused because of it )
+*/
+static long leaf_class( const build_t *bld, const node_t *node )
+{
+	if( bld->train->min_leaf > 1 ) {
+		return majority_class( bld );
+	}
+
+	return ds_code( bld->ds, bld->ds->cols - 1, node->samples[ 0 ] );
+}
+
+/*
+	a split of a node can be chosen among attribs, min_leaf apart: a categorical attribute
+	always splits, a numeric one if the first and the last of its sorted samples differ
+*/
+static int can_split( const build_t *bld, const node_t *node, long tot_attribs )
+{
+	const train_t		*train			= bld->train;
+	const long			*list			= NULL;
+	long				attrib, i;
+
+	for( i = 0; i < tot_attribs; i++ ) {
+		attrib = bld->attribs[ i ];
+		if( train->lists[ attrib ] == NULL ) {
+			return 1;
+		}
+		list = train->lists[ attrib ] + ( node->samples - train->samples );
+		if( train->numbers[ attrib ][ ds_code( bld->ds, attrib, list[ 0 ] ) ] !=
+			train->numbers[ attrib ][ ds_code( bld->ds, attrib, list[ node->tot_samples - 1 ] ) ] ) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+	every child of a split of a categorical attribute gets min_leaf samples at least
+*/
+static int split_fits( const build_t *bld, long attrib )
+{
+	const long			*totals			= bld->totals + bld->voffset[ attrib ];
+	const long			*present		= bld->present + bld->voffset[ attrib ];
+	long				i;
+
+	for( i = 0; i < bld->tot_present[ attrib ]; i++ ) {
+		if( totals[ present[ i ] ] < bld->train->min_leaf ) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+	build a queued subtree on a worker of thread pool
+*/
+static void run_subtree( void *arg, long worker )
+{
+	subtree_t			*subtree		= arg;
+	train_t				*train			= subtree->train;
+	build_t				*bld			= train->builds + worker;
+
+	// a failed worker stops the whole training
+	if( !__atomic_load_n( &train->error, __ATOMIC_RELAXED ) ) {
+		memcpy( bld->avail, subtree->avail, train->ds->cols );
+		bld->depth = subtree->depth;
+		if( create_leaves( subtree->node, bld ) != 0 ) {
+			__atomic_store_n( &train->error, 1, __ATOMIC_RELAXED );
+		}
+	}
+	subtree->node->samples = NULL;
+	free( subtree );
+}
+
+/*
+	queue a subtree on thread pool, it is built with current available attributes
+	returns 0 or -1 on memory error
+*/
+static int spawn_subtree( build_t *bld, node_t *node )
+{
+	subtree_t			*subtree		= NULL;
+
+	if( ( subtree = malloc( sizeof( subtree_t ) + bld->ds->cols ) ) == NULL ) {
+		return -1;
+	}
+	subtree->train	= bld->train;
+	subtree->node	= node;
+	subtree->depth	= bld->depth;
+	memcpy( subtree->avail, bld->avail, bld->ds->cols );
+
+	if( pool_submit( bld->train->pool, bld->worker, NULL, run_subtree, subtree ) != 0 ) {
+		free( subtree );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+	create tree nodes
+*/
+static int create_leaves( node_t *node, build_t *bld )
+{
+	const dataset_t		*ds				= bld->ds;
+	double 			    entropy_set 	= 0;
+	double				*gains			= bld->gains;
+	double				max_gain		= 0;
+	long				max_gain_id		= 0;
+	long				tot_children	= 0;
+	const long			*present		= NULL;
+	long				tot_avattrib	= 0;
+	long				cols			= ds->cols;
+	node_t				*node_ptr		= NULL;
+	double				start			= 0;
+	long				j, i;
+
+	DEBUG( "Current node @ %p:\n", node );
+	DEBUG( "\twinvalue        : %d\n", node->winvalue );
+	DEBUG( "\ttot_samples     : %d\n", node->tot_samples );
+	DEBUG( "\tsamples         : " );
+	for( i = 0; i < node->tot_samples; i++ )
+		DEBUG( "%-2d ", node->samples[ i ] );
+	DEBUG( "\n\tavail_attrib    : " );
+	for( i = 0; i < ( cols - 1 ); i++ )
+		DEBUG( "%d ", bld->avail[ i ] );
+	DEBUG( "\n\ttot_nodes       : %d\n", node->tot_nodes );
+	DEBUG( "\tnodes           @ %p\n", node->nodes );
+
+
+	if( bld->depth > bld->stats.max_depth ) {
+		bld->stats.max_depth = bld->depth;
+	}
+	bld->stats.samples_touched += node->tot_samples;
+
+	// calulate entropy of samples part, class counts are kept for threshold search and
+	// cleared with count tables
+	count_classes( bld, node->samples, node->tot_samples );
+	entropy_set = calc_entropy_set( bld->class_counts, bld->tot_classes, bld->tot_weight );
+
+	DEBUG( "Entropy set = %3.6f\n", entropy_set );
+
+	// value of entropy_set is crucial for deciding to proceed in branches creation:
+	// if zero it means that examined samples are perfectly classified, if one samples
+	// have no rules (are totally random); if the value is between zero and one we must
+	// proceed and calculate the Gain for each available attribute
+	if( entropy_set == 0.000f )	{
+
+		node->class_id 				= ds_code( ds, cols - 1, node->samples[ 0 ] );
+		bld->stats.leaves			+= 1;
+		memset( bld->class_counts, 0, sizeof( long ) * bld->tot_classes );
+
+		DEBUG( "\t\t\tTerminal node @ %p:\n", node );
+		DEBUG( "\t\t\tclass_id        : %d\n", node->class_id );
+	} else if( entropy_set == 1 ) {
+		// totally random data = no rule at all
+		bld->stats.leaves += 1;
+		memset( bld->class_counts, 0, sizeof( long ) * bld->tot_classes );
+	} else if( bld->tot_weight < 2 * bld->train->min_leaf ) {
+		// too few samples for two children
+		node->class_id 				= majority_class( bld );
+		bld->stats.leaves			+= 1;
+		memset( bld->class_counts, 0, sizeof( long ) * bld->tot_classes );
+	} else {
+		// calculate total number of available attributes
+		tot_avattrib = 0;
+		for( j = 0; j < ( cols - 1 ); j++ ) {
+			if( bld->avail[ j ] == 1 ) {
+                bld->attribs[ tot_avattrib++ ] = j;
+			}
+		}
+		// trees of a forest evaluate a random subset of them
+		tot_avattrib = draw_attribs( bld, node, tot_avattrib );
+
+		// at depth limit a node takes the class it would have as inner node ( majority
+		// class ) or, if it cannot be split, as terminal node; so the tree is the one
+		// without limit cut at that depth
+		if( bld->train->max_depth > 0 && bld->depth >= bld->train->max_depth ) {
+			node->class_id 				= can_split( bld, node, tot_avattrib ) ? majority_class( bld ) : leaf_class( bld, node );
+			bld->stats.leaves			+= 1;
+			memset( bld->class_counts, 0, sizeof( long ) * bld->tot_classes );
+			return 0;
+		}
+
+		DEBUG( "\tCalculate entropy for each attribute ( total available %d )\n", tot_avattrib );
+		// se c'e' piu' di un attributo disponibile
+		if( tot_avattrib > 0 ) {
+			// count samples and calculate gain of all attributes with a single pass
+			if( bld->train->timed ) {
+				start = stats_wall();
+			}
+			if( eval_split( bld, node, tot_avattrib, entropy_set ) != 0 ) {
+				return -1;
+			}
+			bld->stats.gain_evals		+= tot_avattrib;
+			bld->stats.samples_touched	+= node->tot_samples * ( tot_avattrib + 1 );
+			if( bld->train->timed ) {
+				bld->stats.split_time += stats_wall() - start;
+			}
+			// find highest value, first available attribute wins if no gain is positive;
+			// numeric attributes whose samples share a single value cannot split, nor
+			// attributes giving a child less than min_leaf samples
+			max_gain_id = -1;
+			for( i = 0; i < tot_avattrib; i++ ) {
+				j = bld->attribs[ i ];
+				if( bld->train->lists[ j ] != NULL && bld->thresholds[ j ] < 0 ) {
+					continue;
+				}
+				if( bld->train->lists[ j ] == NULL && bld->train->min_leaf > 1 && !split_fits( bld, j ) ) {
+					continue;
 				}
-                // insert string
-				sprintf( insptr->name, data[ i ] );
-				// insert current value and update value for next string
-				insptr->value	= string_id++;
-				insptr->column	= col;
-				insptr->next	= NULL;
-				insptr->prev	= prvass;
+				if( max_gain_id < 0 ) {
+					max_gain_id = j;
+				}
+				if( gains[ j ] > max_gain ) {
+					max_gain	= gains[ j ];
+					max_gain_id = j;
+				}
+			}
+			if( max_gain_id < 0 ) {
+				node->class_id 			= leaf_class( bld, node );
+				bld->stats.leaves		+= 1;
+				reset_counts( bld, tot_avattrib );
+				return 0;
+			}
+
+			// values of winning attribute found at node ( in increasing order, as left by
+			// count tables ), a numeric one has a value for each side of its threshold
+			present			= bld->present + bld->voffset[ max_gain_id ];
+			tot_children	= bld->tot_present[ max_gain_id ];
+			node->threshold	= ( bld->train->lists[ max_gain_id ] != NULL ) ? bld->thresholds[ max_gain_id ] : -1;
+			DEBUG( "\tAttribute %d has maximum IG (%3.3f) and %d values at node\n", max_gain_id, max_gain, tot_children );
+
+			// values without samples get no node: they take the default branch, that
+			// leads to majority class of node ( lowest class on ties )
+			node->class_id = majority_class( bld );
+
+			// create node for each value found at node
+			node->attrib	= max_gain_id;
+			node->nodes 	= ( node_t* ) arena_alloc( &bld->arena, sizeof( node_t ) * tot_children );
+			node->tot_nodes = tot_children;
+			DEBUG( "\tAllocate memory for %d nodes @ %p\n", tot_children, node->nodes );
+			if( node->nodes == NULL ) {
+				return -1;
+			}
+			bld->stats.nodes += tot_children;
+
+			for( j = 0; j < tot_children; j++ ) {
+				node_ptr 				= node->nodes + j;
+				node_ptr->winvalue		= present[ j ];
+				node_ptr->attrib		= -1;
+				node_ptr->class_id		= -1;
+				node_ptr->threshold		= -1;
+				node_ptr->tot_nodes 	= 0;
+				node_ptr->nodes			= NULL;
 			}
 
-			// update copy table with current value
-			dataset[ i ] = assign_id;
+			// move samples of each value into its child's slice, count tables are not needed anymore
+			if( bld->train->timed ) {
+				start = stats_wall();
+			}
+			partition_samples( bld, node, max_gain_id );
+			if( bld->train->child_of != NULL ) {
+				partition_lists( bld, node );
+			}
+			reset_counts( bld, tot_avattrib );
+			bld->stats.samples_touched += node->tot_samples;
+			if( bld->train->timed ) {
+				bld->stats.partition_time += stats_wall() - start;
+			}
 
-			// update current column index of attribute
-			if( ++col >= cols ) {
-                col = 0;
+			// winning attribute is not available in this subtree, a numeric one can
+			// split again on another threshold
+			bld->avail[ max_gain_id ]	= ( node->threshold >= 0 );
+			bld->depth					+= 1;
+			for( j = 0; j < tot_children; j++ ) {
+				node_ptr = node->nodes + j;
+
+				DEBUG( "\t\t\tnode_ptr->winvalue    : %d\n", node_ptr->winvalue );
+				DEBUG( "\t\t\tnode_ptr->tot_samples : %d\n", node_ptr->tot_samples );
+				DEBUG( "\t\t\tnode_ptr->samples     : %p\n", node_ptr->samples );
+
+				// recursively create child nodes, big subtrees go to other workers
+				if( node_ptr->tot_samples >= PARALLEL_MIN_SAMPLES && bld->train->pool != NULL ) {
+					if( spawn_subtree( bld, node_ptr ) != 0 ) {
+						return -1;
+					}
+					continue;
+				}
+                if( create_leaves( node_ptr, bld ) != 0 ) {
+					return -1;
+				}
+				node_ptr->samples = NULL;
 			}
-			// next item in original dataset
-			i += 1;
+			bld->avail[ max_gain_id ]	= 1;
+			bld->depth					-= 1;
+		} else {
+			node->class_id 				= leaf_class( bld, node );
+			bld->stats.leaves			+= 1;
+			memset( bld->class_counts, 0, sizeof( long ) * bld->tot_classes );
+
+			DEBUG( "\t\t\tTerminal node @ %p:\n", node );
+			DEBUG( "\t\t\tclass_id        : %d\n", node->class_id );
 		}
-		// exit in case of memory error
-		if( infolisterror ) {
-			result = -3;
+	}
+
+	return 0;
+}
+
+/*
+	fill bitmaps of values of a column of 1 byte codes a word at a time, starting from
+	word first, portable kernel
+*/
+static void fill_bits( const uint8_t *codes, long rows, long tot_values, uint64_t *bits, long tot_words, long first )
+{
+	uint64_t			word[ BITMAP_MAX_VALUES ];
+	long				row, end, w, v;
+
+	for( w = first; w < tot_words; w++ ) {
+		memset( word, 0, sizeof( uint64_t ) * tot_values );
+		end = ( w + 1 ) * 64 < rows ? ( w + 1 ) * 64 : rows;
+		for( row = w * 64; row < end; row++ ) {
+			word[ codes[ row ] ] |= ( uint64_t )1 << ( row & 63 );
+		}
+		for( v = 0; v < tot_values; v++ ) {
+			bits[ v * tot_words + w ] = word[ v ];
+		}
+	}
+}
+
+#ifdef ID3_AVX2
+/*
+	fill bitmaps of values of a column, 64 codes are compared with each value and
+	byte masks of comparisons become a word; the last partial word is left to the
+	portable kernel
+*/
+__attribute__(( target( "avx2" ) ))
+static void fill_bits_avx2( const uint8_t *codes, long rows, long tot_values, uint64_t *bits, long tot_words, long first )
+{
+	__m256i				lo, hi, value;
+	long				w, v;
+
+	for( w = first; ( w + 1 ) * 64 <= rows; w++ ) {
+		lo = _mm256_loadu_si256( ( const __m256i* )( codes + w * 64 ) );
+		hi = _mm256_loadu_si256( ( const __m256i* )( codes + w * 64 + 32 ) );
+		for( v = 0; v < tot_values; v++ ) {
+			value						= _mm256_set1_epi8( ( char )v );
+			bits[ v * tot_words + w ]	= ( uint32_t )_mm256_movemask_epi8( _mm256_cmpeq_epi8( lo, value ) ) |
+				( ( uint64_t )( uint32_t )_mm256_movemask_epi8( _mm256_cmpeq_epi8( hi, value ) ) << 32 );
+		}
+	}
+	fill_bits( codes, rows, tot_values, bits, tot_words, w );
+}
+#endif
+
+/*
+	choose kernel filling bitmaps by features of running cpu
+*/
+static fill_func_t fill_select( void )
+{
+#ifdef ID3_AVX2
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "avx2" ) ) {
+		return fill_bits_avx2;
+	}
+#endif
+	return fill_bits;
+}
+
+/*
+	bitmaps of samples of each value of attributes with few values and of each class,
+	nothing is built for small datasets, for many classes or for weighted rows ( popcounts
+	count rows )
+	returns 0 or -1 on memory error
+*/
+static int bits_build( train_t *train )
+{
+	const dataset_t		*ds				= train->ds;
+	long				classcol		= ds->cols - 1;
+	long				tot_bitmaps		= 0;
+	uint64_t			*bits			= NULL;
+	fill_func_t			fill			= fill_select();
+	long				col, i;
+
+	if( ds->rows < BITMAP_MIN_ROWS || DS_VALUES( ds, classcol ) > BITMAP_MAX_VALUES || ds->weights != NULL ) {
+		return 0;
+	}
+	if( ( train->boffset = malloc( sizeof( long ) * ds->cols ) ) == NULL ) {
+		return -1;
+	}
+	// a node spans at least one word every 64 samples, so attributes whose cells
+	// exceed 64 x BITMAP_RATIO would never be counted by bitmaps
+	for( col = 0; col < classcol; col++ ) {
+		train->boffset[ col ] = -1;
+		if( train->lists[ col ] == NULL && DS_VALUES( ds, col ) <= BITMAP_MAX_VALUES &&
+			DS_VALUES( ds, col ) * DS_VALUES( ds, classcol ) <= 64 * BITMAP_RATIO ) {
+			train->boffset[ col ]	= tot_bitmaps;
+			tot_bitmaps				+= DS_VALUES( ds, col );
+		}
+	}
+	if( tot_bitmaps == 0 ) {
+		return 0;
+	}
+	train->boffset[ classcol ]	= tot_bitmaps;
+	tot_bitmaps					+= DS_VALUES( ds, classcol );
+
+	train->tot_words = ( ds->rows + 63 ) / 64;
+	if( ( train->bitmaps = calloc( tot_bitmaps * train->tot_words, sizeof( uint64_t ) ) ) == NULL ) {
+		return -1;
+	}
+	for( col = 0; col < ds->cols; col++ ) {
+		if( train->boffset[ col ] < 0 ) {
+			continue;
+		}
+		bits = train->bitmaps + train->boffset[ col ] * train->tot_words;
+		fill( ds->columns[ col ], ds->rows, DS_VALUES( ds, col ), bits, train->tot_words, 0 );
+	}
+
+	// every worker turns samples of its nodes into a bitmap
+	for( i = 0; i < train->tot_builds; i++ ) {
+		if( ( train->builds[ i ].node_bits = malloc( sizeof( uint64_t ) * train->tot_words ) ) == NULL ) {
+			return -1;
+		}
+		train->builds[ i ].stats.bytes_allocated += sizeof( uint64_t ) * train->tot_words;
+	}
+	train->builds[ 0 ].stats.bytes_allocated += sizeof( uint64_t ) * tot_bitmaps * train->tot_words;
+
+	return 0;
+}
+
+/*
+	numbers of a numeric attribute in increasing order, ties by code
+*/
+typedef struct number_tag {
+	double				value;
+	long				code;
+} number_t;
+
+/*
+	compare two numbers for qsort
+*/
+static int cmp_number( const void *a, const void *b )
+{
+	const number_t		*x = a;
+	const number_t		*y = b;
+
+	if( x->value != y->value ) {
+		return ( x->value > y->value ) - ( x->value < y->value );
+	}
+	return ( x->code > y->code ) - ( x->code < y->code );
+}
+
+/*
+	sort samples of each numeric attribute once before training: codes are sorted by
+	number, then a counting sort by code places samples in that order ( equal values
+	keep order of samples ). Sorted samples of root are the whole lists, rows of zero
+	weight are left out as they are from root
+	returns 0 or -1 on memory error
+*/
+static int lists_build( train_t *train, const double *const *numbers )
+{
+	const dataset_t		*ds				= train->ds;
+	number_t			*order			= NULL;
+	long				*first			= NULL;
+	long				*list			= NULL;
+	long				tot_lists		= 0;
+	long				max_values		= 0;
+	int					result			= 0;
+	long				col, code, pos, i;
+
+	if( ( train->lists = calloc( ds->cols, sizeof( long* ) ) ) == NULL ) {
+		return -1;
+	}
+	for( col = 0; numbers != NULL && col < ds->cols - 1; col++ ) {
+		if( numbers[ col ] != NULL ) {
+			tot_lists += 1;
+			if( DS_VALUES( ds, col ) > max_values ) {
+				max_values = DS_VALUES( ds, col );
+			}
+		}
+	}
+	if( tot_lists == 0 ) {
+		return 0;
+	}
+	train->numbers = numbers;
+
+	// lists of all attributes are a single allocation owned by the first one
+	order			= malloc( sizeof( number_t ) * ( max_values + 1 ) );
+	first			= malloc( sizeof( long ) * ( max_values + 1 ) );
+	list			= malloc( sizeof( long ) * tot_lists * ( ds->rows + 1 ) );
+	train->child_of	= malloc( sizeof( uint32_t ) * ( ds->rows + 1 ) );
+	if( order == NULL || first == NULL || list == NULL || train->child_of == NULL ) {
+		free( list );
+		result = -1;
+	}
+	for( col = 0; result == 0 && col < ds->cols - 1; col++ ) {
+		if( numbers[ col ] == NULL ) {
+			continue;
+		}
+		train->lists[ col ]	= list;
+		list				+= ds->rows + 1;
+
+		for( code = 0; code < DS_VALUES( ds, col ); code++ ) {
+			order[ code ].value	= numbers[ col ][ code ];
+			order[ code ].code	= code;
+			first[ code ]		= 0;
+		}
+		qsort( order, DS_VALUES( ds, col ), sizeof( number_t ), cmp_number );
+		for( i = 0; i < ds->rows; i++ ) {
+			first[ ds_code( ds, col, i ) ] += ( ds->weights == NULL || ds->weights[ i ] > 0 );
+		}
+		for( pos = 0, i = 0; i < DS_VALUES( ds, col ); i++ ) {
+			code			= order[ i ].code;
+			pos				+= first[ code ];
+			first[ code ]	= pos - first[ code ];
+		}
+		for( i = 0; i < ds->rows; i++ ) {
+			if( ds->weights == NULL || ds->weights[ i ] > 0 ) {
+				train->lists[ col ][ first[ ds_code( ds, col, i ) ]++ ] = i;
+			}
+		}
+	}
+	free( order );
+	free( first );
+
+	return result;
+}
+
+/*
+	first sorted list of numeric attributes, it owns memory of all of them
+*/
+static long *lists_first( const train_t *train )
+{
+	long				col;
+
+	for( col = 0; train->lists != NULL && col < train->ds->cols - 1; col++ ) {
+		if( train->lists[ col ] != NULL ) {
+			return train->lists[ col ];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+	create decision tree of an encoded dataset; sibling subtrees are independent once
+	their parent is split, so with more threads they are built by a work-stealing pool
+	and the tree is the same of serial training. Training buffers are released as soon
+	as tree is complete, only nodes are kept in tree's arena
+	- numbers:	code -> number of each numeric attribute ( see numbers_parse ), NULL if
+				no attribute is numeric
+	- avail:	flag of each attribute available at root, NULL if all are
+	Duplicate rows are trained once, as a row weighing all of them ( see dataset_dedup ),
+	unless ds has weights already: rows of zero weight are then left out ( rows not drawn
+	by bootstrap sample of a tree of a forest ). Attributes of each node are drawn at
+	random when features parameter is set
+	returns 0 or -1 on memory error
+*/
+int tree_build( tree_t *tree, const dataset_t *ds, const double *const *numbers, const id3_params_t *params, const char *avail )
+{
+	train_t				train;						// training state
+	dataset_t			unique;						// rows of ds with weights, if they halve
+	node_t		        *root			= NULL;     // root node
+	long				threads			= params->threads;
+	id3_stats_t			*stats			= params->stats;
+	double				wall			= 0;
+	double				cpu				= 0;
+	int					result			= 0;
+	long 				i = 0, j = 0;
+
+	memset( tree, 0, sizeof( tree_t ) );
+	memset( &train, 0, sizeof( train_t ) );
+	memset( &unique, 0, sizeof( dataset_t ) );
+	arena_init( &tree->arena, 64 * 1024 );
+	train.timed	= ( stats != NULL );
+	if( stats != NULL ) {
+		wall	= stats_wall();
+		cpu		= stats_cpu();
+	}
+
+	if( threads <= 0 ) {
+		threads = sysconf( _SC_NPROCESSORS_ONLN );
+	}
+
+	do {
+		// duplicate rows are collapsed when it pays
+		if( ds->weights == NULL && ( result = dataset_dedup( &unique, ds ) ) < 0 ) {
 			break;
 		}
-
-		// debug string / value list
-#ifdef DO_DEBUG
-        struct dsinfo_t *p = infolist;
-        while( p != NULL ) {
-            printf( "name %-12s value %3d column %3d\n", p->name, p->value, p->column );
-            p = p->next;
-        }
-#endif
-
-        // create root node: tree creation starts from here
-		if( ( root = ( node_t* ) malloc( sizeof( node_t ) ) ) == NULL ) {
-			result = -4;
+		if( result == 0 && ds->weights == NULL ) {
+			ds = &unique;
+		}
+		result			= 0;
+		train.ds		= ds;
+		train.features	= params->features;
+		train.seed		= params->seed;
+		train.max_depth	= params->max_depth;
+		train.min_leaf	= params->min_leaf;
+
+		// thread pool, calling thread is worker 0
+		if( threads > 1 ) {
+			if( ( train.pool = pool_create( threads ) ) == NULL ) {
+				result = -1;
+				break;
+			}
+			threads = pool_workers( train.pool );
+		} else {
+			threads = 1;
+		}
+
+		// numeric attributes are sorted once, split evaluation depends on them
+		if( lists_build( &train, numbers ) != 0 ) {
+			result = -1;
 			break;
 		}
-		// we must examine full tree, as this is the root node
-		root->tot_samples = rows;
-		// create an array with indexes ( from 0 to row - 1 ) of all samples to be examined
-		if( ( root->samples = malloc( sizeof( long ) * rows ) ) == NULL ) {
-			result = -5;
+
+		// allocate split evaluation scratch of each worker, reused by every node
+		if( ( train.builds = calloc( threads, sizeof( build_t ) ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		train.tot_builds = threads;
+		for( i = 0; i < threads; i++ ) {
+			if( build_init( train.builds + i, &train ) != 0 ) {
+				result = -1;
+				break;
+			}
+			train.builds[ i ].worker	= i;
+		}
+		if( result != 0 || ( train.samples = malloc( sizeof( long ) * ( ds->rows + 1 ) ) ) == NULL ) {
+			result = -1;
 			break;
 		}
-		// root node contains indexes of all database samples
-		for( j = 0; j < rows; j++ ) {
-            root->samples[ j ] = j;
+		if( bits_build( &train ) != 0 ) {
+			result = -1;
+			break;
 		}
-        // set all available attributes ( all columns except one, the class column)
-		root->tot_attrib = ( cols - 1 );
-		// we must evaluate all attributes ( cols -1 )
-		if( ( root->avail_attrib = malloc( sizeof( long ) * ( cols - 1 ) ) ) == NULL ) {
-			result = -6;
+
+        // create root node: tree creation starts from here
+		if( ( root = ( node_t* ) arena_alloc( &tree->arena, sizeof( node_t ) ) ) == NULL ) {
+			result = -1;
 			break;
 		}
+		// we must examine full tree, as this is the root node
+		root->tot_samples	= 0;
+		root->samples		= train.samples;
+		// root node contains indexes of all database samples that weigh something
+		for( j = 0; j < ds->rows; j++ ) {
+			if( ds->weights == NULL || ds->weights[ j ] > 0 ) {
+				root->samples[ root->tot_samples++ ] = j;
+			}
+		}
 		// we must check all attributes as we are in the root node
-		for( j = 0; j < ( cols - 1 ); j++ )  {
-            root->avail_attrib[ j ] = 1;
+		for( j = 0; j < ( ds->cols - 1 ); j++ )  {
+            train.builds[ 0 ].avail[ j ] = ( avail != NULL ) ? avail[ j ] : 1;
 		}
 		// value -1 identifies root node, moreover it has no branches at start
 		root->winvalue		= -1;
+		root->attrib		= -1;
+		root->class_id		= -1;
+		root->threshold		= -1;
 		root->tot_nodes		= 0;
+		root->nodes			= NULL;
+		tree->root			= root;
 
 		DEBUG( "Root node @ %p:\n", root );
 		DEBUG( "\twinvalue        : %d\n", root->winvalue );
@@ -786,37 +1670,878 @@ int id3_get_rules( char **data, long cols, long rows, char **column_names )
 		DEBUG( "\tsamples         : " );
 		for( i = 0; i < root->tot_samples; i++ )
 			DEBUG( "%2d ", root->samples[ i ] );
-		DEBUG( "\n\ttot_attrib      : %d (%d %d %d %d )\n", root->tot_attrib, root->avail_attrib[0],root->avail_attrib[1],root->avail_attrib[2],root->avail_attrib[3] );
-		DEBUG( "\ttot_nodes       : %d\n", root->tot_nodes );
+		DEBUG( "\n\ttot_nodes       : %d\n", root->tot_nodes );
 		DEBUG( "\tnodes           @ %p\n", root->nodes );
 
-
-		// create tree and children nodes
-		create_leaves( root, dataset, cols, rows, infolist );
-
-		// scan tree
-		scan_tree( root, &tree_max_depth, &tree_max_rules );
-
-		// rules explanation
-		explain_rules( root, cols, infolist, column_names, tree_max_depth, tree_max_rules );
-
+		// create tree and children nodes, then wait for queued subtrees
+		if( root->tot_samples > 0 && create_leaves( root, train.builds ) != 0 ) {
+			train.error = 1;
+		}
+		if( train.pool != NULL ) {
+			pool_wait( train.pool, 0 );
+		}
+		root->samples = NULL;
+		if( train.error ) {
+			result = -1;
+			break;
+		}
 	} while( 0 );
 
-	// TODO free memory allocated for tree
-
-	// free memory allocated for list string / value
-	insptr = infolist;
-	while( insptr != NULL ) {
-		prvass = insptr->next;
-		free( insptr );
-		insptr = prvass;
+	// free memory allocated for training, nodes created by workers move into tree
+	pool_destroy( train.pool );
+	for( i = 0; train.builds != NULL && i < train.tot_builds; i++ ) {
+		arena_merge( &tree->arena, &train.builds[ i ].arena );
+		if( stats != NULL ) {
+			stats_merge( stats, &train.builds[ i ].stats );
+		}
+		build_free( train.builds + i );
 	}
-	// free memory allocated for copy table
-	if( dataset != NULL ) {
-        free( dataset );
+	free( train.builds );
+	free( train.samples );
+	free( train.bitmaps );
+	free( train.boffset );
+	if( stats != NULL && train.child_of != NULL ) {
+		for( j = 0; j < ds->cols - 1; j++ ) {
+			stats->bytes_allocated += ( train.lists[ j ] != NULL ) ? sizeof( long ) * ( ds->rows + 1 ) : 0;
+		}
+		stats->bytes_allocated += sizeof( uint32_t ) * ( ds->rows + 1 );
 	}
+	free( lists_first( &train ) );
+	free( train.lists );
+	free( train.child_of );
+	if( stats != NULL ) {
+		stats->nodes			+= ( tree->root != NULL );
+		stats->unique_rows		+= ds->rows;
+		stats->tree_bytes		= tree->arena.allocated;
+		stats->bytes_allocated	+= sizeof( long ) * ( ds->rows + 1 ) + tree->arena.allocated;
+		stats->train_wall		+= stats_wall() - wall;
+		stats->train_cpu		+= stats_cpu() - cpu;
+	}
+	if( stats != NULL && unique.weights != NULL ) {
+		stats->bytes_allocated += sizeof( long ) * ( unique.max_rows + 1 );
+		for( j = 0; j < unique.cols; j++ ) {
+			stats->bytes_allocated += ( size_t )unique.widths[ j ] * ( unique.max_rows + 1 );
+		}
+	}
+	unique.dicts = NULL;
+	dataset_free( &unique );
+	if( result != 0 ) {
+		tree_free( tree );
+	}
+
+	return result;
+}
+
+/*
+	release all nodes of a tree
+*/
+void tree_free( tree_t *tree )
+{
+	arena_free( &tree->arena );
+	tree->root = NULL;
+}
+
+/*
+	store code of a cell, column width grows as soon as its catalog does not fit
+*/
+static int ds_store( dataset_t *ds, long col, long row, long code )
+{
+	void				*ptr			= NULL;
+	long				i;
+
+	if( ds->widths[ col ] == 1 && code > UINT8_MAX ) {
+		if( ( ptr = realloc( ds->columns[ col ], sizeof( uint16_t ) * ds->max_rows ) ) == NULL ) {
+			return -1;
+		}
+		// widen codes in place, from last to first
+		for( i = row - 1; i >= 0; i-- ) {
+			( ( uint16_t* )ptr )[ i ] = ( ( uint8_t* )ptr )[ i ];
+		}
+		ds->columns[ col ]	= ptr;
+		ds->widths[ col ]	= 2;
+	}
+	if( ds->widths[ col ] == 2 && code > UINT16_MAX ) {
+		if( ( ptr = realloc( ds->columns[ col ], sizeof( uint32_t ) * ds->max_rows ) ) == NULL ) {
+			return -1;
+		}
+		for( i = row - 1; i >= 0; i-- ) {
+			( ( uint32_t* )ptr )[ i ] = ( ( uint16_t* )ptr )[ i ];
+		}
+		ds->columns[ col ]	= ptr;
+		ds->widths[ col ]	= 4;
+	}
+
+	switch( ds->widths[ col ] ) {
+	case 1:
+		( ( uint8_t* )ds->columns[ col ] )[ row ]	= code;
+		break;
+	case 2:
+		( ( uint16_t* )ds->columns[ col ] )[ row ]	= code;
+		break;
+	default:
+		( ( uint32_t* )ds->columns[ col ] )[ row ]	= code;
+		break;
+	}
+
+	return 0;
+}
+
+/*
+	release memory of encoded dataset
+*/
+void dataset_free( dataset_t *ds )
+{
+	long				col;
+
+	for( col = 0; ds->dicts != NULL && col < ds->cols; col++ ) {
+		dict_free( ds->dicts + col );
+	}
+	for( col = 0; ds->columns != NULL && col < ds->cols; col++ ) {
+		free( ds->columns[ col ] );
+	}
+	free( ds->dicts );
+	free( ds->widths );
+	free( ds->columns );
+	free( ds->weights );
+	memset( ds, 0, sizeof( dataset_t ) );
+}
+
+/*
+	allocate an empty encoded dataset of given size, every column starts with 1 byte codes
+	returns 0 or -1 on memory error
+*/
+int dataset_init( dataset_t *ds, long cols, long rows )
+{
+	long				col;
+
+	memset( ds, 0, sizeof( dataset_t ) );
+	ds->cols		= cols;
+	ds->rows		= rows;
+	ds->max_rows	= rows;
+
+	do {
+		ds->dicts	= calloc( cols, sizeof( dict_t ) );
+		ds->widths	= calloc( cols, sizeof( int ) );
+		ds->columns	= calloc( cols, sizeof( void* ) );
+		if( ds->dicts == NULL || ds->widths == NULL || ds->columns == NULL ) {
+			break;
+		}
+		for( col = 0; col < cols; col++ ) {
+			if( dict_init( ds->dicts + col ) != 0 || ( ds->columns[ col ] = malloc( rows > 0 ? rows : 1 ) ) == NULL ) {
+				break;
+			}
+			ds->widths[ col ] = 1;
+		}
+		if( col < cols ) {
+			break;
+		}
+
+		return 0;
+	} while( 0 );
+
+	dataset_free( ds );
+	return -1;
+}
+
+/*
+	make room for rows samples of encoded dataset, number of samples is left to caller
+	once rows are stored; room of columns grows by doubling so that appending rows one
+	batch at a time costs a linear copy
+	returns 0 or -1 on memory error
+*/
+int dataset_reserve( dataset_t *ds, long rows )
+{
+	long				max_rows		= ds->max_rows;
+	void				*ptr			= NULL;
+	long				col;
+
+	if( rows > max_rows ) {
+		max_rows = ( rows > 2 * max_rows ) ? rows : 2 * max_rows;
+		for( col = 0; col < ds->cols; col++ ) {
+			if( ( ptr = realloc( ds->columns[ col ], ( size_t )ds->widths[ col ] * max_rows ) ) == NULL ) {
+				return -1;
+			}
+			ds->columns[ col ] = ptr;
+		}
+		ds->max_rows = max_rows;
+	}
+
+	return 0;
+}
+
+/*
+	store a cell of encoded dataset given its string of len bytes ( not necessarily NUL
+	terminated ), the string is added to column's catalog when first seen
+	returns 0 or -1 on memory error
+*/
+int dataset_set( dataset_t *ds, long col, long row, const char *name, long len )
+{
+	long				code			= dict_intern( ds->dicts + col, name, len );
+
+	if( code < 0 ) {
+		return -1;
+	}
+
+	return ds_store( ds, col, row, code );
+}
+
+/*
+	slot of hash table of unique rows
+*/
+typedef struct dedup_slot_tag {
+	uint64_t			hash;
+	long				row;			// unique row, -1 if slot is empty
+} dedup_slot_t;
+
+/*
+	hash table of unique rows with twice the slots, kept at most half full
+	returns 0 or -1 on memory error
+*/
+static int dedup_grow( dedup_slot_t **slots, long *mask )
+{
+	dedup_slot_t		*grown			= NULL;
+	long				grown_mask		= *mask * 2 + 1;
+	long				slot, i;
+
+	if( ( grown = malloc( sizeof( dedup_slot_t ) * ( grown_mask + 1 ) ) ) == NULL ) {
+		return -1;
+	}
+	for( slot = 0; slot <= grown_mask; slot++ ) {
+		grown[ slot ].row = -1;
+	}
+	for( i = 0; *slots != NULL && i <= *mask; i++ ) {
+		if( ( *slots )[ i ].row < 0 ) {
+			continue;
+		}
+		for( slot = ( *slots )[ i ].hash & grown_mask; grown[ slot ].row >= 0; slot = ( slot + 1 ) & grown_mask );
+		grown[ slot ] = ( *slots )[ i ];
+	}
+	free( *slots );
+	*slots	= grown;
+	*mask	= grown_mask;
+
+	return 0;
+}
+
+/*
+	collapse duplicate rows of an encoded dataset into unique rows weighing as many rows
+	as they stand for. Unique rows keep order of their first occurrence, so the first
+	sample of any set of rows is the same before and after collapsing and training gives
+	the same tree. Rows are read a block at a time, a column after the other, and unique
+	ones are kept row by row while they are compared, then moved into columns; catalogs
+	are shared with ds ( dicts of unique must be set to NULL before dataset_free ).
+	Collapsing is given up as soon as unique rows exceed half of rows, or half of the
+	first eighth of rows: rows not halving there are not expected to halve at all
+	returns 0, 1 if rows would not halve ( unique is left empty ) or -1 on memory error
+*/
+int dataset_dedup( dataset_t *unique, const dataset_t *ds )
+{
+	load_func_t			load			= load_select();
+	uint64_t			hashes[ COUNT_BLOCK ];
+	uint32_t			*block			= NULL;		// codes of a block of rows, column by column
+	uint32_t			*keys			= NULL;		// codes of each unique row
+	uint32_t			*key			= NULL;
+	dedup_slot_t		*slots			= NULL;
+	void				*ptr			= NULL;
+	long				cols			= ds->cols;
+	long				max_unique		= ds->rows / 2;
+	long				max_keys		= 0;
+	long				mask			= 511;
+	long				checked			= 0;
+	long				first, tot, col, slot, u, k;
+	uint64_t			hash;
+	int					result			= 0;
+
+	// hash table and unique rows grow with unique rows found, so that few of them stay in cache
+	memset( unique, 0, sizeof( dataset_t ) );
+	if( ( block = malloc( sizeof( uint32_t ) * cols * COUNT_BLOCK ) ) == NULL || dedup_grow( &slots, &mask ) != 0 ) {
+		result = -1;
+	}
+
+	for( first = 0; result == 0 && first < ds->rows; first += COUNT_BLOCK ) {
+		tot = ( ds->rows - first < COUNT_BLOCK ) ? ds->rows - first : COUNT_BLOCK;
+		memset( hashes, 0, sizeof( uint64_t ) * tot );
+		for( col = 0; col < cols; col++ ) {
+			load( ds->columns[ col ], ds->widths[ col ], first, tot, block + col * COUNT_BLOCK );
+			for( k = 0; k < tot; k++ ) {
+				hashes[ k ] = ( hashes[ k ] ^ block[ col * COUNT_BLOCK + k ] ) * 0x100000001b3ULL;
+			}
+		}
+		for( k = 0; k < tot; k++ ) {
+			hash = ( hashes[ k ] ^ ( hashes[ k ] >> 33 ) ) * 0xff51afd7ed558ccdULL;
+			hash = hash ^ ( hash >> 33 );
+			for( slot = hash & mask; ( u = slots[ slot ].row ) >= 0; slot = ( slot + 1 ) & mask ) {
+				if( slots[ slot ].hash != hash ) {
+					continue;
+				}
+				for( key = keys + u * cols, col = 0; col < cols && key[ col ] == block[ col * COUNT_BLOCK + k ]; col++ );
+				if( col == cols ) {
+					break;
+				}
+			}
+			if( u >= 0 ) {
+				unique->weights[ u ] += 1;
+				continue;
+			}
+			if( unique->rows == max_unique ) {
+				result = 1;
+				break;
+			}
+			if( unique->rows == max_keys ) {
+				max_keys = ( max_keys * 2 < max_unique ) ? ( max_keys ? max_keys * 2 : 1024 ) : max_unique;
+				if( ( ptr = realloc( keys, sizeof( uint32_t ) * cols * max_keys ) ) == NULL ) {
+					result = -1;
+					break;
+				}
+				keys = ptr;
+				if( ( ptr = realloc( unique->weights, sizeof( long ) * max_keys ) ) == NULL ) {
+					result = -1;
+					break;
+				}
+				unique->weights = ptr;
+			}
+			if( unique->rows * 2 >= mask && dedup_grow( &slots, &mask ) != 0 ) {
+				result = -1;
+				break;
+			}
+			// slot of a new row is found again in the grown table
+			for( slot = hash & mask; slots[ slot ].row >= 0; slot = ( slot + 1 ) & mask );
+			u						= unique->rows++;
+			slots[ slot ].hash		= hash;
+			slots[ slot ].row		= u;
+			unique->weights[ u ]	= 1;
+			for( key = keys + u * cols, col = 0; col < cols; col++ ) {
+				key[ col ] = block[ col * COUNT_BLOCK + k ];
+			}
+		}
+		if( !checked && first + tot >= ds->rows / 8 ) {
+			checked = 1;
+			result	= ( result == 0 && unique->rows * 2 > first + tot ) ? 1 : result;
+		}
+	}
+	free( block );
+	free( slots );
+
+	// unique rows go into columns as wide as those of ds
+	unique->cols		= cols;
+	unique->max_rows	= unique->rows;
+	unique->dicts		= ds->dicts;
+	if( result == 0 ) {
+		unique->widths	= malloc( sizeof( int ) * cols );
+		unique->columns	= calloc( cols, sizeof( void* ) );
+		result			= ( unique->widths == NULL || unique->columns == NULL ) ? -1 : 0;
+	}
+	for( col = 0; result == 0 && col < cols; col++ ) {
+		unique->widths[ col ] = ds->widths[ col ];
+		if( ( unique->columns[ col ] = malloc( ( size_t )ds->widths[ col ] * ( unique->rows + 1 ) ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		for( u = 0; u < unique->rows; u++ ) {
+			ds_store( unique, col, u, keys[ u * cols + col ] );
+		}
+	}
+	free( keys );
+	if( result != 0 ) {
+		unique->dicts = NULL;
+		dataset_free( unique );
+	}
+
+	return result;
+}
+
+/*
+	translate string dataset into encoded dataset: every column has its own dictionary, so
+	each cell costs a single hash lookup whatever the number of distinct strings
+	- ds:		dataset to fill
+	- data:		pointer to string dataset ( cols * rows )
+	returns 0 or -1 on memory error
+*/
+int id3_encode( dataset_t *ds, char **data, long cols, long rows )
+{
+	long				i, col;
+
+	if( dataset_init( ds, cols, rows ) != 0 ) {
+		return -1;
+	}
+
+	for( i = 0; i < rows; i++ ) {
+		for( col = 0; col < cols; col++ ) {
+			if( dataset_set( ds, col, i, data[ i * cols + col ], strlen( data[ i * cols + col ] ) ) != 0 ) {
+				dataset_free( ds );
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+	parse catalogs of numeric columns into numbers, a value must be a finite number
+	written as strtod reads it and nothing else
+	- numeric:	flag of each column, NULL if no column is numeric
+	returns 0, -1 if a value is not a number or the class column is numeric, -2 on
+	memory error; numbers is NULL if no column is numeric
+*/
+int numbers_parse( double ***numbers, const dataset_t *ds, const char *numeric )
+{
+	double				**nums			= NULL;
+	double				*values			= NULL;
+	const char			*name			= NULL;
+	char				*end			= NULL;
+	long				tot_values		= 0;
+	long				col, code;
+
+	*numbers = NULL;
+	if( numeric == NULL ) {
+		return 0;
+	}
+	if( numeric[ ds->cols - 1 ] ) {
+		return -1;
+	}
+	for( col = 0; col < ds->cols - 1; col++ ) {
+		tot_values += numeric[ col ] ? DS_VALUES( ds, col ) + 1 : 0;
+	}
+	if( tot_values == 0 ) {
+		return 0;
+	}
+
+	// values follow the array of columns
+	if( ( nums = malloc( sizeof( double* ) * ds->cols + sizeof( double ) * tot_values ) ) == NULL ) {
+		return -2;
+	}
+	values = ( double* )( nums + ds->cols );
+	for( col = 0; col < ds->cols; col++ ) {
+		nums[ col ] = NULL;
+		if( col == ds->cols - 1 || !numeric[ col ] ) {
+			continue;
+		}
+		nums[ col ] = values;
+		for( code = 0; code < DS_VALUES( ds, col ); code++ ) {
+			name			= DICT_NAME( ds->dicts + col, code );
+			values[ code ]	= strtod( name, &end );
+			if( end == name || *end != '\0' || !isfinite( values[ code ] ) ) {
+				free( nums );
+				return -1;
+			}
+		}
+		values += DS_VALUES( ds, col ) + 1;
+	}
+
+	*numbers = nums;
+	return 0;
+}
+
+/*
+	set default training parameters
+*/
+void id3_params_init( id3_params_t *params )
+{
+	memset( params, 0, sizeof( id3_params_t ) );
+	params->threads	= 1;
+	params->memory	= 256L * 1024 * 1024;
+	params->trees	= 1;
+	params->seed	= 1;
+}
+
+/*
+	create a model from an encoded dataset: column names are copied, tree is built and
+	compiled into the flat array kept by model; catalogs of values are left to caller
+	- spill:	codes of dataset spilled to files for out-of-core training, NULL if ds
+				holds them
+	returns 0, -1 if a value of a numeric column is not a number or numeric columns, a
+	forest, random attributes or limits of tree are asked with update parameter, -2 on memory error for
+	model, -4 for tree or -5 for compiled tree
+*/
+static int model_build( id3_model_t **model, const dataset_t *ds, char **column_names, const id3_params_t *params, spill_t *spill )
+{
+	id3_model_t			*mdl			= NULL;
+	id3_stats_t			*stats			= params->stats;
+	tree_t				tree;
+	double				start			= 0;
+	size_t				names_sz		= 0;
+	char				*nameptr		= NULL;
+	int					result			= 0;
+	long				col;
 
-	return result;
-}
-
+	*model = NULL;
+	memset( &tree, 0, sizeof( tree_t ) );
+	do {
+		// column names are copied into a single block after the model
+		for( col = 0; col < ds->cols; col++ ) {
+			names_sz += strlen( column_names[ col ] ) + 1;
+		}
+		if( ( mdl = calloc( 1, sizeof( id3_model_t ) + sizeof( char* ) * ds->cols + names_sz ) ) == NULL ) {
+			result = -2;
+			break;
+		}
+		mdl->cols			= ds->cols;
+		mdl->stats			= stats;
+		mdl->column_names	= ( char** )( mdl + 1 );
+		nameptr				= ( char* )( mdl->column_names + ds->cols );
+		for( col = 0; col < ds->cols; col++ ) {
+			mdl->column_names[ col ] = nameptr;
+			strcpy( nameptr, column_names[ col ] );
+			nameptr += strlen( nameptr ) + 1;
+		}
+
+		// numbers of numeric columns, trees that can be updated have none
+		if( ( result = numbers_parse( &mdl->numbers, ds, params->numeric ) ) != 0 ) {
+			break;
+		}
+		if( ( mdl->numbers != NULL || params->trees > 1 || params->features > 0 || params->max_depth > 0 ||
+			params->min_leaf > 1 ) && params->update ) {
+			result = -1;
+			break;
+		}
+
+		// debug catalog of values
+#ifdef DO_DEBUG
+		long i, j;
+		for( j = 0; j < ds->cols; j++ ) {
+			for( i = 0; i < DS_VALUES( ds, j ); i++ ) {
+				printf( "name %-12s value %3ld column %3ld\n", DICT_NAME( ds->dicts + j, i ), i, j );
+			}
+		}
+#endif
+
+		// a model that can be updated builds its own tree, which keeps counts of nodes
+		if( params->update ) {
+			if( stats != NULL ) {
+				stats->train_wall	= stats_wall();
+				stats->train_cpu	= stats_cpu();
+			}
+			if( update_create( &mdl->update, ds ) != 0 ) {
+				result = -4;
+				break;
+			}
+			if( stats != NULL ) {
+				stats->train_wall	= stats_wall() - stats->train_wall;
+				stats->train_cpu	= stats_cpu() - stats->train_cpu;
+				stats->unique_rows	= ds->rows;
+				start				= stats_wall();
+			}
+			if( update_compile( mdl->update, ds->dicts, &mdl->flat, stats ) != 0 ) {
+				result = -5;
+				break;
+			}
+		} else if( params->trees > 1 ) {
+			// trees of a forest are compiled as soon as they are built, then joined
+			if( ( mdl->roots = malloc( sizeof( long ) * params->trees ) ) == NULL ) {
+				result = -4;
+				break;
+			}
+			mdl->tot_trees = params->trees;
+			if( forest_build( &mdl->flat, mdl->roots, ds, ( const double *const* )mdl->numbers, params ) != 0 ) {
+				result = -4;
+				break;
+			}
+			if( stats != NULL ) {
+				start = stats_wall();
+			}
+		} else {
+			// create tree and children nodes, level by level from files of a spilled dataset
+			if( spill != NULL ) {
+				result = spill_build( &tree, spill, ( const double *const* )mdl->numbers, params );
+			} else {
+				result = tree_build( &tree, ds, ( const double *const* )mdl->numbers, params, NULL );
+			}
+			if( result != 0 ) {
+				result = -4;
+				break;
+			}
+
+			// prediction and rules walk a flat copy of the tree
+			if( stats != NULL ) {
+				start = stats_wall();
+			}
+			if( flat_compile( &mdl->flat, &tree, DS_VALUES( ds, ds->cols - 1 ) ) != 0 ) {
+				result = -5;
+				break;
+			}
+		}
+		if( stats != NULL ) {
+			stats->compile_wall		+= stats_wall() - start;
+			stats->flat_bytes		= sizeof( int32_t ) * mdl->flat.size;
+			stats->bytes_allocated	+= stats->flat_bytes;
+		}
+	} while( 0 );
+	tree_free( &tree );
+
+	if( result != 0 ) {
+		id3_destroy( mdl );
+		return result;
+	}
+
+	*model = mdl;
+	return 0;
+}
+
+/*
+	train a decision tree on a string dataset, the model keeps tree, catalogs of values
+	and column names; training buffers and encoded dataset are released
+	returns 0, -1 on wrong parameters or a negative value on memory error
+*/
+int id3_train( id3_model_t **model, char **data, long cols, long rows, char **column_names, const id3_params_t *params )
+{
+	id3_params_t		defaults;
+	dataset_t			dataset;					// encoded dataset, codes instead of strings
+	int					result			= 0;
+
+	DEBUG( "ID3 Init: cols = %d rows = %d dataset %p\n", cols, rows, data );
+
+	*model = NULL;
+	if( data == NULL || cols < 2 || rows < 0 || column_names == NULL ) {
+		return -1;
+	}
+	if( params == NULL ) {
+		id3_params_init( &defaults );
+		params = &defaults;
+	}
+	if( params->stats != NULL ) {
+		memset( params->stats, 0, sizeof( id3_stats_t ) );
+		params->stats->encode_wall	= stats_wall();
+		params->stats->encode_cpu	= stats_cpu();
+	}
+
+	// integer values comparison is faster than string comparison,
+	// we create a copy of dataset with unique numbers instead of strings
+	if( id3_encode( &dataset, data, cols, rows ) != 0 ) {
+		return -3;
+	}
+	if( params->stats != NULL ) {
+		params->stats->encode_wall	= stats_wall() - params->stats->encode_wall;
+		params->stats->encode_cpu	= stats_cpu() - params->stats->encode_cpu;
+	}
+
+	if( ( result = model_build( model, &dataset, column_names, params, NULL ) ) == 0 ) {
+		// catalogs are needed to translate strings at prediction time
+		( *model )->dicts	= dataset.dicts;
+		dataset.dicts		= NULL;
+	}
+
+	// encoded dataset is not needed anymore
+	dataset_free( &dataset );
+
+	return result;
+}
+
+/*
+	train a decision tree on a dataset loaded from file, dataset can be used again
+	returns 0, -1 on wrong parameters or a negative value on memory error
+*/
+int id3_train_data( id3_model_t **model, const id3_data_t *data, const id3_params_t *params )
+{
+	id3_params_t		defaults;
+	int					result			= 0;
+	long				col;
+
+	*model = NULL;
+	if( data == NULL ) {
+		return -1;
+	}
+	if( params == NULL ) {
+		id3_params_init( &defaults );
+		params = &defaults;
+	}
+	if( params->stats != NULL ) {
+		memset( params->stats, 0, sizeof( id3_stats_t ) );
+	}
+
+	if( ( result = model_build( model, &data->ds, data->column_names, params, NULL ) ) != 0 ) {
+		return result;
+	}
+
+	// model keeps its own copy of catalogs
+	if( ( ( *model )->dicts = calloc( data->ds.cols, sizeof( dict_t ) ) ) == NULL ) {
+		result = -3;
+	}
+	for( col = 0; result == 0 && col < data->ds.cols; col++ ) {
+		if( dict_copy( ( *model )->dicts + col, data->ds.dicts + col ) != 0 ) {
+			result = -3;
+		}
+	}
+	if( result != 0 ) {
+		id3_destroy( *model );
+		*model = NULL;
+	}
+
+	return result;
+}
+
+/*
+	train a decision tree on a delimited text file out of core: codes are spilled to
+	temporary files and only catalogs are moved into model
+	returns 0, -1 on wrong parameters, -2 on file error, -3 on malformed file or -4 on
+	memory error
+*/
+int id3_train_file( id3_model_t **model, const char *path, char delim, long class_col, const id3_params_t *params )
+{
+	id3_params_t		defaults;
+	spill_t				spill;
+	int					result			= 0;
+
+	*model = NULL;
+	if( params == NULL ) {
+		id3_params_init( &defaults );
+		params = &defaults;
+	}
+	if( params->update || params->trees > 1 || params->features > 0 ) {
+		return -1;
+	}
+	if( params->stats != NULL ) {
+		memset( params->stats, 0, sizeof( id3_stats_t ) );
+		params->stats->encode_wall	= stats_wall();
+		params->stats->encode_cpu	= stats_cpu();
+	}
+
+	if( ( result = spill_create( &spill, path, delim, class_col, params ) ) == 0 ) {
+		if( params->stats != NULL ) {
+			params->stats->encode_wall	= stats_wall() - params->stats->encode_wall;
+			params->stats->encode_cpu	= stats_cpu() - params->stats->encode_cpu;
+		}
+		if( ( result = model_build( model, &spill.ds, spill.column_names, params, &spill ) ) == 0 ) {
+			( *model )->dicts	= spill.ds.dicts;
+			spill.ds.dicts		= NULL;
+		} else if( spill.io_error ) {
+			result = -2;
+		} else if( result != -1 ) {
+			result = -4;
+		}
+	}
+	spill_free( &spill );
+
+	return result;
+}
+
+/*
+	train a decision tree on rows held by worker processes, catalogs of workers are
+	merged by coordinator and moved into model
+	returns 0, -1 on wrong parameters, -2 if a worker cannot be reached or fails, -3 if
+	shards do not match or -4 on memory error
+*/
+int id3_train_workers( id3_model_t **model, const char *const *addresses, long tot_workers, const id3_params_t *params )
+{
+	id3_params_t		defaults;
+	spill_t				spill;
+	long				worker;
+	int					result			= 0;
+
+	*model = NULL;
+	if( params == NULL ) {
+		id3_params_init( &defaults );
+		params = &defaults;
+	}
+	if( params->update || params->trees > 1 || params->features > 0 || addresses == NULL || tot_workers < 1 ) {
+		return -1;
+	}
+	for( worker = 0; worker < tot_workers; worker++ ) {
+		if( addresses[ worker ] == NULL ) {
+			return -1;
+		}
+	}
+	if( params->stats != NULL ) {
+		memset( params->stats, 0, sizeof( id3_stats_t ) );
+		params->stats->encode_wall	= stats_wall();
+		params->stats->encode_cpu	= stats_cpu();
+	}
+
+	if( ( result = spill_connect( &spill, addresses, tot_workers, params ) ) == 0 ) {
+		if( params->stats != NULL ) {
+			params->stats->encode_wall	= stats_wall() - params->stats->encode_wall;
+			params->stats->encode_cpu	= stats_cpu() - params->stats->encode_cpu;
+		}
+		if( ( result = model_build( model, &spill.ds, spill.column_names, params, &spill ) ) == 0 ) {
+			( *model )->dicts	= spill.ds.dicts;
+			spill.ds.dicts		= NULL;
+		} else if( spill.io_error ) {
+			result = -2;
+		} else if( result != -1 ) {
+			result = -4;
+		}
+	}
+	spill_free( &spill );
+
+	return result;
+}
+
+/*
+	release a model
+*/
+void id3_destroy( id3_model_t *model )
+{
+	fmap_t				map;
+	long				col;
+
+	if( model == NULL ) {
+		return;
+	}
+	// a loaded model points into its file, descriptor is its only allocation
+	if( model->map != NULL ) {
+		map.base	= model->map;
+		map.size	= model->map_size;
+		fmap_close( &map );
+		free( model );
+		return;
+	}
+	flat_free( &model->flat );
+	free( model->roots );
+	update_free( model->update );
+	free( model->numbers );
+	for( col = 0; model->dicts != NULL && col < model->cols; col++ ) {
+		dict_free( model->dicts + col );
+	}
+	free( model->dicts );
+	free( model );
+}
+
+/*
+	code of a value of a column, -1 if value was never seen in training
+*/
+long id3_value_code( const id3_model_t *model, long col, const char *name )
+{
+	if( col < 0 || col >= model->cols || name == NULL ) {
+		return -1;
+	}
+
+	return dict_lookup( model->dicts + col, name, strlen( name ) );
+}
+
+/*
+	name of a class, NULL if class does not exist
+*/
+const char *id3_class_name( const id3_model_t *model, long class_id )
+{
+	if( class_id < 0 || class_id >= model->dicts[ model->cols - 1 ].tot_values ) {
+		return NULL;
+	}
+
+	return DICT_NAME( model->dicts + model->cols - 1, class_id );
+}
+
+/*
+	print rules of a model
+*/
+int id3_print_rules( const id3_model_t *model )
+{
+	return id3_write_rules( model, stdout, ID3_RULES_TEXT );
+}
+
+/*
+	try to find dataset rules
+*/
+int id3_get_rules( char **data, long cols, long rows, char **column_names )
+{
+	id3_model_t			*model			= NULL;
+	int					result			= 0;
+
+	if( ( result = id3_train( &model, data, cols, rows, column_names, NULL ) ) != 0 ) {
+		return result;
+	}
+	result = id3_print_rules( model );
+	id3_destroy( model );
+
+	return result;
+}
 
@@ -26,12 +26,439 @@
     OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#ifndef ID3_H_INCLUDED
-#define ID3_H_INCLUDED
-
+#ifndef ID3_H_INCLUDED
+#define ID3_H_INCLUDED
+
+#include <stdio.h>
+
 /*
 	try to find dataset rules
 */
 int id3_get_rules( char **data, long cols, long rows, char **column_names );
-
-#endif // ID3_H_INCLUDED
+
+/*
+	trained decision tree, data of model is private to library
+*/
+typedef struct id3_model_tag id3_model_t;
+
+/*
+	statistics of training and rule extraction; times are in seconds, split and
+	partition times are summed over training threads
+*/
+typedef struct id3_stats_tag {
+	double				encode_wall;		// translation of strings into codes ( id3_train )
+	double				encode_cpu;
+	double				train_wall;			// tree building
+	double				train_cpu;			// all threads
+	double				split_time;			// counting of samples and info gains
+	double				partition_time;		// moving samples into children
+	double				compile_wall;		// flat tree for prediction
+	double				rules_wall;			// rule extraction, summed over every extraction
+	double				rules_cpu;
+	long				nodes;				// nodes created
+	long				leaves;				// nodes without branches
+	long				max_depth;			// branches from root to deepest node
+	long				gain_evals;			// info gains calculated
+	long				samples_touched;	// codes read by split evaluation and partition
+	long				unique_rows;		// samples trained once duplicate rows are collapsed
+	long				rules;				// rules of model, as the last extraction found them
+	size_t				bytes_allocated;	// memory requested by training
+	size_t				tree_bytes;			// peak memory of tree nodes
+	size_t				flat_bytes;			// memory of flat tree kept by model
+} id3_stats_t;
+
+/*
+	training parameters
+*/
+typedef struct id3_params_tag {
+	long				threads;		// training threads, 0 uses every processor ( default 1 )
+	int					update;			// model keeps training rows and counts of nodes so that
+										// id3_update can add rows, tree is built serially ( default 0 )
+	const char			*numeric;		// one flag for each column, columns flagged with a value other
+										// than zero hold numbers and are split by a threshold ( x <= t
+										// and x > t ) instead of one branch for each value; class
+										// column cannot be numeric. NULL if no column is ( default )
+	id3_stats_t			*stats;			// statistics filled by training and by rule extraction of
+										// trained model, NULL to disable ( default ); it must stay
+										// valid while the model is used
+	size_t				memory;			// memory budget of id3_train_file in bytes, nodes whose count
+										// tables do not fit together are counted by more passes
+										// ( default 256 MB )
+	const char			*spill_dir;		// directory of temporary files of id3_train_file, NULL uses
+										// TMPDIR or /tmp ( default )
+	long				trees;			// trees of a bagged forest, each one trained on a bootstrap
+										// sample of rows; prediction takes the class voted by most
+										// trees. 1 trains a single tree on all rows ( default 1 )
+	long				features;		// attributes drawn at random at each node, the others are not
+										// evaluated there; 0 draws none for a single tree and square
+										// root of attributes for trees of a forest ( default 0 )
+	unsigned long		seed;			// seed of random draws, same seed gives same model ( default 1 )
+	long				max_depth;		// nodes this many branches below root are terminal nodes of
+										// their majority class, 0 for no limit ( default 0 )
+	long				min_leaf;		// samples each child of a split needs at least, nodes that
+										// cannot be split so get their majority class; 0 or 1 for no
+										// limit ( default 0 )
+} id3_params_t;
+
+/*
+	set default training parameters
+*/
+void id3_params_init( id3_params_t *params );
+
+/*
+	train a model on a dataset of strings ( cols * rows, class is the last column ),
+	params may be NULL for default parameters
+	returns 0, -1 on wrong parameters ( a value of a numeric column is not a number, a
+	forest, random attributes or limits of tree with update parameter ) or a negative
+	value on memory error
+*/
+int id3_train( id3_model_t **model, char **data, long cols, long rows, char **column_names, const id3_params_t *params );
+
+/*
+	add rows of strings ( cols * rows, class is the last column ) to a model trained with
+	update parameter: counts of nodes along paths of rows are updated and only subtrees
+	whose best split changes are built again, so the model is the one training on all
+	rows in the same order would give
+	returns 0, -1 on wrong parameters or if model cannot be updated ( model was trained
+	without update parameter, has numeric columns or a previous update failed with -4 or
+	-5 ), -3 on memory error storing rows ( model is left as it was ) or -4 / -5 on memory
+	error updating the tree ( counts are partly updated, model must be destroyed )
+*/
+int id3_update( id3_model_t *model, char **data, long rows );
+
+/*
+	dataset loaded from a delimited text file, data is private to library
+*/
+typedef struct id3_data_tag id3_data_t;
+
+/*
+	load a delimited text file ( CSV, TSV ): first line holds column names, every other
+	line a sample. delim 0 chooses tab if header has one, comma otherwise; class_col is
+	the column holding the class ( -1 for last one ), it is moved after attributes
+	returns 0, -1 on wrong parameters, -2 if file cannot be read, -3 on malformed file
+	or -4 on memory error
+*/
+int id3_data_load( id3_data_t **data, const char *path, char delim, long class_col );
+
+/*
+	number of samples of a loaded dataset
+*/
+long id3_data_rows( const id3_data_t *data );
+
+/*
+	release a loaded dataset
+*/
+void id3_data_destroy( id3_data_t *data );
+
+/*
+	train a model on a loaded dataset, params may be NULL for default parameters
+	returns 0, -1 on wrong parameters or a negative value on memory error
+*/
+int id3_train_data( id3_model_t **model, const id3_data_t *data, const id3_params_t *params );
+
+/*
+	train a model on a delimited text file that may not fit in memory ( see id3_data_load
+	for delim and class_col ): codes of each column are written to temporary files and the
+	tree grows one level at a time, every level reading the files from start to end ( a
+	node whose rows fit in memory has its subtree trained there ), so memory of training
+	stays within memory parameter ( catalogs of values and tree nodes apart ) whatever the
+	number of rows. Tree is the one id3_train gives, it is built serially and cannot be
+	updated, be a forest or draw attributes
+	returns 0, -1 on wrong parameters ( memory too small for count tables of a node ), -2
+	if file cannot be read or temporary files cannot be written, -3 on malformed file or
+	-4 on memory error
+*/
+int id3_train_file( id3_model_t **model, const char *path, char delim, long class_col, const id3_params_t *params );
+
+/*
+	train a model on a dataset sharded by rows across worker processes, each one serving
+	its shard with id3_worker_serve at an address ( "unix:PATH" for a Unix domain socket,
+	"HOST:PORT" for TCP ). Rows never move: tree grows one level at a time as in
+	id3_train_file, every worker counts its rows for the nodes of a level and the count
+	tables are summed before splits are chosen and sent back. Catalogs of workers are
+	merged in order of addresses, so tree is the one id3_train_file gives on the shards
+	joined in that order. Same parameters apply as to id3_train_file, memory bounds count
+	tables of a pass on coordinator and on workers
+	returns 0, -1 on wrong parameters ( an address is wrong, memory too small for count
+	tables of a node ), -2 if a worker cannot be reached or fails, -3 if shards have
+	different columns or -4 on memory error
+*/
+int id3_train_workers( id3_model_t **model, const char *const *addresses, long tot_workers, const id3_params_t *params );
+
+/*
+	serve a shard of rows to the coordinator of a distributed training ( see
+	id3_train_workers ): listen at address, accept a single coordinator and count rows of
+	data for it until its tree is built. Columns and class column must be the same in
+	every shard
+	returns 0, -1 on wrong parameters, -2 on socket error or if coordinator goes away,
+	-3 on malformed message or a value of a numeric column not a number or -4 on memory
+	error
+*/
+int id3_worker_serve( const id3_data_t *data, const char *address );
+
+/*
+	point of a grid of tree limits evaluated by id3_cross_validate: limits are set by
+	caller, results are filled
+*/
+typedef struct id3_cv_point_tag {
+	long				max_depth;		// as training parameter, 0 for no limit
+	long				min_leaf;		// as training parameter, 0 or 1 for no limit
+	double				accuracy;		// rows classified right when held out, over all rows
+	double				train_wall;		// seconds training trees the point is read from ( points
+										// sharing min_leaf share them ), folds summed
+	double				predict_wall;	// seconds classifying held out rows, share of the point
+										// when its tree serves more points, folds summed
+} id3_cv_point_t;
+
+/*
+	k-fold cross validation of a grid of points on a dataset of strings ( cols * rows,
+	class is the last column ): dataset is encoded once, rows are dealt to folds at random
+	( seed parameter ) and each fold is held out in turn while the others train. Folds are
+	masks over the shared encoded rows, and points sharing min_leaf share their trees: a
+	fold trains a single tree at the largest depth of those points, every depth is read by
+	cutting it, so splits near root are counted once for all depths. Trees are tasks of a
+	thread pool ( threads parameter ), each one built serially. Other parameters apply as
+	to id3_train, statistics are not filled
+	returns 0, -1 on wrong parameters ( less than 2 folds or more folds than rows, a value
+	of a numeric column is not a number, a forest or update parameter ) or a negative
+	value on memory error
+*/
+int id3_cross_validate( char **data, long cols, long rows, long folds, id3_cv_point_t *points, long tot_points, const id3_params_t *params );
+
+/*
+	k-fold cross validation of a grid of points on a dataset loaded from file ( see
+	id3_cross_validate ), dataset can be used again
+	returns 0, -1 on wrong parameters or a negative value on memory error
+*/
+int id3_cross_validate_data( const id3_data_t *data, long folds, id3_cv_point_t *points, long tot_points, const id3_params_t *params );
+
+/*
+	classify a row of cols - 1 attribute strings, returns class or -1 if model has no
+	rule for the row ( samples reaching its terminal node were totally random ). A value
+	without a branch at a node, unknown to model or not found there in training, gets the
+	majority class of node; values of numeric columns need not be known to model, they are
+	compared with thresholds of the tree. A forest returns the class voted by most trees
+	( lowest class on ties ), trees without a rule for the row do not vote
+*/
+long id3_predict( const id3_model_t *model, char **row );
+
+/*
+	classify rows of attribute strings ( rows * ( cols - 1 ) ), one class for each row; a forest
+	walks a block of rows down one tree after the other, so each tree stays in cache
+	returns 0 or -4 on memory error ( forests only )
+*/
+int id3_predict_batch( const id3_model_t *model, char **data, long rows, long *classes );
+
+/*
+	classify rows of attribute codes ( rows * ( cols - 1 ) ), one class for each row;
+	codes come from id3_value_code, negative codes are unknown values ( numbers of numeric
+	columns too: only values found in training have a code ); forests as id3_predict_batch
+*/
+int id3_predict_codes( const id3_model_t *model, const long *codes, long rows, long *classes );
+
+/*
+	classify rows given column by column, columns[ j ] holds codes of attribute j for
+	all rows; rows are walked down the tree in groups to hide memory latency, forests as
+	id3_predict_batch
+*/
+int id3_predict_columns( const id3_model_t *model, const long *const *columns, long rows, long *classes );
+
+/*
+	code of a value of a column, -1 if value is unknown to model
+*/
+long id3_value_code( const id3_model_t *model, long col, const char *name );
+
+/*
+	name of a class returned by prediction, NULL for unknown class
+*/
+const char *id3_class_name( const id3_model_t *model, long class_id );
+
+/*
+	save a model to a binary file, an existing file is replaced atomically
+	returns 0, -1 on wrong parameters ( forests cannot be saved ) or -2 if file cannot be
+	written
+*/
+int id3_model_save( const id3_model_t *model, const char *path );
+
+/*
+	load a model saved by id3_model_save: file is mapped in memory and used as it is,
+	processes loading the same file share its memory
+	returns 0, -1 on wrong parameters, -2 if file cannot be read, -3 on wrong format or
+	version or -4 on memory error
+*/
+int id3_model_load( id3_model_t **model, const char *path );
+
+/*
+	prediction server: models loaded from files are served on a Unix domain socket to
+	any number of clients, requests received together are scored as a single batch for
+	each model. A model is replaced by loading another file into its slot, requests
+	already being scored finish with the previous version
+
+	protocol, integers in byte order of the machine:
+	request		uint32 bytes following this word, uint32 id ( returned in reply ), uint16
+				operation, uint16 slot of model, uint32 rows; then rows * ( cols - 1 )
+				attribute values as NUL terminated strings, row after row
+	reply		uint32 bytes following this word, uint32 id of request, int32 status ( 0 or
+				-1 on wrong request, -4 on memory error ), uint32 version of model that
+				scored request; then an int32 class for each row ( -1 if model has no
+				rule for row ) or id3_server_stats_t for ID3_SERVER_STATS
+	replies of a client come back in order of its requests
+*/
+typedef struct id3_server_tag id3_server_t;
+
+#define	ID3_SERVER_PREDICT	1			// classify rows with model of slot
+#define	ID3_SERVER_STATS	2			// counters of server, slot and rows are not used
+
+#define	ID3_SERVER_SLOTS	16			// models served at once
+
+/*
+	counters of a server since it was created; latencies go from the time a request is
+	received to the time its reply is ready, in seconds
+*/
+typedef struct id3_server_stats_tag {
+	double				uptime;
+	double				latency_p50;
+	double				latency_p99;
+	double				requests_rate;		// requests per second of uptime
+	double				rows_rate;			// rows per second of uptime
+	long				requests;
+	long				rows;
+	long				batches;			// batches scored, requests of a batch share tree walks
+	long				errors;				// requests with a status other than 0
+	long				clients;			// clients connected now
+	long				reloads;			// models loaded into a slot already serving one
+} id3_server_stats_t;
+
+/*
+	create a server listening on a Unix domain socket at path ( an existing socket file is
+	replaced )
+	- max_batch:	rows scored in a batch, at most ( a request is never split ), 0 for
+					4096
+	- batch_wait:	milliseconds a request may wait for others to fill a batch, 0 scores
+					requests received together at once
+	returns 0, -1 on wrong parameters, -2 on socket error or -4 on memory error
+*/
+int id3_server_create( id3_server_t **server, const char *path, long max_batch, long batch_wait );
+
+/*
+	load a model saved by id3_model_save into a slot ( 0 .. ID3_SERVER_SLOTS - 1 ): it
+	serves requests received from now on and gets the next version, a model previously
+	in slot is released once requests it is scoring are done. It can be called from any
+	thread while server runs
+	returns 0, -1 on wrong parameters or as id3_model_load
+*/
+int id3_server_load( id3_server_t *server, long slot, const char *path );
+
+/*
+	serve requests until id3_server_stop is called
+	returns 0, -2 on socket error or -4 on memory error
+*/
+int id3_server_run( id3_server_t *server );
+
+/*
+	make id3_server_run return once requests of current batch are replied; it can be
+	called from any thread or from a signal handler
+*/
+void id3_server_stop( id3_server_t *server );
+
+/*
+	read counters of a server, from any thread
+*/
+void id3_server_stats( id3_server_t *server, id3_server_stats_t *stats );
+
+/*
+	close server socket and its clients, release models
+*/
+void id3_server_destroy( id3_server_t *server );
+
+/*
+	client of a prediction server: connect to socket at path
+	returns socket or -2 on socket error
+*/
+int id3_client_connect( const char *path );
+
+/*
+	classify rows of attribute strings ( rows * attribs ) with model of a slot of a
+	server, one class for each row; version gets version of model that scored them
+	( NULL if not needed )
+	returns 0, -1 if server refused request, -2 on socket error or a reply that does not
+	match request ( socket cannot be used any more, it is to be closed ) or -4 on memory
+	error
+*/
+int id3_client_predict( int fd, long slot, char **data, long rows, long attribs, long *classes, long *version );
+
+/*
+	rule of a class: terms are attribute / value couples from root to a terminal node,
+	names point into model and are valid only during the call to sink. A term of a
+	numeric column compares it with a threshold: value is the code of threshold and
+	operator tells which side of it the rule takes
+*/
+#define	ID3_TERM_EQ			0			// column = value
+#define	ID3_TERM_LE			1			// column <= value
+#define	ID3_TERM_GT			2			// column > value
+
+typedef struct id3_rule_tag {
+	long				class_id;
+	const char			*class_name;
+	long				tot_terms;
+	const long			*attribs;		// column of each term
+	const long			*values;		// value code of each term
+	const int			*operators;		// operator of each term ( ID3_TERM_EQ, ... )
+	const char *const	*columns;		// column name of each term
+	const char *const	*names;			// value name of each term
+} id3_rule_t;
+
+/*
+	sink of rules, returning a value other than zero stops the export
+*/
+typedef int ( *id3_rule_func_t )( const id3_rule_t *rule, void *arg );
+
+/*
+	pass every rule of every class to func in a single walk of the tree, rules come in
+	tree order ( not grouped by class )
+	returns 0, value returned by func to stop export, -1 for a forest ( rules of its trees
+	are not the ones of the model ) or -4 on memory error
+*/
+int id3_export_rules( const id3_model_t *model, id3_rule_func_t func, void *arg );
+
+/*
+	formats of id3_write_rules: text grouped by class as printed by id3_print_rules,
+	or one JSON object for each rule ( JSON lines )
+*/
+#define	ID3_RULES_TEXT		0
+#define	ID3_RULES_JSON		1
+
+/*
+	write rules of a model to a file
+	returns 0, -1 on wrong parameters, -2 on write error or -4 on memory error
+*/
+int id3_write_rules( const id3_model_t *model, FILE *fp, int format );
+
+/*
+	write a model as a standalone C source: the tree becomes nested switch statements on
+	value codes ( comparisons for thresholds of numeric columns ) and catalogs become
+	perfect hash tables, generated functions are named
+	after prefix ( prefix_classify, prefix_classify_codes, prefix_value_code and
+	prefix_class_name )
+	returns 0, -1 on wrong parameters ( a forest ), -2 on write error, -3 if a catalog has
+	no perfect hash table or -4 on memory error
+*/
+int id3_write_source( const id3_model_t *model, FILE *fp, const char *prefix );
+
+/*
+	write statistics as a JSON object
+	returns 0 or -2 on write error
+*/
+int id3_stats_json( const id3_stats_t *stats, FILE *fp );
+
+/*
+	print rules of a model to stdout
+*/
+int id3_print_rules( const id3_model_t *model );
+
+/*
+	release a model
+*/
+void id3_destroy( id3_model_t *model );
+
+#endif // ID3_H_INCLUDED
@@ -0,0 +1,129 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3_int.h"
+
+// every allocation is aligned to this size
+#define	ARENA_ALIGN			16
+
+/*
+	header of a block of memory, data follows
+*/
+struct arena_block_tag {
+	struct arena_block_tag	*next;
+	size_t					size;			// usable bytes of block
+	size_t					used;			// allocated bytes of block
+};
+
+#define	ARENA_HEADER		( ( sizeof( arena_block_t ) + ARENA_ALIGN - 1 ) & ~( size_t )( ARENA_ALIGN - 1 ) )
+
+/*
+	initialize an empty arena, memory is requested in blocks of block_size bytes
+*/
+void arena_init( arena_t *arena, size_t block_size )
+{
+	memset( arena, 0, sizeof( arena_t ) );
+	arena->block_size = block_size;
+}
+
+/*
+	allocate size bytes from arena; returns NULL on memory error
+*/
+void *arena_alloc( arena_t *arena, size_t size )
+{
+	arena_block_t		*block		= arena->blocks;
+	size_t				bytes		= 0;
+
+	size = ( size + ARENA_ALIGN - 1 ) & ~( size_t )( ARENA_ALIGN - 1 );
+
+	// current block is full: big requests get a block of their own, behind current one
+	if( block == NULL || block->used + size > block->size ) {
+		bytes = ( size > arena->block_size / 4 ) ? size : arena->block_size;
+		if( ( block = malloc( ARENA_HEADER + bytes ) ) == NULL ) {
+			return NULL;
+		}
+		block->size		= bytes;
+		block->used		= 0;
+		if( bytes == size && arena->blocks != NULL ) {
+			block->next				= arena->blocks->next;
+			arena->blocks->next		= block;
+		} else {
+			block->next				= arena->blocks;
+			arena->blocks			= block;
+		}
+		arena->allocated += ARENA_HEADER + bytes;
+	}
+
+	block->used += size;
+	return ( char* )block + ARENA_HEADER + block->used - size;
+}
+
+/*
+	release all memory of arena in one step
+*/
+void arena_free( arena_t *arena )
+{
+	arena_block_t		*block		= arena->blocks;
+	arena_block_t		*next		= NULL;
+
+	while( block != NULL ) {
+		next = block->next;
+		free( block );
+		block = next;
+	}
+	arena->blocks		= NULL;
+	arena->allocated	= 0;
+}
+
+/*
+	move all blocks of an arena into another one, source arena is left empty
+*/
+void arena_merge( arena_t *arena, arena_t *from )
+{
+	arena_block_t		*block		= from->blocks;
+
+	if( block == NULL ) {
+		return;
+	}
+	// blocks of source go behind current block of destination
+	while( block->next != NULL ) {
+		block = block->next;
+	}
+	if( arena->blocks != NULL ) {
+		block->next				= arena->blocks->next;
+		arena->blocks->next		= from->blocks;
+	} else {
+		arena->blocks			= from->blocks;
+	}
+	arena->allocated	+= from->allocated;
+	from->blocks		= NULL;
+	from->allocated		= 0;
+}
@@ -0,0 +1,707 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	code generation: a model is written as a standalone C source holding the tree as
+	nested switch statements on value codes and the catalogs of values as perfect hash
+	tables, so the compiler sees a classifier specialized for that model. Numeric nodes
+	become comparisons of numbers with thresholds written as constants
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+// seeds tried before giving up on perfect hash table of a column
+#define	PHASH_SEEDS			32
+
+// branches of a generated function: compilers slow down badly on huge functions, so
+// subtrees not fitting into the function of their parent get a function of their own
+#define	EMIT_CASES			1024
+
+/*
+	perfect hash table of a catalog: name hash picks a bucket, displacement of bucket
+	picks the slot, so every name has a slot of its own
+*/
+typedef struct phash_tag {
+	uint32_t			seed;			// seed of name hash
+	long				tot_buckets;
+	uint32_t			*displace;		// displacement of each bucket
+	int32_t				*slots;			// code of each slot, -1 if empty
+	long				tot_slots;		// power of two
+} phash_t;
+
+/*
+	state of tree emission
+*/
+typedef struct emit_tag {
+	FILE				*fp;
+	const char			*prefix;
+	const int32_t		*nodes;			// flat tree
+	double				**numbers;		// numbers of numeric columns, NULL if none is numeric
+	const char			*args;			// arguments of tree functions
+	long				tot_classes;
+	long				*cases;			// branches of subtree of each inner node
+	char				*roots;			// inner nodes emitted as functions
+} emit_t;
+
+/*
+	bucket of a catalog value, used to place biggest buckets first
+*/
+typedef struct phash_bucket_tag {
+	long				size;
+	long				first;			// first key of bucket in sorted keys
+} phash_bucket_t;
+
+/*
+	hash and mix functions, emitted as they are in generated source: they must
+	give the same results here and there
+*/
+#define	PHASH_SOURCE																				\
+"static uint32_t %s_hash( uint32_t seed, const char *name )\n"									\
+"{\n"																								\
+"\tuint32_t\t\t\thash\t\t= 2166136261u ^ seed;\n"													\
+"\n"																								\
+"\tfor( ; *name != '\\0'; name++ ) {\n"															\
+"\t\thash ^= ( unsigned char )*name;\n"															\
+"\t\thash *= 16777619u;\n"																		\
+"\t}\n"																								\
+"\n"																								\
+"\treturn hash;\n"																				\
+"}\n"																								\
+"\n"																								\
+"static uint32_t %s_mix( uint32_t hash )\n"														\
+"{\n"																								\
+"\thash ^= hash >> 16;\n"																			\
+"\thash *= 0x85ebca6bu;\n"																		\
+"\thash ^= hash >> 13;\n"																			\
+"\thash *= 0xc2b2ae35u;\n"																		\
+"\thash ^= hash >> 16;\n"																			\
+"\n"																								\
+"\treturn hash;\n"																				\
+"}\n"
+
+static uint32_t phash_hash( uint32_t seed, const char *name )
+{
+	uint32_t			hash		= 2166136261u ^ seed;
+
+	for( ; *name != '\0'; name++ ) {
+		hash ^= ( unsigned char )*name;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t phash_mix( uint32_t hash )
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/*
+	order of buckets: biggest first
+*/
+static int phash_cmp( const void *a, const void *b )
+{
+	const phash_bucket_t	*x		= a;
+	const phash_bucket_t	*y		= b;
+
+	if( x->size != y->size ) {
+		return x->size > y->size ? -1 : 1;
+	}
+
+	return x->first < y->first ? -1 : ( x->first > y->first );
+}
+
+/*
+	place buckets with a seed, each bucket tries displacements until its keys fall
+	into free slots
+	returns 0 or 1 if a bucket cannot be placed with this seed
+*/
+static int phash_place( phash_t *ph, const phash_bucket_t *buckets, const long *keys, const uint32_t *hashes )
+{
+	uint32_t			mask		= ph->tot_slots - 1;
+	uint32_t			limit		= 32 * ph->tot_slots + 1024;
+	uint32_t			disp, slot;
+	long				b, i, j, code;
+
+	for( b = 0; b < ph->tot_buckets && buckets[ b ].size > 0; b++ ) {
+		for( disp = 0; disp < limit; disp++ ) {
+			for( i = 0; i < buckets[ b ].size; i++ ) {
+				code = keys[ buckets[ b ].first + i ];
+				slot = phash_mix( hashes[ code ] ^ disp ) & mask;
+				if( ph->slots[ slot ] >= 0 ) {
+					break;
+				}
+				ph->slots[ slot ] = code;
+			}
+			if( i == buckets[ b ].size ) {
+				break;
+			}
+			// release slots taken by this attempt
+			for( j = 0; j < i; j++ ) {
+				code = keys[ buckets[ b ].first + j ];
+				ph->slots[ phash_mix( hashes[ code ] ^ disp ) & mask ] = -1;
+			}
+		}
+		if( disp == limit ) {
+			return 1;
+		}
+		ph->displace[ hashes[ keys[ buckets[ b ].first ] ] % ph->tot_buckets ] = disp;
+	}
+
+	return 0;
+}
+
+/*
+	build perfect hash table of a catalog
+	returns 0, -3 if no seed gives a perfect table or -4 on memory error
+*/
+static int phash_build( phash_t *ph, const dict_t *dict )
+{
+	long				n			= dict->tot_values;
+	uint32_t			*hashes		= NULL;
+	long				*keys		= NULL;
+	long				*fill		= NULL;
+	phash_bucket_t		*buckets	= NULL;
+	long				i, b;
+	int					result		= -3;
+
+	memset( ph, 0, sizeof( phash_t ) );
+	ph->tot_slots	= 1;
+	while( ph->tot_slots < n ) {
+		ph->tot_slots *= 2;
+	}
+	ph->tot_buckets	= n / 2 + 1;
+
+	hashes		= malloc( sizeof( uint32_t ) * ( n + 1 ) );
+	keys		= malloc( sizeof( long ) * ( n + 1 ) );
+	fill		= malloc( sizeof( long ) * ph->tot_buckets );
+	buckets		= malloc( sizeof( phash_bucket_t ) * ph->tot_buckets );
+	ph->displace	= malloc( sizeof( uint32_t ) * ph->tot_buckets );
+	ph->slots		= malloc( sizeof( int32_t ) * ph->tot_slots );
+	if( hashes == NULL || keys == NULL || fill == NULL || buckets == NULL || ph->displace == NULL || ph->slots == NULL ) {
+		result = -4;
+	}
+
+	for( ph->seed = 0; result == -3 && ph->seed < PHASH_SEEDS; ph->seed++ ) {
+		// keys sorted by bucket ( counting sort )
+		memset( buckets, 0, sizeof( phash_bucket_t ) * ph->tot_buckets );
+		for( i = 0; i < n; i++ ) {
+			hashes[ i ] = phash_hash( ph->seed, DICT_NAME( dict, i ) );
+			buckets[ hashes[ i ] % ph->tot_buckets ].size += 1;
+		}
+		for( b = 0, i = 0; b < ph->tot_buckets; b++ ) {
+			buckets[ b ].first	= i;
+			fill[ b ]			= i;
+			i					+= buckets[ b ].size;
+		}
+		for( i = 0; i < n; i++ ) {
+			keys[ fill[ hashes[ i ] % ph->tot_buckets ]++ ] = i;
+		}
+		qsort( buckets, ph->tot_buckets, sizeof( phash_bucket_t ), phash_cmp );
+
+		memset( ph->displace, 0, sizeof( uint32_t ) * ph->tot_buckets );
+		memset( ph->slots, 0xff, sizeof( int32_t ) * ph->tot_slots );
+		if( phash_place( ph, buckets, keys, hashes ) == 0 ) {
+			result = 0;
+			break;
+		}
+	}
+
+	free( hashes );
+	free( keys );
+	free( fill );
+	free( buckets );
+	if( result != 0 ) {
+		free( ph->displace );
+		free( ph->slots );
+		memset( ph, 0, sizeof( phash_t ) );
+	}
+
+	return result;
+}
+
+/*
+	write a string as a C literal: quotes, backslashes and question marks ( trigraphs )
+	are escaped, other bytes out of printable ASCII become octal escapes
+*/
+static void emit_string( FILE *fp, const char *str )
+{
+	const unsigned char	*p			= ( const unsigned char* )str;
+
+	fputc( '"', fp );
+	for( ; *p != '\0'; p++ ) {
+		if( *p == '"' || *p == '\\' || *p == '?' ) {
+			fputc( '\\', fp );
+			fputc( *p, fp );
+		} else if( *p < 0x20 || *p >= 0x7f ) {
+			fprintf( fp, "\\%03o", *p );
+		} else {
+			fputc( *p, fp );
+		}
+	}
+	fputc( '"', fp );
+}
+
+/*
+	write perfect hash table and names of catalog of a column
+*/
+static void emit_dict( FILE *fp, const char *prefix, long col, const dict_t *dict, const phash_t *ph )
+{
+	long				i;
+
+	fprintf( fp, "static const char *const %s_names_%ld[ %ld ] = {\n", prefix, col, dict->tot_values + 1 );
+	for( i = 0; i < dict->tot_values; i++ ) {
+		fputc( '\t', fp );
+		emit_string( fp, DICT_NAME( dict, i ) );
+		fprintf( fp, ",\n" );
+	}
+	fprintf( fp, "\tNULL\n};\n\n" );
+
+	fprintf( fp, "static const uint32_t %s_displace_%ld[ %ld ] = {", prefix, col, ph->tot_buckets );
+	for( i = 0; i < ph->tot_buckets; i++ ) {
+		fprintf( fp, "%s%lu,", i % 16 ? " " : "\n\t", ( unsigned long )ph->displace[ i ] );
+	}
+	fprintf( fp, "\n};\n\n" );
+
+	fprintf( fp, "static const int32_t %s_slots_%ld[ %ld ] = {", prefix, col, ph->tot_slots );
+	for( i = 0; i < ph->tot_slots; i++ ) {
+		fprintf( fp, "%s%ld,", i % 16 ? " " : "\n\t", ( long )ph->slots[ i ] );
+	}
+	fprintf( fp, "\n};\n\n" );
+}
+
+/*
+	indentation of generated code
+*/
+static void emit_indent( FILE *fp, long depth )
+{
+	for( ; depth > 0; depth-- ) {
+		fputc( '\t', fp );
+	}
+}
+
+static void emit_node( emit_t *emit, long pos, long depth );
+
+/*
+	write a numeric node of flat tree and its subtree as tests of number of split
+	attribute against threshold, a number that is not one ( NAN ) fails both and takes
+	the default branch
+*/
+static void emit_numeric( emit_t *emit, long pos, long depth )
+{
+	static const char	*const tests[ 2 ] = { "<=", ">" };
+	const int32_t		*nodes		= emit->nodes;
+	long				attrib		= FLAT_ATTRIB( nodes[ pos ] );
+	double				threshold	= emit->numbers[ attrib ][ nodes[ pos + 4 ] ];
+	long				other		= nodes[ FLAT_DEFAULT( nodes, pos ) + 1 ];
+	long				value, child;
+
+	for( value = 0; value < 2; value++ ) {
+		child = nodes[ pos + 2 + value ];
+		emit_indent( emit->fp, depth );
+		fprintf( emit->fp, "%sif( numbers[ %ld ] %s %.17g ) {\n", value > 0 ? "} else " : "", attrib, tests[ value ], threshold );
+		if( nodes[ child ] < 0 ) {
+			if( nodes[ child + 1 ] >= 0 ) {
+				emit_indent( emit->fp, depth + 1 );
+				fprintf( emit->fp, "return %ld;\n", ( long )nodes[ child + 1 ] );
+			}
+		} else if( emit->roots[ child ] ) {
+			emit_indent( emit->fp, depth + 1 );
+			fprintf( emit->fp, "return %s_node_%ld( %s );\n", emit->prefix, child, emit->args );
+		} else {
+			emit_node( emit, child, depth + 1 );
+		}
+	}
+	if( other >= 0 ) {
+		emit_indent( emit->fp, depth );
+		fprintf( emit->fp, "} else {\n" );
+		emit_indent( emit->fp, depth + 1 );
+		fprintf( emit->fp, "return %ld;\n", other );
+	}
+	emit_indent( emit->fp, depth );
+	fprintf( emit->fp, "}\n" );
+}
+
+/*
+	write a node of flat tree and its subtree as a switch on code of split attribute;
+	branches with the same terminal node share their return and values without a child
+	are the default case
+*/
+static void emit_node( emit_t *emit, long pos, long depth )
+{
+	const int32_t		*nodes		= emit->nodes;
+	long				attrib		= nodes[ pos ];
+	long				tot_values	= nodes[ pos + 1 ];
+	long				other		= 0;
+	long				class_id, value, child;
+	int					found;
+
+	if( attrib & FLAT_NUMERIC ) {
+		emit_numeric( emit, pos, depth );
+		return;
+	}
+
+	other = nodes[ FLAT_DEFAULT( nodes, pos ) + 1 ];
+	emit_indent( emit->fp, depth );
+	fprintf( emit->fp, "switch( codes[ %ld ] ) {\n", FLAT_ATTRIB( attrib ) );
+
+	// terminal branches grouped by class, branches without class are left to the final
+	// return of function unless node has a default case
+	for( class_id = ( other >= 0 ? -1 : 0 ); class_id < emit->tot_classes; class_id++ ) {
+		found = 0;
+		for( value = 0; value < tot_values; value++ ) {
+			if( nodes[ pos + 2 + value ] == FLAT_LEAF( class_id ) ) {
+				emit_indent( emit->fp, depth );
+				fprintf( emit->fp, "case %ld:\n", ( long )FLAT_VALUE( nodes, pos, value ) );
+				found = 1;
+			}
+		}
+		if( found ) {
+			emit_indent( emit->fp, depth + 1 );
+			fprintf( emit->fp, "return %ld;\n", class_id );
+		}
+	}
+
+	// inner branches, nested or calling the function of their subtree
+	for( value = 0; value < tot_values; value++ ) {
+		child = nodes[ pos + 2 + value ];
+		if( nodes[ child ] < 0 ) {
+			continue;
+		}
+		emit_indent( emit->fp, depth );
+		fprintf( emit->fp, "case %ld:\n", ( long )FLAT_VALUE( nodes, pos, value ) );
+		if( emit->roots[ child ] ) {
+			emit_indent( emit->fp, depth + 1 );
+			fprintf( emit->fp, "return %s_node_%ld( %s );\n", emit->prefix, child, emit->args );
+		} else {
+			emit_node( emit, child, depth + 1 );
+			emit_indent( emit->fp, depth + 1 );
+			fprintf( emit->fp, "break;\n" );
+		}
+	}
+
+	if( other >= 0 ) {
+		emit_indent( emit->fp, depth );
+		fprintf( emit->fp, "default:\n" );
+		emit_indent( emit->fp, depth + 1 );
+		fprintf( emit->fp, "return %ld;\n", other );
+	}
+	emit_indent( emit->fp, depth );
+	fprintf( emit->fp, "}\n" );
+}
+
+/*
+	split tree into functions: inner nodes follow terminal ones in breadth first order,
+	so subtree sizes are summed from last node back and functions are filled from root
+	down, every subtree is nested into its parent's function while budget allows
+	returns 0 or -4 on memory error
+*/
+static int emit_split( emit_t *emit, const flat_t *flat )
+{
+	const int32_t		*nodes		= emit->nodes;
+	long				*inner		= NULL;
+	long				tot_inner	= 0;
+	long				pos, child, budget, i, j;
+
+	emit->cases	= calloc( flat->size, sizeof( long ) );
+	emit->roots	= calloc( flat->size, sizeof( char ) );
+	inner		= malloc( sizeof( long ) * ( flat->size / 2 + 1 ) );
+	if( emit->cases == NULL || emit->roots == NULL || inner == NULL ) {
+		free( inner );
+		return -4;
+	}
+	for( pos = FLAT_INNER( emit->tot_classes ); pos < flat->size; pos += FLAT_SIZE( nodes, pos ) ) {
+		inner[ tot_inner++ ] = pos;
+	}
+
+	// branches of each subtree, default one included
+	for( i = tot_inner - 1; i >= 0; i-- ) {
+		pos					= inner[ i ];
+		emit->cases[ pos ]	= 1;
+		for( j = 0; j < nodes[ pos + 1 ]; j++ ) {
+			child = nodes[ pos + 2 + j ];
+			if( child != FLAT_LEAF( -1 ) && nodes[ child ] != FLAT_OTHER_WORD ) {
+				emit->cases[ pos ] += 1 + ( nodes[ child ] >= 0 ? emit->cases[ child ] : 0 );
+			}
+		}
+	}
+
+	// subtrees not fitting into the function of their parent start a new one
+	if( nodes[ flat->root ] >= 0 ) {
+		emit->roots[ flat->root ] = 1;
+	}
+	for( i = 0; i < tot_inner; i++ ) {
+		pos = inner[ i ];
+		if( !emit->roots[ pos ] ) {
+			continue;
+		}
+		budget = EMIT_CASES - nodes[ pos + 1 ];
+		for( j = 0; j < nodes[ pos + 1 ]; j++ ) {
+			child = nodes[ pos + 2 + j ];
+			if( nodes[ child ] < 0 ) {
+				continue;
+			}
+			if( emit->cases[ child ] <= budget ) {
+				budget -= emit->cases[ child ];
+			} else {
+				emit->roots[ child ] = 1;
+			}
+		}
+	}
+
+	free( inner );
+
+	return 0;
+}
+
+/*
+	write a model as C source: functions and tables of source are named after prefix,
+	which must be a C identifier
+	returns 0, -1 on wrong parameters ( forests are not written ), -2 on write error, -3
+	if a catalog has no perfect hash table or -4 on memory error
+*/
+int id3_write_source( const id3_model_t *model, FILE *fp, const char *prefix )
+{
+	const int32_t		*nodes			= NULL;
+	const dict_t		*classes		= NULL;
+	phash_t				*tables			= NULL;
+	char				*used			= NULL;
+	emit_t				emit;
+	long				tot_numeric		= 0;		// numeric columns tested by tree
+	long				attrs, col, pos, i;
+	int					result			= 0;
+
+	if( model == NULL || fp == NULL || prefix == NULL || model->roots != NULL ) {
+		return -1;
+	}
+	for( i = 0; prefix[ i ] != '\0'; i++ ) {
+		if( !( prefix[ i ] == '_' || ( prefix[ i ] >= 'a' && prefix[ i ] <= 'z' ) || ( prefix[ i ] >= 'A' && prefix[ i ] <= 'Z' ) ||
+			( i > 0 && prefix[ i ] >= '0' && prefix[ i ] <= '9' ) ) ) {
+			return -1;
+		}
+	}
+	if( i == 0 ) {
+		return -1;
+	}
+
+	nodes	= model->flat.nodes;
+	classes	= model->dicts + model->cols - 1;
+	attrs	= model->cols - 1;
+
+	memset( &emit, 0, sizeof( emit_t ) );
+	emit.fp				= fp;
+	emit.prefix			= prefix;
+	emit.nodes			= nodes;
+	emit.numbers		= model->numbers;
+	emit.args			= ( model->numbers != NULL ) ? "codes, numbers" : "codes";
+	emit.tot_classes	= classes->tot_values;
+
+	do {
+		// perfect hash tables of attributes
+		tables	= calloc( attrs + 1, sizeof( phash_t ) );
+		used	= calloc( attrs + 1, sizeof( char ) );
+		if( tables == NULL || used == NULL ) {
+			result = -4;
+			break;
+		}
+		for( col = 0; result == 0 && col < attrs; col++ ) {
+			result = phash_build( tables + col, model->dicts + col );
+		}
+		if( result != 0 || ( result = emit_split( &emit, &model->flat ) ) != 0 ) {
+			break;
+		}
+		// attributes tested by tree, the only ones looked up by classify
+		for( pos = FLAT_INNER( classes->tot_values ); pos < model->flat.size; pos += FLAT_SIZE( nodes, pos ) ) {
+			used[ FLAT_ATTRIB( nodes[ pos ] ) ] = 1;
+		}
+
+		fprintf( fp, "/*\n\tdecision tree generated by id3_write_source\n\n" );
+		fprintf( fp, "\tlong %s_value_code( long col, const char *name );\n", prefix );
+		fprintf( fp, "\tlong %s_classify( const char *const *row );\n", prefix );
+		fprintf( fp, "\tlong %s_classify_codes( const long *codes );\n", prefix );
+		fprintf( fp, "\tconst char *%s_class_name( long class_id );\n", prefix );
+		fprintf( fp, "\n\trows hold %ld attributes, classes are -1 if no rule matches\n*/\n\n", attrs );
+		fprintf( fp, "#include <stddef.h>\n#include <stdint.h>\n#include <string.h>\n" );
+		if( model->numbers != NULL ) {
+			fprintf( fp, "#include <math.h>\n#include <stdlib.h>\n" );
+		}
+		fprintf( fp, "\n" );
+
+		fprintf( fp, "typedef struct %s_dict_tag {\n", prefix );
+		fprintf( fp, "\tuint32_t\t\t\tseed;\n\tuint32_t\t\t\ttot_buckets;\n\tuint32_t\t\t\tmask;\n" );
+		fprintf( fp, "\tconst uint32_t\t\t*displace;\n\tconst int32_t\t\t*slots;\n\tconst char *const\t*names;\n" );
+		fprintf( fp, "} %s_dict_t;\n\n", prefix );
+		fprintf( fp, PHASH_SOURCE, prefix, prefix );
+		fprintf( fp, "\n" );
+
+		// catalogs of attributes and their perfect hash tables
+		for( col = 0; col < attrs; col++ ) {
+			emit_dict( fp, prefix, col, model->dicts + col, tables + col );
+		}
+		fprintf( fp, "static const %s_dict_t %s_dicts[ %ld ] = {\n", prefix, prefix, attrs );
+		for( col = 0; col < attrs; col++ ) {
+			fprintf( fp, "\t{ %lu, %ld, %ld, %s_displace_%ld, %s_slots_%ld, %s_names_%ld },\t// ", ( unsigned long )tables[ col ].seed,
+				tables[ col ].tot_buckets, tables[ col ].tot_slots - 1, prefix, col, prefix, col, prefix, col );
+			emit_string( fp, model->column_names[ col ] );
+			fprintf( fp, "\n" );
+		}
+		fprintf( fp, "};\n\n" );
+
+		fprintf( fp, "static const char *const %s_classes[ %ld ] = {\n", prefix, classes->tot_values + 1 );
+		for( i = 0; i < classes->tot_values; i++ ) {
+			fputc( '\t', fp );
+			emit_string( fp, DICT_NAME( classes, i ) );
+			fprintf( fp, ",\n" );
+		}
+		fprintf( fp, "\tNULL\n};\n\n" );
+
+		// numbers of numeric columns tested by tree, for rows of codes, and parsing of
+		// numbers for rows of strings
+		for( col = 0; model->numbers != NULL && col < attrs; col++ ) {
+			if( !used[ col ] || model->numbers[ col ] == NULL ) {
+				continue;
+			}
+			fprintf( fp, "static const double %s_numbers_%ld[ %ld ] = {", prefix, col, model->dicts[ col ].tot_values );
+			for( i = 0; i < model->dicts[ col ].tot_values; i++ ) {
+				fprintf( fp, "%s%.17g,", i % 8 ? " " : "\n\t", model->numbers[ col ][ i ] );
+			}
+			fprintf( fp, "\n};\n\n" );
+			tot_numeric += 1;
+		}
+		if( tot_numeric > 0 ) {
+			fprintf( fp, "static double %s_number( const char *name )\n{\n", prefix );
+			fprintf( fp, "\tchar\t\t\t\t*end\t\t= NULL;\n\tdouble\t\t\t\tvalue\t\t= strtod( name, &end );\n\n" );
+			fprintf( fp, "\tif( end == name || *end != '\\0' ) {\n\t\treturn NAN;\n\t}\n\n" );
+			fprintf( fp, "\treturn value;\n}\n\n" );
+		}
+
+		// lookup of values
+		fprintf( fp, "long %s_value_code( long col, const char *name )\n{\n", prefix );
+		fprintf( fp, "\tconst %s_dict_t\t*dict\t\t= NULL;\n\tuint32_t\t\t\thash;\n\tint32_t\t\t\t\tcode;\n\n", prefix );
+		fprintf( fp, "\tif( col < 0 || col >= %ld || name == NULL ) {\n\t\treturn -1;\n\t}\n", attrs );
+		fprintf( fp, "\tdict = %s_dicts + col;\n", prefix );
+		fprintf( fp, "\thash = %s_hash( dict->seed, name );\n", prefix );
+		fprintf( fp, "\tcode = dict->slots[ %s_mix( hash ^ dict->displace[ hash %% dict->tot_buckets ] ) & dict->mask ];\n", prefix );
+		fprintf( fp, "\tif( code < 0 || strcmp( dict->names[ code ], name ) != 0 ) {\n\t\treturn -1;\n\t}\n\n" );
+		fprintf( fp, "\treturn code;\n}\n\n" );
+
+		// tree, one function for each subtree split by emit_split
+		// tree functions of a model with numeric columns also get numbers of rows
+		for( pos = FLAT_INNER( classes->tot_values ); pos < model->flat.size; pos += FLAT_SIZE( nodes, pos ) ) {
+			if( emit.roots[ pos ] ) {
+				fprintf( fp, "static long %s_node_%ld( const long *codes%s );\n", prefix, pos,
+					model->numbers != NULL ? ", const double *numbers" : "" );
+			}
+		}
+		fprintf( fp, "\n" );
+		for( pos = FLAT_INNER( classes->tot_values ); pos < model->flat.size; pos += FLAT_SIZE( nodes, pos ) ) {
+			if( emit.roots[ pos ] ) {
+				fprintf( fp, "static long %s_node_%ld( const long *codes%s )\n{\n", prefix, pos,
+					model->numbers != NULL ? ", const double *numbers" : "" );
+				if( model->numbers != NULL ) {
+					fprintf( fp, "\t( void )codes;\n\t( void )numbers;\n" );
+				}
+				emit_node( &emit, pos, 1 );
+				fprintf( fp, "\n\treturn -1;\n}\n\n" );
+			}
+		}
+
+		fprintf( fp, "long %s_classify_codes( const long *codes )\n{\n", prefix );
+		if( nodes[ model->flat.root ] < 0 ) {
+			fprintf( fp, "\t( void )codes;\n\treturn %ld;\n}\n\n", ( long )nodes[ model->flat.root + 1 ] );
+		} else if( model->numbers == NULL ) {
+			fprintf( fp, "\treturn %s_node_%ld( codes );\n}\n\n", prefix, model->flat.root );
+		} else {
+			// codes of numeric columns are turned into their numbers
+			fprintf( fp, "\tdouble\t\t\t\tnumbers[ %ld ];\n\n", attrs );
+			for( col = 0; col < attrs; col++ ) {
+				if( used[ col ] && model->numbers[ col ] != NULL ) {
+					fprintf( fp, "\tnumbers[ %ld ] = ( codes[ %ld ] >= 0 && codes[ %ld ] < %ld ) ? %s_numbers_%ld[ codes[ %ld ] ] : NAN;\n",
+						col, col, col, model->dicts[ col ].tot_values, prefix, col, col );
+				}
+			}
+			fprintf( fp, "\n\treturn %s_node_%ld( codes, numbers );\n}\n\n", prefix, model->flat.root );
+		}
+
+		// rows of names are translated into codes of attributes tested by tree, strings
+		// of numeric columns are parsed as numbers
+		fprintf( fp, "long %s_classify( const char *const *row )\n{\n", prefix );
+		fprintf( fp, "\tlong\t\t\t\tcodes[ %ld ];\n", attrs > 0 ? attrs : 1 );
+		if( model->numbers != NULL && nodes[ model->flat.root ] >= 0 ) {
+			fprintf( fp, "\tdouble\t\t\t\tnumbers[ %ld ];\n", attrs );
+		}
+		fprintf( fp, "\n" );
+		for( col = 0; col < attrs; col++ ) {
+			if( used[ col ] && model->numbers != NULL && model->numbers[ col ] != NULL ) {
+				fprintf( fp, "\tcodes[ %ld ] = -1;\n\tnumbers[ %ld ] = %s_number( row[ %ld ] );\n", col, col, prefix, col );
+			} else if( used[ col ] ) {
+				fprintf( fp, "\tcodes[ %ld ] = %s_value_code( %ld, row[ %ld ] );\n", col, prefix, col, col );
+			} else {
+				fprintf( fp, "\tcodes[ %ld ] = -1;\n", col );
+			}
+		}
+		if( nodes[ model->flat.root ] < 0 ) {
+			fprintf( fp, "\t( void )row;\n" );
+		}
+		if( nodes[ model->flat.root ] >= 0 && model->numbers != NULL ) {
+			fprintf( fp, "\n\treturn %s_node_%ld( codes, numbers );\n}\n\n", prefix, model->flat.root );
+		} else {
+			fprintf( fp, "\n\treturn %s_classify_codes( codes );\n}\n\n", prefix );
+		}
+
+		fprintf( fp, "const char *%s_class_name( long class_id )\n{\n", prefix );
+		fprintf( fp, "\tif( class_id < 0 || class_id >= %ld ) {\n\t\treturn NULL;\n\t}\n\n", classes->tot_values );
+		fprintf( fp, "\treturn %s_classes[ class_id ];\n}\n", prefix );
+
+		if( ferror( fp ) ) {
+			result = -2;
+		}
+	} while( 0 );
+
+	for( col = 0; tables != NULL && col < attrs; col++ ) {
+		free( tables[ col ].displace );
+		free( tables[ col ].slots );
+	}
+	free( tables );
+	free( used );
+	free( emit.cases );
+	free( emit.roots );
+
+	return result;
+}
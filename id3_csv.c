@@ -0,0 +1,412 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+#include "id3.h"
+#include "id3_int.h"
+
+// bytes of file tokenized before their pages are given back to system
+#define	TEXT_WINDOW		( 64L * 1024 * 1024 )
+
+/*
+	file contents in memory: a private writable mapping, pages are read on demand and
+	copied only if a quoted field must be unescaped in place
+*/
+typedef struct text_tag {
+	fmap_t				map;
+	size_t				released;		// bytes at start of mapping already given back
+} text_t;
+
+/*
+	tokenizer state
+*/
+typedef struct parser_tag {
+	char				*cur;			// start of next line
+	char				*end;			// end of file contents
+	char				delim;			// field delimiter
+	field_t				*fields;		// fields of last line read
+	long				max_fields;		// allocated fields
+} parser_t;
+
+/*
+	give back pages of file contents before a position: samples are already encoded, so
+	resident memory does not grow with file size
+*/
+static void text_release( text_t *text, const char *pos )
+{
+#ifndef _WIN32
+	size_t				page			= sysconf( _SC_PAGESIZE );
+	size_t				upto			= ( ( size_t )( pos - text->map.base ) / page ) * page;
+
+	if( upto < text->released ) {
+		// a new pass starts from the beginning
+		text->released = 0;
+	}
+	if( upto >= text->released + TEXT_WINDOW ) {
+		madvise( text->map.base + text->released, upto - text->released, MADV_DONTNEED );
+		text->released = upto;
+	}
+#else
+	( void )text;
+	( void )pos;
+#endif
+}
+
+/*
+	read a field starting at p, returns position of delimiter or end of line after it.
+	A field between double quotes may hold delimiters and new lines, "" stands for a quote
+	character: quotes are removed moving characters in place
+*/
+static char *parse_field( char *p, char *end, char delim, field_t *field )
+{
+	char				*w				= NULL;
+
+	if( p < end && *p == '"' ) {
+		field->ptr = w = ++p;
+		while( p < end ) {
+			if( *p == '"' ) {
+				if( p + 1 < end && p[ 1 ] == '"' ) {
+					p += 1;
+				} else {
+					p += 1;
+					break;
+				}
+			}
+			// pages are written only once a quote has been removed
+			if( w != p ) {
+				*w = *p;
+			}
+			w += 1;
+			p += 1;
+		}
+		field->len = w - field->ptr;
+		// skip anything up to next field ( e.g. \r of a CRLF line )
+		while( p < end && *p != delim && *p != '\n' ) {
+			p += 1;
+		}
+	} else {
+		field->ptr = p;
+		while( p < end && *p != delim && *p != '\n' ) {
+			p += 1;
+		}
+		field->len = p - field->ptr;
+		// CRLF line
+		if( field->len > 0 && field->ptr[ field->len - 1 ] == '\r' && ( p == end || *p == '\n' ) ) {
+			field->len -= 1;
+		}
+	}
+
+	return p;
+}
+
+/*
+	split next line into fields
+	returns number of fields, 0 at end of file or -1 on memory error
+*/
+static long parse_line( parser_t *ps )
+{
+	char				*p				= ps->cur;
+	void				*ptr			= NULL;
+	long				n				= 0;
+
+	if( p >= ps->end ) {
+		return 0;
+	}
+	while( 1 ) {
+		if( n == ps->max_fields ) {
+			if( ( ptr = realloc( ps->fields, sizeof( field_t ) * ( n ? n * 2 : 16 ) ) ) == NULL ) {
+				return -1;
+			}
+			ps->fields		= ptr;
+			ps->max_fields	= n ? n * 2 : 16;
+		}
+		p = parse_field( p, ps->end, ps->delim, ps->fields + n );
+		n += 1;
+		if( p >= ps->end || *p == '\n' ) {
+			break;
+		}
+		// skip delimiter
+		p += 1;
+	}
+	ps->cur = ( p < ps->end ) ? p + 1 : p;
+
+	return n;
+}
+
+/*
+	read a delimited text file ( CSV, TSV ): file is mapped in memory and tokenized in place,
+	pages already read are given back so resident memory does not grow with file size.
+	Fields are passed to sink in dataset order, class column last
+	- path:			file name
+	- delim:		field delimiter, 0 to detect tab or comma from header line
+	- class_col:	column of class, -1 for last one
+	- sink:			functions receiving header and samples
+	returns 0, -1 on wrong parameters, -2 if file cannot be read, -3 on malformed file,
+	-4 on memory error or error returned by sink
+*/
+int csv_read( const char *path, char delim, long class_col, const csv_sink_t *sink )
+{
+	text_t				text;
+	parser_t			ps;
+	field_t				*fields			= NULL;
+	const char			*p				= NULL;
+	long				max_rows		= 0;
+	long				cols			= 0;
+	long				n, col, dcol;
+	int					result			= 0;
+
+	if( path == NULL ) {
+		return -1;
+	}
+	memset( &text, 0, sizeof( text_t ) );
+	if( fmap_open( &text.map, path, 1 ) != 0 ) {
+		return -2;
+	}
+#ifndef _WIN32
+	// file is tokenized once from start to end
+	madvise( text.map.base, text.map.size, MADV_SEQUENTIAL );
+#endif
+	memset( &ps, 0, sizeof( parser_t ) );
+	ps.cur	= text.map.base;
+	ps.end	= text.map.base + text.map.size;
+
+	do {
+		// UTF-8 byte order mark
+		if( text.map.size >= 3 && !memcmp( text.map.base, "\xEF\xBB\xBF", 3 ) ) {
+			ps.cur += 3;
+		}
+		if( delim == 0 ) {
+			delim = ',';
+			for( p = ps.cur; p < ps.end && *p != '\n'; p++ ) {
+				if( *p == '\t' ) {
+					delim = '\t';
+					break;
+				}
+			}
+		}
+		ps.delim = delim;
+
+		// header
+		if( ( cols = parse_line( &ps ) ) < 0 ) {
+			result = -4;
+			break;
+		}
+		if( cols < 2 ) {
+			result = -3;
+			break;
+		}
+		if( class_col < 0 ) {
+			class_col = cols - 1;
+		}
+		if( class_col >= cols ) {
+			result = -1;
+			break;
+		}
+		if( ( fields = malloc( sizeof( field_t ) * cols ) ) == NULL ) {
+			result = -4;
+			break;
+		}
+		for( col = 0; col < cols; col++ ) {
+			dcol			= ( col == class_col ) ? cols - 1 : ( col > class_col ? col - 1 : col );
+			fields[ dcol ]	= ps.fields[ col ];
+		}
+
+		// upper bound of samples
+		if( sink->count ) {
+			for( p = ps.cur; p < ps.end && ( p = memchr( p, '\n', ps.end - p ) ) != NULL; p++ ) {
+				max_rows += 1;
+				text_release( &text, p );
+			}
+			max_rows += 1;
+			// pages are read again from cache while tokenizing
+			text_release( &text, ps.cur );
+		}
+		if( ( result = sink->header( sink->arg, fields, cols, max_rows ) ) != 0 ) {
+			break;
+		}
+
+		// samples
+		while( text_release( &text, ps.cur ), ( n = parse_line( &ps ) ) != 0 ) {
+			if( n < 0 ) {
+				result = -4;
+				break;
+			}
+			// blank line
+			if( n == 1 && ps.fields[ 0 ].len == 0 ) {
+				continue;
+			}
+			if( n != cols ) {
+				result = -3;
+				break;
+			}
+			for( col = 0; col < cols; col++ ) {
+				dcol			= ( col == class_col ) ? cols - 1 : ( col > class_col ? col - 1 : col );
+				fields[ dcol ]	= ps.fields[ col ];
+			}
+			if( ( result = sink->sample( sink->arg, fields, cols ) ) != 0 ) {
+				break;
+			}
+		}
+	} while( 0 );
+
+	free( fields );
+	free( ps.fields );
+	fmap_close( &text.map );
+
+	return result;
+}
+
+/*
+	loaded dataset being filled by csv_read
+*/
+typedef struct load_tag {
+	id3_data_t			*dt;
+	long				rows;			// samples stored
+} load_t;
+
+/*
+	allocate dataset for an upper bound of samples, column names are copied into a
+	single block after it
+	returns 0 or -4 on memory error
+*/
+static int load_header( void *arg, const field_t *names, long cols, long max_rows )
+{
+	load_t				*load			= arg;
+	size_t				names_sz		= 0;
+	char				*nameptr		= NULL;
+	long				col;
+
+	for( col = 0; col < cols; col++ ) {
+		names_sz += names[ col ].len + 1;
+	}
+	if( ( load->dt = calloc( 1, sizeof( id3_data_t ) + sizeof( char* ) * cols + names_sz ) ) == NULL ) {
+		return -4;
+	}
+	load->dt->column_names	= ( char** )( load->dt + 1 );
+	nameptr					= ( char* )( load->dt->column_names + cols );
+	for( col = 0; col < cols; col++ ) {
+		load->dt->column_names[ col ] = nameptr;
+		memcpy( nameptr, names[ col ].ptr, names[ col ].len );
+		nameptr[ names[ col ].len ] = '\0';
+		nameptr += names[ col ].len + 1;
+	}
+	if( dataset_init( &load->dt->ds, cols, max_rows ) != 0 ) {
+		return -4;
+	}
+
+	return 0;
+}
+
+/*
+	encode a sample, fields go straight into dictionaries so only distinct strings are copied
+	returns 0 or -4 on memory error
+*/
+static int load_sample( void *arg, const field_t *fields, long cols )
+{
+	load_t				*load			= arg;
+	long				col;
+
+	for( col = 0; col < cols; col++ ) {
+		if( dataset_set( &load->dt->ds, col, load->rows, fields[ col ].ptr, fields[ col ].len ) != 0 ) {
+			return -4;
+		}
+	}
+	load->rows += 1;
+
+	return 0;
+}
+
+/*
+	load a delimited text file ( CSV, TSV ) into an encoded dataset. Rows are counted first
+	with a fast scan of new lines: it is an upper bound of samples ( blank lines and new
+	lines inside quotes are not samples ) used to allocate columns
+	- data:			loaded dataset, NULL on error
+	- path:			file name
+	- delim:		field delimiter, 0 to detect tab or comma from header line
+	- class_col:	column of class, -1 for last one
+	returns 0, -1 on wrong parameters, -2 if file cannot be read, -3 on malformed file
+	or -4 on memory error
+*/
+int id3_data_load( id3_data_t **data, const char *path, char delim, long class_col )
+{
+	load_t				load;
+	csv_sink_t			sink;
+	void				*ptr			= NULL;
+	int					result			= 0;
+	long				col;
+
+	*data = NULL;
+	memset( &load, 0, sizeof( load_t ) );
+	sink.header	= load_header;
+	sink.sample	= load_sample;
+	sink.arg	= &load;
+	sink.count	= 1;
+	if( ( result = csv_read( path, delim, class_col, &sink ) ) != 0 ) {
+		id3_data_destroy( load.dt );
+		return result;
+	}
+
+	// give back room of rows that were not samples
+	load.dt->ds.rows		= load.rows;
+	load.dt->ds.max_rows	= load.rows;
+	for( col = 0; load.rows > 0 && col < load.dt->ds.cols; col++ ) {
+		if( ( ptr = realloc( load.dt->ds.columns[ col ], ( size_t )load.dt->ds.widths[ col ] * load.rows ) ) != NULL ) {
+			load.dt->ds.columns[ col ] = ptr;
+		}
+	}
+
+	*data = load.dt;
+	return 0;
+}
+
+/*
+	number of samples of a loaded dataset
+*/
+long id3_data_rows( const id3_data_t *data )
+{
+	return data->ds.rows;
+}
+
+/*
+	release a loaded dataset
+*/
+void id3_data_destroy( id3_data_t *data )
+{
+	if( data == NULL ) {
+		return;
+	}
+	dataset_free( &data->ds );
+	free( data );
+}
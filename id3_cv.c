@@ -0,0 +1,365 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+struct cv_tag;
+
+/*
+	tree of a fold serving the points of a min_leaf value, built by a worker of thread pool
+*/
+typedef struct cv_task_tag {
+	const struct cv_tag	*cv;
+	long				fold;			// fold held out, the others train
+	long				min_leaf;		// min_leaf of points served by tree
+	long				max_depth;		// largest depth of those points, 0 if one has no limit
+	long				*correct;		// held out rows classified right for each point
+	double				train_wall;		// seconds training tree
+	double				predict_wall;	// seconds classifying held out rows at every depth
+	int					result;
+} cv_task_t;
+
+/*
+	state shared by trees of a cross validation, read only while they are built
+*/
+typedef struct cv_tag {
+	const dataset_t		*ds;			// rows of every fold, encoded once
+	const double *const	*numbers;
+	const long			*fold_of;		// fold of each row
+	const id3_cv_point_t	*points;
+	long				tot_points;
+	id3_params_t		params;			// parameters of trees: serial, without statistics
+} cv_t;
+
+/*
+	min_leaf of a point, values without limit are the same
+*/
+static inline long cv_min_leaf( const id3_cv_point_t *point )
+{
+	return ( point->min_leaf > 1 ) ? point->min_leaf : 1;
+}
+
+/*
+	train the tree of a task on rows of the other folds and classify rows of its fold for
+	each depth of its points: mask of fold becomes weights of samples ( 1 for training
+	rows, 0 for held out ones, which are left out ), so tasks share the encoded dataset
+*/
+static void cv_run( void *arg, long worker )
+{
+	cv_task_t			*task			= arg;
+	const cv_t			*cv				= task->cv;
+	const dataset_t		*ds				= cv->ds;
+	dataset_t			view			= *ds;
+	id3_params_t		params			= cv->params;
+	id3_model_t			model;
+	tree_t				built;
+	long				*weights		= NULL;
+	long				*depths			= NULL;
+	long				*index			= NULL;
+	long				*classes		= NULL;
+	long				tot_depths		= 0;
+	double				start			= 0;
+	long				row, k;
+
+	( void )worker;
+	memset( &model, 0, sizeof( id3_model_t ) );
+	weights	= malloc( sizeof( long ) * ( ds->rows + 1 ) );
+	depths	= malloc( sizeof( long ) * cv->tot_points );
+	index	= malloc( sizeof( long ) * cv->tot_points );
+	classes	= malloc( sizeof( long ) * cv->tot_points );
+	do {
+		if( weights == NULL || depths == NULL || index == NULL || classes == NULL ) {
+			task->result = -1;
+			break;
+		}
+		for( row = 0; row < ds->rows; row++ ) {
+			weights[ row ] = ( cv->fold_of[ row ] != task->fold );
+		}
+		for( k = 0; k < cv->tot_points; k++ ) {
+			if( cv_min_leaf( cv->points + k ) == task->min_leaf ) {
+				index[ tot_depths ]		= k;
+				depths[ tot_depths++ ]	= ( cv->points[ k ].max_depth > 0 ) ? cv->points[ k ].max_depth : 0;
+			}
+		}
+
+		start				= stats_wall();
+		view.weights		= weights;
+		params.max_depth	= task->max_depth;
+		params.min_leaf		= task->min_leaf;
+		if( ( task->result = tree_build( &built, &view, cv->numbers, &params, NULL ) ) != 0 ) {
+			break;
+		}
+		task->result = flat_compile( &model.flat, &built, DS_VALUES( ds, ds->cols - 1 ) );
+		tree_free( &built );
+		task->train_wall = stats_wall() - start;
+		if( task->result != 0 ) {
+			break;
+		}
+
+		// held out rows walk the tree once for all depths, codes come from dataset
+		start			= stats_wall();
+		model.cols		= ds->cols;
+		model.dicts		= ds->dicts;
+		model.numbers	= ( double** )cv->numbers;
+		for( row = 0; row < ds->rows; row++ ) {
+			if( cv->fold_of[ row ] != task->fold ) {
+				continue;
+			}
+			flat_walk_depths( &model, ds, row, depths, tot_depths, classes );
+			for( k = 0; k < tot_depths; k++ ) {
+				task->correct[ index[ k ] ] += ( classes[ k ] == ds_code( ds, ds->cols - 1, row ) );
+			}
+		}
+		task->predict_wall = stats_wall() - start;
+	} while( 0 );
+
+	flat_free( &model.flat );
+	free( weights );
+	free( depths );
+	free( index );
+	free( classes );
+}
+
+/*
+	cross validation of an encoded dataset ( see id3_cross_validate ): a task for each
+	fold and each min_leaf value of points, tasks of a thread pool fill their own counts
+	and timings, which are summed into points once every task is done
+	returns 0 or -1 on memory error
+*/
+static int cv_build( const dataset_t *ds, const double *const *numbers, long folds, id3_cv_point_t *points, long tot_points, const id3_params_t *params )
+{
+	cv_t				cv;
+	cv_task_t			*tasks			= NULL;
+	cv_task_t			*task			= NULL;
+	long				*fold_of		= NULL;
+	long				*order			= NULL;
+	long				*correct		= NULL;
+	pool_t				*pool			= NULL;
+	uint64_t			state			= params->seed;
+	long				threads			= params->threads;
+	long				tot_tasks		= 0;
+	long				tot_group		= 0;
+	int					result			= 0;
+	long				swap, i, j, k;
+
+	memset( &cv, 0, sizeof( cv_t ) );
+	cv.ds				= ds;
+	cv.numbers			= numbers;
+	cv.points			= points;
+	cv.tot_points		= tot_points;
+	cv.params			= *params;
+	cv.params.threads	= 1;
+	cv.params.stats		= NULL;
+
+	do {
+		// rows are dealt to folds in a random order, folds differ by a row at most
+		fold_of	= malloc( sizeof( long ) * ( ds->rows + 1 ) );
+		order	= malloc( sizeof( long ) * ( ds->rows + 1 ) );
+		if( fold_of == NULL || order == NULL ) {
+			result = -1;
+			break;
+		}
+		for( i = 0; i < ds->rows; i++ ) {
+			order[ i ] = i;
+		}
+		for( i = ds->rows - 1; i > 0; i-- ) {
+			j			= ( long )( random_next( &state ) % ( uint64_t )( i + 1 ) );
+			swap		= order[ i ];
+			order[ i ]	= order[ j ];
+			order[ j ]	= swap;
+		}
+		for( i = 0; i < ds->rows; i++ ) {
+			fold_of[ order[ i ] ] = i % folds;
+		}
+		cv.fold_of = fold_of;
+
+		// a task for each fold of each min_leaf value, at the first point having it
+		tasks	= calloc( folds * tot_points, sizeof( cv_task_t ) );
+		correct	= calloc( folds * tot_points * tot_points, sizeof( long ) );
+		if( tasks == NULL || correct == NULL ) {
+			result = -1;
+			break;
+		}
+		for( k = 0; k < tot_points; k++ ) {
+			for( j = 0; j < k && cv_min_leaf( points + j ) != cv_min_leaf( points + k ); j++ );
+			if( j < k ) {
+				continue;
+			}
+			for( i = 0; i < folds; i++ ) {
+				task			= tasks + tot_tasks;
+				task->cv		= &cv;
+				task->fold		= i;
+				task->min_leaf	= cv_min_leaf( points + k );
+				task->correct	= correct + tot_tasks * tot_points;
+				for( j = k; j < tot_points; j++ ) {
+					if( cv_min_leaf( points + j ) != task->min_leaf ) {
+						continue;
+					}
+					if( points[ j ].max_depth <= 0 ) {
+						task->max_depth = 0;
+						break;
+					}
+					if( points[ j ].max_depth > task->max_depth ) {
+						task->max_depth = points[ j ].max_depth;
+					}
+				}
+				tot_tasks += 1;
+			}
+		}
+
+		// tasks are independent, calling thread is worker 0
+		if( threads <= 0 ) {
+			threads = sysconf( _SC_NPROCESSORS_ONLN );
+		}
+		if( threads > tot_tasks ) {
+			threads = tot_tasks;
+		}
+		if( threads > 1 && ( pool = pool_create( threads ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		for( i = 0; i < tot_tasks; i++ ) {
+			if( pool == NULL ) {
+				cv_run( tasks + i, 0 );
+			} else if( pool_submit( pool, 0, NULL, cv_run, tasks + i ) != 0 ) {
+				tasks[ i ].result	= -1;
+				result				= -1;
+				break;
+			}
+		}
+		if( pool != NULL ) {
+			pool_wait( pool, 0 );
+		}
+		for( i = 0; result == 0 && i < tot_tasks; i++ ) {
+			result = tasks[ i ].result;
+		}
+		if( result != 0 ) {
+			break;
+		}
+
+		// every row is held out once; a walk serves all points of its tree, its time is
+		// shared among them
+		for( k = 0; k < tot_points; k++ ) {
+			points[ k ].accuracy		= 0;
+			points[ k ].train_wall		= 0;
+			points[ k ].predict_wall	= 0;
+			for( tot_group = 0, j = 0; j < tot_points; j++ ) {
+				tot_group += ( cv_min_leaf( points + j ) == cv_min_leaf( points + k ) );
+			}
+			for( i = 0; i < tot_tasks; i++ ) {
+				if( tasks[ i ].min_leaf != cv_min_leaf( points + k ) ) {
+					continue;
+				}
+				points[ k ].accuracy		+= tasks[ i ].correct[ k ];
+				points[ k ].train_wall		+= tasks[ i ].train_wall;
+				points[ k ].predict_wall	+= tasks[ i ].predict_wall / tot_group;
+			}
+			points[ k ].accuracy /= ds->rows;
+		}
+	} while( 0 );
+
+	pool_destroy( pool );
+	free( tasks );
+	free( correct );
+	free( fold_of );
+	free( order );
+
+	return result;
+}
+
+/*
+	cross validation of a grid of tree limits on a dataset of strings ( cols * rows, class
+	is the last column ), dataset is encoded once for every fold and point
+	returns 0, -1 on wrong parameters or a negative value on memory error
+*/
+int id3_cross_validate( char **data, long cols, long rows, long folds, id3_cv_point_t *points, long tot_points, const id3_params_t *params )
+{
+	id3_params_t		defaults;
+	dataset_t			dataset;
+	double				**numbers		= NULL;
+	int					result			= 0;
+
+	if( data == NULL || cols < 2 || folds < 2 || rows < folds || points == NULL || tot_points < 1 ) {
+		return -1;
+	}
+	if( params == NULL ) {
+		id3_params_init( &defaults );
+		params = &defaults;
+	}
+	if( params->update || params->trees > 1 ) {
+		return -1;
+	}
+
+	if( id3_encode( &dataset, data, cols, rows ) != 0 ) {
+		return -3;
+	}
+	if( ( result = numbers_parse( &numbers, &dataset, params->numeric ) ) == 0 &&
+		cv_build( &dataset, ( const double *const* )numbers, folds, points, tot_points, params ) != 0 ) {
+		result = -4;
+	}
+	free( numbers );
+	dataset_free( &dataset );
+
+	return result;
+}
+
+/*
+	cross validation of a grid of tree limits on a dataset loaded from file, dataset can
+	be used again
+	returns 0, -1 on wrong parameters or a negative value on memory error
+*/
+int id3_cross_validate_data( const id3_data_t *data, long folds, id3_cv_point_t *points, long tot_points, const id3_params_t *params )
+{
+	id3_params_t		defaults;
+	double				**numbers		= NULL;
+	int					result			= 0;
+
+	if( data == NULL || folds < 2 || data->ds.rows < folds || points == NULL || tot_points < 1 ) {
+		return -1;
+	}
+	if( params == NULL ) {
+		id3_params_init( &defaults );
+		params = &defaults;
+	}
+	if( params->update || params->trees > 1 ) {
+		return -1;
+	}
+
+	if( ( result = numbers_parse( &numbers, &data->ds, params->numeric ) ) == 0 &&
+		cv_build( &data->ds, ( const double *const* )numbers, folds, points, tot_points, params ) != 0 ) {
+		result = -4;
+	}
+	free( numbers );
+
+	return result;
+}
@@ -0,0 +1,255 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3_int.h"
+
+// initial number of slots of the hash table ( power of two )
+#define	DICT_MIN_SLOTS		16
+
+/*
+	FNV-1a hash of a string of len bytes
+*/
+static uint32_t dict_hash( const char *name, long len )
+{
+	uint32_t			hash		= 2166136261u;
+	long				i;
+
+	for( i = 0; i < len; i++ ) {
+		hash ^= ( unsigned char )name[ i ];
+		hash *= 16777619u;
+	}
+	// final mix, low bits are used as slot index
+	hash ^= hash >> 15;
+	hash *= 0x2c1b3c6du;
+	hash ^= hash >> 12;
+
+	return hash;
+}
+
+/*
+	search slot of a string: returns index of the slot holding the string or
+	index of the empty slot where it must be inserted
+*/
+static long dict_find( const dict_t *dict, const char *name, long len, uint32_t hash )
+{
+	long				mask		= dict->tot_slots - 1;
+	long				slot		= hash & mask;
+	long				code;
+	const char			*str;
+
+	while( dict->slots[ slot ] != 0 ) {
+		code = dict->slots[ slot ] - 1;
+		if( dict->hashes[ code ] == hash ) {
+			str = DICT_NAME( dict, code );
+			if( !strncmp( str, name, len ) && str[ len ] == '\0' ) {
+				break;
+			}
+		}
+		// linear probing
+		slot = ( slot + 1 ) & mask;
+	}
+
+	return slot;
+}
+
+/*
+	double hash table size and reinsert all codes
+*/
+static int dict_grow( dict_t *dict )
+{
+	uint32_t			*slots		= NULL;
+	long				tot_slots	= dict->tot_slots * 2;
+	long				mask		= tot_slots - 1;
+	long				slot, code;
+
+	if( ( slots = calloc( tot_slots, sizeof( uint32_t ) ) ) == NULL ) {
+		return -1;
+	}
+	for( code = 0; code < dict->tot_values; code++ ) {
+		slot = dict->hashes[ code ] & mask;
+		while( slots[ slot ] != 0 ) {
+			slot = ( slot + 1 ) & mask;
+		}
+		slots[ slot ] = code + 1;
+	}
+	free( dict->slots );
+	dict->slots		= slots;
+	dict->tot_slots	= tot_slots;
+
+	return 0;
+}
+
+/*
+	initialize an empty dictionary
+*/
+int dict_init( dict_t *dict )
+{
+	memset( dict, 0, sizeof( dict_t ) );
+
+	if( ( dict->slots = calloc( DICT_MIN_SLOTS, sizeof( uint32_t ) ) ) == NULL ) {
+		return -1;
+	}
+	dict->tot_slots = DICT_MIN_SLOTS;
+
+	return 0;
+}
+
+/*
+	release memory of a dictionary
+*/
+void dict_free( dict_t *dict )
+{
+	free( dict->offsets );
+	free( dict->hashes );
+	free( dict->pool );
+	free( dict->slots );
+	memset( dict, 0, sizeof( dict_t ) );
+}
+
+/*
+	make an independent copy of a dictionary, arrays are sized to its content
+	returns 0 or -1 on memory error
+*/
+int dict_copy( dict_t *dict, const dict_t *from )
+{
+	memset( dict, 0, sizeof( dict_t ) );
+	dict->offsets	= malloc( sizeof( uint32_t ) * ( from->tot_values + 1 ) );
+	dict->hashes	= malloc( sizeof( uint32_t ) * ( from->tot_values + 1 ) );
+	dict->pool		= malloc( from->pool_size + 1 );
+	dict->slots		= malloc( sizeof( uint32_t ) * from->tot_slots );
+	if( dict->offsets == NULL || dict->hashes == NULL || dict->pool == NULL || dict->slots == NULL ) {
+		dict_free( dict );
+		return -1;
+	}
+	memcpy( dict->offsets, from->offsets, sizeof( uint32_t ) * from->tot_values );
+	memcpy( dict->hashes, from->hashes, sizeof( uint32_t ) * from->tot_values );
+	memcpy( dict->pool, from->pool, from->pool_size );
+	memcpy( dict->slots, from->slots, sizeof( uint32_t ) * from->tot_slots );
+	dict->tot_values	= from->tot_values;
+	dict->max_values	= from->tot_values + 1;
+	dict->pool_size		= from->pool_size;
+	dict->pool_max		= from->pool_size + 1;
+	dict->tot_slots		= from->tot_slots;
+
+	return 0;
+}
+
+/*
+	return code of a string, the string is added to dictionary if not found;
+	returns -1 in case of memory error
+*/
+long dict_intern( dict_t *dict, const char *name, long len )
+{
+	uint32_t			hash		= dict_hash( name, len );
+	long				slot		= dict_find( dict, name, len, hash );
+	long				code;
+	long				size;
+	void				*ptr;
+
+	// already known string
+	if( dict->slots[ slot ] != 0 ) {
+		return dict->slots[ slot ] - 1;
+	}
+
+	// make room for a new code
+	if( dict->tot_values == dict->max_values ) {
+		size = dict->max_values ? dict->max_values * 2 : 16;
+		if( ( ptr = realloc( dict->offsets, sizeof( uint32_t ) * size ) ) == NULL ) {
+			return -1;
+		}
+		dict->offsets = ptr;
+		if( ( ptr = realloc( dict->hashes, sizeof( uint32_t ) * size ) ) == NULL ) {
+			return -1;
+		}
+		dict->hashes		= ptr;
+		dict->max_values	= size;
+	}
+	// make room for the string
+	if( dict->pool_size + len + 1 > dict->pool_max ) {
+		size = dict->pool_max ? dict->pool_max * 2 : 256;
+		while( size < dict->pool_size + len + 1 ) {
+			size *= 2;
+		}
+		if( size > UINT32_MAX || ( ptr = realloc( dict->pool, size ) ) == NULL ) {
+			return -1;
+		}
+		dict->pool		= ptr;
+		dict->pool_max	= size;
+	}
+
+	// store string and assign the next dense code
+	code = dict->tot_values++;
+	dict->offsets[ code ]	= dict->pool_size;
+	dict->hashes[ code ]	= hash;
+	memcpy( dict->pool + dict->pool_size, name, len );
+	dict->pool[ dict->pool_size + len ] = '\0';
+	dict->pool_size			+= len + 1;
+	dict->slots[ slot ]		= code + 1;
+
+	// keep load factor under 1/2
+	if( dict->tot_values * 2 > dict->tot_slots ) {
+		if( dict_grow( dict ) != 0 ) {
+			return -1;
+		}
+	}
+
+	return code;
+}
+
+/*
+	return code of a string, -1 if the string is unknown
+*/
+long dict_lookup( const dict_t *dict, const char *name, long len )
+{
+	long				slot		= dict_find( dict, name, len, dict_hash( name, len ) );
+
+	return ( long )dict->slots[ slot ] - 1;
+}
+
+/*
+	forget codes from tot_values on, the last ones added: codes are placed in hash table
+	in code order ( dict_grow reinserts them so ), so probing of the codes kept never
+	passed through slots of the codes removed
+*/
+void dict_truncate( dict_t *dict, long tot_values )
+{
+	long				mask		= dict->tot_slots - 1;
+	long				slot, code;
+
+	for( code = tot_values; code < dict->tot_values; code++ ) {
+		for( slot = dict->hashes[ code ] & mask; dict->slots[ slot ] != code + 1; slot = ( slot + 1 ) & mask );
+		dict->slots[ slot ] = 0;
+	}
+	if( tot_values < dict->tot_values ) {
+		dict->pool_size		= dict->offsets[ tot_values ];
+		dict->tot_values	= tot_values;
+	}
+}
@@ -0,0 +1,1035 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	distributed training: rows are sharded across worker processes, which never send
+	them. Coordinator grows the tree level by level as out-of-core training does ( see
+	id3_spill.c ), but a pass over rows is run by every worker on its shard: it moves its
+	rows along splits of previous level and returns count tables of the nodes asked,
+	which coordinator sums before choosing splits. Catalogs of workers are merged at
+	connection, so that codes are the ones of the shards read one after the other and
+	the tree is the one of single process training on them
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+// messages: a header and its payload of 64 bit words ( bytes for flags and names ), in
+// byte order of the machine, as workers are local processes
+#define	DIST_HELLO			1			// worker: shape, column names and catalogs of its shard
+#define	DIST_CODES			2			// coordinator: sizes of merged catalogs, numeric columns
+										// and merged code of each value of worker's catalogs
+#define	DIST_PASS			3			// coordinator: splits of previous level, nodes to count
+#define	DIST_TABLES			4			// worker: first class and count tables of nodes counted
+#define	DIST_DONE			5			// coordinator: training is over
+
+#define	DIST_MAGIC			0x49443344	// first word of hello
+#define	DIST_MAX_MESSAGE	( 1L << 30 )	// bytes of a payload, a peer sending more is malformed
+
+// a worker not listening yet is dialed again, for about 5 seconds
+#define	DIST_DIAL_TRIES		200
+#define	DIST_DIAL_WAIT		25000		// microseconds
+
+/*
+	header of a message
+*/
+typedef struct dist_header_tag {
+	uint32_t			type;
+	uint32_t			reserved;
+	uint64_t			bytes;			// payload following header
+} dist_header_t;
+
+/*
+	payload of a message being written or read
+*/
+typedef struct dist_buf_tag {
+	char				*data;
+	size_t				size;			// bytes written or received
+	size_t				max;			// bytes allocated
+	size_t				pos;			// read position
+} dist_buf_t;
+
+/*
+	connections of coordinator to workers, in order of their shards
+*/
+struct dist_tag {
+	int					*fds;
+	long				tot_workers;
+	long				tot_attrib;
+	long				*voffset;		// first cell of each attribute into count tables, class
+										// counts come first, last one is end of table
+	dist_buf_t			buf;
+};
+
+/*
+	shard of a worker: its rows are encoded with catalogs of their own, count tables use
+	merged codes
+*/
+typedef struct dist_shard_tag {
+	const dataset_t		*ds;
+	int					fd;
+	long				tot_attrib;
+	long				tot_classes;	// classes of merged catalog
+	int32_t				**maps;			// merged code of each value of each column
+	double				**numbers;		// number of each value of numeric attributes, NULL if none is
+	long				*voffset;		// as voffset of dist_t
+	int32_t				*assign;		// node of each row into level, -1 once row reached a
+										// terminal node
+	int64_t				*tables;		// first class and count table of each node counted
+	long				max_tables;		// tables allocated
+	long				*slots;			// table of each node of a pass, -1 if it is not counted
+	long				max_slots;
+	dist_buf_t			buf;			// message received
+	dist_buf_t			reply;			// message sent
+} dist_shard_t;
+
+/*
+	append bytes to a payload
+	returns 0 or -4 on memory error
+*/
+static int buf_put( dist_buf_t *buf, const void *data, size_t size )
+{
+	size_t				max				= buf->max ? buf->max : 4096;
+	void				*ptr			= NULL;
+
+	while( buf->size + size > max ) {
+		max *= 2;
+	}
+	if( max > buf->max ) {
+		if( ( ptr = realloc( buf->data, max ) ) == NULL ) {
+			return -4;
+		}
+		buf->data	= ptr;
+		buf->max	= max;
+	}
+	if( size > 0 ) {
+		memcpy( buf->data + buf->size, data, size );
+	}
+	buf->size += size;
+
+	return 0;
+}
+
+/*
+	append a word to a payload
+	returns 0 or -4 on memory error
+*/
+static int buf_put64( dist_buf_t *buf, int64_t word )
+{
+	return buf_put( buf, &word, sizeof( int64_t ) );
+}
+
+/*
+	bytes of a payload at read position, which moves past them
+	returns bytes or NULL if payload is too short
+*/
+static const void *buf_get( dist_buf_t *buf, size_t size )
+{
+	const void			*bytes			= buf->data + buf->pos;
+
+	if( size > buf->size - buf->pos ) {
+		return NULL;
+	}
+	buf->pos += size;
+
+	return bytes;
+}
+
+/*
+	array of count items of size bytes at read position: count is read from payload, it
+	is checked against bytes left before any product that could wrap
+	returns items or NULL if count is negative or payload is too short
+*/
+static const void *buf_array( dist_buf_t *buf, int64_t count, size_t size )
+{
+	if( count < 0 || ( uint64_t )count > ( buf->size - buf->pos ) / size ) {
+		return NULL;
+	}
+
+	return buf_get( buf, size * count );
+}
+
+/*
+	next word of a payload, -1 if payload is too short
+*/
+static int64_t buf_get64( dist_buf_t *buf )
+{
+	const void			*bytes			= buf_get( buf, sizeof( int64_t ) );
+	int64_t				word			= -1;
+
+	if( bytes != NULL ) {
+		memcpy( &word, bytes, sizeof( int64_t ) );
+	}
+
+	return word;
+}
+
+/*
+	write all bytes to a socket
+	returns 0 or -2 on socket error
+*/
+static int dist_write( int fd, const void *data, size_t size )
+{
+	const char			*ptr			= data;
+	ssize_t				done;
+
+	while( size > 0 ) {
+		if( ( done = send( fd, ptr, size, MSG_NOSIGNAL ) ) < 0 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			return -2;
+		}
+		ptr		+= done;
+		size	-= done;
+	}
+
+	return 0;
+}
+
+/*
+	read all bytes from a socket
+	returns 0 or -2 on socket error or closed connection
+*/
+static int dist_read( int fd, void *data, size_t size )
+{
+	char				*ptr			= data;
+	ssize_t				done;
+
+	while( size > 0 ) {
+		if( ( done = recv( fd, ptr, size, 0 ) ) <= 0 ) {
+			if( done < 0 && errno == EINTR ) {
+				continue;
+			}
+			return -2;
+		}
+		ptr		+= done;
+		size	-= done;
+	}
+
+	return 0;
+}
+
+/*
+	send a message, payload is buf ( NULL if message has none )
+	returns 0 or -2 on socket error
+*/
+static int dist_send( int fd, uint32_t type, const dist_buf_t *buf )
+{
+	dist_header_t		header;
+
+	memset( &header, 0, sizeof( dist_header_t ) );
+	header.type		= type;
+	header.bytes	= ( buf != NULL ) ? buf->size : 0;
+	if( dist_write( fd, &header, sizeof( dist_header_t ) ) != 0 ) {
+		return -2;
+	}
+
+	return ( header.bytes > 0 ) ? dist_write( fd, buf->data, buf->size ) : 0;
+}
+
+/*
+	receive a message, its type goes to type and its payload to buf
+	returns 0, -2 on socket error, -3 on a payload over DIST_MAX_MESSAGE bytes or -4 on
+	memory error
+*/
+static int dist_receive( int fd, uint32_t *type, dist_buf_t *buf )
+{
+	dist_header_t		header;
+	void				*ptr			= NULL;
+
+	if( dist_read( fd, &header, sizeof( dist_header_t ) ) != 0 ) {
+		return -2;
+	}
+	if( header.bytes > DIST_MAX_MESSAGE ) {
+		return -3;
+	}
+	if( header.bytes > buf->max ) {
+		if( ( ptr = realloc( buf->data, header.bytes ) ) == NULL ) {
+			return -4;
+		}
+		buf->data	= ptr;
+		buf->max	= header.bytes;
+	}
+	buf->size	= header.bytes;
+	buf->pos	= 0;
+	*type		= header.type;
+
+	return dist_read( fd, buf->data, header.bytes );
+}
+
+/*
+	receive a message of a given type
+	returns 0, -2 on socket error, -3 on a message of another type or -4 on memory error
+*/
+static int dist_expect( int fd, uint32_t type, dist_buf_t *buf )
+{
+	uint32_t			received		= 0;
+	int					result			= dist_receive( fd, &received, buf );
+
+	return ( result == 0 && received != type ) ? -3 : result;
+}
+
+/*
+	socket address of a worker: "unix:PATH" for a Unix domain socket, "HOST:PORT" for TCP
+	returns address family or -1 if address is wrong
+*/
+static int dist_address( const char *address, struct sockaddr_storage *addr, socklen_t *size )
+{
+	struct sockaddr_un	*local			= ( struct sockaddr_un* )addr;
+	struct addrinfo		hints;
+	struct addrinfo		*found			= NULL;
+	const char			*port			= NULL;
+	char				host[ 256 ];
+
+	memset( addr, 0, sizeof( struct sockaddr_storage ) );
+	if( !strncmp( address, "unix:", 5 ) ) {
+		if( address[ 5 ] == '\0' || strlen( address + 5 ) >= sizeof( local->sun_path ) ) {
+			return -1;
+		}
+		local->sun_family	= AF_UNIX;
+		strcpy( local->sun_path, address + 5 );
+		*size				= sizeof( struct sockaddr_un );
+		return AF_UNIX;
+	}
+
+	if( ( port = strrchr( address, ':' ) ) == NULL || port == address || ( size_t )( port - address ) >= sizeof( host ) ) {
+		return -1;
+	}
+	memcpy( host, address, port - address );
+	host[ port - address ] = '\0';
+	memset( &hints, 0, sizeof( struct addrinfo ) );
+	hints.ai_family		= AF_UNSPEC;
+	hints.ai_socktype	= SOCK_STREAM;
+	if( getaddrinfo( host, port + 1, &hints, &found ) != 0 ) {
+		return -1;
+	}
+	memcpy( addr, found->ai_addr, found->ai_addrlen );
+	*size = found->ai_addrlen;
+	freeaddrinfo( found );
+
+	return addr->ss_family;
+}
+
+/*
+	connect to a worker, which may not be listening yet
+	returns socket, -1 if address is wrong or -2 if worker cannot be reached
+*/
+static int dist_dial( const char *address )
+{
+	struct sockaddr_storage	addr;
+	socklen_t			size			= 0;
+	int					family			= dist_address( address, &addr, &size );
+	int					on				= 1;
+	int					fd				= -1;
+	long				tries;
+
+	if( family < 0 ) {
+		return -1;
+	}
+	for( tries = 0; tries < DIST_DIAL_TRIES; tries++ ) {
+		if( ( fd = socket( family, SOCK_STREAM, 0 ) ) < 0 ) {
+			return -2;
+		}
+		if( connect( fd, ( struct sockaddr* )&addr, size ) == 0 ) {
+			// a pass is a small request and its reply, they must not wait for more data
+			if( family != AF_UNIX ) {
+				setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( int ) );
+			}
+			return fd;
+		}
+		close( fd );
+		if( errno != ECONNREFUSED && errno != ENOENT && errno != EINTR ) {
+			return -2;
+		}
+		usleep( DIST_DIAL_WAIT );
+	}
+
+	return -2;
+}
+
+/*
+	first cell of each attribute into count tables of a node, class counts first
+	returns offsets or NULL on memory error
+*/
+static long *dist_offsets( const long *tot_values, long cols )
+{
+	long				*voffset		= malloc( sizeof( long ) * cols );
+	long				col;
+
+	if( voffset != NULL ) {
+		voffset[ 0 ] = tot_values[ cols - 1 ];
+		for( col = 1; col < cols; col++ ) {
+			voffset[ col ] = voffset[ col - 1 ] + tot_values[ col - 1 ] * tot_values[ cols - 1 ];
+		}
+	}
+
+	return voffset;
+}
+
+/*
+	merge hello of a worker: first one gives column names and the other ones must have
+	the same, values of its catalogs are interned into merged ones in order of their
+	codes, workers being merged in order of shards
+	- map:		merged code of each value of each column of worker, one after the other,
+				tot_map gets its length
+	returns 0, -3 on malformed message or shard not matching the first one or -4 on memory
+	error
+*/
+static int dist_hello( dist_buf_t *buf, long worker, dataset_t *ds, char ***column_names, int32_t **map, long *tot_map )
+{
+	const char			*names			= NULL;
+	const char			*pool			= NULL;
+	const char			*name			= NULL;
+	char				*nameptr		= NULL;
+	int64_t				cols, rows, size, tot_values;
+	long				offset			= 0;
+	long				col, code, len, i;
+	void				*ptr			= NULL;
+
+	if( buf_get64( buf ) != DIST_MAGIC || ( cols = buf_get64( buf ) ) < 2 || ( rows = buf_get64( buf ) ) < 0 ||
+		( size = buf_get64( buf ) ) <= 0 || ( names = buf_get( buf, size ) ) == NULL || names[ size - 1 ] != '\0' || cols > size ) {
+		return -3;
+	}
+	if( worker > 0 && cols != ds->cols ) {
+		return -3;
+	}
+
+	// names of first worker are copied into a single block, as spill keeps them
+	if( worker == 0 ) {
+		ds->cols	= cols;
+		ds->dicts	= calloc( cols, sizeof( dict_t ) );
+		ds->widths	= calloc( cols, sizeof( int ) );
+		if( ds->dicts == NULL || ds->widths == NULL || ( *column_names = malloc( sizeof( char* ) * cols + size ) ) == NULL ) {
+			return -4;
+		}
+		memcpy( *column_names + cols, names, size );
+		for( col = 0; col < cols; col++ ) {
+			if( dict_init( ds->dicts + col ) != 0 ) {
+				return -4;
+			}
+			ds->widths[ col ] = sizeof( uint32_t );
+		}
+	}
+	nameptr = ( char* )( *column_names + cols );
+	for( col = 0, name = names; col < cols; col++ ) {
+		if( name >= names + size || strcmp( name, nameptr ) ) {
+			return -3;
+		}
+		( *column_names )[ col ]	= nameptr;
+		nameptr						+= strlen( nameptr ) + 1;
+		name						+= strlen( name ) + 1;
+	}
+	ds->rows += rows;
+
+	// catalog of each column: number of values and their names in code order
+	for( col = 0; col < cols; col++ ) {
+		tot_values	= buf_get64( buf );
+		size		= buf_get64( buf );
+		// a value takes a byte of pool at least
+		if( tot_values < 0 || size < 0 || ( pool = buf_get( buf, size ) ) == NULL || tot_values > size ) {
+			return -3;
+		}
+		if( ( ptr = realloc( *map, sizeof( int32_t ) * ( offset + tot_values + 1 ) ) ) == NULL ) {
+			return -4;
+		}
+		*map = ptr;
+		for( i = 0, name = pool; i < tot_values; i++ ) {
+			for( len = 0; name + len < pool + size && name[ len ] != '\0'; len++ );
+			if( name + len == pool + size ) {
+				return -3;
+			}
+			if( ( code = dict_intern( ds->dicts + col, name, len ) ) < 0 ) {
+				return -4;
+			}
+			( *map )[ offset++ ]	= code;
+			name					+= len + 1;
+		}
+	}
+	*tot_map = offset;
+
+	return ( buf->pos == buf->size ) ? 0 : -3;
+}
+
+/*
+	connect to workers holding shards of a dataset, in order of addresses: catalogs of
+	every worker are merged into ds ( rows are summed, columns stay NULL ), then every
+	worker gets merged codes of its values and numeric columns
+	- numeric:	flag of each column, NULL if no column is numeric
+	returns 0, -1 if an address is wrong, -2 if a worker cannot be reached, -3 if a
+	worker sends a malformed message or shards have different columns or -4 on memory
+	error; dist must be released by dist_close anyway
+*/
+int dist_connect( dist_t **dist, dataset_t *ds, char ***column_names, const char *const *addresses, long tot_workers, const char *numeric )
+{
+	dist_t				*dst			= NULL;
+	int32_t				**maps			= NULL;
+	long				*tot_maps		= NULL;
+	long				*tot_values		= NULL;
+	long				worker, col;
+	char				flag;
+	int					result			= 0;
+
+	*dist = NULL;
+	if( ( dst = calloc( 1, sizeof( dist_t ) ) ) == NULL || ( dst->fds = malloc( sizeof( int ) * tot_workers ) ) == NULL ) {
+		free( dst );
+		return -4;
+	}
+	for( worker = 0; worker < tot_workers; worker++ ) {
+		dst->fds[ worker ] = -1;
+	}
+	dst->tot_workers	= tot_workers;
+	*dist				= dst;
+
+	do {
+		maps		= calloc( tot_workers, sizeof( int32_t* ) );
+		tot_maps	= calloc( tot_workers, sizeof( long ) );
+		if( maps == NULL || tot_maps == NULL ) {
+			result = -4;
+			break;
+		}
+		for( worker = 0; result == 0 && worker < tot_workers; worker++ ) {
+			if( ( dst->fds[ worker ] = dist_dial( addresses[ worker ] ) ) < 0 ) {
+				result = dst->fds[ worker ];
+			} else if( ( result = dist_expect( dst->fds[ worker ], DIST_HELLO, &dst->buf ) ) == 0 ) {
+				result = dist_hello( &dst->buf, worker, ds, column_names, maps + worker, tot_maps + worker );
+			}
+		}
+		if( result != 0 ) {
+			break;
+		}
+
+		dst->tot_attrib = ds->cols - 1;
+		if( ( tot_values = malloc( sizeof( long ) * ds->cols ) ) == NULL ) {
+			result = -4;
+			break;
+		}
+		for( col = 0; col < ds->cols; col++ ) {
+			tot_values[ col ] = DS_VALUES( ds, col );
+		}
+		if( ( dst->voffset = dist_offsets( tot_values, ds->cols ) ) == NULL ) {
+			result = -4;
+			break;
+		}
+
+		// every worker knows the size of its own catalogs, so its map needs no length
+		for( worker = 0; result == 0 && worker < tot_workers; worker++ ) {
+			dst->buf.size = 0;
+			for( col = 0; result == 0 && col < ds->cols; col++ ) {
+				result = buf_put64( &dst->buf, tot_values[ col ] );
+			}
+			for( col = 0; result == 0 && col < ds->cols; col++ ) {
+				flag	= ( numeric != NULL && col < ds->cols - 1 && numeric[ col ] );
+				result	= buf_put( &dst->buf, &flag, 1 );
+			}
+			if( result == 0 ) {
+				result = buf_put( &dst->buf, maps[ worker ], sizeof( int32_t ) * tot_maps[ worker ] );
+			}
+			if( result == 0 ) {
+				result = dist_send( dst->fds[ worker ], DIST_CODES, &dst->buf );
+			}
+		}
+	} while( 0 );
+
+	for( worker = 0; maps != NULL && worker < tot_workers; worker++ ) {
+		free( maps[ worker ] );
+	}
+	free( maps );
+	free( tot_maps );
+	free( tot_values );
+
+	return result;
+}
+
+/*
+	run a pass on every worker: the pass goes to all of them, which move and count their
+	rows at the same time, then count tables are summed in order of workers. First class
+	of a node comes from first worker having rows there, as they are its first rows
+	- counts:		count tables of nodes counted by pass, zeroed by caller
+	- first_class:	class of first row of each node counted, -1 if node has no rows
+	returns 0, -2 on socket error, -3 on malformed message or -4 on memory error
+*/
+int dist_pass( dist_t *dist, const dist_pass_t *pass, long *const *counts, long *first_class )
+{
+	dist_buf_t			*buf			= &dist->buf;
+	const long			*voffset		= dist->voffset;
+	const int64_t		*cells			= NULL;
+	const char			*avail			= NULL;
+	long				tot_counted		= 0;
+	long				worker, node, slot, col, cell, end;
+	int64_t				class_id;
+	int					result			= 0;
+
+	buf->size = 0;
+	if( buf_put64( buf, pass->move ) != 0 || buf_put64( buf, pass->root ) != 0 || buf_put64( buf, pass->tot_routes ) != 0 ||
+		buf_put64( buf, pass->tot_values ) != 0 || buf_put64( buf, pass->first ) != 0 || buf_put64( buf, pass->tot_nodes ) != 0 ||
+		buf_put( buf, pass->routes, sizeof( dist_route_t ) * pass->tot_routes ) != 0 ||
+		buf_put( buf, pass->values, sizeof( int32_t ) * pass->tot_values ) != 0 ||
+		buf_put( buf, pass->targets, sizeof( int32_t ) * pass->tot_values ) != 0 ||
+		buf_put( buf, pass->counted, pass->tot_nodes ) != 0 ||
+		buf_put( buf, pass->avail, pass->tot_nodes * dist->tot_attrib ) != 0 ) {
+		return -4;
+	}
+	for( worker = 0; worker < dist->tot_workers; worker++ ) {
+		if( dist_send( dist->fds[ worker ], DIST_PASS, buf ) != 0 ) {
+			return -2;
+		}
+	}
+
+	for( node = 0; node < pass->tot_nodes; node++ ) {
+		if( pass->counted[ node ] ) {
+			first_class[ tot_counted++ ] = -1;
+		}
+	}
+	// a table holds class counts and cells of attributes available at its node
+	for( worker = 0; result == 0 && worker < dist->tot_workers; worker++ ) {
+		if( ( result = dist_expect( dist->fds[ worker ], DIST_TABLES, buf ) ) != 0 ) {
+			break;
+		}
+		for( node = 0, slot = 0; result == 0 && node < pass->tot_nodes; node++ ) {
+			if( !pass->counted[ node ] ) {
+				continue;
+			}
+			avail		= pass->avail + node * dist->tot_attrib;
+			class_id	= buf_get64( buf );
+			if( first_class[ slot ] < 0 ) {
+				first_class[ slot ] = class_id;
+			}
+			for( col = -1; col < dist->tot_attrib; col++ ) {
+				if( col >= 0 && !avail[ col ] ) {
+					continue;
+				}
+				cell	= ( col < 0 ) ? 0 : voffset[ col ];
+				end		= voffset[ col + 1 ];
+				if( ( cells = buf_get( buf, sizeof( int64_t ) * ( end - cell ) ) ) == NULL ) {
+					result = -3;
+					break;
+				}
+				for( ; cell < end; cell++ ) {
+					counts[ slot ][ cell ] += *cells++;
+				}
+			}
+			slot += 1;
+		}
+		if( result == 0 && buf->pos != buf->size ) {
+			result = -3;
+		}
+	}
+
+	return result;
+}
+
+/*
+	tell workers training is over and close connections, then release dist
+*/
+void dist_close( dist_t *dist )
+{
+	long				worker;
+
+	if( dist == NULL ) {
+		return;
+	}
+	for( worker = 0; worker < dist->tot_workers; worker++ ) {
+		if( dist->fds[ worker ] >= 0 ) {
+			dist_send( dist->fds[ worker ], DIST_DONE, NULL );
+			close( dist->fds[ worker ] );
+		}
+	}
+	free( dist->fds );
+	free( dist->voffset );
+	free( dist->buf.data );
+	free( dist );
+}
+
+/*
+	send hello of a worker: shape of its shard, column names and catalog of each column
+	returns 0, -2 on socket error or -4 on memory error
+*/
+static int shard_hello( dist_shard_t *shard, char *const *column_names )
+{
+	const dataset_t		*ds				= shard->ds;
+	dist_buf_t			*buf			= &shard->reply;
+	size_t				at				= 0;
+	int64_t				size			= 0;
+	long				col, code;
+	int					result			= 0;
+
+	buf->size = 0;
+	result |= buf_put64( buf, DIST_MAGIC );
+	result |= buf_put64( buf, ds->cols );
+	result |= buf_put64( buf, ds->rows );
+	result |= buf_put64( buf, 0 );
+	for( col = 0, at = buf->size; col < ds->cols; col++ ) {
+		result |= buf_put( buf, column_names[ col ], strlen( column_names[ col ] ) + 1 );
+	}
+	// sizes are known once names are written
+	size = buf->size - at;
+	if( result == 0 ) {
+		memcpy( buf->data + at - sizeof( int64_t ), &size, sizeof( int64_t ) );
+	}
+	for( col = 0; result == 0 && col < ds->cols; col++ ) {
+		result |= buf_put64( buf, DS_VALUES( ds, col ) );
+		result |= buf_put64( buf, 0 );
+		for( code = 0, at = buf->size; code < DS_VALUES( ds, col ); code++ ) {
+			result |= buf_put( buf, DICT_NAME( ds->dicts + col, code ), strlen( DICT_NAME( ds->dicts + col, code ) ) + 1 );
+		}
+		size = buf->size - at;
+		if( result == 0 ) {
+			memcpy( buf->data + at - sizeof( int64_t ), &size, sizeof( int64_t ) );
+		}
+	}
+
+	return ( result != 0 ) ? -4 : dist_send( shard->fd, DIST_HELLO, buf );
+}
+
+/*
+	read codes sent by coordinator: merged code of each value of shard, sizes of merged
+	catalogs and numeric columns, whose numbers are parsed from catalogs of shard
+	returns 0, -3 on malformed message or a value of a numeric column not a number or
+	-4 on memory error
+*/
+static int shard_codes( dist_shard_t *shard )
+{
+	const dataset_t		*ds				= shard->ds;
+	dist_buf_t			*buf			= &shard->buf;
+	const char			*flags			= NULL;
+	const void			*codes			= NULL;
+	long				*tot_values		= NULL;
+	int32_t				*map			= NULL;
+	long				tot_map			= 0;
+	long				col, code;
+	int					numeric			= 0;
+	int					result			= 0;
+
+	if( ( tot_values = malloc( sizeof( long ) * ds->cols ) ) == NULL ) {
+		return -4;
+	}
+	do {
+		for( col = 0; col < ds->cols; col++ ) {
+			if( ( tot_values[ col ] = buf_get64( buf ) ) < DS_VALUES( ds, col ) ) {
+				result = -3;
+			}
+			tot_map += DS_VALUES( ds, col );
+		}
+		if( result != 0 || ( flags = buf_get( buf, ds->cols ) ) == NULL ||
+			( codes = buf_get( buf, sizeof( int32_t ) * tot_map ) ) == NULL || buf->pos != buf->size ) {
+			result = -3;
+			break;
+		}
+
+		// maps follow the array of columns
+		if( ( shard->maps = malloc( sizeof( int32_t* ) * ds->cols + sizeof( int32_t ) * ( tot_map + 1 ) ) ) == NULL ) {
+			result = -4;
+			break;
+		}
+		map = ( int32_t* )( shard->maps + ds->cols );
+		memcpy( map, codes, sizeof( int32_t ) * tot_map );
+		for( col = 0; col < ds->cols; col++ ) {
+			shard->maps[ col ] = map;
+			for( code = 0; code < DS_VALUES( ds, col ); code++ ) {
+				if( map[ code ] < 0 || map[ code ] >= tot_values[ col ] ) {
+					result = -3;
+				}
+			}
+			map		+= DS_VALUES( ds, col );
+			numeric	|= flags[ col ];
+		}
+		if( result != 0 ) {
+			break;
+		}
+
+		shard->tot_classes	= tot_values[ ds->cols - 1 ];
+		shard->voffset		= dist_offsets( tot_values, ds->cols );
+		shard->assign		= malloc( sizeof( int32_t ) * ( ds->rows + 1 ) );
+		if( shard->voffset == NULL || shard->assign == NULL ) {
+			result = -4;
+			break;
+		}
+		if( numeric && ( result = numbers_parse( &shard->numbers, ds, flags ) ) != 0 ) {
+			result = ( result == -1 ) ? -3 : -4;
+		}
+	} while( 0 );
+	free( tot_values );
+
+	return result;
+}
+
+/*
+	node of level a row moves to from its node of previous level, -1 if it stops
+*/
+static long shard_route( const dist_shard_t *shard, const dist_pass_t *pass, long row, long node )
+{
+	const dist_route_t	*route			= pass->routes + node;
+	long				code			= 0;
+	long				low				= route->first;
+	long				high			= route->first + route->tot_values;
+	long				mid;
+
+	if( route->attrib < 0 ) {
+		return -1;
+	}
+	code = ds_code( shard->ds, route->attrib, row );
+	if( route->tot_values == 0 ) {
+		return pass->targets[ route->first + ( shard->numbers[ route->attrib ][ code ] > route->threshold ) ];
+	}
+	code = shard->maps[ route->attrib ][ code ];
+	while( low < high ) {
+		mid = ( low + high ) / 2;
+		if( pass->values[ mid ] < code ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return ( low < route->first + route->tot_values && pass->values[ low ] == code ) ? pass->targets[ low ] : -1;
+}
+
+/*
+	run a pass over rows of shard: rows move to nodes of level if pass asks it, then rows
+	of nodes counted fill their count tables, which are sent back with class counts and
+	cells of attributes available at node only
+	returns 0, -2 on socket error, -3 on malformed message or -4 on memory error
+*/
+static int shard_pass( dist_shard_t *shard )
+{
+	const dataset_t		*ds				= shard->ds;
+	dist_buf_t			*buf			= &shard->buf;
+	long				tot_attrib		= shard->tot_attrib;
+	long				tot_classes		= shard->tot_classes;
+	long				tot_cells		= shard->voffset[ ds->cols - 1 ];
+	const long			*voffset		= shard->voffset;
+	const dist_route_t	*route			= NULL;
+	const char			*avail			= NULL;
+	int64_t				*table			= NULL;
+	dist_pass_t			pass;
+	long				tot_counted		= 0;
+	long				row, node, col, class_id;
+	void				*ptr			= NULL;
+	int					result			= 0;
+
+	memset( &pass, 0, sizeof( dist_pass_t ) );
+	pass.move		= buf_get64( buf );
+	pass.root		= buf_get64( buf );
+	pass.tot_routes	= buf_get64( buf );
+	pass.tot_values	= buf_get64( buf );
+	pass.first		= buf_get64( buf );
+	pass.tot_nodes	= buf_get64( buf );
+	if( pass.first < 0 ||
+		( pass.routes = buf_array( buf, pass.tot_routes, sizeof( dist_route_t ) ) ) == NULL ||
+		( pass.values = buf_array( buf, pass.tot_values, sizeof( int32_t ) ) ) == NULL ||
+		( pass.targets = buf_array( buf, pass.tot_values, sizeof( int32_t ) ) ) == NULL ||
+		( pass.counted = buf_array( buf, pass.tot_nodes, 1 ) ) == NULL ||
+		( pass.avail = buf_array( buf, pass.tot_nodes, tot_attrib ) ) == NULL || buf->pos != buf->size ) {
+		return -3;
+	}
+	for( node = 0; node < pass.tot_routes; node++ ) {
+		route = pass.routes + node;
+		if( route->attrib < 0 ) {
+			continue;
+		}
+		// a numeric split has two targets
+		if( route->attrib >= tot_attrib || route->first < 0 || route->tot_values < 0 ||
+			route->first > pass.tot_values - ( route->tot_values ? route->tot_values : 2 ) ||
+			( route->tot_values == 0 && ( shard->numbers == NULL || shard->numbers[ route->attrib ] == NULL ) ) ) {
+			return -3;
+		}
+	}
+
+	// a table of each node counted, its first cell is class of its first row
+	if( pass.tot_nodes > shard->max_slots ) {
+		if( ( ptr = realloc( shard->slots, sizeof( long ) * pass.tot_nodes ) ) == NULL ) {
+			return -4;
+		}
+		shard->slots		= ptr;
+		shard->max_slots	= pass.tot_nodes;
+	}
+	for( node = 0; node < pass.tot_nodes; node++ ) {
+		shard->slots[ node ] = pass.counted[ node ] ? tot_counted++ : -1;
+	}
+	if( tot_counted > shard->max_tables ) {
+		if( ( ptr = realloc( shard->tables, sizeof( int64_t ) * ( tot_cells + 1 ) * tot_counted ) ) == NULL ) {
+			return -4;
+		}
+		shard->tables		= ptr;
+		shard->max_tables	= tot_counted;
+	}
+	memset( shard->tables, 0, sizeof( int64_t ) * ( tot_cells + 1 ) * tot_counted );
+	for( node = 0; node < tot_counted; node++ ) {
+		shard->tables[ node * ( tot_cells + 1 ) ] = -1;
+	}
+
+	for( row = 0; row < ds->rows; row++ ) {
+		if( pass.move ) {
+			if( pass.root ) {
+				shard->assign[ row ] = 0;
+			} else if( shard->assign[ row ] >= 0 ) {
+				if( shard->assign[ row ] >= pass.tot_routes ) {
+					return -3;
+				}
+				shard->assign[ row ] = shard_route( shard, &pass, row, shard->assign[ row ] );
+			}
+		}
+		node = shard->assign[ row ] - pass.first;
+		if( node < 0 || node >= pass.tot_nodes || shard->slots[ node ] < 0 ) {
+			continue;
+		}
+		table		= shard->tables + shard->slots[ node ] * ( tot_cells + 1 );
+		class_id	= shard->maps[ tot_attrib ][ ds_code( ds, tot_attrib, row ) ];
+		if( table[ 0 ] < 0 ) {
+			table[ 0 ] = class_id;
+		}
+		table		+= 1;
+		avail		= pass.avail + node * tot_attrib;
+		table[ class_id ] += 1;
+		for( col = 0; col < tot_attrib; col++ ) {
+			if( avail[ col ] ) {
+				table[ voffset[ col ] + shard->maps[ col ][ ds_code( ds, col, row ) ] * tot_classes + class_id ] += 1;
+			}
+		}
+	}
+
+	shard->reply.size = 0;
+	for( node = 0; result == 0 && node < pass.tot_nodes; node++ ) {
+		if( shard->slots[ node ] < 0 ) {
+			continue;
+		}
+		table	= shard->tables + shard->slots[ node ] * ( tot_cells + 1 );
+		avail	= pass.avail + node * tot_attrib;
+		result	= buf_put( &shard->reply, table, sizeof( int64_t ) * ( 1 + tot_classes ) );
+		for( col = 0; result == 0 && col < tot_attrib; col++ ) {
+			if( avail[ col ] ) {
+				result = buf_put( &shard->reply, table + 1 + voffset[ col ], sizeof( int64_t ) * ( voffset[ col + 1 ] - voffset[ col ] ) );
+			}
+		}
+	}
+
+	return ( result != 0 ) ? -4 : dist_send( shard->fd, DIST_TABLES, &shard->reply );
+}
+
+/*
+	serve a shard to the coordinator of a distributed training ( see id3_train_workers ):
+	listen at address ( "unix:PATH" or "HOST:PORT" ), accept a single coordinator and
+	run its passes over rows of data until tree is built. Rows never leave worker,
+	only count tables of nodes do
+	returns 0, -1 on wrong parameters, -2 on socket error or if coordinator goes away,
+	-3 on malformed message or a value of a numeric column not a number or -4 on memory
+	error
+*/
+int id3_worker_serve( const id3_data_t *data, const char *address )
+{
+	struct sockaddr_storage	addr;
+	socklen_t			size			= 0;
+	int					family			= -1;
+	int					listener		= -1;
+	int					on				= 1;
+	dist_shard_t		shard;
+	uint32_t			type			= 0;
+	int					result			= 0;
+
+	if( data == NULL || address == NULL || ( family = dist_address( address, &addr, &size ) ) < 0 ) {
+		return -1;
+	}
+	memset( &shard, 0, sizeof( dist_shard_t ) );
+	shard.ds			= &data->ds;
+	shard.fd			= -1;
+	shard.tot_attrib	= data->ds.cols - 1;
+
+	do {
+		// a socket file left by a previous worker is replaced
+		if( ( listener = socket( family, SOCK_STREAM, 0 ) ) < 0 ) {
+			result = -2;
+			break;
+		}
+		if( family == AF_UNIX ) {
+			unlink( ( ( struct sockaddr_un* )&addr )->sun_path );
+		} else {
+			setsockopt( listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( int ) );
+		}
+		if( bind( listener, ( struct sockaddr* )&addr, size ) != 0 || listen( listener, 1 ) != 0 ) {
+			result = -2;
+			break;
+		}
+		while( ( shard.fd = accept( listener, NULL, NULL ) ) < 0 && errno == EINTR );
+		if( shard.fd < 0 ) {
+			result = -2;
+			break;
+		}
+		if( family != AF_UNIX ) {
+			setsockopt( shard.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( int ) );
+		}
+
+		// codes come first, then passes until coordinator is done
+		if( ( result = shard_hello( &shard, data->column_names ) ) != 0 ) {
+			break;
+		}
+		while( ( result = dist_receive( shard.fd, &type, &shard.buf ) ) == 0 && type != DIST_DONE ) {
+			if( type == DIST_CODES && shard.maps == NULL ) {
+				result = shard_codes( &shard );
+			} else if( type == DIST_PASS && shard.maps != NULL ) {
+				result = shard_pass( &shard );
+			} else {
+				result = -3;
+			}
+			if( result != 0 ) {
+				break;
+			}
+		}
+	} while( 0 );
+
+	if( shard.fd >= 0 ) {
+		close( shard.fd );
+	}
+	if( listener >= 0 ) {
+		close( listener );
+		if( family == AF_UNIX ) {
+			unlink( ( ( struct sockaddr_un* )&addr )->sun_path );
+		}
+	}
+	free( shard.maps );
+	free( shard.numbers );
+	free( shard.voffset );
+	free( shard.assign );
+	free( shard.tables );
+	free( shard.slots );
+	free( shard.buf.data );
+	free( shard.reply.data );
+
+	return result;
+}
@@ -0,0 +1,295 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+struct forest_tag;
+
+/*
+	tree of a forest, built by a worker of thread pool
+*/
+typedef struct forest_tree_tag {
+	const struct forest_tag	*forest;
+	uint64_t			seed;			// seed of bootstrap sample and of attribute draws
+	flat_t				flat;			// compiled tree
+	id3_stats_t			stats;			// statistics of tree if enabled
+	int					result;
+} forest_tree_t;
+
+/*
+	state shared by trees of a forest, read only while they are built
+*/
+typedef struct forest_tag {
+	const dataset_t		*ds;			// samples drawn by every tree, never copied
+	const long			*bounds;		// rows up to each sample ( weights summed ) when duplicate
+										// rows are collapsed, NULL if every sample is a row
+	long				tot_rows;		// rows of dataset, drawn by each bootstrap sample
+	const double *const	*numbers;
+	id3_params_t		params;			// parameters of trees: serial, attributes drawn
+} forest_t;
+
+/*
+	train a tree of a forest: bootstrap sample draws as many rows as dataset has with
+	replacement and becomes weights of samples ( a row drawn twice weighs 2, rows never
+	drawn weigh 0 and are left out ), so trees share the encoded dataset. A dataset of
+	collapsed duplicates draws rows as well, a row picks the sample standing for it
+*/
+static void forest_run( void *arg, long worker )
+{
+	forest_tree_t		*tree			= arg;
+	const forest_t		*forest			= tree->forest;
+	dataset_t			view			= *forest->ds;
+	id3_params_t		params			= forest->params;
+	tree_t				built;
+	uint64_t			state			= tree->seed;
+	long				*weights		= NULL;
+	double				start			= 0;
+	long				draw, low, high, mid, i;
+
+	( void )worker;
+	if( ( weights = calloc( view.rows + 1, sizeof( long ) ) ) == NULL ) {
+		tree->result = -1;
+		return;
+	}
+	for( i = 0; i < forest->tot_rows; i++ ) {
+		draw = ( long )( random_next( &state ) % ( uint64_t )forest->tot_rows );
+		if( forest->bounds != NULL ) {
+			for( low = 0, high = view.rows - 1; low < high; ) {
+				mid = ( low + high ) / 2;
+				if( forest->bounds[ mid ] > draw ) {
+					high	= mid;
+				} else {
+					low		= mid + 1;
+				}
+			}
+			draw = low;
+		}
+		weights[ draw ] += 1;
+	}
+	view.weights	= weights;
+	params.seed		= random_next( &state );
+	params.stats	= ( forest->params.stats != NULL ) ? &tree->stats : NULL;
+
+	if( ( tree->result = tree_build( &built, &view, forest->numbers, &params, NULL ) ) == 0 ) {
+		start			= stats_wall();
+		tree->result	= flat_compile( &tree->flat, &built, DS_VALUES( &view, view.cols - 1 ) );
+		tree_free( &built );
+		tree->stats.compile_wall	+= stats_wall() - start;
+		tree->stats.bytes_allocated	+= sizeof( long ) * ( view.rows + 1 ) + sizeof( int32_t ) * tree->flat.size;
+	}
+	free( weights );
+}
+
+/*
+	join compiled trees into a single flat array: terminal nodes are the same for every
+	tree and are stored once, inner nodes of each tree follow the ones of previous tree
+	in their breadth first order, with offsets of children moved by their new position
+	returns 0 or -1 on memory error
+*/
+static int forest_join( flat_t *flat, long *roots, const forest_tree_t *trees, long tot_trees, long tot_classes )
+{
+	const flat_t		*from			= NULL;
+	int32_t				*nodes			= NULL;
+	long				inner			= FLAT_INNER( tot_classes );
+	long				size			= inner;
+	long				shift, end, pos, tree, j;
+
+	memset( flat, 0, sizeof( flat_t ) );
+	for( tree = 0; tree < tot_trees; tree++ ) {
+		size += trees[ tree ].flat.size - inner;
+	}
+	if( size > INT32_MAX || ( nodes = malloc( sizeof( int32_t ) * size ) ) == NULL ) {
+		return -1;
+	}
+	memcpy( nodes, trees[ 0 ].flat.nodes, sizeof( int32_t ) * inner );
+
+	for( pos = inner, tree = 0; tree < tot_trees; tree++ ) {
+		from	= &trees[ tree ].flat;
+		shift	= pos - inner;
+		end		= pos + from->size - inner;
+		memcpy( nodes + pos, from->nodes + inner, sizeof( int32_t ) * ( from->size - inner ) );
+		roots[ tree ] = ( from->root >= inner ) ? from->root + shift : from->root;
+		for( ; pos < end; pos += FLAT_SIZE( nodes, pos ) ) {
+			for( j = 0; j < nodes[ pos + 1 ]; j++ ) {
+				if( nodes[ pos + 2 + j ] >= inner ) {
+					nodes[ pos + 2 + j ] += shift;
+				}
+			}
+		}
+	}
+	flat->nodes	= nodes;
+	flat->size	= size;
+	flat->root	= roots[ 0 ];
+
+	return 0;
+}
+
+/*
+	train a bagged forest of params->trees trees: every tree is a task of thread pool,
+	built serially on its bootstrap sample with features attributes drawn at each node
+	( square root of attributes if not set ); seeds of trees are drawn in order before
+	training, so the forest is the same for any number of threads. Duplicate rows are
+	collapsed once for all trees
+	returns 0 or -1 on memory error
+*/
+int forest_build( flat_t *flat, long *roots, const dataset_t *ds, const double *const *numbers, const id3_params_t *params )
+{
+	forest_t			forest;
+	forest_tree_t		*trees			= NULL;
+	dataset_t			unique;						// rows of ds with weights, if they halve
+	long				*bounds			= NULL;
+	pool_t				*pool			= NULL;
+	id3_stats_t			*stats			= params->stats;
+	uint64_t			state			= params->seed;
+	long				tot_trees		= params->trees;
+	long				threads			= params->threads;
+	double				wall			= 0;
+	double				cpu				= 0;
+	int					result			= 0;
+	long				i;
+
+	memset( &forest, 0, sizeof( forest_t ) );
+	memset( &unique, 0, sizeof( dataset_t ) );
+	memset( flat, 0, sizeof( flat_t ) );
+	if( stats != NULL ) {
+		wall	= stats_wall();
+		cpu		= stats_cpu();
+	}
+	forest.ds				= ds;
+	forest.tot_rows			= ds->rows;
+	forest.numbers			= numbers;
+	forest.params			= *params;
+	forest.params.threads	= 1;
+	forest.params.trees		= 1;
+	if( forest.params.features <= 0 ) {
+		forest.params.features = ( long )sqrt( ( double )( ds->cols - 1 ) );
+		if( forest.params.features < 1 ) {
+			forest.params.features = 1;
+		}
+	}
+	if( threads <= 0 ) {
+		threads = sysconf( _SC_NPROCESSORS_ONLN );
+	}
+	if( threads > tot_trees ) {
+		threads = tot_trees;
+	}
+
+	do {
+		// duplicate rows are collapsed when it pays, bootstrap samples still draw rows
+		if( ( result = dataset_dedup( &unique, ds ) ) < 0 ) {
+			break;
+		}
+		if( result == 0 ) {
+			if( ( bounds = malloc( sizeof( long ) * ( unique.rows + 1 ) ) ) == NULL ) {
+				result = -1;
+				break;
+			}
+			for( i = 0; i < unique.rows; i++ ) {
+				bounds[ i ] = unique.weights[ i ] + ( ( i > 0 ) ? bounds[ i - 1 ] : 0 );
+			}
+			forest.ds		= &unique;
+			forest.bounds	= bounds;
+		}
+		result = 0;
+
+		if( ( trees = calloc( tot_trees, sizeof( forest_tree_t ) ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		for( i = 0; i < tot_trees; i++ ) {
+			trees[ i ].forest	= &forest;
+			trees[ i ].seed		= random_next( &state );
+		}
+
+		// trees are independent tasks, calling thread is worker 0
+		if( threads > 1 && ( pool = pool_create( threads ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		for( i = 0; i < tot_trees; i++ ) {
+			if( pool == NULL ) {
+				forest_run( trees + i, 0 );
+			} else if( pool_submit( pool, 0, NULL, forest_run, trees + i ) != 0 ) {
+				trees[ i ].result	= -1;
+				result				= -1;
+				break;
+			}
+		}
+		if( pool != NULL ) {
+			pool_wait( pool, 0 );
+		}
+		for( i = 0; result == 0 && i < tot_trees; i++ ) {
+			result = trees[ i ].result;
+		}
+		if( result != 0 ) {
+			break;
+		}
+
+		// trees are laid out one after the other, in order of their seeds
+		result = forest_join( flat, roots, trees, tot_trees, DS_VALUES( ds, ds->cols - 1 ) );
+	} while( 0 );
+
+	pool_destroy( pool );
+	for( i = 0; trees != NULL && i < tot_trees; i++ ) {
+		if( stats != NULL ) {
+			stats_merge( stats, &trees[ i ].stats );
+			stats->compile_wall += trees[ i ].stats.compile_wall;
+			if( trees[ i ].stats.tree_bytes > stats->tree_bytes ) {
+				stats->tree_bytes = trees[ i ].stats.tree_bytes;
+			}
+		}
+		flat_free( &trees[ i ].flat );
+	}
+	if( stats != NULL ) {
+		stats->unique_rows		+= forest.ds->rows;
+		stats->bytes_allocated	+= sizeof( forest_tree_t ) * tot_trees;
+		if( bounds != NULL ) {
+			stats->bytes_allocated += sizeof( long ) * 2 * ( unique.max_rows + 1 );
+			for( i = 0; i < unique.cols; i++ ) {
+				stats->bytes_allocated += ( size_t )unique.widths[ i ] * ( unique.max_rows + 1 );
+			}
+		}
+		stats->train_wall		+= stats_wall() - wall;
+		stats->train_cpu		+= stats_cpu() - cpu;
+	}
+	free( trees );
+	free( bounds );
+	unique.dicts = NULL;
+	dataset_free( &unique );
+	if( result != 0 ) {
+		flat_free( flat );
+	}
+
+	return result;
+}
@@ -0,0 +1,404 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	internal declarations shared by library sources (and by bench.c),
+	not part of the public interface in id3.h
+*/
+
+#ifndef ID3_INT_H_INCLUDED
+#define ID3_INT_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "id3.h"
+
+/*
+	string dictionary of a single column: every distinct string is stored once
+	and receives a dense code ( 0, 1, 2, ... ) in order of first appearance
+*/
+typedef struct dict_tag {
+	long				tot_values;		// number of interned strings
+	long				max_values;		// allocated entries of offsets / hashes
+	uint32_t			*offsets;		// code -> offset of name into pool
+	uint32_t			*hashes;		// code -> hash of name, kept to grow slots
+	char				*pool;			// NUL terminated names in insertion order
+	long				pool_size;		// used bytes of pool
+	long				pool_max;		// allocated bytes of pool
+	uint32_t			*slots;			// open addressing table, code + 1 ( 0 = empty slot )
+	long				tot_slots;		// size of slots, always a power of two
+} dict_t;
+
+/*
+	name of an interned string
+*/
+#define DICT_NAME( dict, code )		( ( dict )->pool + ( dict )->offsets[ ( code ) ] )
+
+int dict_init( dict_t *dict );
+void dict_free( dict_t *dict );
+int dict_copy( dict_t *dict, const dict_t *from );
+long dict_intern( dict_t *dict, const char *name, long len );
+long dict_lookup( const dict_t *dict, const char *name, long len );
+void dict_truncate( dict_t *dict, long tot_values );
+
+/*
+	encoded dataset: columns are stored one after the other ( column-major ) and every
+	column uses the narrowest code width able to hold its catalog of values
+*/
+typedef struct dataset_tag {
+	long				cols;			// attributes + class column ( always the last one )
+	long				rows;			// total samples
+	long				max_rows;		// samples columns have room for
+	dict_t				*dicts;			// catalog of values of each column, code -> name
+	int					*widths;		// bytes of each code of column: 1, 2 or 4
+	void				**columns;		// codes of each column
+	long				*weights;		// rows each sample stands for once duplicates are collapsed,
+										// NULL if every sample is a single row
+} dataset_t;
+
+/*
+	code of a cell of encoded dataset
+*/
+static inline long ds_code( const dataset_t *ds, long col, long row )
+{
+	switch( ds->widths[ col ] ) {
+	case 1:
+		return ( ( const uint8_t* )ds->columns[ col ] )[ row ];
+	case 2:
+		return ( ( const uint16_t* )ds->columns[ col ] )[ row ];
+	default:
+		return ( ( const uint32_t* )ds->columns[ col ] )[ row ];
+	}
+}
+
+/*
+	number of values of a column
+*/
+#define DS_VALUES( ds, col )		( ( ds )->dicts[ ( col ) ].tot_values )
+
+/*
+	info gain from count tables, shared by every engine building trees
+*/
+double calc_entropy_set( const long *class_counts, long tot_classes, long totsamples );
+double calc_counts_gain( const long *counts, const long *totals, const long *present, long tot_present, long tot_classtype, long totsamples );
+
+/*
+	numbers of numeric columns: code -> value parsed from catalog, NULL for columns that
+	are not numeric; a single allocation that is released by free
+*/
+int numbers_parse( double ***numbers, const dataset_t *ds, const char *numeric );
+
+/*
+	field of a line of a delimited text file, it points into file contents and is not NUL
+	terminated
+*/
+typedef struct field_tag {
+	const char			*ptr;
+	long				len;
+} field_t;
+
+/*
+	receiver of a delimited text file read by csv_read: header gets column names and, if
+	count is set, an upper bound of samples ( 0 otherwise ), sample gets fields of every
+	line. Both return 0 or a negative error that stops reading
+*/
+typedef struct csv_sink_tag {
+	int					( *header )( void *arg, const field_t *names, long cols, long max_rows );
+	int					( *sample )( void *arg, const field_t *fields, long cols );
+	void				*arg;
+	int					count;			// samples are counted before reading them
+} csv_sink_t;
+
+int csv_read( const char *path, char delim, long class_col, const csv_sink_t *sink );
+
+int dataset_init( dataset_t *ds, long cols, long rows );
+int dataset_reserve( dataset_t *ds, long rows );
+int dataset_set( dataset_t *ds, long col, long row, const char *name, long len );
+int dataset_dedup( dataset_t *unique, const dataset_t *ds );
+int id3_encode( dataset_t *ds, char **data, long cols, long rows );
+void dataset_free( dataset_t *ds );
+
+/*
+	memory arena: objects are carved out of big blocks and released all together
+*/
+typedef struct arena_block_tag arena_block_t;
+
+typedef struct arena_tag {
+	arena_block_t		*blocks;		// allocated blocks, current one first
+	size_t				block_size;		// bytes requested to system for each block
+	size_t				allocated;		// total bytes requested to system
+} arena_t;
+
+void arena_init( arena_t *arena, size_t block_size );
+void *arena_alloc( arena_t *arena, size_t size );
+void arena_free( arena_t *arena );
+void arena_merge( arena_t *arena, arena_t *from );
+
+/*
+	work-stealing thread pool: every worker owns a deque of tasks and steals from
+	the others when its own is empty
+*/
+typedef void ( *pool_func_t )( void *arg, long worker );
+
+/*
+	tasks waited together by the worker that submitted them
+*/
+typedef struct pool_group_tag {
+	long				pending;		// tasks of group queued or running, under pool lock
+} pool_group_t;
+
+typedef struct pool_task_tag {
+	pool_func_t			func;
+	void				*arg;
+	pool_group_t		*group;			// NULL if task is not part of a group
+} pool_task_t;
+
+typedef struct pool_tag pool_t;
+
+pool_t *pool_create( long workers );
+void pool_destroy( pool_t *pool );
+long pool_workers( const pool_t *pool );
+int pool_submit( pool_t *pool, long worker, pool_group_t *group, pool_func_t func, void *arg );
+void pool_wait( pool_t *pool, long worker );
+void pool_wait_group( pool_t *pool, long worker, pool_group_t *group );
+
+/*
+	node data
+*/
+typedef struct node_tag {
+	int32_t				winvalue;		// value of parent's split attribute ( -1 for root )
+	int32_t				threshold;		// code of threshold of a numeric split attribute, values up
+										// to it go to first child and greater ones to second, else -1
+	long				attrib;			// split attribute, -1 if node has no branches
+	long				class_id;		// class of terminal node, majority class of inner node
+										// ( default branch of values without a child )
+	long				tot_samples;
+	long				*samples;		// slice of training sample buffer, NULL once node is built
+	long				tot_nodes;
+	struct node_tag		*nodes;			// children of values found at node, by increasing value
+} node_t;
+
+/*
+	decision tree: every node lives in the arena and the whole tree is freed at once
+*/
+typedef struct tree_tag {
+	arena_t				arena;
+	node_t				*root;
+} tree_t;
+
+int tree_build( tree_t *tree, const dataset_t *ds, const double *const *numbers, const id3_params_t *params, const char *avail );
+void tree_free( tree_t *tree );
+
+/*
+	next number of a random sequence ( splitmix64 ), state is advanced; training draws
+	are reproducible from seed parameter
+*/
+static inline uint64_t random_next( uint64_t *state )
+{
+	uint64_t			z				= ( *state += 0x9e3779b97f4a7c15ull );
+
+	z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebull;
+	return z ^ ( z >> 31 );
+}
+
+/*
+	rows held by worker processes for distributed training ( see id3_dist.c ): a tree grows
+	level by level as in out-of-core training, every pass sends splits of previous level
+	and nodes to count to all workers, their count tables are summed
+*/
+typedef struct dist_tag dist_t;
+
+// split of a node of previous level: rows go to the target of their value, numeric splits
+// have targets for values up to threshold and greater ones
+typedef struct dist_route_tag {
+	int32_t				attrib;			// split attribute, -1 if rows of node stop there
+	int32_t				tot_values;		// values of a categorical split, 0 for a numeric one
+	int64_t				first;			// first value and target of split into pass arrays
+	double				threshold;		// number of threshold of a numeric split
+} dist_route_t;
+
+// pass of workers over their rows: move is set by first pass of a level ( root is set
+// at depth 0, where every row starts from root ), nodes of a batch are counted
+typedef struct dist_pass_tag {
+	int					move;
+	int					root;
+	long				tot_routes;		// a route for each node of previous level
+	const dist_route_t	*routes;
+	long				tot_values;
+	const int32_t		*values;		// value of each child of categorical splits
+	const int32_t		*targets;		// node of each child into level, -1 if it is not open
+	long				first;			// first node of batch into level
+	long				tot_nodes;		// nodes of batch
+	const char			*counted;		// node of batch is counted
+	const char			*avail;			// attributes counted for each node of batch
+} dist_pass_t;
+
+int dist_connect( dist_t **dist, dataset_t *ds, char ***column_names, const char *const *addresses, long tot_workers, const char *numeric );
+int dist_pass( dist_t *dist, const dist_pass_t *pass, long *const *counts, long *first_class );
+void dist_close( dist_t *dist );
+
+/*
+	dataset spilled to temporary files for out-of-core training ( see id3_spill.c ): codes
+	of each column are in a file of their own, only catalogs stay in memory. Rows of
+	distributed training stay with workers instead, spill keeps their catalogs
+*/
+typedef struct spill_tag {
+	dataset_t			ds;				// catalogs and code widths, columns are NULL
+	char				**column_names;	// names of columns, class last ( single block )
+	FILE				**files;		// codes of each column
+	char				*dir;			// directory of temporary files
+	size_t				memory;			// memory budget of training
+	long				chunk;			// rows read or written at a time
+	uint32_t			*codes;			// chunk of codes of each column
+	uint32_t			*row;			// codes of sample being encoded
+	long				buffered;		// rows of codes not yet written while encoding
+	long				tot_cells;		// cells of count tables of a node
+	long				row_bytes;		// memory of a gathered row while its subtree is built
+	size_t				batch_bytes;	// memory of count tables and gathered rows of a pass
+	size_t				fixed;			// memory of training besides a pass
+	int					assign_file;	// node of each row is kept in a file, not in memory
+	int					io_error;		// a temporary file could not be written or read ( a worker
+										// failed during distributed training )
+	dist_t				*dist;			// workers holding rows, NULL if rows are in files
+} spill_t;
+
+int spill_create( spill_t *spill, const char *path, char delim, long class_col, const id3_params_t *params );
+int spill_connect( spill_t *spill, const char *const *addresses, long tot_workers, const id3_params_t *params );
+int spill_build( tree_t *tree, spill_t *spill, const double *const *numbers, const id3_params_t *params );
+void spill_free( spill_t *spill );
+
+/*
+	tree compiled for prediction into a single array ( see flat_compile )
+*/
+// offset of terminal node of a class inside flat array, 0 is the node without class
+#define	FLAT_LEAF( class_id )		( ( class_id ) >= 0 ? 2 + 2 * ( class_id ) : 0 )
+
+// offset of terminal node of a class reached by default branch of inner nodes, its first
+// word is FLAT_OTHER_WORD so that values without a child are told apart from children
+#define	FLAT_OTHER( class_id, tot_classes )	( ( class_id ) >= 0 ? 2 + 2 * ( tot_classes ) + 2 * ( class_id ) : 0 )
+#define	FLAT_OTHER_WORD				-2
+
+// offset of first inner node, after terminal nodes
+#define	FLAT_INNER( tot_classes )	( 2 + 4 * ( tot_classes ) )
+
+// attribute word of an inner node splitting a numeric attribute by a threshold, such a
+// node has 2 children and a word holding code of threshold
+#define	FLAT_NUMERIC				0x40000000
+
+// attribute word of an inner node having children for few values of its attribute,
+// values of children follow them
+#define	FLAT_SPARSE					0x20000000
+#define	FLAT_ATTRIB( word )			( ( word ) & ~( FLAT_NUMERIC | FLAT_SPARSE ) )
+
+// a node gets the sparse form when its children are less than a quarter of the words
+// of the dense one
+#define	FLAT_SPARSE_RATIO			4
+
+// words of inner node at offset pos, the last one is its default branch
+#define	FLAT_SIZE( nodes, pos )		( 3 + ( nodes )[ ( pos ) + 1 ] + ( ( ( nodes )[ pos ] & FLAT_NUMERIC ) != 0 ) +	\
+									( ( ( nodes )[ pos ] & FLAT_SPARSE ) ? ( nodes )[ ( pos ) + 1 ] : 0 ) )
+
+// default branch of inner node at offset pos
+#define	FLAT_DEFAULT( nodes, pos )	( ( nodes )[ ( pos ) + FLAT_SIZE( nodes, pos ) - 1 ] )
+
+// value of child j of an inner node splitting a categorical attribute
+#define	FLAT_VALUE( nodes, pos, j )	( ( ( nodes )[ pos ] & FLAT_SPARSE ) ? ( nodes )[ ( pos ) + 2 + ( nodes )[ ( pos ) + 1 ] + ( j ) ] : ( j ) )
+
+typedef struct flat_tag {
+	int32_t				*nodes;			// words of nodes
+	long				size;			// total words
+	long				root;			// offset of root node
+} flat_t;
+
+int flat_compile( flat_t *flat, const tree_t *tree, long tot_classes );
+void flat_free( flat_t *flat );
+void flat_walk_depths( const id3_model_t *model, const dataset_t *ds, long row, const long *depths, long tot_depths, long *classes );
+
+/*
+	bagged forest ( see id3_forest.c ): trees of bootstrap samples are built concurrently
+	and joined into a single flat array, roots gets the root of each tree
+*/
+int forest_build( flat_t *flat, long *roots, const dataset_t *ds, const double *const *numbers, const id3_params_t *params );
+
+/*
+	file mapped in memory, read into a buffer where mmap is not available
+*/
+typedef struct fmap_tag {
+	char				*base;
+	size_t				size;
+} fmap_t;
+
+int fmap_open( fmap_t *map, const char *path, int writable );
+void fmap_close( fmap_t *map );
+
+/*
+	clocks and accumulation of statistics ( id3_stats_t of public interface )
+*/
+double stats_wall( void );
+double stats_cpu( void );
+void stats_merge( id3_stats_t *stats, const id3_stats_t *from );
+
+/*
+	tree that can be updated with new rows ( see id3_update.c ), it keeps training rows
+	and counts of every node
+*/
+typedef struct update_tag update_t;
+
+int update_create( update_t **update, const dataset_t *ds );
+int update_compile( update_t *update, const dict_t *dicts, flat_t *flat, id3_stats_t *stats );
+void update_free( update_t *update );
+
+/*
+	trained model ( id3_model_t of public interface )
+*/
+struct id3_model_tag {
+	long				cols;			// attributes + class column
+	char				**column_names;	// copy of column names
+	dict_t				*dicts;			// catalog of values of each column
+	double				**numbers;		// code -> number of each numeric column, NULL if none is
+	flat_t				flat;			// tree used by prediction
+	void				*map;			// file a loaded model points into, NULL if trained
+	id3_stats_t			*stats;			// statistics given to training, NULL if disabled
+	update_t			*update;		// state for id3_update, NULL if model cannot be updated
+	long				*roots;			// root of each tree of a forest into flat tree, whose
+										// root is the one of first tree; NULL for a single tree
+	long				tot_trees;
+	size_t				map_size;
+};
+
+/*
+	dataset loaded from file ( id3_data_t of public interface )
+*/
+struct id3_data_tag {
+	dataset_t			ds;				// class column is moved to last position
+	char				**column_names;	// names of dataset columns
+};
+
+#endif // ID3_INT_H_INCLUDED
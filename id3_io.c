@@ -0,0 +1,646 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "id3.h"
+#include "id3_int.h"
+
+/*
+	model file layout, every section starts at a multiple of 8 bytes and is referenced
+	by its offset from start of file, so a mapped file is used without any parsing:
+
+		header
+		column names		cols offsets ( uint64 ) followed by NUL terminated names
+		dictionaries		cols records, then offsets, hashes, slots ( uint32 ) and pool of each one
+		numbers				cols offsets ( uint64, 0 for columns not numeric ) followed by
+							numbers ( double ) of values of each numeric column, only if
+							model has numeric columns
+		flat tree			words ( int32 ) as built by flat_compile
+
+	numbers are stored with byte order of writer, byte_order field tells it. Files of
+	any other version are rejected
+*/
+#define	MODEL_MAGIC			"ID3MODEL"
+#define	MODEL_VERSION		1
+#define	MODEL_BYTE_ORDER	0x01020304u
+#define	MODEL_TEMP_TRIES	100			// names tried for the temporary file of a save
+
+#define	MODEL_ALIGN( pos )	( ( ( pos ) + 7 ) & ~( uint64_t )7 )
+
+typedef struct model_header_tag {
+	char				magic[ 8 ];
+	uint32_t			version;
+	uint32_t			byte_order;
+	uint64_t			file_size;
+	uint64_t			cols;
+	uint64_t			names;			// offset of name offsets
+	uint64_t			dicts;			// offset of dictionary records
+	uint64_t			nodes;			// offset of flat tree
+	uint64_t			tot_nodes;		// words of flat tree
+	uint64_t			root;			// offset of root node inside flat tree
+	uint64_t			numbers;		// offset of number offsets, 0 if no column is numeric
+} model_header_t;
+
+typedef struct model_dict_tag {
+	uint64_t			tot_values;
+	uint64_t			tot_slots;
+	uint64_t			pool_size;
+	uint64_t			offsets;		// offsets of arrays of dictionary
+	uint64_t			hashes;
+	uint64_t			slots;
+	uint64_t			pool;
+} model_dict_t;
+
+/*
+	map a whole file in memory: a writable mapping is private, changes are never written
+	back; a read only mapping is shared with other processes mapping the same file
+	returns 0 or -1 if file cannot be read
+*/
+int fmap_open( fmap_t *map, const char *path, int writable )
+{
+#ifdef _WIN32
+	FILE				*fp				= NULL;
+	long				size			= 0;
+
+	( void )writable;
+	memset( map, 0, sizeof( fmap_t ) );
+	if( ( fp = fopen( path, "rb" ) ) == NULL ) {
+		return -1;
+	}
+	// no mmap: whole file is read into a buffer
+	if( fseek( fp, 0, SEEK_END ) != 0 || ( size = ftell( fp ) ) < 0 || fseek( fp, 0, SEEK_SET ) != 0 ||
+		( map->base = malloc( size + 1 ) ) == NULL || fread( map->base, 1, size, fp ) != ( size_t )size ) {
+		free( map->base );
+		map->base = NULL;
+		fclose( fp );
+		return -1;
+	}
+	fclose( fp );
+	map->size = size;
+#else
+	struct stat			st;
+	int					fd				= -1;
+
+	memset( map, 0, sizeof( fmap_t ) );
+	if( ( fd = open( path, O_RDONLY ) ) < 0 ) {
+		return -1;
+	}
+	if( fstat( fd, &st ) != 0 ) {
+		close( fd );
+		return -1;
+	}
+	map->size = st.st_size;
+	if( map->size > 0 ) {
+		if( writable ) {
+			map->base = mmap( NULL, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+		} else {
+			map->base = mmap( NULL, map->size, PROT_READ, MAP_SHARED, fd, 0 );
+		}
+		if( map->base == MAP_FAILED ) {
+			map->base = NULL;
+			close( fd );
+			return -1;
+		}
+	}
+	close( fd );
+#endif
+
+	return 0;
+}
+
+/*
+	release a mapped file
+*/
+void fmap_close( fmap_t *map )
+{
+#ifdef _WIN32
+	free( map->base );
+#else
+	if( map->base != NULL ) {
+		munmap( map->base, map->size );
+	}
+#endif
+	memset( map, 0, sizeof( fmap_t ) );
+}
+
+/*
+	write a section and zeros up to next multiple of 8 bytes
+	returns 0 or -1 on write error
+*/
+static int model_write( FILE *fp, const void *data, uint64_t size, uint64_t *pos )
+{
+	static const char	zeros[ 8 ]		= { 0 };
+	uint64_t			pad				= MODEL_ALIGN( *pos + size ) - ( *pos + size );
+
+	if( fwrite( data, 1, size, fp ) != size || fwrite( zeros, 1, pad, fp ) != pad ) {
+		return -1;
+	}
+	*pos += size + pad;
+
+	return 0;
+}
+
+/*
+	create a temporary file with a unique name next to path, so that saves of the same
+	path at once never share it; its name goes to tmp_path ( strlen( path ) + 8 bytes ).
+	It is created as fopen would, with permissions allowed by umask
+	returns file or NULL if it cannot be created
+*/
+static FILE *model_temp( const char *path, char *tmp_path )
+{
+#ifndef _WIN32
+	static uint32_t		counter			= 0;
+	FILE				*fp				= NULL;
+	uint32_t			stamp;
+	long				tries;
+	int					fd				= -1;
+
+	// names mix process, call and time, a name taken meanwhile is tried again
+	for( tries = 0; fd < 0 && tries < MODEL_TEMP_TRIES; tries++ ) {
+		stamp = ( uint32_t )getpid() * 2654435761u ^ __atomic_add_fetch( &counter, 1, __ATOMIC_RELAXED ) * 40503u ^
+			( uint32_t )( stats_wall() * 1e9 );
+		sprintf( tmp_path, "%s.%06x", path, stamp & 0xffffff );
+		if( ( fd = open( tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0666 ) ) < 0 && errno != EEXIST ) {
+			return NULL;
+		}
+	}
+	if( fd < 0 ) {
+		return NULL;
+	}
+	if( ( fp = fdopen( fd, "wb" ) ) == NULL ) {
+		close( fd );
+		unlink( tmp_path );
+		return NULL;
+	}
+
+	return fp;
+#else
+	sprintf( tmp_path, "%s.tmp", path );
+	return fopen( tmp_path, "wb" );
+#endif
+}
+
+/*
+	save a model: sections are placed first, then written in the same order into a
+	temporary file that replaces the old one only when complete
+	returns 0, -1 on wrong parameters ( file format has a single tree, forests are not
+	saved ) or -2 if file cannot be written
+*/
+int id3_model_save( const id3_model_t *model, const char *path )
+{
+	model_header_t		header;
+	model_dict_t		*records		= NULL;
+	uint64_t			*names			= NULL;
+	uint64_t			*numbers		= NULL;
+	const dict_t		*dict			= NULL;
+	char				*tmp_path		= NULL;
+	FILE				*fp				= NULL;
+	uint64_t			pos				= 0;
+	int					result			= 0;
+	long				col;
+
+	if( model == NULL || path == NULL || model->roots != NULL ) {
+		return -1;
+	}
+
+	records		= malloc( sizeof( model_dict_t ) * model->cols );
+	names		= malloc( sizeof( uint64_t ) * model->cols );
+	numbers		= calloc( model->cols, sizeof( uint64_t ) );
+	tmp_path	= malloc( strlen( path ) + 8 );
+	if( records == NULL || names == NULL || numbers == NULL || tmp_path == NULL ) {
+		free( records );
+		free( names );
+		free( numbers );
+		free( tmp_path );
+		return -2;
+	}
+
+	// place sections
+	memset( &header, 0, sizeof( model_header_t ) );
+	memcpy( header.magic, MODEL_MAGIC, 8 );
+	header.version		= MODEL_VERSION;
+	header.byte_order	= MODEL_BYTE_ORDER;
+	header.cols			= model->cols;
+	pos					= MODEL_ALIGN( sizeof( model_header_t ) );
+	header.names		= pos;
+	pos					= MODEL_ALIGN( pos + sizeof( uint64_t ) * model->cols );
+	for( col = 0; col < model->cols; col++ ) {
+		names[ col ]	= pos;
+		pos				+= strlen( model->column_names[ col ] ) + 1;
+	}
+	pos					= MODEL_ALIGN( pos );
+	header.dicts		= pos;
+	pos					= MODEL_ALIGN( pos + sizeof( model_dict_t ) * model->cols );
+	for( col = 0; col < model->cols; col++ ) {
+		dict						= model->dicts + col;
+		records[ col ].tot_values	= dict->tot_values;
+		records[ col ].tot_slots	= dict->tot_slots;
+		records[ col ].pool_size	= dict->pool_size;
+		records[ col ].offsets		= pos;
+		pos							= MODEL_ALIGN( pos + sizeof( uint32_t ) * dict->tot_values );
+		records[ col ].hashes		= pos;
+		pos							= MODEL_ALIGN( pos + sizeof( uint32_t ) * dict->tot_values );
+		records[ col ].slots		= pos;
+		pos							= MODEL_ALIGN( pos + sizeof( uint32_t ) * dict->tot_slots );
+		records[ col ].pool			= pos;
+		pos							= MODEL_ALIGN( pos + dict->pool_size );
+	}
+	if( model->numbers != NULL ) {
+		header.numbers	= pos;
+		pos				+= sizeof( uint64_t ) * model->cols;
+		for( col = 0; col < model->cols; col++ ) {
+			if( model->numbers[ col ] != NULL ) {
+				numbers[ col ]	= pos;
+				pos				+= sizeof( double ) * model->dicts[ col ].tot_values;
+			}
+		}
+	}
+	header.nodes		= pos;
+	header.tot_nodes	= model->flat.size;
+	header.root			= model->flat.root;
+	header.file_size	= MODEL_ALIGN( pos + sizeof( int32_t ) * model->flat.size );
+
+	// write sections
+	do {
+		if( ( fp = model_temp( path, tmp_path ) ) == NULL ) {
+			result = -2;
+			break;
+		}
+		pos = 0;
+		if( model_write( fp, &header, sizeof( model_header_t ), &pos ) != 0 ||
+			model_write( fp, names, sizeof( uint64_t ) * model->cols, &pos ) != 0 ) {
+			result = -2;
+			break;
+		}
+		// names are a single section, padded after last one
+		for( col = 0; col < model->cols; col++ ) {
+			if( fwrite( model->column_names[ col ], 1, strlen( model->column_names[ col ] ) + 1, fp ) != strlen( model->column_names[ col ] ) + 1 ) {
+				result = -2;
+				break;
+			}
+			pos += strlen( model->column_names[ col ] ) + 1;
+		}
+		if( result != 0 || model_write( fp, "", 0, &pos ) != 0 ) {
+			result = -2;
+			break;
+		}
+		if( model_write( fp, records, sizeof( model_dict_t ) * model->cols, &pos ) != 0 ) {
+			result = -2;
+			break;
+		}
+		for( col = 0; col < model->cols; col++ ) {
+			dict = model->dicts + col;
+			if( model_write( fp, dict->offsets, sizeof( uint32_t ) * dict->tot_values, &pos ) != 0 ||
+				model_write( fp, dict->hashes, sizeof( uint32_t ) * dict->tot_values, &pos ) != 0 ||
+				model_write( fp, dict->slots, sizeof( uint32_t ) * dict->tot_slots, &pos ) != 0 ||
+				model_write( fp, dict->pool, dict->pool_size, &pos ) != 0 ) {
+				result = -2;
+				break;
+			}
+		}
+		if( result == 0 && model->numbers != NULL ) {
+			if( model_write( fp, numbers, sizeof( uint64_t ) * model->cols, &pos ) != 0 ) {
+				result = -2;
+				break;
+			}
+			for( col = 0; col < model->cols; col++ ) {
+				if( model->numbers[ col ] != NULL &&
+					model_write( fp, model->numbers[ col ], sizeof( double ) * model->dicts[ col ].tot_values, &pos ) != 0 ) {
+					result = -2;
+					break;
+				}
+			}
+		}
+		if( result != 0 || model_write( fp, model->flat.nodes, sizeof( int32_t ) * model->flat.size, &pos ) != 0 ) {
+			result = -2;
+			break;
+		}
+	} while( 0 );
+
+	if( fp != NULL && fclose( fp ) != 0 ) {
+		result = -2;
+	}
+#ifdef _WIN32
+	// rename does not replace an existing file
+	if( result == 0 ) {
+		remove( path );
+	}
+#endif
+	if( result == 0 && rename( tmp_path, path ) != 0 ) {
+		result = -2;
+	}
+	if( result != 0 && fp != NULL ) {
+		remove( tmp_path );
+	}
+	free( records );
+	free( names );
+	free( numbers );
+	free( tmp_path );
+
+	return result;
+}
+
+/*
+	check that a section of size bytes at offset pos lies inside a file
+*/
+static int model_span( const fmap_t *map, uint64_t pos, uint64_t size )
+{
+	return pos % 8 == 0 && pos <= map->size && size <= map->size - pos;
+}
+
+/*
+	check a dictionary mapped from file: every lookup must stay inside its arrays and
+	find an empty slot
+	returns 0 or -1 if dictionary is not valid
+*/
+static int model_check_dict( const dict_t *dict )
+{
+	long				used			= 0;
+	long				i;
+
+	if( dict->tot_slots < 1 || ( dict->tot_slots & ( dict->tot_slots - 1 ) ) != 0 ||
+		dict->pool_size > UINT32_MAX || ( dict->pool_size > 0 && dict->pool[ dict->pool_size - 1 ] != '\0' ) ) {
+		return -1;
+	}
+	for( i = 0; i < dict->tot_values; i++ ) {
+		if( dict->offsets[ i ] >= dict->pool_size ) {
+			return -1;
+		}
+	}
+	for( i = 0; i < dict->tot_slots; i++ ) {
+		if( dict->slots[ i ] > dict->tot_values ) {
+			return -1;
+		}
+		used += ( dict->slots[ i ] != 0 );
+	}
+
+	// linear probing stops at an empty slot
+	return ( used < dict->tot_slots ) ? 0 : -1;
+}
+
+/*
+	words of an inner node of a flat tree mapped from file, it must fit into the array
+	returns words or -1 if node is not valid
+*/
+static long model_node_words( const int32_t *nodes, long pos, long size )
+{
+	long				words;
+
+	if( size - pos < 3 || nodes[ pos ] < 0 || nodes[ pos + 1 ] < 0 ||
+		( ( nodes[ pos ] & FLAT_NUMERIC ) && ( nodes[ pos ] & FLAT_SPARSE ) ) ) {
+		return -1;
+	}
+	words = 3 + ( long )nodes[ pos + 1 ] * ( ( nodes[ pos ] & FLAT_SPARSE ) ? 2 : 1 ) + ( ( nodes[ pos ] & FLAT_NUMERIC ) != 0 );
+
+	return ( words <= size - pos ) ? words : -1;
+}
+
+/*
+	check a flat tree mapped from file, prediction must only meet valid attributes and
+	reach a terminal node. flat_compile stores inner nodes in breadth first order, the
+	root first and then children in order of reference: a single pass checks that every
+	reference to an inner node points to the next node not referenced yet
+	returns 0 or -1 if tree is not valid
+*/
+static int model_check_flat( const id3_model_t *model )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	long				size			= model->flat.size;
+	long				tot_classes		= model->dicts[ model->cols - 1 ].tot_values;
+	long				leaves			= FLAT_INNER( tot_classes );
+	long				next			= leaves;		// next inner node to be referenced
+	long				pos, child, attrib, value, j;
+
+	if( size < leaves ) {
+		return -1;
+	}
+	for( j = -1; j < tot_classes; j++ ) {
+		if( nodes[ FLAT_LEAF( j ) ] != -1 || nodes[ FLAT_LEAF( j ) + 1 ] != j ) {
+			return -1;
+		}
+	}
+	for( j = 0; j < tot_classes; j++ ) {
+		if( nodes[ FLAT_OTHER( j, tot_classes ) ] != FLAT_OTHER_WORD || nodes[ FLAT_OTHER( j, tot_classes ) + 1 ] != j ) {
+			return -1;
+		}
+	}
+
+// reference to an inner node: it must be the next one and fit into the array
+#define	CHECK_NEXT( child )																	\
+	if( ( child ) != next || model_node_words( nodes, next, size ) < 0 ) {					\
+		return -1;																			\
+	}																						\
+	next += FLAT_SIZE( nodes, next );
+
+	// root is a terminal node or the first inner node
+	child = model->flat.root;
+	if( child < leaves ) {
+		if( child % 2 != 0 || size != leaves ) {
+			return -1;
+		}
+	} else {
+		CHECK_NEXT( child );
+	}
+
+	for( pos = leaves; pos < size; pos += FLAT_SIZE( nodes, pos ) ) {
+		// only nodes already referenced, their size was checked then
+		attrib = FLAT_ATTRIB( nodes[ pos ] );
+		if( pos >= next || nodes[ pos ] < 0 || attrib >= model->cols - 1 ) {
+			return -1;
+		}
+		// numeric node: a numeric column, two children and a known threshold
+		if( ( nodes[ pos ] & FLAT_NUMERIC ) && ( model->numbers == NULL || model->numbers[ attrib ] == NULL ||
+			nodes[ pos + 1 ] != 2 || nodes[ pos + 4 ] < 0 || nodes[ pos + 4 ] >= model->dicts[ attrib ].tot_values ) ) {
+			return -1;
+		}
+		// sparse node: known values in increasing order, as binary search needs them
+		for( j = 0; ( nodes[ pos ] & FLAT_SPARSE ) && j < nodes[ pos + 1 ]; j++ ) {
+			value = FLAT_VALUE( nodes, pos, j );
+			if( value < 0 || value >= model->dicts[ attrib ].tot_values || ( j > 0 && value <= FLAT_VALUE( nodes, pos, j - 1 ) ) ) {
+				return -1;
+			}
+		}
+		// default branch leads to a terminal node
+		child = FLAT_DEFAULT( nodes, pos );
+		if( child < 0 || child >= leaves || child % 2 != 0 ) {
+			return -1;
+		}
+		for( j = 0; j < nodes[ pos + 1 ]; j++ ) {
+			child = nodes[ pos + 2 + j ];
+			if( child < 0 ) {
+				return -1;
+			}
+			if( child < leaves ) {
+				if( child % 2 != 0 ) {
+					return -1;
+				}
+			} else {
+				CHECK_NEXT( child );
+			}
+		}
+	}
+#undef	CHECK_NEXT
+
+	return ( next == size ) ? 0 : -1;
+}
+
+/*
+	load a model file: dictionaries and flat tree point into the mapped file, only the
+	model descriptor is allocated. Sections are checked once so that prediction never
+	reads outside file whatever its contents
+	returns 0, -1 on wrong parameters, -2 if file cannot be read, -3 on wrong format or
+	version or -4 on memory error
+*/
+int id3_model_load( id3_model_t **model, const char *path )
+{
+	fmap_t				map;
+	const model_header_t *header		= NULL;
+	const model_dict_t	*records		= NULL;
+	const uint64_t		*names			= NULL;
+	const uint64_t		*numbers		= NULL;
+	uint64_t			numbers_pos		= 0;
+	id3_model_t			*mdl			= NULL;
+	dict_t				*dict			= NULL;
+	int					result			= 0;
+	long				col;
+
+	*model = NULL;
+	if( path == NULL ) {
+		return -1;
+	}
+	if( fmap_open( &map, path, 0 ) != 0 ) {
+		return -2;
+	}
+
+	do {
+		header = ( const model_header_t* )map.base;
+		if( map.size < sizeof( model_header_t ) || memcmp( header->magic, MODEL_MAGIC, 8 ) != 0 ||
+			header->version != MODEL_VERSION || header->byte_order != MODEL_BYTE_ORDER ||
+			header->file_size != map.size || header->cols < 2 || header->cols > map.size ||
+			!model_span( &map, header->names, sizeof( uint64_t ) * header->cols ) ||
+			!model_span( &map, header->dicts, sizeof( model_dict_t ) * header->cols ) ||
+			header->tot_nodes > INT32_MAX || !model_span( &map, header->nodes, sizeof( int32_t ) * header->tot_nodes ) ||
+			header->root >= header->tot_nodes ) {
+			result = -3;
+			break;
+		}
+		numbers_pos = header->numbers;
+		if( numbers_pos != 0 && !model_span( &map, numbers_pos, sizeof( uint64_t ) * header->cols ) ) {
+			result = -3;
+			break;
+		}
+
+		// descriptor, dictionaries, column names and numbers are arrays after the model
+		if( ( mdl = calloc( 1, sizeof( id3_model_t ) + ( sizeof( char* ) + sizeof( dict_t ) + sizeof( double* ) ) * header->cols ) ) == NULL ) {
+			result = -4;
+			break;
+		}
+		mdl->cols			= header->cols;
+		mdl->dicts			= ( dict_t* )( mdl + 1 );
+		mdl->column_names	= ( char** )( mdl->dicts + mdl->cols );
+		mdl->numbers		= ( numbers_pos != 0 ) ? ( double** )( mdl->column_names + mdl->cols ) : NULL;
+		mdl->map			= map.base;
+		mdl->map_size		= map.size;
+
+		names	= ( const uint64_t* )( map.base + header->names );
+		records	= ( const model_dict_t* )( map.base + header->dicts );
+		for( col = 0; col < mdl->cols; col++ ) {
+			if( names[ col ] >= map.size || memchr( map.base + names[ col ], '\0', map.size - names[ col ] ) == NULL ||
+				records[ col ].tot_values > UINT32_MAX || records[ col ].tot_slots > UINT32_MAX ||
+				!model_span( &map, records[ col ].offsets, sizeof( uint32_t ) * records[ col ].tot_values ) ||
+				!model_span( &map, records[ col ].hashes, sizeof( uint32_t ) * records[ col ].tot_values ) ||
+				!model_span( &map, records[ col ].slots, sizeof( uint32_t ) * records[ col ].tot_slots ) ||
+				!model_span( &map, records[ col ].pool, records[ col ].pool_size ) ) {
+				result = -3;
+				break;
+			}
+			mdl->column_names[ col ]	= map.base + names[ col ];
+			dict						= mdl->dicts + col;
+			dict->tot_values			= records[ col ].tot_values;
+			dict->max_values			= records[ col ].tot_values;
+			dict->offsets				= ( uint32_t* )( map.base + records[ col ].offsets );
+			dict->hashes				= ( uint32_t* )( map.base + records[ col ].hashes );
+			dict->slots					= ( uint32_t* )( map.base + records[ col ].slots );
+			dict->tot_slots				= records[ col ].tot_slots;
+			dict->pool					= map.base + records[ col ].pool;
+			dict->pool_size				= records[ col ].pool_size;
+			dict->pool_max				= records[ col ].pool_size;
+			if( model_check_dict( dict ) != 0 ) {
+				result = -3;
+				break;
+			}
+		}
+		if( result != 0 ) {
+			break;
+		}
+
+		// numbers of numeric columns, the class column is never numeric
+		numbers = ( const uint64_t* )( map.base + numbers_pos );
+		for( col = 0; mdl->numbers != NULL && col < mdl->cols; col++ ) {
+			if( numbers[ col ] == 0 ) {
+				continue;
+			}
+			if( col == mdl->cols - 1 || !model_span( &map, numbers[ col ], sizeof( double ) * mdl->dicts[ col ].tot_values ) ) {
+				result = -3;
+				break;
+			}
+			mdl->numbers[ col ] = ( double* )( map.base + numbers[ col ] );
+		}
+		if( result != 0 ) {
+			break;
+		}
+
+		mdl->flat.nodes	= ( int32_t* )( map.base + header->nodes );
+		mdl->flat.size	= header->tot_nodes;
+		mdl->flat.root	= header->root;
+		if( model_check_flat( mdl ) != 0 ) {
+			result = -3;
+			break;
+		}
+	} while( 0 );
+
+	if( result != 0 ) {
+		// model does not own the mapping yet
+		free( mdl );
+		fmap_close( &map );
+		return result;
+	}
+
+	*model = mdl;
+	return 0;
+}
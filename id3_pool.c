@@ -0,0 +1,372 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "id3_int.h"
+
+/*
+	task queue of a worker: owner pushes and pops at the bottom ( depth first, recently
+	split data is still in cache ), thieves take from the top ( biggest pending subtrees ).
+	Each deque has its own lock, so workers contend only when they touch the same deque
+*/
+typedef struct pool_deque_tag {
+	pthread_mutex_t		lock;			// protects ring buffer and its indexes
+	pool_task_t			*tasks;			// ring buffer
+	long				capacity;		// size of ring buffer, power of two
+	long				top;			// index of oldest task
+	long				bottom;			// index after newest task
+} pool_deque_t;
+
+struct pool_tag {
+	long				workers;		// worker 0 is the thread calling pool_wait
+	pthread_t			*threads;
+	pool_deque_t		*deques;
+	pthread_mutex_t		lock;			// protects sleeping workers, group counters and stop
+	pthread_cond_t		wake;			// new task queued ( one sleeper ), all tasks done or stop
+	pthread_cond_t		done;			// a group has no task left
+	long				sleeping;		// workers waiting on wake, read atomically
+	long				queued;			// tasks waiting in deques, updated atomically
+	long				pending;		// tasks queued or running, updated atomically
+	int					stop;
+};
+
+/*
+	thread of a worker
+*/
+typedef struct pool_start_tag {
+	pool_t				*pool;
+	long				worker;
+} pool_start_t;
+
+/*
+	pop newest task of a deque, only if it belongs to group when group is not NULL
+	returns 1 if a task was taken
+*/
+static int pool_pop( pool_t *pool, pool_deque_t *deque, const pool_group_t *group, pool_task_t *task )
+{
+	int					taken			= 0;
+
+	pthread_mutex_lock( &deque->lock );
+	if( deque->bottom > deque->top &&
+		( group == NULL || deque->tasks[ ( deque->bottom - 1 ) & ( deque->capacity - 1 ) ].group == group ) ) {
+		__atomic_store_n( &deque->bottom, deque->bottom - 1, __ATOMIC_RELAXED );
+		*task			= deque->tasks[ deque->bottom & ( deque->capacity - 1 ) ];
+		taken			= 1;
+	}
+	pthread_mutex_unlock( &deque->lock );
+	if( taken ) {
+		__atomic_sub_fetch( &pool->queued, 1, __ATOMIC_SEQ_CST );
+	}
+
+	return taken;
+}
+
+/*
+	take a task for a worker: own newest task first, otherwise steal oldest task of
+	another worker. returns 1 if a task was taken
+*/
+static int pool_take( pool_t *pool, long worker, pool_task_t *task )
+{
+	long				workers			= __atomic_load_n( &pool->workers, __ATOMIC_ACQUIRE );
+	pool_deque_t		*deque			= NULL;
+	int					taken			= 0;
+	long				i;
+
+	if( pool_pop( pool, pool->deques + worker, NULL, task ) ) {
+		return 1;
+	}
+	for( i = 1; !taken && i < workers; i++ ) {
+		deque = pool->deques + ( worker + i ) % workers;
+		// an empty deque is skipped without its lock, indexes are stored atomically for it
+		if( __atomic_load_n( &deque->bottom, __ATOMIC_RELAXED ) <= __atomic_load_n( &deque->top, __ATOMIC_RELAXED ) ) {
+			continue;
+		}
+		pthread_mutex_lock( &deque->lock );
+		if( deque->bottom > deque->top ) {
+			*task		= deque->tasks[ deque->top & ( deque->capacity - 1 ) ];
+			__atomic_store_n( &deque->top, deque->top + 1, __ATOMIC_RELAXED );
+			taken		= 1;
+		}
+		pthread_mutex_unlock( &deque->lock );
+	}
+	if( taken ) {
+		__atomic_sub_fetch( &pool->queued, 1, __ATOMIC_SEQ_CST );
+	}
+
+	return taken;
+}
+
+/*
+	run a task and account its end: the waiter of a group is woken when its last task
+	ends, pool_wait when the last task of pool ends
+*/
+static void pool_run( pool_t *pool, pool_task_t *task, long worker )
+{
+	task->func( task->arg, worker );
+
+	// group lives in the frame of its waiter, it is left before the lock is released
+	if( task->group != NULL ) {
+		pthread_mutex_lock( &pool->lock );
+		if( --task->group->pending == 0 ) {
+			pthread_cond_broadcast( &pool->done );
+		}
+		pthread_mutex_unlock( &pool->lock );
+	}
+	if( __atomic_sub_fetch( &pool->pending, 1, __ATOMIC_SEQ_CST ) == 0 ) {
+		pthread_mutex_lock( &pool->lock );
+		pthread_cond_broadcast( &pool->wake );
+		pthread_mutex_unlock( &pool->lock );
+	}
+}
+
+/*
+	sleep until a task is queued, or until every task is done for pool_wait ( until is
+	set ), or until pool stops; a submitter signals only when it sees a sleeper, and a
+	sleeper checks queued after it is counted, so no task is left without a worker
+	returns 1 if pool stops
+*/
+static int pool_sleep( pool_t *pool, int until_done )
+{
+	int					stop;
+
+	pthread_mutex_lock( &pool->lock );
+	__atomic_add_fetch( &pool->sleeping, 1, __ATOMIC_SEQ_CST );
+	if( !pool->stop && __atomic_load_n( &pool->queued, __ATOMIC_SEQ_CST ) == 0 &&
+		( !until_done || __atomic_load_n( &pool->pending, __ATOMIC_SEQ_CST ) > 0 ) ) {
+		pthread_cond_wait( &pool->wake, &pool->lock );
+	}
+	__atomic_sub_fetch( &pool->sleeping, 1, __ATOMIC_SEQ_CST );
+	stop = pool->stop;
+	pthread_mutex_unlock( &pool->lock );
+
+	return stop;
+}
+
+/*
+	main loop of worker threads
+*/
+static void *pool_thread( void *arg )
+{
+	pool_start_t		*start			= arg;
+	pool_t				*pool			= start->pool;
+	long				worker			= start->worker;
+	pool_task_t			task;
+
+	free( start );
+
+	while( 1 ) {
+		if( pool_take( pool, worker, &task ) ) {
+			pool_run( pool, &task, worker );
+		} else if( pool_sleep( pool, 0 ) && __atomic_load_n( &pool->queued, __ATOMIC_SEQ_CST ) == 0 ) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+	create a pool of workers, calling thread is worker 0 so workers - 1 threads are started
+	returns NULL on error
+*/
+pool_t *pool_create( long workers )
+{
+	pool_t				*pool			= NULL;
+	pool_start_t		*start			= NULL;
+	long				i;
+
+	if( workers < 1 || ( pool = calloc( 1, sizeof( pool_t ) ) ) == NULL ) {
+		return NULL;
+	}
+	pool->workers	= workers;
+	pool->threads	= calloc( workers, sizeof( pthread_t ) );
+	pool->deques	= calloc( workers, sizeof( pool_deque_t ) );
+	if( pool->threads == NULL || pool->deques == NULL ) {
+		free( pool->threads );
+		free( pool->deques );
+		free( pool );
+		return NULL;
+	}
+	pthread_mutex_init( &pool->lock, NULL );
+	pthread_cond_init( &pool->wake, NULL );
+	pthread_cond_init( &pool->done, NULL );
+	for( i = 0; i < workers; i++ ) {
+		pthread_mutex_init( &pool->deques[ i ].lock, NULL );
+	}
+
+	for( i = 1; i < workers; i++ ) {
+		if( ( start = malloc( sizeof( pool_start_t ) ) ) == NULL ) {
+			break;
+		}
+		start->pool		= pool;
+		start->worker	= i;
+		if( pthread_create( pool->threads + i, NULL, pool_thread, start ) != 0 ) {
+			free( start );
+			break;
+		}
+	}
+	// fewer threads than requested: their deques are never filled, started threads
+	// may be already looking for tasks
+	__atomic_store_n( &pool->workers, i, __ATOMIC_RELEASE );
+
+	return pool;
+}
+
+/*
+	stop worker threads and release pool, queued tasks are run before
+*/
+void pool_destroy( pool_t *pool )
+{
+	long				i;
+
+	if( pool == NULL ) {
+		return;
+	}
+	pthread_mutex_lock( &pool->lock );
+	pool->stop = 1;
+	pthread_cond_broadcast( &pool->wake );
+	pthread_mutex_unlock( &pool->lock );
+
+	for( i = 1; i < pool->workers; i++ ) {
+		pthread_join( pool->threads[ i ], NULL );
+	}
+	for( i = 0; i < pool->workers; i++ ) {
+		free( pool->deques[ i ].tasks );
+	}
+	for( i = 0; i < pool->workers; i++ ) {
+		pthread_mutex_destroy( &pool->deques[ i ].lock );
+	}
+	pthread_cond_destroy( &pool->done );
+	pthread_cond_destroy( &pool->wake );
+	pthread_mutex_destroy( &pool->lock );
+	free( pool->threads );
+	free( pool->deques );
+	free( pool );
+}
+
+/*
+	number of workers of a pool
+*/
+long pool_workers( const pool_t *pool )
+{
+	return pool->workers;
+}
+
+/*
+	queue a task on deque of a worker, group may be NULL; a single sleeping worker is
+	woken, if any
+	returns 0 or -1 on memory error
+*/
+int pool_submit( pool_t *pool, long worker, pool_group_t *group, pool_func_t func, void *arg )
+{
+	pool_deque_t		*deque			= pool->deques + worker;
+	pool_task_t			*tasks			= NULL;
+	long				capacity, i;
+
+	// counted before it can be taken, so pending never drops to 0 while it is queued
+	if( group != NULL ) {
+		pthread_mutex_lock( &pool->lock );
+		group->pending += 1;
+		pthread_mutex_unlock( &pool->lock );
+	}
+	__atomic_add_fetch( &pool->pending, 1, __ATOMIC_SEQ_CST );
+
+	pthread_mutex_lock( &deque->lock );
+	if( deque->bottom - deque->top == deque->capacity ) {
+		capacity = deque->capacity ? deque->capacity * 2 : 64;
+		if( ( tasks = malloc( sizeof( pool_task_t ) * capacity ) ) == NULL ) {
+			pthread_mutex_unlock( &deque->lock );
+			if( group != NULL ) {
+				pthread_mutex_lock( &pool->lock );
+				group->pending -= 1;
+				pthread_mutex_unlock( &pool->lock );
+			}
+			__atomic_sub_fetch( &pool->pending, 1, __ATOMIC_SEQ_CST );
+			return -1;
+		}
+		for( i = deque->top; i < deque->bottom; i++ ) {
+			tasks[ i & ( capacity - 1 ) ] = deque->tasks[ i & ( deque->capacity - 1 ) ];
+		}
+		free( deque->tasks );
+		deque->tasks	= tasks;
+		deque->capacity	= capacity;
+	}
+	deque->tasks[ deque->bottom & ( deque->capacity - 1 ) ].func	= func;
+	deque->tasks[ deque->bottom & ( deque->capacity - 1 ) ].arg		= arg;
+	deque->tasks[ deque->bottom & ( deque->capacity - 1 ) ].group	= group;
+	__atomic_store_n( &deque->bottom, deque->bottom + 1, __ATOMIC_RELAXED );
+	pthread_mutex_unlock( &deque->lock );
+
+	__atomic_add_fetch( &pool->queued, 1, __ATOMIC_SEQ_CST );
+	if( __atomic_load_n( &pool->sleeping, __ATOMIC_SEQ_CST ) > 0 ) {
+		pthread_mutex_lock( &pool->lock );
+		pthread_cond_signal( &pool->wake );
+		pthread_mutex_unlock( &pool->lock );
+	}
+
+	return 0;
+}
+
+/*
+	worker helps running queued tasks until every submitted task is done
+*/
+void pool_wait( pool_t *pool, long worker )
+{
+	pool_task_t			task;
+
+	while( __atomic_load_n( &pool->pending, __ATOMIC_SEQ_CST ) > 0 ) {
+		if( pool_take( pool, worker, &task ) ) {
+			pool_run( pool, &task, worker );
+		} else {
+			pool_sleep( pool, 1 );
+		}
+	}
+}
+
+/*
+	worker waits for tasks of a group it submitted; meanwhile it runs only tasks of group
+	left on its own deque, so its state is not touched by unrelated tasks. Tasks of group
+	are never queued on its deque again once it waits, so it sleeps on done once there
+	is none left there
+*/
+void pool_wait_group( pool_t *pool, long worker, pool_group_t *group )
+{
+	pool_task_t			task;
+
+	while( pool_pop( pool, pool->deques + worker, group, &task ) ) {
+		pool_run( pool, &task, worker );
+	}
+	pthread_mutex_lock( &pool->lock );
+	while( group->pending > 0 ) {
+		pthread_cond_wait( &pool->done, &pool->lock );
+	}
+	pthread_mutex_unlock( &pool->lock );
+}
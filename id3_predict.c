@@ -0,0 +1,552 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+// rows walked down the tree together by batch prediction: their loads are independent,
+// so memory latency of one row is hidden by the others
+#define	PREDICT_LANES		8
+
+// rows of a forest prediction walked down each tree before the next one, votes of the
+// block are counted together
+#define	FOREST_BLOCK		256
+
+/*
+	number of values of dense form of an inner node, children are in increasing value
+*/
+#define	FLAT_VALUES( node )			( ( node )->nodes[ ( node )->tot_nodes - 1 ].winvalue + 1 )
+
+/*
+	inner node takes the sparse form, numeric nodes never do
+*/
+static inline int flat_sparse( const node_t *node )
+{
+	return node->threshold < 0 && node->tot_nodes * FLAT_SPARSE_RATIO < FLAT_VALUES( node );
+}
+
+/*
+	words of flat representation of an inner node
+*/
+static inline long flat_words( const node_t *node )
+{
+	if( node->threshold >= 0 ) {
+		return 3 + node->tot_nodes + 1;
+	}
+
+	return 3 + ( flat_sparse( node ) ? 2 * node->tot_nodes : FLAT_VALUES( node ) );
+}
+
+/*
+	count inner nodes of a tree and words needed by their flat representation
+*/
+static void flat_count( const node_t *node, long *tot_inner, long *size )
+{
+	long				j;
+
+	if( node->attrib >= 0 ) {
+		*tot_inner	+= 1;
+		*size		+= flat_words( node );
+		for( j = 0; j < node->tot_nodes; j++ ) {
+			flat_count( node->nodes + j, tot_inner, size );
+		}
+	}
+}
+
+/*
+	compile a tree into a flat array of 32 bit words, nodes are stored in breadth first
+	order so that upper levels share few cache lines:
+
+		terminal node	[ -1, class ] or [ FLAT_OTHER_WORD, class ] for default branches
+		inner node		[ attribute, number of values, child of value 0, child of value 1, ...,
+						  default ]
+		sparse node		[ attribute | FLAT_SPARSE, number of children, child 0, child 1, ...,
+						  value of child 0, value of child 1, ..., default ]
+		numeric node	[ attribute | FLAT_NUMERIC, 2, child of values <= threshold,
+						  child of values > threshold, code of threshold, default ]
+
+	children are word offsets into the array, one step down the tree is a single load
+	( a binary search of values in sparse nodes, that have children for few values of a
+	big catalog ); values without a child and unknown ones take the default branch, the
+	terminal node of majority class of node. Values without a child of an inner node lead
+	there as well. Terminal nodes are shared by class and offset 0 is the terminal node
+	without class
+	returns 0 or -1 on memory error
+*/
+int flat_compile( flat_t *flat, const tree_t *tree, long tot_classes )
+{
+	const node_t		**queue			= NULL;
+	const node_t		*node			= NULL;
+	const node_t		*child			= NULL;
+	long				*offsets		= NULL;
+	long				tot_inner		= 0;
+	long				size			= FLAT_INNER( tot_classes );
+	long				head			= 0;
+	long				tot_queue		= 0;
+	int32_t				*words			= NULL;
+	long				pos, other, slot, j;
+
+	memset( flat, 0, sizeof( flat_t ) );
+
+	flat_count( tree->root, &tot_inner, &size );
+	if( size > INT32_MAX ) {
+		return -1;
+	}
+
+	queue	= malloc( sizeof( node_t* ) * ( tot_inner + 1 ) );
+	offsets	= malloc( sizeof( long ) * ( tot_inner + 1 ) );
+	if( queue == NULL || offsets == NULL || ( flat->nodes = malloc( sizeof( int32_t ) * size ) ) == NULL ) {
+		free( queue );
+		free( offsets );
+		return -1;
+	}
+	flat->size = size;
+
+	// terminal nodes, one for each class and one for each class of default branches
+	for( j = -1; j < tot_classes; j++ ) {
+		flat->nodes[ FLAT_LEAF( j ) ]		= -1;
+		flat->nodes[ FLAT_LEAF( j ) + 1 ]	= j;
+	}
+	for( j = 0; j < tot_classes; j++ ) {
+		flat->nodes[ FLAT_OTHER( j, tot_classes ) ]		= FLAT_OTHER_WORD;
+		flat->nodes[ FLAT_OTHER( j, tot_classes ) + 1 ]	= j;
+	}
+	pos = FLAT_INNER( tot_classes );
+
+	// inner nodes in breadth first order, each node gets its offset when queued
+	if( tree->root->attrib >= 0 ) {
+		queue[ tot_queue ]		= tree->root;
+		offsets[ tot_queue++ ]	= pos;
+		pos						+= flat_words( tree->root );
+	}
+	flat->root = ( tot_queue > 0 ) ? offsets[ 0 ] : FLAT_LEAF( tree->root->class_id );
+
+	while( head < tot_queue ) {
+		node	= queue[ head ];
+		words	= flat->nodes + offsets[ head ];
+		other	= FLAT_OTHER( node->class_id, tot_classes );
+		words[ 0 ] = node->attrib;
+		if( node->threshold >= 0 ) {
+			words[ 0 ]						|= FLAT_NUMERIC;
+			words[ 1 ]						= node->tot_nodes;
+			words[ 2 + node->tot_nodes ]	= node->threshold;
+		} else if( flat_sparse( node ) ) {
+			words[ 0 ]						|= FLAT_SPARSE;
+			words[ 1 ]						= node->tot_nodes;
+			for( j = 0; j < node->tot_nodes; j++ ) {
+				words[ 2 + node->tot_nodes + j ] = node->nodes[ j ].winvalue;
+			}
+		} else {
+			// values without a child take the default branch
+			words[ 1 ]						= FLAT_VALUES( node );
+			for( j = 0; j < words[ 1 ]; j++ ) {
+				words[ 2 + j ] = other;
+			}
+		}
+		FLAT_DEFAULT( flat->nodes, offsets[ head ] ) = other;
+
+		for( j = 0; j < node->tot_nodes; j++ ) {
+			child	= node->nodes + j;
+			slot	= 2 + ( ( words[ 0 ] & FLAT_SPARSE ) ? j : child->winvalue );
+			if( child->attrib >= 0 ) {
+				queue[ tot_queue ]		= child;
+				offsets[ tot_queue ]	= pos;
+				pos						+= flat_words( child );
+				words[ slot ]			= offsets[ tot_queue++ ];
+			} else {
+				words[ slot ]			= FLAT_LEAF( child->class_id );
+			}
+		}
+		++head;
+	}
+
+	free( queue );
+	free( offsets );
+
+	return 0;
+}
+
+/*
+	release a flat tree
+*/
+void flat_free( flat_t *flat )
+{
+	free( flat->nodes );
+	memset( flat, 0, sizeof( flat_t ) );
+}
+
+/*
+	one step down a flat tree: code of split attribute selects the child, values without
+	a child and unknown ones take the default branch ( word after children )
+*/
+#define	FLAT_STEP( nodes, pos, code )																\
+	( ( unsigned long )( code ) < ( unsigned long )( nodes )[ ( pos ) + 1 ] ? ( nodes )[ ( pos ) + 2 + ( code ) ] :	\
+		( nodes )[ ( pos ) + 2 + ( nodes )[ ( pos ) + 1 ] ] )
+
+/*
+	one step down a sparse node: binary search of code among values of children, codes
+	not found take the default branch ( word after values ). Search halves the range
+	without branches, so rows going different ways cost no mispredictions
+*/
+static inline long flat_sparse_step( const int32_t *nodes, long pos, long code )
+{
+	long				tot_nodes		= nodes[ pos + 1 ];
+	const int32_t		*values			= nodes + pos + 2 + tot_nodes;
+	const int32_t		*base			= values;
+	long				size			= tot_nodes;
+	long				half;
+
+	while( size > 1 ) {
+		half	= size / 2;
+		base	= ( base[ half ] <= code ) ? base + half : base;
+		size	-= half;
+	}
+
+	return ( *base == code ) ? nodes[ pos + 2 + ( base - values ) ] : values[ tot_nodes ];
+}
+
+/*
+	one step down a numeric node from a code: number of value is compared with number of
+	threshold, unknown values take the default branch
+*/
+static inline long flat_number_step( const id3_model_t *model, long pos, long code )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	long				attrib			= FLAT_ATTRIB( nodes[ pos ] );
+	const double		*numbers		= model->numbers[ attrib ];
+
+	if( ( unsigned long )code >= ( unsigned long )model->dicts[ attrib ].tot_values ) {
+		return nodes[ pos + 5 ];
+	}
+
+	return nodes[ pos + 2 + ( numbers[ code ] > numbers[ nodes[ pos + 4 ] ] ) ];
+}
+
+/*
+	one step down a numeric node from a string, which needs not be a value known to model;
+	strings that are not numbers take the default branch
+*/
+static inline long flat_string_step( const id3_model_t *model, long pos, const char *str )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	char				*end			= NULL;
+	double				value			= strtod( str, &end );
+
+	if( end == str || *end != '\0' || value != value ) {
+		return nodes[ pos + 5 ];
+	}
+
+	return nodes[ pos + 2 + ( value > model->numbers[ FLAT_ATTRIB( nodes[ pos ] ) ][ nodes[ pos + 4 ] ] ) ];
+}
+
+/*
+	one step down any inner node from a code, dense nodes first
+*/
+#define	FLAT_CODE_STEP( model, nodes, pos, attrib, code )												\
+	( !( ( attrib ) & ( FLAT_NUMERIC | FLAT_SPARSE ) ) ? FLAT_STEP( nodes, pos, code ) :				\
+		( ( attrib ) & FLAT_NUMERIC ) ? flat_number_step( model, pos, code ) : flat_sparse_step( nodes, pos, code ) )
+
+/*
+	walk a row of strings ( cols - 1 attributes ) down the tree starting at root, only
+	attributes met along the path are looked up; returns class or -1 if tree has no rule
+	for the row
+*/
+static long walk_row( const id3_model_t *model, long root, char **row )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	long				pos				= root;
+	long				attrib, col, code;
+
+	while( ( attrib = nodes[ pos ] ) >= 0 ) {
+		col = FLAT_ATTRIB( attrib );
+		if( attrib & FLAT_NUMERIC ) {
+			pos = flat_string_step( model, pos, row[ col ] );
+			continue;
+		}
+		code	= dict_lookup( model->dicts + col, row[ col ], strlen( row[ col ] ) );
+		pos		= ( attrib & FLAT_SPARSE ) ? flat_sparse_step( nodes, pos, code ) : FLAT_STEP( nodes, pos, code );
+	}
+
+	return nodes[ pos + 1 ];
+}
+
+/*
+	walk PREDICT_LANES rows down the tree from root at the same time, CODE( attrib, lane )
+	gives code of an attribute for a row of the group starting at row i
+*/
+#define	PREDICT_GROUP( CODE )																		\
+	do {																							\
+		long			lane_pos[ PREDICT_LANES ];													\
+		long			active, lane, attrib, code;													\
+		for( lane = 0; lane < PREDICT_LANES; lane++ ) {												\
+			lane_pos[ lane ] = root;																\
+		}																							\
+		do {																						\
+			active = 0;																				\
+			for( lane = 0; lane < PREDICT_LANES; lane++ ) {											\
+				if( ( attrib = nodes[ lane_pos[ lane ] ] ) >= 0 ) {									\
+					code				= CODE( FLAT_ATTRIB( attrib ), lane );						\
+					lane_pos[ lane ]	= FLAT_CODE_STEP( model, nodes, lane_pos[ lane ], attrib, code );	\
+					active				= 1;														\
+				}																					\
+			}																						\
+		} while( active );																			\
+		for( lane = 0; lane < PREDICT_LANES; lane++ ) {												\
+			classes[ i + lane ] = nodes[ lane_pos[ lane ] + 1 ];									\
+		}																							\
+	} while( 0 )
+
+/*
+	walk rows already translated into codes ( rows * ( cols - 1 ), see id3_value_code )
+	down the tree starting at root, negative codes stand for unknown values
+*/
+static void walk_codes( const id3_model_t *model, long root, const long *codes, long rows, long *classes )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	long				attribs			= model->cols - 1;
+	long				i				= 0;
+	long				pos, attrib;
+
+#define	ROW_CODE( attrib, lane )		codes[ ( i + ( lane ) ) * attribs + ( attrib ) ]
+	for( ; i + PREDICT_LANES <= rows; i += PREDICT_LANES ) {
+		PREDICT_GROUP( ROW_CODE );
+	}
+#undef	ROW_CODE
+
+	for( ; i < rows; i++ ) {
+		pos = root;
+		while( ( attrib = nodes[ pos ] ) >= 0 ) {
+			pos = FLAT_CODE_STEP( model, nodes, pos, attrib, codes[ i * attribs + FLAT_ATTRIB( attrib ) ] );
+		}
+		classes[ i ] = nodes[ pos + 1 ];
+	}
+}
+
+/*
+	walk rows given column by column down the tree starting at root: columns[ j ] holds
+	codes of attribute j for all rows, rows from first on are walked
+*/
+static void walk_columns( const id3_model_t *model, long root, const long *const *columns, long first, long rows, long *classes )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	long				i				= 0;
+	long				pos, attrib;
+
+#define	COLUMN_CODE( attrib, lane )		columns[ ( attrib ) ][ first + i + ( lane ) ]
+	for( ; i + PREDICT_LANES <= rows; i += PREDICT_LANES ) {
+		PREDICT_GROUP( COLUMN_CODE );
+	}
+#undef	COLUMN_CODE
+
+	for( ; i < rows; i++ ) {
+		pos = root;
+		while( ( attrib = nodes[ pos ] ) >= 0 ) {
+			pos = FLAT_CODE_STEP( model, nodes, pos, attrib, columns[ FLAT_ATTRIB( attrib ) ][ first + i ] );
+		}
+		classes[ i ] = nodes[ pos + 1 ];
+	}
+}
+
+/*
+	walk a row of an encoded dataset down the tree as trees cut at several depths would:
+	classes[ k ] gets the class of the row for the tree cut depths[ k ] branches below
+	root ( 0 for the whole tree ), inner nodes at the cut answer with their majority
+	class as tree trained with that max_depth does. One tree serves every depth limit
+*/
+void flat_walk_depths( const id3_model_t *model, const dataset_t *ds, long row, const long *depths, long tot_depths, long *classes )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	long				pos				= model->flat.root;
+	long				depth			= 0;
+	long				attrib, k;
+
+	while( ( attrib = nodes[ pos ] ) >= 0 ) {
+		for( k = 0; k < tot_depths; k++ ) {
+			if( depths[ k ] == depth ) {
+				classes[ k ] = nodes[ FLAT_DEFAULT( nodes, pos ) + 1 ];
+			}
+		}
+		pos		= FLAT_CODE_STEP( model, nodes, pos, attrib, ds_code( ds, FLAT_ATTRIB( attrib ), row ) );
+		depth	+= 1;
+	}
+	for( k = 0; k < tot_depths; k++ ) {
+		if( depths[ k ] <= 0 || depths[ k ] >= depth ) {
+			classes[ k ] = nodes[ pos + 1 ];
+		}
+	}
+}
+
+/*
+	classify rows by vote of the trees of a forest, rows come as strings, codes or columns
+	( only one of them is not NULL ): a block of rows is walked down a tree after the
+	other, so each tree stays in cache for the whole block, and the class voted by most
+	trees wins ( lowest class on ties ); trees without a rule for a row do not vote, -1 if
+	none has one
+	returns 0 or -4 on memory error
+*/
+static int forest_predict( const id3_model_t *model, char **data, const long *codes, const long *const *columns, long rows, long *classes )
+{
+	long				tot_classes		= model->dicts[ model->cols - 1 ].tot_values;
+	long				attribs			= model->cols - 1;
+	long				voted[ FOREST_BLOCK ];
+	long				*votes			= NULL;
+	long				*row_votes		= NULL;
+	long				first, tot, tree, best, i, k;
+
+	if( ( votes = malloc( sizeof( long ) * ( FOREST_BLOCK * tot_classes + 1 ) ) ) == NULL ) {
+		return -4;
+	}
+	for( first = 0; first < rows; first += FOREST_BLOCK ) {
+		tot = ( rows - first < FOREST_BLOCK ) ? rows - first : FOREST_BLOCK;
+		memset( votes, 0, sizeof( long ) * tot * tot_classes );
+		for( tree = 0; tree < model->tot_trees; tree++ ) {
+			if( data != NULL ) {
+				for( i = 0; i < tot; i++ ) {
+					voted[ i ] = walk_row( model, model->roots[ tree ], data + ( first + i ) * attribs );
+				}
+			} else if( codes != NULL ) {
+				walk_codes( model, model->roots[ tree ], codes + first * attribs, tot, voted );
+			} else {
+				walk_columns( model, model->roots[ tree ], columns, first, tot, voted );
+			}
+			for( i = 0; i < tot; i++ ) {
+				if( voted[ i ] >= 0 ) {
+					votes[ i * tot_classes + voted[ i ] ] += 1;
+				}
+			}
+		}
+		for( i = 0; i < tot; i++ ) {
+			row_votes = votes + i * tot_classes;
+			for( best = -1, k = 0; k < tot_classes; k++ ) {
+				if( row_votes[ k ] > ( ( best < 0 ) ? 0 : row_votes[ best ] ) ) {
+					best = k;
+				}
+			}
+			classes[ first + i ] = best;
+		}
+	}
+	free( votes );
+
+	return 0;
+}
+
+/*
+	classify a row of strings by vote of the trees of a forest without any allocation:
+	votes are counted on stack for FOREST_BLOCK classes at a time, trees are walked again
+	for each further block of classes of a model with more of them
+	returns class voted by most trees ( lowest class on ties ) or -1 if none has a rule
+*/
+static long forest_predict_row( const id3_model_t *model, char **row )
+{
+	long				tot_classes		= model->dicts[ model->cols - 1 ].tot_values;
+	long				votes[ FOREST_BLOCK ];
+	long				best			= -1;
+	long				best_votes		= 0;
+	long				first, tot, tree, voted, k;
+
+	for( first = 0; first < tot_classes; first += FOREST_BLOCK ) {
+		tot = ( tot_classes - first < FOREST_BLOCK ) ? tot_classes - first : FOREST_BLOCK;
+		memset( votes, 0, sizeof( long ) * tot );
+		for( tree = 0; tree < model->tot_trees; tree++ ) {
+			voted = walk_row( model, model->roots[ tree ], row );
+			if( voted >= first && voted < first + tot ) {
+				votes[ voted - first ] += 1;
+			}
+		}
+		for( k = 0; k < tot; k++ ) {
+			if( votes[ k ] > best_votes ) {
+				best		= first + k;
+				best_votes	= votes[ k ];
+			}
+		}
+	}
+
+	return best;
+}
+
+/*
+	classify a row of strings ( cols - 1 attributes ); returns class or -1 if tree ( every
+	tree of a forest ) has no rule for the row
+*/
+long id3_predict( const id3_model_t *model, char **row )
+{
+	if( model->roots != NULL ) {
+		return forest_predict_row( model, row );
+	}
+
+	return walk_row( model, model->flat.root, row );
+}
+
+/*
+	classify rows of strings stored like training dataset, without class column
+	( rows * ( cols - 1 ) ); class of each row is stored in classes
+*/
+int id3_predict_batch( const id3_model_t *model, char **data, long rows, long *classes )
+{
+	long				i;
+
+	if( model->roots != NULL ) {
+		return forest_predict( model, data, NULL, NULL, rows, classes );
+	}
+	for( i = 0; i < rows; i++ ) {
+		classes[ i ] = walk_row( model, model->flat.root, data + i * ( model->cols - 1 ) );
+	}
+
+	return 0;
+}
+
+/*
+	classify rows already translated into codes ( rows * ( cols - 1 ), see id3_value_code ),
+	negative codes stand for unknown values
+*/
+int id3_predict_codes( const id3_model_t *model, const long *codes, long rows, long *classes )
+{
+	if( model->roots != NULL ) {
+		return forest_predict( model, NULL, codes, NULL, rows, classes );
+	}
+	walk_codes( model, model->flat.root, codes, rows, classes );
+
+	return 0;
+}
+
+/*
+	classify rows given column by column: columns[ j ] holds codes of attribute j for all
+	rows, negative codes stand for unknown values
+*/
+int id3_predict_columns( const id3_model_t *model, const long *const *columns, long rows, long *classes )
+{
+	if( model->roots != NULL ) {
+		return forest_predict( model, NULL, NULL, columns, rows, classes );
+	}
+	walk_columns( model, model->flat.root, columns, 0, rows, classes );
+
+	return 0;
+}
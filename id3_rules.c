@@ -0,0 +1,402 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+/*
+	state of rule extraction: path from root to current node, its terms are the
+	attribute / value couples of the rule ending at a terminal node
+*/
+typedef struct walk_tag {
+	long				*pos;			// node of each level
+	long				*next;			// next child to visit at each level
+	long				*attribs;		// terms of path
+	long				*values;
+	int					*operators;
+	const char			**columns;
+	const char			**names;
+	long				max_depth;		// allocated levels
+} walk_t;
+
+/*
+	text written by a sink for each class, legacy text lists rules grouped by class
+*/
+typedef struct text_buf_tag {
+	char				*data;
+	size_t				size;
+	size_t				max;
+} text_buf_t;
+
+typedef struct text_sink_tag {
+	text_buf_t			*classes;		// text of rules of each class
+	int					error;
+} text_sink_t;
+
+/*
+	make room for one more level of path
+	returns 0 or -1 on memory error
+*/
+static int walk_grow( walk_t *walk )
+{
+	long				max				= walk->max_depth ? walk->max_depth * 2 : 16;
+	void				*ptr[ 7 ];
+	int					i;
+
+	ptr[ 0 ] = realloc( walk->pos, sizeof( long ) * max );
+	if( ptr[ 0 ] != NULL ) {
+		walk->pos = ptr[ 0 ];
+	}
+	ptr[ 1 ] = realloc( walk->next, sizeof( long ) * max );
+	if( ptr[ 1 ] != NULL ) {
+		walk->next = ptr[ 1 ];
+	}
+	ptr[ 2 ] = realloc( walk->attribs, sizeof( long ) * max );
+	if( ptr[ 2 ] != NULL ) {
+		walk->attribs = ptr[ 2 ];
+	}
+	ptr[ 3 ] = realloc( walk->values, sizeof( long ) * max );
+	if( ptr[ 3 ] != NULL ) {
+		walk->values = ptr[ 3 ];
+	}
+	ptr[ 4 ] = realloc( walk->columns, sizeof( char* ) * max );
+	if( ptr[ 4 ] != NULL ) {
+		walk->columns = ptr[ 4 ];
+	}
+	ptr[ 5 ] = realloc( walk->names, sizeof( char* ) * max );
+	if( ptr[ 5 ] != NULL ) {
+		walk->names = ptr[ 5 ];
+	}
+	ptr[ 6 ] = realloc( walk->operators, sizeof( int ) * max );
+	if( ptr[ 6 ] != NULL ) {
+		walk->operators = ptr[ 6 ];
+	}
+	for( i = 0; i < 7; i++ ) {
+		if( ptr[ i ] == NULL ) {
+			return -1;
+		}
+	}
+	walk->max_depth = max;
+
+	return 0;
+}
+
+/*
+	stream every rule of a model to a function with a single depth first walk of the
+	flat tree; rules of all classes come in tree order and every name is taken from
+	catalogs by its code, thresholds of numeric columns too. Default branches of values
+	without a child are not rules
+	returns 0, value returned by func if not zero, -1 for a forest or -4 on memory error
+*/
+int id3_export_rules( const id3_model_t *model, id3_rule_func_t func, void *arg )
+{
+	const int32_t		*nodes			= model->flat.nodes;
+	const dict_t		*classes		= model->dicts + model->cols - 1;
+	walk_t				walk;
+	id3_rule_t			rule;
+	double				wall			= 0;
+	double				cpu				= 0;
+	long				tot_rules		= 0;
+	long				depth			= 0;
+	long				pos, child, attrib, value;
+	int					result			= 0;
+
+	// rules of a tree of a forest are not the ones of the model
+	if( model->roots != NULL ) {
+		return -1;
+	}
+	if( model->stats != NULL ) {
+		wall	= stats_wall();
+		cpu		= stats_cpu();
+	}
+	memset( &walk, 0, sizeof( walk_t ) );
+	if( walk_grow( &walk ) != 0 ) {
+		result	= -4;
+		depth	= -1;
+	}
+	rule.attribs	= walk.attribs;
+	rule.values		= walk.values;
+	rule.operators	= walk.operators;
+	rule.columns	= ( const char *const* )walk.columns;
+	rule.names		= ( const char *const* )walk.names;
+
+	// a tree made of a terminal node has a rule without terms
+	pos = model->flat.root;
+	if( depth >= 0 && nodes[ pos ] < 0 ) {
+		if( nodes[ pos + 1 ] >= 0 ) {
+			rule.class_id	= nodes[ pos + 1 ];
+			rule.class_name	= DICT_NAME( classes, rule.class_id );
+			rule.tot_terms	= 0;
+			result			= func( &rule, arg );
+			tot_rules		+= 1;
+		}
+		depth = -1;
+	}
+	if( depth >= 0 ) {
+		walk.pos[ 0 ]	= pos;
+		walk.next[ 0 ]	= 0;
+	}
+
+	// stack holds inner nodes only, terminal children are handled in place so that
+	// branches without class cost a single test
+	while( result == 0 && depth >= 0 ) {
+		pos		= walk.pos[ depth ];
+		value	= walk.next[ depth ];
+
+		// skip branches leading to terminal node without class, and values without a
+		// child that lead to default branch
+		while( value < nodes[ pos + 1 ] && ( nodes[ pos + 2 + value ] == FLAT_LEAF( -1 ) ||
+			nodes[ nodes[ pos + 2 + value ] ] == FLAT_OTHER_WORD ) ) {
+			++value;
+		}
+		// all branches of node visited
+		if( value >= nodes[ pos + 1 ] ) {
+			depth -= 1;
+			continue;
+		}
+		walk.next[ depth ] = value + 1;
+
+		// term of branch
+		if( depth + 1 >= walk.max_depth ) {
+			if( walk_grow( &walk ) != 0 ) {
+				result = -4;
+				break;
+			}
+			rule.attribs	= walk.attribs;
+			rule.values		= walk.values;
+			rule.operators	= walk.operators;
+			rule.columns	= ( const char *const* )walk.columns;
+			rule.names		= ( const char *const* )walk.names;
+		}
+		attrib					= FLAT_ATTRIB( nodes[ pos ] );
+		child					= nodes[ pos + 2 + value ];
+		walk.attribs[ depth ]	= attrib;
+		walk.values[ depth ]	= FLAT_VALUE( nodes, pos, value );
+		walk.operators[ depth ]	= ID3_TERM_EQ;
+		walk.columns[ depth ]	= model->column_names[ attrib ];
+		// branches of a numeric node are the two sides of its threshold
+		if( nodes[ pos ] & FLAT_NUMERIC ) {
+			walk.values[ depth ]	= nodes[ pos + 4 ];
+			walk.operators[ depth ]	= ( value == 0 ) ? ID3_TERM_LE : ID3_TERM_GT;
+		}
+		walk.names[ depth ]		= DICT_NAME( model->dicts + attrib, walk.values[ depth ] );
+
+		// terminal node: path from root is a rule of its class
+		if( nodes[ child ] < 0 ) {
+			rule.class_id	= nodes[ child + 1 ];
+			rule.class_name	= DICT_NAME( classes, rule.class_id );
+			rule.tot_terms	= depth + 1;
+			result			= func( &rule, arg );
+			tot_rules		+= 1;
+			continue;
+		}
+
+		// go down the branch
+		depth					+= 1;
+		walk.pos[ depth ]		= child;
+		walk.next[ depth ]		= 0;
+	}
+
+	free( walk.pos );
+	free( walk.next );
+	free( walk.attribs );
+	free( walk.values );
+	free( walk.operators );
+	free( walk.columns );
+	free( walk.names );
+	if( model->stats != NULL ) {
+		model->stats->rules_wall	+= stats_wall() - wall;
+		model->stats->rules_cpu		+= stats_cpu() - cpu;
+		model->stats->rules			= tot_rules;
+	}
+
+	return result;
+}
+
+/*
+	append a string to a text buffer
+	returns 0 or -1 on memory error
+*/
+static int text_append( text_buf_t *buf, const char *str )
+{
+	size_t				len				= strlen( str );
+	size_t				max				= buf->max ? buf->max : 256;
+	void				*ptr			= NULL;
+
+	if( buf->size + len > buf->max ) {
+		while( max < buf->size + len ) {
+			max *= 2;
+		}
+		if( ( ptr = realloc( buf->data, max ) ) == NULL ) {
+			return -1;
+		}
+		buf->data	= ptr;
+		buf->max	= max;
+	}
+	memcpy( buf->data + buf->size, str, len );
+	buf->size += len;
+
+	return 0;
+}
+
+/*
+	operator of a term as written by sinks, in text and in JSON
+*/
+static const char *const term_text[] = { " = ", " <= ", " > " };
+static const char *const term_operators[] = { "=", "<=", ">" };
+
+/*
+	legacy text sink: a rule is a line of terms "if column = value " joined by "and ",
+	kept with rules of its class until the walk is over
+*/
+static int text_rule( const id3_rule_t *rule, void *arg )
+{
+	text_sink_t			*sink			= arg;
+	text_buf_t			*buf			= sink->classes + rule->class_id;
+	long				i;
+
+	for( i = 0; i < rule->tot_terms; i++ ) {
+		if( text_append( buf, "if " ) != 0 || text_append( buf, rule->columns[ i ] ) != 0 ||
+			text_append( buf, term_text[ rule->operators[ i ] ] ) != 0 || text_append( buf, rule->names[ i ] ) != 0 ||
+			text_append( buf, i + 1 < rule->tot_terms ? " and " : " \n\t\t" ) != 0 ) {
+			sink->error = 1;
+			return -4;
+		}
+	}
+
+	return 0;
+}
+
+/*
+	write a JSON string, runs of characters without escapes are written at once
+*/
+static void json_string( FILE *fp, const char *str )
+{
+	const unsigned char	*p				= ( const unsigned char* )str;
+	const unsigned char	*run			= p;
+
+	fputc( '"', fp );
+	for( ; *p != '\0'; p++ ) {
+		if( *p != '"' && *p != '\\' && *p >= 0x20 ) {
+			continue;
+		}
+		fwrite( run, 1, p - run, fp );
+		if( *p < 0x20 ) {
+			fprintf( fp, "\\u%04x", *p );
+		} else {
+			fputc( '\\', fp );
+			fputc( *p, fp );
+		}
+		run = p + 1;
+	}
+	fwrite( run, 1, p - run, fp );
+	fputc( '"', fp );
+}
+
+/*
+	JSON lines sink: one object for each rule, written as soon as it is found; terms of
+	numeric columns have an operator
+*/
+static int json_rule( const id3_rule_t *rule, void *arg )
+{
+	FILE				*fp				= arg;
+	long				i;
+
+	fputs( "{\"class\":", fp );
+	json_string( fp, rule->class_name );
+	fputs( ",\"terms\":[", fp );
+	for( i = 0; i < rule->tot_terms; i++ ) {
+		fputs( i > 0 ? ",{\"column\":" : "{\"column\":", fp );
+		json_string( fp, rule->columns[ i ] );
+		fputs( ",\"value\":", fp );
+		json_string( fp, rule->names[ i ] );
+		if( rule->operators[ i ] != ID3_TERM_EQ ) {
+			fputs( ",\"op\":", fp );
+			json_string( fp, term_operators[ rule->operators[ i ] ] );
+		}
+		fputc( '}', fp );
+	}
+	fputs( "]}\n", fp );
+
+	return ferror( fp ) ? -2 : 0;
+}
+
+/*
+	write rules of a model to a file
+	- format:	ID3_RULES_TEXT for text of id3_print_rules, ID3_RULES_JSON for JSON lines
+	returns 0, -1 on wrong parameters, -2 on write error or -4 on memory error
+*/
+int id3_write_rules( const id3_model_t *model, FILE *fp, int format )
+{
+	const dict_t		*classes		= NULL;
+	text_sink_t			sink;
+	long				class_id;
+	int					result			= 0;
+
+	if( model == NULL || fp == NULL || model->roots != NULL ) {
+		return -1;
+	}
+	if( format == ID3_RULES_JSON ) {
+		return id3_export_rules( model, json_rule, fp );
+	}
+	if( format != ID3_RULES_TEXT ) {
+		return -1;
+	}
+
+	classes = model->dicts + model->cols - 1;
+	memset( &sink, 0, sizeof( text_sink_t ) );
+	if( ( sink.classes = calloc( classes->tot_values + 1, sizeof( text_buf_t ) ) ) == NULL ) {
+		return -4;
+	}
+	result = id3_export_rules( model, text_rule, &sink );
+
+	if( result == 0 ) {
+		fprintf( fp, "Found rules:\n\n" );
+		for( class_id = 0; class_id < classes->tot_values; class_id++ ) {
+			fprintf( fp, "Class %s\n\t\t", DICT_NAME( classes, class_id ) );
+			if( sink.classes[ class_id ].size > 0 ) {
+				fwrite( sink.classes[ class_id ].data, 1, sink.classes[ class_id ].size, fp );
+			}
+			fprintf( fp, "\n" );
+		}
+		if( ferror( fp ) ) {
+			result = -2;
+		}
+	}
+
+	for( class_id = 0; class_id < classes->tot_values; class_id++ ) {
+		free( sink.classes[ class_id ].data );
+	}
+	free( sink.classes );
+
+	return result;
+}
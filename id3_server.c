@@ -0,0 +1,1096 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	prediction server: a single thread polls the socket and its clients, requests whose
+	bytes arrived are queued and scored together as a batch, a tree walk over rows of
+	every request of a model at once. Models live in slots holding their current version
+	with a count of references: a batch takes a reference on versions it uses, so a model
+	replaced meanwhile is released by the last batch scoring with it
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+#define	SERVER_BATCH		4096			// rows of a batch by default
+#define	SERVER_MAX_REQUEST	( 64L << 20 )	// bytes of a request, a client sending more is closed
+#define	SERVER_READ			65536			// bytes read from a client at a time, at least
+#define	SERVER_READ_MAX		( 1L << 20 )	// bytes read from a client by a poll round, at most
+#define	SERVER_MAX_QUEUED	256				// requests of a client waiting for a batch, more are not read
+#define	SERVER_MAX_OUT		( 4L << 20 )	// reply bytes of a client not sent yet, more stop its reads
+#define	SERVER_REQUEST		16				// bytes of request header, length word included
+#define	SERVER_REPLY		16				// bytes of reply header, length word included
+
+// latency histogram: bucket k holds latencies up to 2^( k / 8 ) microseconds
+#define	SERVER_BUCKETS		256
+#define	SERVER_BUCKET_STEPS	8
+
+/*
+	version of a model in a slot
+*/
+typedef struct version_tag {
+	id3_model_t			*model;
+	long				version;
+	long				refs;				// slot and batches scoring with it
+} version_t;
+
+/*
+	connection of a client: bytes received not yet replied and reply bytes not yet sent
+*/
+typedef struct client_tag {
+	int					fd;
+	char				*in;
+	size_t				in_size;
+	size_t				in_max;
+	size_t				parsed;				// bytes of requests already queued
+	size_t				answered;			// bytes of requests already replied, while a batch ends
+	char				*out;
+	size_t				out_size;
+	size_t				out_max;
+	size_t				out_sent;
+	long				queued;				// requests of client waiting for a batch
+	int					closing;			// client sends no more requests
+	int					broken;				// socket failed or client sent a malformed request
+} client_t;
+
+/*
+	request waiting for a batch, its header is read when it is queued
+*/
+typedef struct request_tag {
+	long				client;
+	size_t				values;				// attribute values into input of client
+	size_t				size;				// bytes of attribute values
+	uint32_t			id;
+	long				operation;
+	long				slot;
+	long				rows;
+	double				received;
+} request_t;
+
+struct id3_server_tag {
+	char				*path;
+	int					listener;
+	int					wake[ 2 ];			// pipe written by id3_server_stop
+	int					stop;				// set by id3_server_stop, read atomically
+	pthread_mutex_t		lock;				// protects slots, versions and counters
+	version_t			*slots[ ID3_SERVER_SLOTS ];
+	long				versions;			// versions loaded so far
+	long				max_batch;
+	long				batch_wait;
+	client_t			*clients;
+	long				tot_clients;
+	long				max_clients;
+	request_t			*pending;
+	long				tot_pending;
+	long				max_pending;
+	long				pending_rows;
+	// batch scratch, grown to the largest batch up to max_batch rows
+	char				**strings;			// attribute values of rows of a slot
+	long				*classes;			// class of each row of batch
+	long				*scratch;			// classes of rows of a slot
+	int32_t				*replies;			// classes of a request as they are sent
+	long				*codes;				// codes of rows of a slot, column by column
+	long				**columns;
+	long				*offsets;			// first row of each request of batch into classes
+	int32_t				*status;			// status of each request of batch
+	long				max_rows;
+	long				max_strings;
+	long				max_columns;
+	long				max_requests;
+	// counters
+	double				start;
+	long				requests;
+	long				rows;
+	long				batches;
+	long				errors;
+	long				reloads;
+	long				connected;
+	long				histogram[ SERVER_BUCKETS ];
+};
+
+/*
+	release a reference to a version, model goes with the last one
+*/
+static void version_release( id3_server_t *server, version_t *version )
+{
+	long				refs;
+
+	if( version == NULL ) {
+		return;
+	}
+	pthread_mutex_lock( &server->lock );
+	refs = --version->refs;
+	pthread_mutex_unlock( &server->lock );
+	if( refs == 0 ) {
+		id3_destroy( version->model );
+		free( version );
+	}
+}
+
+/*
+	grow a buffer to hold at least size bytes
+	returns 0 or -4 on memory error
+*/
+static int server_reserve( char **data, size_t *max, size_t size )
+{
+	size_t				grown			= *max ? *max : SERVER_READ;
+	void				*ptr			= NULL;
+
+	while( grown < size ) {
+		grown *= 2;
+	}
+	if( grown > *max ) {
+		if( ( ptr = realloc( *data, grown ) ) == NULL ) {
+			return -4;
+		}
+		*data	= ptr;
+		*max	= grown;
+	}
+
+	return 0;
+}
+
+/*
+	socket of a client or of server does not block
+*/
+static int server_nonblock( int fd )
+{
+	int					flags			= fcntl( fd, F_GETFL, 0 );
+
+	return ( flags < 0 || fcntl( fd, F_SETFL, flags | O_NONBLOCK ) != 0 ) ? -2 : 0;
+}
+
+/*
+	create a server listening at path
+*/
+int id3_server_create( id3_server_t **server, const char *path, long max_batch, long batch_wait )
+{
+	id3_server_t		*srv			= NULL;
+	struct sockaddr_un	addr;
+	int					result			= 0;
+
+	*server = NULL;
+	if( path == NULL || strlen( path ) >= sizeof( addr.sun_path ) || max_batch < 0 || batch_wait < 0 ) {
+		return -1;
+	}
+	if( ( srv = calloc( 1, sizeof( id3_server_t ) ) ) == NULL || ( srv->path = malloc( strlen( path ) + 1 ) ) == NULL ) {
+		free( srv );
+		return -4;
+	}
+	strcpy( srv->path, path );
+	srv->listener	= -1;
+	srv->wake[ 0 ]	= -1;
+	srv->wake[ 1 ]	= -1;
+	srv->max_batch	= max_batch ? max_batch : SERVER_BATCH;
+	srv->batch_wait	= batch_wait;
+	srv->start		= stats_wall();
+	pthread_mutex_init( &srv->lock, NULL );
+	*server			= srv;
+
+	memset( &addr, 0, sizeof( struct sockaddr_un ) );
+	addr.sun_family = AF_UNIX;
+	strcpy( addr.sun_path, path );
+	do {
+		if( pipe( srv->wake ) != 0 || server_nonblock( srv->wake[ 0 ] ) != 0 || server_nonblock( srv->wake[ 1 ] ) != 0 ) {
+			result = -2;
+			break;
+		}
+		// a socket file left by a previous server is replaced
+		unlink( path );
+		if( ( srv->listener = socket( AF_UNIX, SOCK_STREAM, 0 ) ) < 0 ||
+			bind( srv->listener, ( struct sockaddr* )&addr, sizeof( struct sockaddr_un ) ) != 0 ||
+			listen( srv->listener, 64 ) != 0 || server_nonblock( srv->listener ) != 0 ) {
+			result = -2;
+			break;
+		}
+	} while( 0 );
+
+	if( result != 0 ) {
+		id3_server_destroy( srv );
+		*server = NULL;
+	}
+
+	return result;
+}
+
+/*
+	load a model into a slot, it replaces the current version
+*/
+int id3_server_load( id3_server_t *server, long slot, const char *path )
+{
+	version_t			*version		= NULL;
+	version_t			*previous		= NULL;
+	int					result			= 0;
+
+	if( server == NULL || slot < 0 || slot >= ID3_SERVER_SLOTS || path == NULL ) {
+		return -1;
+	}
+	if( ( version = calloc( 1, sizeof( version_t ) ) ) == NULL ) {
+		return -4;
+	}
+	// file is loaded before the swap, requests are not held meanwhile
+	if( ( result = id3_model_load( &version->model, path ) ) != 0 ) {
+		free( version );
+		return result;
+	}
+	version->refs = 1;
+
+	pthread_mutex_lock( &server->lock );
+	previous				= server->slots[ slot ];
+	server->slots[ slot ]	= version;
+	version->version		= ++server->versions;
+	server->reloads			+= ( previous != NULL );
+	pthread_mutex_unlock( &server->lock );
+	version_release( server, previous );
+
+	return 0;
+}
+
+/*
+	stop a running server
+*/
+void id3_server_stop( id3_server_t *server )
+{
+	char				byte			= 0;
+
+	__atomic_store_n( &server->stop, 1, __ATOMIC_RELAXED );
+	if( write( server->wake[ 1 ], &byte, 1 ) < 0 ) {
+		// pipe is full, server is being woken anyway
+	}
+}
+
+/*
+	read counters of a server, quantiles come from the upper bound of their bucket
+*/
+void id3_server_stats( id3_server_t *server, id3_server_stats_t *stats )
+{
+	long				tot				= 0;
+	long				seen			= 0;
+	long				k;
+
+	memset( stats, 0, sizeof( id3_server_stats_t ) );
+	pthread_mutex_lock( &server->lock );
+	stats->uptime		= stats_wall() - server->start;
+	stats->requests		= server->requests;
+	stats->rows			= server->rows;
+	stats->batches		= server->batches;
+	stats->errors		= server->errors;
+	stats->clients		= server->connected;
+	stats->reloads		= server->reloads;
+	for( k = 0; k < SERVER_BUCKETS; k++ ) {
+		tot += server->histogram[ k ];
+	}
+	for( k = 0; k < SERVER_BUCKETS && tot > 0; k++ ) {
+		seen += server->histogram[ k ];
+		if( stats->latency_p50 == 0 && seen * 2 >= tot ) {
+			stats->latency_p50 = pow( 2, ( double )k / SERVER_BUCKET_STEPS ) * 1e-6;
+		}
+		if( seen * 100 >= tot * 99 ) {
+			stats->latency_p99 = pow( 2, ( double )k / SERVER_BUCKET_STEPS ) * 1e-6;
+			break;
+		}
+	}
+	pthread_mutex_unlock( &server->lock );
+	if( stats->uptime > 0 ) {
+		stats->requests_rate	= stats->requests / stats->uptime;
+		stats->rows_rate		= stats->rows / stats->uptime;
+	}
+}
+
+/*
+	accept every client waiting
+	returns 0, -2 on socket error or -4 on memory error
+*/
+static int server_accept( id3_server_t *server )
+{
+	client_t			*client			= NULL;
+	void				*ptr			= NULL;
+	long				max_clients		= server->max_clients ? server->max_clients * 2 : 16;
+	int					fd;
+
+	while( ( fd = accept( server->listener, NULL, NULL ) ) >= 0 || errno == EINTR ) {
+		if( fd < 0 ) {
+			continue;
+		}
+		if( server_nonblock( fd ) != 0 ) {
+			close( fd );
+			continue;
+		}
+		if( server->tot_clients == server->max_clients ) {
+			if( ( ptr = realloc( server->clients, sizeof( client_t ) * max_clients ) ) == NULL ) {
+				close( fd );
+				return -4;
+			}
+			server->clients		= ptr;
+			server->max_clients	= max_clients;
+			max_clients			*= 2;
+		}
+		client		= server->clients + server->tot_clients++;
+		memset( client, 0, sizeof( client_t ) );
+		client->fd	= fd;
+		pthread_mutex_lock( &server->lock );
+		server->connected += 1;
+		pthread_mutex_unlock( &server->lock );
+	}
+
+	return ( errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED ) ? 0 : -2;
+}
+
+/*
+	a client is read while it has room for more requests and takes its replies: one
+	that sends requests without reading replies is left alone until it does
+*/
+static int server_readable( const client_t *client )
+{
+	return !client->closing && !client->broken && client->queued < SERVER_MAX_QUEUED &&
+		client->out_size - client->out_sent < SERVER_MAX_OUT;
+}
+
+/*
+	queue complete requests a client sent, up to SERVER_MAX_QUEUED of them waiting; a
+	client sending a length too big or too small for a request is dropped
+	returns 0 or -4 on memory error
+*/
+static int server_parse( id3_server_t *server, long index )
+{
+	client_t			*client			= server->clients + index;
+	request_t			*request		= NULL;
+	void				*ptr			= NULL;
+	long				max_pending		= server->max_pending ? server->max_pending * 2 : 64;
+	uint32_t			header[ SERVER_REQUEST / sizeof( uint32_t ) ];
+	uint16_t			fields[ 2 ];
+
+	// header: length, id, operation and slot, rows
+	while( !client->broken && client->queued < SERVER_MAX_QUEUED && client->in_size - client->parsed >= SERVER_REQUEST ) {
+		memcpy( header, client->in + client->parsed, SERVER_REQUEST );
+		memcpy( fields, header + 2, sizeof( fields ) );
+		if( header[ 0 ] < SERVER_REQUEST - sizeof( uint32_t ) || header[ 0 ] > SERVER_MAX_REQUEST ) {
+			client->broken = 1;
+			break;
+		}
+		if( client->in_size - client->parsed < header[ 0 ] + sizeof( uint32_t ) ) {
+			break;
+		}
+		if( server->tot_pending == server->max_pending ) {
+			if( ( ptr = realloc( server->pending, sizeof( request_t ) * max_pending ) ) == NULL ) {
+				return -4;
+			}
+			server->pending		= ptr;
+			server->max_pending	= max_pending;
+			max_pending			*= 2;
+		}
+		request				= server->pending + server->tot_pending++;
+		request->client		= index;
+		request->values		= client->parsed + SERVER_REQUEST;
+		request->size		= header[ 0 ] + sizeof( uint32_t ) - SERVER_REQUEST;
+		request->id			= header[ 1 ];
+		request->operation	= fields[ 0 ];
+		request->slot		= fields[ 1 ];
+		request->rows		= ( fields[ 0 ] == ID3_SERVER_PREDICT ) ? header[ 3 ] : 0;
+		// a row takes a byte at least, more rows are a malformed request
+		if( request->rows > ( long )request->size ) {
+			request->operation	= 0;
+			request->rows		= 0;
+		}
+		request->received	= stats_wall();
+		server->pending_rows	+= request->rows;
+		client->queued			+= 1;
+		client->parsed			+= header[ 0 ] + sizeof( uint32_t );
+	}
+
+	return 0;
+}
+
+/*
+	read bytes a client sent, SERVER_READ_MAX at most so that a client sending fast does
+	not hold up others, and queue its complete requests
+	returns 0 or -4 on memory error
+*/
+static int server_read( id3_server_t *server, long index )
+{
+	client_t			*client			= server->clients + index;
+	size_t				taken			= 0;
+	ssize_t				done;
+
+	while( taken < SERVER_READ_MAX ) {
+		if( server_reserve( &client->in, &client->in_max, client->in_size + SERVER_READ ) != 0 ) {
+			return -4;
+		}
+		done = recv( client->fd, client->in + client->in_size, client->in_max - client->in_size, 0 );
+		if( done < 0 && errno == EINTR ) {
+			continue;
+		}
+		if( done == 0 ) {
+			client->closing = 1;
+		} else if( done < 0 && errno != EAGAIN && errno != EWOULDBLOCK ) {
+			client->broken = 1;
+		}
+		if( done <= 0 ) {
+			break;
+		}
+		client->in_size	+= done;
+		taken			+= done;
+	}
+
+	return server_parse( server, index );
+}
+
+/*
+	send reply bytes of a client, as many as socket takes
+*/
+static void server_flush( client_t *client )
+{
+	ssize_t				done;
+
+	while( client->out_sent < client->out_size ) {
+		done = send( client->fd, client->out + client->out_sent, client->out_size - client->out_sent, MSG_NOSIGNAL );
+		if( done < 0 && errno == EINTR ) {
+			continue;
+		}
+		if( done < 0 ) {
+			client->broken |= ( errno != EAGAIN && errno != EWOULDBLOCK );
+			return;
+		}
+		client->out_sent += done;
+	}
+	client->out_size	= 0;
+	client->out_sent	= 0;
+}
+
+/*
+	append a reply to output of a client
+	returns 0 or -4 on memory error
+*/
+static int server_reply( client_t *client, uint32_t id, int32_t status, long version, const void *payload, size_t size )
+{
+	uint32_t			header[ SERVER_REPLY / sizeof( uint32_t ) ];
+
+	header[ 0 ]	= SERVER_REPLY - sizeof( uint32_t ) + size;
+	header[ 1 ]	= id;
+	header[ 2 ]	= ( uint32_t )status;
+	header[ 3 ]	= ( uint32_t )version;
+	if( server_reserve( &client->out, &client->out_max, client->out_size + SERVER_REPLY + size ) != 0 ) {
+		return -4;
+	}
+	memcpy( client->out + client->out_size, header, SERVER_REPLY );
+	if( size > 0 ) {
+		memcpy( client->out + client->out_size + SERVER_REPLY, payload, size );
+	}
+	client->out_size += SERVER_REPLY + size;
+
+	return 0;
+}
+
+/*
+	grow an array of batch scratch to hold at least tot items
+	returns 0 or -4 on memory error
+*/
+static int server_grow( void **array, long *max, long tot, size_t size )
+{
+	void				*ptr			= NULL;
+
+	if( tot > *max ) {
+		if( ( ptr = realloc( *array, size * tot ) ) == NULL ) {
+			return -4;
+		}
+		*array	= ptr;
+		*max	= tot;
+	}
+
+	return 0;
+}
+
+/*
+	release batch scratch grown past max_batch rows by a single large request, so that
+	it is not held until server exits
+*/
+static void server_trim( id3_server_t *server )
+{
+	if( server->max_rows > server->max_batch ) {
+		free( server->classes );
+		free( server->scratch );
+		free( server->replies );
+		server->classes		= NULL;
+		server->scratch		= NULL;
+		server->replies		= NULL;
+		server->max_rows	= 0;
+	}
+	if( server->max_strings > server->max_batch * server->max_columns ) {
+		free( server->strings );
+		free( server->codes );
+		server->strings		= NULL;
+		server->codes		= NULL;
+		server->max_strings	= 0;
+	}
+}
+
+/*
+	attribute values of a request: rows * attribs NUL terminated strings filling request
+	returns 0 or -1 if request does not hold them
+*/
+static int server_values( const char *values, size_t size, long rows, long attribs, char **strings )
+{
+	const char			*end			= values + size;
+	const char			*nul			= NULL;
+	long				i;
+
+	for( i = 0; i < rows * attribs; i++ ) {
+		if( values >= end || ( nul = memchr( values, '\0', end - values ) ) == NULL ) {
+			return -1;
+		}
+		strings[ i ]	= ( char* )values;
+		values			= nul + 1;
+	}
+
+	return ( values == end ) ? 0 : -1;
+}
+
+/*
+	score rows of every request of a batch for the model of a slot: values are
+	translated into codes column by column and walked down tree together ( a model with
+	numeric columns walks strings, as numbers unknown to model have no code ). Classes
+	go to the offset of each request into batch, a request whose values do not match
+	columns of model gets status -1
+	- tot:		requests of batch, first pending ones
+	returns 0 or -4 on memory error
+*/
+static int server_score( id3_server_t *server, const version_t *version, long slot, long tot )
+{
+	const id3_model_t	*model			= version->model;
+	long				attribs			= model->cols - 1;
+	long				tot_rows		= 0;
+	long				rows			= 0;
+	long				max_strings		= server->max_strings;
+	const request_t		*request		= NULL;
+	long				i, j, k;
+
+	for( i = 0; i < tot; i++ ) {
+		if( server->status[ i ] == 0 && server->pending[ i ].slot == slot ) {
+			tot_rows += server->pending[ i ].rows;
+		}
+	}
+	if( tot_rows == 0 ) {
+		return 0;
+	}
+	if( server_grow( ( void** )&server->strings, &max_strings, tot_rows * attribs, sizeof( char* ) ) != 0 ||
+		server_grow( ( void** )&server->codes, &server->max_strings, tot_rows * attribs, sizeof( long ) ) != 0 ||
+		server_grow( ( void** )&server->columns, &server->max_columns, attribs, sizeof( long* ) ) != 0 ) {
+		return -4;
+	}
+
+	// strings of every row of slot
+	for( i = 0; i < tot; i++ ) {
+		request = server->pending + i;
+		if( server->status[ i ] != 0 || request->slot != slot ) {
+			continue;
+		}
+		if( server_values( server->clients[ request->client ].in + request->values, request->size, request->rows, attribs,
+			server->strings + rows * attribs ) != 0 ) {
+			server->status[ i ] = -1;
+			continue;
+		}
+		rows += request->rows;
+	}
+
+	if( model->numbers != NULL || model->roots != NULL ) {
+		if( id3_predict_batch( model, server->strings, rows, server->scratch ) != 0 ) {
+			return -4;
+		}
+	} else {
+		for( j = 0; j < attribs; j++ ) {
+			server->columns[ j ] = server->codes + j * rows;
+			for( k = 0; k < rows; k++ ) {
+				server->columns[ j ][ k ] = id3_value_code( model, j, server->strings[ k * attribs + j ] );
+			}
+		}
+		id3_predict_columns( model, ( const long *const* )server->columns, rows, server->scratch );
+	}
+
+	for( i = 0, rows = 0; i < tot; i++ ) {
+		request = server->pending + i;
+		if( server->status[ i ] != 0 || request->slot != slot ) {
+			continue;
+		}
+		memcpy( server->classes + server->offsets[ i ], server->scratch + rows, sizeof( long ) * request->rows );
+		rows += request->rows;
+	}
+
+	return 0;
+}
+
+/*
+	score a batch of the first pending requests, as many as max_batch rows ( at least one
+	request ), and append their replies in order; versions of models are held while they
+	score. Latency of each request is counted once its reply is ready
+	returns 0 or -4 on memory error
+*/
+static int server_batch( id3_server_t *server )
+{
+	version_t			*versions[ ID3_SERVER_SLOTS ];
+	const request_t		*request		= NULL;
+	client_t			*client			= NULL;
+	id3_server_stats_t	stats;
+	long				tot				= 0;
+	long				rows			= 0;
+	long				scored			= 0;
+	long				errors			= 0;
+	long				max_requests	= server->max_requests;
+	long				max_rows		= server->max_rows;
+	long				max_scratch		= server->max_rows;
+	long				slot, bucket, i, k;
+	double				now, micros;
+	int					result			= 0;
+
+	for( tot = 0; tot < server->tot_pending; tot++ ) {
+		if( tot > 0 && rows + server->pending[ tot ].rows > server->max_batch ) {
+			break;
+		}
+		rows += server->pending[ tot ].rows;
+	}
+	// arrays sharing a size grow together, the last one records it
+	if( server_grow( ( void** )&server->offsets, &max_requests, tot, sizeof( long ) ) != 0 ||
+		server_grow( ( void** )&server->status, &server->max_requests, tot, sizeof( int32_t ) ) != 0 ) {
+		return -4;
+	}
+
+	// every slot of batch serves with its version at start of batch; a request too short
+	// for a NUL terminated value per attribute of its rows is rejected before any scratch
+	// grows for its rows
+	memset( versions, 0, sizeof( versions ) );
+	pthread_mutex_lock( &server->lock );
+	for( i = 0; i < tot; i++ ) {
+		request					= server->pending + i;
+		server->offsets[ i ]	= scored;
+		server->status[ i ]		= 0;
+		if( request->operation == ID3_SERVER_STATS ) {
+			continue;
+		}
+		if( request->operation != ID3_SERVER_PREDICT || request->slot >= ID3_SERVER_SLOTS || server->slots[ request->slot ] == NULL ||
+			request->rows * ( server->slots[ request->slot ]->model->cols - 1 ) > ( long )request->size ) {
+			server->status[ i ] = -1;
+			continue;
+		}
+		scored += request->rows;
+		if( versions[ request->slot ] == NULL ) {
+			versions[ request->slot ]	= server->slots[ request->slot ];
+			versions[ request->slot ]->refs	+= 1;
+		}
+	}
+	pthread_mutex_unlock( &server->lock );
+
+	// versions are held now, requests of a batch whose scratch does not fit fail alone
+	if( server_grow( ( void** )&server->classes, &max_rows, scored, sizeof( long ) ) != 0 ||
+		server_grow( ( void** )&server->scratch, &max_scratch, scored, sizeof( long ) ) != 0 ||
+		server_grow( ( void** )&server->replies, &server->max_rows, scored, sizeof( int32_t ) ) != 0 ) {
+		for( i = 0; i < tot; i++ ) {
+			if( server->status[ i ] == 0 && server->pending[ i ].operation == ID3_SERVER_PREDICT ) {
+				server->status[ i ] = -4;
+			}
+		}
+	}
+
+	for( slot = 0; slot < ID3_SERVER_SLOTS; slot++ ) {
+		if( versions[ slot ] != NULL && server_score( server, versions[ slot ], slot, tot ) != 0 ) {
+			for( i = 0; i < tot; i++ ) {
+				if( server->pending[ i ].slot == slot && server->status[ i ] == 0 ) {
+					server->status[ i ] = -4;
+				}
+			}
+		}
+	}
+
+	// replies in order of requests
+	for( i = 0; result == 0 && i < tot; i++ ) {
+		request	= server->pending + i;
+		client	= server->clients + request->client;
+		errors	+= ( server->status[ i ] != 0 );
+		if( server->status[ i ] != 0 ) {
+			result = server_reply( client, request->id, server->status[ i ], 0, NULL, 0 );
+		} else if( request->operation == ID3_SERVER_STATS ) {
+			id3_server_stats( server, &stats );
+			result = server_reply( client, request->id, 0, 0, &stats, sizeof( id3_server_stats_t ) );
+		} else {
+			for( k = 0; k < request->rows; k++ ) {
+				server->replies[ k ] = ( int32_t )server->classes[ server->offsets[ i ] + k ];
+			}
+			result = server_reply( client, request->id, 0, versions[ request->slot ]->version, server->replies, sizeof( int32_t ) * request->rows );
+		}
+	}
+
+	now = stats_wall();
+	pthread_mutex_lock( &server->lock );
+	server->batches		+= 1;
+	server->requests	+= tot;
+	server->rows		+= rows;
+	server->errors		+= errors;
+	for( i = 0; i < tot; i++ ) {
+		micros = ( now - server->pending[ i ].received ) * 1e6;
+		bucket = ( micros <= 1 ) ? 0 : ( long )ceil( SERVER_BUCKET_STEPS * log2( micros ) );
+		server->histogram[ bucket < SERVER_BUCKETS ? bucket : SERVER_BUCKETS - 1 ] += 1;
+	}
+	pthread_mutex_unlock( &server->lock );
+	for( slot = 0; slot < ID3_SERVER_SLOTS; slot++ ) {
+		version_release( server, versions[ slot ] );
+	}
+
+	// requests leave queue, inputs of clients drop requests replied: requests of a client
+	// are replied in order, its first request still queued starts what is kept
+	for( i = 0; i < tot; i++ ) {
+		server->clients[ server->pending[ i ].client ].queued -= 1;
+	}
+	server->tot_pending		-= tot;
+	server->pending_rows	-= rows;
+	memmove( server->pending, server->pending + tot, sizeof( request_t ) * server->tot_pending );
+	for( i = 0; i < server->tot_clients; i++ ) {
+		server->clients[ i ].answered = server->clients[ i ].parsed;
+	}
+	for( i = server->tot_pending - 1; i >= 0; i-- ) {
+		server->clients[ server->pending[ i ].client ].answered = server->pending[ i ].values - SERVER_REQUEST;
+	}
+	for( i = 0; i < server->tot_pending; i++ ) {
+		server->pending[ i ].values -= server->clients[ server->pending[ i ].client ].answered;
+	}
+	for( i = 0; i < server->tot_clients; i++ ) {
+		client = server->clients + i;
+		if( client->answered > 0 ) {
+			memmove( client->in, client->in + client->answered, client->in_size - client->answered );
+			client->in_size	-= client->answered;
+			client->parsed	-= client->answered;
+		}
+	}
+	server_trim( server );
+
+	return result;
+}
+
+/*
+	drop clients that went away once their requests are replied, or whose socket failed
+	once their requests left queue
+*/
+static void server_prune( id3_server_t *server )
+{
+	client_t			*client			= NULL;
+	long				*moved			= NULL;
+	long				kept			= 0;
+	long				dropped			= 0;
+	long				i;
+
+	for( i = 0; i < server->tot_clients; i++ ) {
+		client = server->clients + i;
+		if( client->queued == 0 && ( client->broken || ( client->closing && client->out_size == 0 ) ) ) {
+			dropped += 1;
+		}
+	}
+	if( dropped == 0 || ( moved = malloc( sizeof( long ) * server->tot_clients ) ) == NULL ) {
+		return;
+	}
+	// clients keep their order, pending requests follow them
+	for( i = 0; i < server->tot_clients; i++ ) {
+		client = server->clients + i;
+		if( client->queued == 0 && ( client->broken || ( client->closing && client->out_size == 0 ) ) ) {
+			close( client->fd );
+			free( client->in );
+			free( client->out );
+			moved[ i ] = -1;
+			continue;
+		}
+		moved[ i ]					= kept;
+		server->clients[ kept++ ]	= *client;
+	}
+	for( i = 0; i < server->tot_pending; i++ ) {
+		server->pending[ i ].client = moved[ server->pending[ i ].client ];
+	}
+	server->tot_clients = kept;
+	free( moved );
+
+	pthread_mutex_lock( &server->lock );
+	server->connected -= dropped;
+	pthread_mutex_unlock( &server->lock );
+}
+
+/*
+	serve requests: a poll waits for clients, requests queue up until a batch is ready
+	( at once if batch_wait is 0, else when oldest request waited that long or max_batch
+	rows are queued ) and replies are sent as sockets take them
+*/
+int id3_server_run( id3_server_t *server )
+{
+	struct pollfd		*fds			= NULL;
+	long				max_fds			= 0;
+	long				tot_polled		= 0;
+	double				waited			= 0;
+	int					timeout			= -1;
+	char				drain[ 64 ];
+	long				i;
+	int					result			= 0;
+
+	while( result == 0 && !__atomic_load_n( &server->stop, __ATOMIC_RELAXED ) ) {
+		if( server_grow( ( void** )&fds, &max_fds, server->tot_clients + 2, sizeof( struct pollfd ) ) != 0 ) {
+			result = -4;
+			break;
+		}
+		fds[ 0 ].fd		= server->wake[ 0 ];
+		fds[ 0 ].events	= POLLIN;
+		fds[ 1 ].fd		= server->listener;
+		fds[ 1 ].events	= POLLIN;
+		for( i = 0; i < server->tot_clients; i++ ) {
+			fds[ i + 2 ].fd		= server->clients[ i ].fd;
+			fds[ i + 2 ].events	= server_readable( server->clients + i ) ? POLLIN : 0;
+			if( server->clients[ i ].out_size > 0 && !server->clients[ i ].broken ) {
+				fds[ i + 2 ].events |= POLLOUT;
+			}
+			// a client that hung up would wake poll at once
+			if( fds[ i + 2 ].events == 0 ) {
+				fds[ i + 2 ].fd = -1;
+			}
+		}
+		tot_polled = server->tot_clients;
+
+		// a queued request waits for the rest of batch_wait
+		timeout = -1;
+		if( server->tot_pending > 0 ) {
+			waited	= ( stats_wall() - server->pending[ 0 ].received ) * 1000;
+			timeout	= ( server->pending_rows >= server->max_batch || waited >= server->batch_wait ) ? 0 :
+					  ( int )ceil( server->batch_wait - waited );
+		}
+		if( poll( fds, tot_polled + 2, timeout ) < 0 && errno != EINTR ) {
+			result = -2;
+			break;
+		}
+		if( fds[ 0 ].revents ) {
+			while( read( server->wake[ 0 ], drain, sizeof( drain ) ) > 0 );
+		}
+		for( i = 0; result == 0 && i < tot_polled; i++ ) {
+			if( ( fds[ i + 2 ].events & POLLIN ) && ( fds[ i + 2 ].revents & ( POLLIN | POLLHUP | POLLERR ) ) ) {
+				result = server_read( server, i );
+			}
+		}
+		if( result == 0 && ( fds[ 1 ].revents & POLLIN ) ) {
+			result = server_accept( server );
+		}
+
+		while( result == 0 && server->tot_pending > 0 ) {
+			waited = ( stats_wall() - server->pending[ 0 ].received ) * 1000;
+			if( server->pending_rows < server->max_batch && waited < server->batch_wait ) {
+				break;
+			}
+			result = server_batch( server );
+		}
+		// requests held back while their client had too many queued
+		for( i = 0; result == 0 && i < server->tot_clients; i++ ) {
+			result = server_parse( server, i );
+		}
+		for( i = 0; i < server->tot_clients; i++ ) {
+			if( server->clients[ i ].out_size > 0 && !server->clients[ i ].broken ) {
+				server_flush( server->clients + i );
+			}
+		}
+		server_prune( server );
+	}
+	free( fds );
+
+	return result;
+}
+
+/*
+	close a server and release its models
+*/
+void id3_server_destroy( id3_server_t *server )
+{
+	long				i;
+
+	if( server == NULL ) {
+		return;
+	}
+	for( i = 0; i < server->tot_clients; i++ ) {
+		close( server->clients[ i ].fd );
+		free( server->clients[ i ].in );
+		free( server->clients[ i ].out );
+	}
+	if( server->listener >= 0 ) {
+		close( server->listener );
+		unlink( server->path );
+	}
+	for( i = 0; i < 2; i++ ) {
+		if( server->wake[ i ] >= 0 ) {
+			close( server->wake[ i ] );
+		}
+	}
+	for( i = 0; i < ID3_SERVER_SLOTS; i++ ) {
+		version_release( server, server->slots[ i ] );
+	}
+	pthread_mutex_destroy( &server->lock );
+	free( server->clients );
+	free( server->pending );
+	free( server->strings );
+	free( server->classes );
+	free( server->scratch );
+	free( server->replies );
+	free( server->codes );
+	free( server->columns );
+	free( server->offsets );
+	free( server->status );
+	free( server->path );
+	free( server );
+}
+
+/*
+	connect to a server
+*/
+int id3_client_connect( const char *path )
+{
+	struct sockaddr_un	addr;
+	int					fd				= -1;
+
+	if( path == NULL || strlen( path ) >= sizeof( addr.sun_path ) ) {
+		return -2;
+	}
+	memset( &addr, 0, sizeof( struct sockaddr_un ) );
+	addr.sun_family = AF_UNIX;
+	strcpy( addr.sun_path, path );
+	if( ( fd = socket( AF_UNIX, SOCK_STREAM, 0 ) ) < 0 ) {
+		return -2;
+	}
+	if( connect( fd, ( struct sockaddr* )&addr, sizeof( struct sockaddr_un ) ) != 0 ) {
+		close( fd );
+		return -2;
+	}
+
+	return fd;
+}
+
+// id of last request sent by a client of this process, replies must carry it
+static uint32_t			client_ids		= 0;
+
+/*
+	move all bytes of a buffer through a socket of client, in either direction
+	returns 0 or -2 on socket error
+*/
+static int client_transfer( int fd, void *data, size_t size, int sending )
+{
+	char				*ptr			= data;
+	ssize_t				done;
+
+	while( size > 0 ) {
+		done = sending ? send( fd, ptr, size, MSG_NOSIGNAL ) : recv( fd, ptr, size, 0 );
+		if( done < 0 && errno == EINTR ) {
+			continue;
+		}
+		if( done <= 0 ) {
+			return -2;
+		}
+		ptr		+= done;
+		size	-= done;
+	}
+
+	return 0;
+}
+
+/*
+	send a request of rows to a server and wait its reply
+*/
+int id3_client_predict( int fd, long slot, char **data, long rows, long attribs, long *classes, long *version )
+{
+	uint32_t			header[ SERVER_REQUEST / sizeof( uint32_t ) ];
+	uint16_t			fields[ 2 ];
+	int32_t				*replies		= NULL;
+	char				*request		= NULL;
+	size_t				size			= SERVER_REQUEST;
+	uint32_t			id				= __atomic_add_fetch( &client_ids, 1, __ATOMIC_RELAXED );
+	size_t				len;
+	long				i;
+	int					result			= 0;
+
+	if( slot < 0 || slot >= ID3_SERVER_SLOTS || rows < 0 || attribs < 1 ) {
+		return -1;
+	}
+	for( i = 0; i < rows * attribs; i++ ) {
+		size += strlen( data[ i ] ) + 1;
+	}
+	if( size > SERVER_MAX_REQUEST ) {
+		return -1;
+	}
+	if( ( request = malloc( size ) ) == NULL || ( replies = malloc( sizeof( int32_t ) * ( rows + 1 ) ) ) == NULL ) {
+		free( request );
+		return -4;
+	}
+
+	do {
+		header[ 0 ]	= size - sizeof( uint32_t );
+		header[ 1 ]	= id;
+		fields[ 0 ]	= ID3_SERVER_PREDICT;
+		fields[ 1 ]	= slot;
+		memcpy( header + 2, fields, sizeof( fields ) );
+		header[ 3 ]	= rows;
+		memcpy( request, header, SERVER_REQUEST );
+		for( i = 0, size = SERVER_REQUEST; i < rows * attribs; i++ ) {
+			len = strlen( data[ i ] ) + 1;
+			memcpy( request + size, data[ i ], len );
+			size += len;
+		}
+		if( client_transfer( fd, request, size, 1 ) != 0 || client_transfer( fd, header, SERVER_REPLY, 0 ) != 0 ) {
+			result = -2;
+			break;
+		}
+		// a refused request has no classes, a reply of another request or of another
+		// length leaves the stream at an unknown place
+		if( header[ 1 ] != id || header[ 0 ] != SERVER_REPLY - sizeof( uint32_t ) + ( ( int32_t )header[ 2 ] == 0 ? sizeof( int32_t ) * rows : 0 ) ) {
+			result = -2;
+			break;
+		}
+		if( ( int32_t )header[ 2 ] != 0 ) {
+			result = ( ( int32_t )header[ 2 ] == -4 ) ? -4 : -1;
+			break;
+		}
+		if( client_transfer( fd, replies, sizeof( int32_t ) * rows, 0 ) != 0 ) {
+			result = -2;
+			break;
+		}
+		for( i = 0; i < rows; i++ ) {
+			classes[ i ] = replies[ i ];
+		}
+		if( version != NULL ) {
+			*version = header[ 3 ];
+		}
+	} while( 0 );
+	free( request );
+	free( replies );
+
+	return result;
+}
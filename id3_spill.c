@@ -0,0 +1,1368 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	out-of-core training: while a text file is encoded the codes of each column are written
+	to a temporary file, then the tree grows one level at a time. A pass over the column
+	files fills count tables of every node of a level at once ( as many as the memory
+	budget holds, more passes otherwise ), the only state of a row being the node it has
+	reached, so memory does not depend on the number of rows. A node whose rows fit the
+	budget has them gathered by the pass instead, and its whole subtree is built in memory
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+	#include <unistd.h>
+#endif
+
+#include "id3.h"
+#include "id3_int.h"
+
+// rows of codes moved to and from temporary files at a time, at most
+#define	SPILL_MAX_CHUNK		65536
+#define	SPILL_MIN_CHUNK		1024
+
+/*
+	node of the level being grown
+*/
+typedef struct snode_tag {
+	node_t				*node;
+	long				*counts;		// count tables while node is counted by a pass, else NULL
+	uint32_t			*rows;			// codes of rows of node column by column while a pass
+										// gathers them, else NULL
+	long				gathered;		// rows gathered so far
+	long				first_class;	// class of first row of node, -1 until a pass finds it
+	long				child;			// first child into next level, -1 if node has none there
+	int					open;			// node must be counted to choose its split
+} snode_t;
+
+/*
+	nodes of a level, available attributes of node k are avail[ k * attributes ]
+*/
+typedef struct level_tag {
+	snode_t				*nodes;
+	char				*avail;
+	long				tot_nodes;
+	long				max_nodes;
+} level_t;
+
+/*
+	state of a tree growing level by level
+*/
+typedef struct grow_tag {
+	spill_t				*spill;
+	tree_t				*tree;
+	const id3_params_t	*params;
+	const double *const	*numbers;		// code -> number of numeric attributes, NULL if none is
+	long				**order;		// codes of each numeric attribute by increasing number
+	long				tot_attrib;
+	long				tot_classes;
+	long				*voffset;		// first cell of each attribute into count tables of a node,
+										// class counts come first
+	level_t				levels[ 3 ];	// levels of rows being moved, of nodes counted and of children
+	int32_t				*assign;		// node of each row into level, -1 once row reached a
+										// terminal node; a chunk of rows if it is kept in a file
+	FILE				*assign_fp;		// node of each row, NULL if it is kept in memory
+	long				*block;			// count tables and gathered rows of nodes of a pass
+	void				**columns;		// columns of rows gathered for a node
+	long				*totals;		// samples of each value of an attribute
+	long				*present;		// values with samples, in increasing order
+	long				*sides;			// class counts of both sides of a threshold
+	long				*best_left;		// class counts of left side of best threshold
+	long				*attribs;		// attributes available at a node
+	char				*avail;			// attributes available to children of a node
+	double				*gains;			// info gain of each attribute
+	long				*thresholds;	// best threshold of each numeric attribute, -1 if none; 0 for
+										// a categorical one, -1 if a child gets less than min_leaf rows
+	long				depth;			// depth of nodes being counted
+	id3_stats_t			stats;
+} grow_t;
+
+/*
+	temporary file, it is removed from directory at once and disappears when closed
+*/
+static FILE *spill_file( const spill_t *spill )
+{
+#ifndef _WIN32
+	char				*path			= NULL;
+	FILE				*fp				= NULL;
+	int					fd;
+
+	if( ( path = malloc( strlen( spill->dir ) + 16 ) ) == NULL ) {
+		return NULL;
+	}
+	sprintf( path, "%s/id3_XXXXXX", spill->dir );
+	if( ( fd = mkstemp( path ) ) >= 0 ) {
+		unlink( path );
+		if( ( fp = fdopen( fd, "w+b" ) ) == NULL ) {
+			close( fd );
+		}
+	}
+	free( path );
+
+	return fp;
+#else
+	( void )spill;
+	return tmpfile();
+#endif
+}
+
+/*
+	widen codes of a buffer in place, from last to first
+*/
+static void spill_widen_codes( void *codes, int from, int to, long tot )
+{
+	uint32_t			code;
+	long				i;
+
+	for( i = tot - 1; i >= 0; i-- ) {
+		code = ( from == 1 ) ? ( ( uint8_t* )codes )[ i ] : ( from == 2 ) ? ( ( uint16_t* )codes )[ i ] : ( ( uint32_t* )codes )[ i ];
+		if( to == 2 ) {
+			( ( uint16_t* )codes )[ i ] = code;
+		} else {
+			( ( uint32_t* )codes )[ i ] = code;
+		}
+	}
+}
+
+/*
+	narrow 32 bit codes of a buffer in place, from first to last
+*/
+static void spill_narrow_codes( uint32_t *codes, int to, long tot )
+{
+	long				i;
+
+	for( i = 0; to < 4 && i < tot; i++ ) {
+		if( to == 1 ) {
+			( ( uint8_t* )codes )[ i ] = codes[ i ];
+		} else {
+			( ( uint16_t* )codes )[ i ] = codes[ i ];
+		}
+	}
+}
+
+/*
+	write buffered codes of every column at the width of its file
+	returns 0 or -2 on write error
+*/
+static int spill_flush( spill_t *spill )
+{
+	uint32_t			*codes			= NULL;
+	long				col;
+
+	for( col = 0; col < spill->ds.cols; col++ ) {
+		codes = spill->codes + col * spill->chunk;
+		spill_narrow_codes( codes, spill->ds.widths[ col ], spill->buffered );
+		if( fwrite( codes, spill->ds.widths[ col ], spill->buffered, spill->files[ col ] ) != ( size_t )spill->buffered ) {
+			spill->io_error = 1;
+			return -2;
+		}
+	}
+	spill->buffered = 0;
+
+	return 0;
+}
+
+/*
+	rewrite file of a column with wider codes as soon as its catalog does not fit, codes
+	of all columns must have been written
+	returns 0 or -2 on write error
+*/
+static int spill_widen( spill_t *spill, long col, int width )
+{
+	FILE				*fp				= NULL;
+	size_t				tot;
+
+	if( ( fp = spill_file( spill ) ) == NULL ) {
+		spill->io_error = 1;
+		return -2;
+	}
+	rewind( spill->files[ col ] );
+	while( ( tot = fread( spill->codes, spill->ds.widths[ col ], spill->chunk, spill->files[ col ] ) ) > 0 ) {
+		spill_widen_codes( spill->codes, spill->ds.widths[ col ], width, tot );
+		if( fwrite( spill->codes, width, tot, fp ) != tot ) {
+			break;
+		}
+	}
+	if( ferror( spill->files[ col ] ) || ferror( fp ) ) {
+		fclose( fp );
+		spill->io_error = 1;
+		return -2;
+	}
+	fclose( spill->files[ col ] );
+	spill->files[ col ]			= fp;
+	spill->ds.widths[ col ]		= width;
+
+	return 0;
+}
+
+/*
+	column names and catalogs of a file being spilled, column files are created and rows
+	are buffered in chunks taking a quarter of memory budget
+	returns 0, -2 if a temporary file cannot be created or -4 on memory error
+*/
+static int spill_header( void *arg, const field_t *names, long cols, long max_rows )
+{
+	spill_t				*spill			= arg;
+	size_t				names_sz		= 0;
+	char				*nameptr		= NULL;
+	long				col;
+
+	( void )max_rows;
+	for( col = 0; col < cols; col++ ) {
+		names_sz += names[ col ].len + 1;
+	}
+	if( ( spill->column_names = malloc( sizeof( char* ) * cols + names_sz ) ) == NULL ) {
+		return -4;
+	}
+	nameptr = ( char* )( spill->column_names + cols );
+	for( col = 0; col < cols; col++ ) {
+		spill->column_names[ col ] = nameptr;
+		memcpy( nameptr, names[ col ].ptr, names[ col ].len );
+		nameptr[ names[ col ].len ] = '\0';
+		nameptr += names[ col ].len + 1;
+	}
+
+	spill->chunk = spill->memory / 4 / ( sizeof( uint32_t ) * cols );
+	if( spill->chunk > SPILL_MAX_CHUNK ) {
+		spill->chunk = SPILL_MAX_CHUNK;
+	}
+	if( spill->chunk < SPILL_MIN_CHUNK ) {
+		spill->chunk = SPILL_MIN_CHUNK;
+	}
+	spill->ds.cols	= cols;
+	spill->ds.dicts	= calloc( cols, sizeof( dict_t ) );
+	spill->ds.widths	= calloc( cols, sizeof( int ) );
+	spill->files	= calloc( cols, sizeof( FILE* ) );
+	spill->codes	= malloc( sizeof( uint32_t ) * cols * spill->chunk );
+	spill->row		= malloc( sizeof( uint32_t ) * cols );
+	if( spill->ds.dicts == NULL || spill->ds.widths == NULL || spill->files == NULL || spill->codes == NULL ||
+		spill->row == NULL ) {
+		return -4;
+	}
+	for( col = 0; col < cols; col++ ) {
+		if( dict_init( spill->ds.dicts + col ) != 0 ) {
+			return -4;
+		}
+		spill->ds.widths[ col ] = 1;
+		if( ( spill->files[ col ] = spill_file( spill ) ) == NULL ) {
+			spill->io_error = 1;
+			return -2;
+		}
+	}
+
+	return 0;
+}
+
+/*
+	encode a sample into buffered codes; a column whose catalog outgrows its code width
+	is rewritten wider, after buffered rows are written
+	returns 0, -2 on write error or -4 on memory error
+*/
+static int spill_sample( void *arg, const field_t *fields, long cols )
+{
+	spill_t				*spill			= arg;
+	long				code, col;
+	int					width;
+
+	for( col = 0; col < cols; col++ ) {
+		if( ( code = dict_intern( spill->ds.dicts + col, fields[ col ].ptr, fields[ col ].len ) ) < 0 ) {
+			return -4;
+		}
+		spill->row[ col ] = code;
+	}
+	for( col = 0; col < cols; col++ ) {
+		width = ( spill->row[ col ] > UINT16_MAX ) ? 4 : ( spill->row[ col ] > UINT8_MAX ) ? 2 : 1;
+		if( width > spill->ds.widths[ col ] && ( spill_flush( spill ) != 0 || spill_widen( spill, col, width ) != 0 ) ) {
+			return -2;
+		}
+	}
+	for( col = 0; col < cols; col++ ) {
+		spill->codes[ col * spill->chunk + spill->buffered ] = spill->row[ col ];
+	}
+	spill->ds.rows	+= 1;
+	spill->buffered	+= 1;
+	if( spill->buffered == spill->chunk ) {
+		return spill_flush( spill );
+	}
+
+	return 0;
+}
+
+/*
+	share memory budget once catalogs are known: a quarter goes to chunks of codes, the
+	node of each row stays in memory if it takes at most half of it ( else it is kept in
+	a file and read by chunks ), a pass takes the rest. A gathered row costs its codes
+	and what training of its subtree allocates for it ( sample buffers, sorted lists of
+	numeric attributes, bits of small catalogs )
+	- numeric:	flag of each column, NULL if no column is numeric
+	returns 0 or -1 if budget cannot hold count tables of a single node
+*/
+static int spill_plan( spill_t *spill, const char *numeric )
+{
+	const dataset_t		*ds				= &spill->ds;
+	long				tot_classes		= DS_VALUES( ds, ds->cols - 1 );
+	size_t				fixed			= sizeof( uint32_t ) * ds->cols * spill->chunk;
+	long				max_values		= 2;
+	long				col;
+
+	spill->row_bytes = ( sizeof( uint32_t ) + 2 ) * ds->cols + 2 * sizeof( long ) + tot_classes / 8 + 1;
+
+	// a dataset without rows still has a cell, so that a batch is never empty
+	spill->tot_cells = tot_classes > 0 ? tot_classes : 1;
+	for( col = 0; col < ds->cols - 1; col++ ) {
+		spill->tot_cells += DS_VALUES( ds, col ) * tot_classes;
+		if( DS_VALUES( ds, col ) > max_values ) {
+			max_values = DS_VALUES( ds, col );
+		}
+		if( numeric != NULL && numeric[ col ] ) {
+			fixed				+= sizeof( long ) * DS_VALUES( ds, col );
+			spill->row_bytes	+= sizeof( long ) + sizeof( uint32_t );
+		}
+	}
+	// scratch of split choice, count tables of training a gathered subtree
+	fixed += sizeof( long ) * ( 2 * max_values + 4 * tot_classes + 3 * ds->cols ) + ( sizeof( double ) + 1 ) * ds->cols;
+	fixed += sizeof( long ) * 2 * spill->tot_cells + sizeof( void* ) * ds->cols;
+
+	// rows of workers keep their own nodes
+	if( spill->dist == NULL ) {
+		spill->assign_file = ( sizeof( int32_t ) * ( size_t )ds->rows > spill->memory / 2 );
+		fixed += sizeof( int32_t ) * ( spill->assign_file ? spill->chunk : ds->rows );
+	}
+
+	if( fixed + sizeof( long ) * spill->tot_cells > spill->memory ) {
+		return -1;
+	}
+	spill->fixed		= fixed;
+	spill->batch_bytes	= spill->memory - fixed;
+
+	return 0;
+}
+
+/*
+	encode a delimited text file into temporary files of codes, one for each column;
+	temporary files go to spill_dir of params, TMPDIR or /tmp
+	returns 0, -1 on wrong parameters ( memory budget too small ), -2 if file cannot be
+	read or temporary files cannot be written, -3 on malformed file or -4 on memory error;
+	spill must be released by spill_free anyway
+*/
+int spill_create( spill_t *spill, const char *path, char delim, long class_col, const id3_params_t *params )
+{
+	csv_sink_t			sink;
+	const char			*dir			= params->spill_dir;
+	int					result			= 0;
+
+	memset( spill, 0, sizeof( spill_t ) );
+	spill->memory = params->memory;
+	if( dir == NULL && ( dir = getenv( "TMPDIR" ) ) == NULL ) {
+		dir = "/tmp";
+	}
+	if( ( spill->dir = malloc( strlen( dir ) + 1 ) ) == NULL ) {
+		return -4;
+	}
+	strcpy( spill->dir, dir );
+
+	sink.header	= spill_header;
+	sink.sample	= spill_sample;
+	sink.arg	= spill;
+	sink.count	= 0;
+	if( ( result = csv_read( path, delim, class_col, &sink ) ) != 0 ) {
+		return result;
+	}
+	if( spill->buffered > 0 && spill_flush( spill ) != 0 ) {
+		return -2;
+	}
+
+	return spill_plan( spill, params->numeric );
+}
+
+/*
+	connect to workers holding shards of a dataset for distributed training: spill gets
+	their merged catalogs, rows stay with workers ( see id3_dist.c )
+	returns 0, -1 on wrong parameters ( an address is wrong or memory budget is too
+	small ), -2 if a worker cannot be reached, -3 if a worker sends a malformed message or shards have different
+	columns or -4 on memory error; spill must be released by spill_free anyway
+*/
+int spill_connect( spill_t *spill, const char *const *addresses, long tot_workers, const id3_params_t *params )
+{
+	int					result			= 0;
+
+	memset( spill, 0, sizeof( spill_t ) );
+	spill->memory = params->memory;
+	if( ( result = dist_connect( &spill->dist, &spill->ds, &spill->column_names, addresses, tot_workers, params->numeric ) ) != 0 ) {
+		return result;
+	}
+
+	return spill_plan( spill, params->numeric );
+}
+
+/*
+	release temporary files and catalogs left to spill
+*/
+void spill_free( spill_t *spill )
+{
+	long				col;
+
+	for( col = 0; spill->files != NULL && col < spill->ds.cols; col++ ) {
+		if( spill->files[ col ] != NULL ) {
+			fclose( spill->files[ col ] );
+		}
+	}
+	dist_close( spill->dist );
+	dataset_free( &spill->ds );
+	free( spill->files );
+	free( spill->codes );
+	free( spill->row );
+	free( spill->column_names );
+	free( spill->dir );
+	memset( spill, 0, sizeof( spill_t ) );
+}
+
+/*
+	numbers of a numeric attribute in increasing order, ties by code
+*/
+typedef struct number_tag {
+	double				value;
+	long				code;
+} number_t;
+
+/*
+	compare two numbers for qsort
+*/
+static int cmp_number( const void *a, const void *b )
+{
+	const number_t		*x = a;
+	const number_t		*y = b;
+
+	if( x->value != y->value ) {
+		return ( x->value > y->value ) - ( x->value < y->value );
+	}
+	return ( x->code > y->code ) - ( x->code < y->code );
+}
+
+/*
+	codes of each numeric attribute sorted by number, threshold search walks count tables
+	in this order as training walks samples sorted by value
+	returns 0 or -1 on memory error
+*/
+static int grow_order( grow_t *grow )
+{
+	const dataset_t		*ds				= &grow->spill->ds;
+	number_t			*order			= NULL;
+	long				col, code;
+
+	if( ( grow->order = calloc( ds->cols, sizeof( long* ) ) ) == NULL ) {
+		return -1;
+	}
+	for( col = 0; grow->numbers != NULL && col < grow->tot_attrib; col++ ) {
+		if( grow->numbers[ col ] == NULL ) {
+			continue;
+		}
+		order				= malloc( sizeof( number_t ) * ( DS_VALUES( ds, col ) + 1 ) );
+		grow->order[ col ]	= malloc( sizeof( long ) * ( DS_VALUES( ds, col ) + 1 ) );
+		if( order == NULL || grow->order[ col ] == NULL ) {
+			free( order );
+			return -1;
+		}
+		for( code = 0; code < DS_VALUES( ds, col ); code++ ) {
+			order[ code ].value	= grow->numbers[ col ][ code ];
+			order[ code ].code	= code;
+		}
+		qsort( order, DS_VALUES( ds, col ), sizeof( number_t ), cmp_number );
+		for( code = 0; code < DS_VALUES( ds, col ); code++ ) {
+			grow->order[ col ][ code ] = order[ code ].code;
+		}
+		free( order );
+	}
+
+	return 0;
+}
+
+/*
+	append a node to a level, available attributes are copied from avail
+	returns index of node or -1 on memory error
+*/
+static long level_add( level_t *level, long tot_attrib, node_t *node, const char *avail, int open )
+{
+	void				*ptr			= NULL;
+	long				max_nodes		= level->max_nodes ? level->max_nodes * 2 : 64;
+
+	if( level->tot_nodes == level->max_nodes ) {
+		if( ( ptr = realloc( level->nodes, sizeof( snode_t ) * max_nodes ) ) == NULL ) {
+			return -1;
+		}
+		level->nodes = ptr;
+		if( ( ptr = realloc( level->avail, tot_attrib * max_nodes + 1 ) ) == NULL ) {
+			return -1;
+		}
+		level->avail		= ptr;
+		level->max_nodes	= max_nodes;
+	}
+	memset( level->nodes + level->tot_nodes, 0, sizeof( snode_t ) );
+	level->nodes[ level->tot_nodes ].node			= node;
+	level->nodes[ level->tot_nodes ].first_class	= -1;
+	level->nodes[ level->tot_nodes ].child			= -1;
+	level->nodes[ level->tot_nodes ].open			= open;
+	memcpy( level->avail + level->tot_nodes * tot_attrib, avail, tot_attrib );
+
+	return level->tot_nodes++;
+}
+
+/*
+	child of a split node taking a code of its attribute, -1 if node has none
+*/
+static long grow_child( const grow_t *grow, const node_t *node, long code )
+{
+	long				low				= 0;
+	long				high			= node->tot_nodes;
+	long				mid;
+
+	if( node->threshold >= 0 ) {
+		return grow->numbers[ node->attrib ][ code ] > grow->numbers[ node->attrib ][ node->threshold ];
+	}
+	while( low < high ) {
+		mid = ( low + high ) / 2;
+		if( node->nodes[ mid ].winvalue < code ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return ( low < node->tot_nodes && node->nodes[ low ].winvalue == code ) ? low : -1;
+}
+
+/*
+	read a chunk of codes of a column, they are widened in place to 32 bits
+	returns 0 or -2 on read error
+*/
+static int grow_read( grow_t *grow, long col, long tot )
+{
+	spill_t				*spill			= grow->spill;
+	uint32_t			*codes			= spill->codes + col * spill->chunk;
+
+	if( fread( codes, spill->ds.widths[ col ], tot, spill->files[ col ] ) != ( size_t )tot ) {
+		spill->io_error = 1;
+		return -2;
+	}
+	if( spill->ds.widths[ col ] < 4 ) {
+		spill_widen_codes( codes, spill->ds.widths[ col ], 4, tot );
+	}
+
+	return 0;
+}
+
+/*
+	a pass run by workers of distributed training over their shards: splits of previous
+	level go with the first pass of a level, so that rows move to their children, then
+	count tables of nodes of batch are summed over workers
+	returns 0, -1 on memory error or -2 if a worker fails
+*/
+static int grow_remote( grow_t *grow, int move )
+{
+	spill_t				*spill			= grow->spill;
+	const level_t		*from			= grow->levels;
+	const level_t		*level			= grow->levels + 1;
+	const snode_t		*snode			= NULL;
+	const node_t		*node			= NULL;
+	dist_pass_t			pass;
+	dist_route_t		*routes			= NULL;
+	int32_t				*values			= NULL;
+	int32_t				*targets		= NULL;
+	char				*counted		= NULL;
+	long				**counts		= NULL;
+	long				*first_class	= NULL;
+	long				tot_counted		= 0;
+	long				i, k;
+	int					result			= 0;
+
+	memset( &pass, 0, sizeof( dist_pass_t ) );
+	pass.move	= move;
+	pass.root	= ( grow->depth == 0 );
+	for( pass.first = 0; pass.first < level->tot_nodes && level->nodes[ pass.first ].counts == NULL; pass.first++ );
+	for( i = level->tot_nodes; i > pass.first && level->nodes[ i - 1 ].counts == NULL; i-- );
+	pass.tot_nodes = i - pass.first;
+
+	do {
+		// children of each split of previous level, a numeric split has two
+		if( move && !pass.root ) {
+			pass.tot_routes = from->tot_nodes;
+			for( i = 0; i < from->tot_nodes; i++ ) {
+				node = from->nodes[ i ].node;
+				if( from->nodes[ i ].child >= 0 ) {
+					pass.tot_values += ( node->threshold >= 0 ) ? 2 : node->tot_nodes;
+				}
+			}
+		}
+		routes		= malloc( sizeof( dist_route_t ) * ( pass.tot_routes + 1 ) );
+		values		= malloc( sizeof( int32_t ) * ( pass.tot_values + 1 ) );
+		targets		= malloc( sizeof( int32_t ) * ( pass.tot_values + 1 ) );
+		counted		= malloc( pass.tot_nodes + 1 );
+		counts		= malloc( sizeof( long* ) * ( pass.tot_nodes + 1 ) );
+		first_class	= malloc( sizeof( long ) * ( pass.tot_nodes + 1 ) );
+		if( routes == NULL || values == NULL || targets == NULL || counted == NULL || counts == NULL || first_class == NULL ) {
+			result = -1;
+			break;
+		}
+		for( i = 0, pass.tot_values = 0; i < pass.tot_routes; i++ ) {
+			snode				= from->nodes + i;
+			node				= snode->node;
+			routes[ i ].attrib	= ( snode->child >= 0 ) ? node->attrib : -1;
+			routes[ i ].first	= pass.tot_values;
+			if( snode->child < 0 ) {
+				routes[ i ].tot_values	= 0;
+				routes[ i ].threshold	= 0;
+				continue;
+			}
+			routes[ i ].tot_values	= ( node->threshold >= 0 ) ? 0 : node->tot_nodes;
+			routes[ i ].threshold	= ( node->threshold >= 0 ) ? grow->numbers[ node->attrib ][ node->threshold ] : 0;
+			for( k = 0; k < ( node->threshold >= 0 ? 2 : node->tot_nodes ); k++ ) {
+				values[ pass.tot_values ]	= node->nodes[ k ].winvalue;
+				targets[ pass.tot_values ]	= level->nodes[ snode->child + k ].open ? snode->child + k : -1;
+				pass.tot_values				+= 1;
+			}
+		}
+		for( i = 0; i < pass.tot_nodes; i++ ) {
+			snode		= level->nodes + pass.first + i;
+			counted[ i ] = ( snode->counts != NULL );
+			if( counted[ i ] ) {
+				counts[ tot_counted++ ] = snode->counts;
+			}
+		}
+		pass.routes		= routes;
+		pass.values		= values;
+		pass.targets	= targets;
+		pass.counted	= counted;
+		pass.avail		= level->avail + pass.first * grow->tot_attrib;
+
+		if( ( result = dist_pass( spill->dist, &pass, counts, first_class ) ) != 0 ) {
+			spill->io_error	= ( result != -4 );
+			result			= ( result == -4 ) ? -1 : -2;
+			break;
+		}
+		for( i = 0, k = 0; i < pass.tot_nodes; i++ ) {
+			if( counted[ i ] ) {
+				level->nodes[ pass.first + i ].first_class = first_class[ k++ ];
+			}
+		}
+		grow->stats.samples_touched += spill->ds.rows * spill->ds.cols;
+	} while( 0 );
+
+	free( routes );
+	free( values );
+	free( targets );
+	free( counted );
+	free( counts );
+	free( first_class );
+
+	return result;
+}
+
+/*
+	a sequential pass over column files: rows first move from nodes of previous level to
+	their children ( move is set by first pass of a level ), then rows of nodes having
+	count tables are counted and those of nodes being gathered are copied
+	returns 0 or -2 on read or write error
+*/
+static int grow_pass( grow_t *grow, int move )
+{
+	spill_t				*spill			= grow->spill;
+	const level_t		*from			= grow->levels;
+	const level_t		*level			= grow->levels + 1;
+	long				tot_classes		= grow->tot_classes;
+	long				tot_attrib		= grow->tot_attrib;
+	const uint32_t		*classes		= spill->codes + tot_attrib * spill->chunk;
+	const snode_t		*snode			= NULL;
+	snode_t				*target			= NULL;
+	int32_t				*assign			= NULL;
+	const char			*avail			= NULL;
+	long				*counts			= NULL;
+	long				first, tot, col, i, j;
+
+	if( spill->dist != NULL ) {
+		return grow_remote( grow, move );
+	}
+	for( col = 0; col < spill->ds.cols; col++ ) {
+		rewind( spill->files[ col ] );
+	}
+	for( first = 0; first < spill->ds.rows; first += spill->chunk ) {
+		tot = ( spill->ds.rows - first < spill->chunk ) ? spill->ds.rows - first : spill->chunk;
+		for( col = 0; col < spill->ds.cols; col++ ) {
+			if( grow_read( grow, col, tot ) != 0 ) {
+				return -2;
+			}
+		}
+
+		// node of each row, every row starts from root
+		assign = grow->assign_fp != NULL ? grow->assign : grow->assign + first;
+		if( grow->assign_fp != NULL && grow->depth > 0 ) {
+			if( fseek( grow->assign_fp, sizeof( int32_t ) * first, SEEK_SET ) != 0 ||
+				fread( assign, sizeof( int32_t ), tot, grow->assign_fp ) != ( size_t )tot ) {
+				spill->io_error = 1;
+				return -2;
+			}
+		}
+		if( move && grow->depth == 0 ) {
+			memset( assign, 0, sizeof( int32_t ) * tot );
+		} else if( move ) {
+			for( i = 0; i < tot; i++ ) {
+				if( assign[ i ] < 0 ) {
+					continue;
+				}
+				snode = from->nodes + assign[ i ];
+				if( snode->child < 0 ) {
+					assign[ i ] = -1;
+					continue;
+				}
+				j			= grow_child( grow, snode->node, spill->codes[ snode->node->attrib * spill->chunk + i ] );
+				assign[ i ]	= ( j >= 0 && level->nodes[ snode->child + j ].open ) ? snode->child + j : -1;
+			}
+		}
+
+		for( i = 0; i < tot; i++ ) {
+			if( assign[ i ] < 0 ) {
+				continue;
+			}
+			target = level->nodes + assign[ i ];
+			if( target->rows != NULL ) {
+				for( col = 0; col < spill->ds.cols; col++ ) {
+					target->rows[ col * target->node->tot_samples + target->gathered ] = spill->codes[ col * spill->chunk + i ];
+				}
+				target->gathered += 1;
+				continue;
+			}
+			if( ( counts = target->counts ) == NULL ) {
+				continue;
+			}
+			if( target->first_class < 0 ) {
+				target->first_class = classes[ i ];
+			}
+			counts[ classes[ i ] ] += 1;
+			avail = level->avail + assign[ i ] * tot_attrib;
+			for( col = 0; col < tot_attrib; col++ ) {
+				if( avail[ col ] ) {
+					counts[ grow->voffset[ col ] + spill->codes[ col * spill->chunk + i ] * tot_classes + classes[ i ] ] += 1;
+				}
+			}
+		}
+
+		if( grow->assign_fp != NULL && move ) {
+			if( fseek( grow->assign_fp, sizeof( int32_t ) * first, SEEK_SET ) != 0 ||
+				fwrite( assign, sizeof( int32_t ), tot, grow->assign_fp ) != ( size_t )tot ) {
+				spill->io_error = 1;
+				return -2;
+			}
+		}
+		grow->stats.samples_touched += tot * spill->ds.cols;
+	}
+
+	return 0;
+}
+
+/*
+	threshold search of a numeric attribute from its count table: codes are walked by
+	increasing number moving their samples to left side, every change of number after
+	some samples is a candidate as every change of value of sorted samples is in training
+	( if both sides get min_leaf samples ). Lowest threshold wins ties, class counts of its
+	left side are left in best_left
+	returns info gain of best threshold ( without entropy of set ), thresholds[ attrib ] is
+	-1 if there is none
+*/
+static double grow_threshold( grow_t *grow, const long *counts, long attrib, long tot_samples )
+{
+	const double		*numbers		= grow->numbers[ attrib ];
+	const long			*order			= grow->order[ attrib ];
+	const long			*table			= counts + grow->voffset[ attrib ];
+	long				tot_classes		= grow->tot_classes;
+	long				*sides			= grow->sides;
+	long				present[ 2 ]	= { 0, 1 };
+	long				totals[ 2 ];
+	double				max_gain		= 0;
+	double				gain			= 0;
+	long				best			= -1;
+	long				last			= -1;
+	long				left			= 0;
+	long				min_leaf		= grow->params->min_leaf;
+	long				total, code, i, k;
+
+	memset( sides, 0, sizeof( long ) * tot_classes );
+	for( i = 0; i < DS_VALUES( &grow->spill->ds, attrib ); i++ ) {
+		code = order[ i ];
+		for( total = 0, k = 0; k < tot_classes; k++ ) {
+			total += table[ code * tot_classes + k ];
+		}
+		if( total == 0 ) {
+			continue;
+		}
+		if( last >= 0 && numbers[ code ] != numbers[ last ] && left >= min_leaf && tot_samples - left >= min_leaf ) {
+			totals[ 0 ] = left;
+			totals[ 1 ] = tot_samples - left;
+			for( k = 0; k < tot_classes; k++ ) {
+				sides[ tot_classes + k ] = counts[ k ] - sides[ k ];
+			}
+			gain = calc_counts_gain( sides, totals, present, 2, tot_classes, tot_samples );
+			if( best < 0 || gain > max_gain ) {
+				max_gain	= gain;
+				best		= last;
+				memcpy( grow->best_left, sides, sizeof( long ) * tot_classes );
+			}
+		}
+		for( k = 0; k < tot_classes; k++ ) {
+			sides[ k ] += table[ code * tot_classes + k ];
+		}
+		left	+= total;
+		last	= code;
+	}
+	grow->thresholds[ attrib ] = best;
+
+	return max_gain;
+}
+
+/*
+	info gain of a categorical attribute from its count table, values in code order;
+	thresholds[ attrib ] is -1 if a value has less than min_leaf samples
+*/
+static double grow_gain( grow_t *grow, const long *counts, long attrib, long tot_samples )
+{
+	const long			*table			= counts + grow->voffset[ attrib ];
+	long				tot_classes		= grow->tot_classes;
+	long				tot_present		= 0;
+	long				value, k;
+
+	grow->thresholds[ attrib ] = 0;
+	for( value = 0; value < DS_VALUES( &grow->spill->ds, attrib ); value++ ) {
+		grow->totals[ value ] = 0;
+		for( k = 0; k < tot_classes; k++ ) {
+			grow->totals[ value ] += table[ value * tot_classes + k ];
+		}
+		if( grow->totals[ value ] > 0 ) {
+			grow->present[ tot_present++ ] = value;
+		}
+		if( grow->totals[ value ] > 0 && grow->totals[ value ] < grow->params->min_leaf ) {
+			grow->thresholds[ attrib ] = -1;
+		}
+	}
+
+	return calc_counts_gain( table, grow->totals, grow->present, tot_present, tot_classes, tot_samples );
+}
+
+/*
+	majority class of class counts, lowest class on ties
+*/
+static long grow_majority( const grow_t *grow, const long *class_counts )
+{
+	long				class_id		= 0;
+	long				k;
+
+	for( k = 1; k < grow->tot_classes; k++ ) {
+		if( class_counts[ k ] > class_counts[ class_id ] ) {
+			class_id = k;
+		}
+	}
+
+	return class_id;
+}
+
+/*
+	create a child of a split node given its class counts: a pure child or one of totally
+	random samples is a terminal node at once, as a child with too few samples for two
+	children ( of majority class ) or one at depth limit that surely can be split ( it is
+	not split then, and takes majority class ); the others are counted by next level
+	returns 0 or -1 on memory error
+*/
+static int grow_child_add( grow_t *grow, node_t *child, long value, const long *class_counts, long tot_samples, const char *avail )
+{
+	double				entropy_set		= calc_entropy_set( class_counts, grow->tot_classes, tot_samples );
+	int					open			= ( entropy_set != 0.000f && entropy_set != 1 );
+	int					limited			= ( tot_samples < 2 * grow->params->min_leaf );
+	long				k;
+
+	// a categorical attribute always splits, numeric ones only if rows have two numbers
+	if( grow->params->max_depth > 0 && grow->depth + 1 >= grow->params->max_depth ) {
+		for( k = 0; k < grow->tot_attrib && !limited; k++ ) {
+			limited = avail[ k ] && ( grow->numbers == NULL || grow->numbers[ k ] == NULL );
+		}
+		limited |= ( grow->params->min_leaf > 1 );
+	}
+
+	child->winvalue		= value;
+	child->attrib		= -1;
+	child->class_id		= -1;
+	child->threshold	= -1;
+	child->tot_samples	= tot_samples;
+	child->samples		= NULL;
+	child->tot_nodes	= 0;
+	child->nodes		= NULL;
+	if( entropy_set == 0.000f ) {
+		for( k = 0; class_counts[ k ] == 0; k++ );
+		child->class_id = k;
+	}
+	if( open && limited ) {
+		child->class_id	= grow_majority( grow, class_counts );
+		open			= 0;
+	}
+	if( !open ) {
+		grow->stats.leaves += 1;
+	}
+
+	return level_add( grow->levels + 2, grow->tot_attrib, child, avail, open ) < 0 ? -1 : 0;
+}
+
+/*
+	choose split of a counted node as training does and create its children into next
+	level, a node that cannot be split gets class of its first row ( majority class if
+	min_leaf is set ) and one at depth limit that can be split gets majority class
+	returns 0 or -1 on memory error
+*/
+static int grow_split( grow_t *grow, long index )
+{
+	const dataset_t		*ds				= &grow->spill->ds;
+	snode_t				*snode			= grow->levels[ 1 ].nodes + index;
+	node_t				*node			= snode->node;
+	const long			*counts			= snode->counts;
+	const char			*avail			= grow->levels[ 1 ].avail + index * grow->tot_attrib;
+	long				tot_classes		= grow->tot_classes;
+	const long			*table			= NULL;
+	double				entropy_set		= 0;
+	double				max_gain		= 0;
+	long				max_gain_id		= -1;
+	long				tot_avattrib	= 0;
+	long				tot_children	= 0;
+	long				i, j, k;
+
+	entropy_set = calc_entropy_set( counts, tot_classes, node->tot_samples );
+	if( entropy_set == 1 ) {
+		grow->stats.leaves += 1;
+		return 0;
+	}
+	// root only, children with too few samples are closed when they are added
+	if( entropy_set != 0.000f && node->tot_samples < 2 * grow->params->min_leaf ) {
+		node->class_id		= grow_majority( grow, counts );
+		grow->stats.leaves	+= 1;
+		return 0;
+	}
+	for( j = 0; entropy_set != 0.000f && j < grow->tot_attrib; j++ ) {
+		if( avail[ j ] ) {
+			grow->attribs[ tot_avattrib++ ] = j;
+		}
+	}
+	for( i = 0; i < tot_avattrib; i++ ) {
+		j = grow->attribs[ i ];
+		if( grow->numbers != NULL && grow->numbers[ j ] != NULL ) {
+			grow->gains[ j ] = entropy_set + grow_threshold( grow, counts, j, node->tot_samples );
+		} else {
+			grow->gains[ j ] = entropy_set + grow_gain( grow, counts, j, node->tot_samples );
+		}
+	}
+	grow->stats.gain_evals += tot_avattrib;
+
+	// highest gain, first available attribute if no gain is positive; numeric attributes
+	// whose samples share a single value cannot split, nor attributes giving a child less
+	// than min_leaf samples
+	for( i = 0; i < tot_avattrib; i++ ) {
+		j = grow->attribs[ i ];
+		if( grow->thresholds[ j ] < 0 ) {
+			continue;
+		}
+		if( max_gain_id < 0 ) {
+			max_gain_id = j;
+		}
+		if( grow->gains[ j ] > max_gain ) {
+			max_gain	= grow->gains[ j ];
+			max_gain_id = j;
+		}
+	}
+	if( max_gain_id < 0 ) {
+		node->class_id		= ( grow->params->min_leaf > 1 ) ? grow_majority( grow, counts ) : snode->first_class;
+		grow->stats.leaves	+= 1;
+		return 0;
+	}
+
+	// default branch leads to majority class ( lowest class on ties )
+	node->class_id = grow_majority( grow, counts );
+	if( grow->params->max_depth > 0 && grow->depth >= grow->params->max_depth ) {
+		grow->stats.leaves += 1;
+		return 0;
+	}
+	node->attrib	= max_gain_id;
+	node->threshold	= -1;
+	table			= counts + grow->voffset[ max_gain_id ];
+	if( grow->numbers != NULL && grow->numbers[ max_gain_id ] != NULL ) {
+		// threshold search is run again, later attributes overwrote its left side
+		grow_threshold( grow, counts, max_gain_id, node->tot_samples );
+		node->threshold	= grow->thresholds[ max_gain_id ];
+		tot_children	= 2;
+	} else {
+		grow_gain( grow, counts, max_gain_id, node->tot_samples );
+		for( k = 0; k < DS_VALUES( ds, max_gain_id ); k++ ) {
+			tot_children += ( grow->totals[ k ] > 0 );
+		}
+	}
+
+	node->nodes		= arena_alloc( &grow->tree->arena, sizeof( node_t ) * tot_children );
+	node->tot_nodes	= tot_children;
+	if( node->nodes == NULL ) {
+		return -1;
+	}
+	grow->stats.nodes += tot_children;
+	if( grow->depth + 1 > grow->stats.max_depth ) {
+		grow->stats.max_depth = grow->depth + 1;
+	}
+
+	// children go to next level, winning attribute is not available below a categorical split
+	snode->child = grow->levels[ 2 ].tot_nodes;
+	memcpy( grow->avail, avail, grow->tot_attrib );
+	grow->avail[ max_gain_id ] = ( node->threshold >= 0 );
+	if( node->threshold >= 0 ) {
+		for( k = 0; k < tot_classes; k++ ) {
+			grow->sides[ k ] = counts[ k ] - grow->best_left[ k ];
+		}
+		j = 0;
+		for( k = 0; k < tot_classes; k++ ) {
+			j += grow->best_left[ k ];
+		}
+		if( grow_child_add( grow, node->nodes, 0, grow->best_left, j, grow->avail ) != 0 ||
+			grow_child_add( grow, node->nodes + 1, 1, grow->sides, node->tot_samples - j, grow->avail ) != 0 ) {
+			return -1;
+		}
+		return 0;
+	}
+	for( i = 0, k = 0; k < DS_VALUES( ds, max_gain_id ); k++ ) {
+		if( grow->totals[ k ] == 0 ) {
+			continue;
+		}
+		if( grow_child_add( grow, node->nodes + i, k, table + k * tot_classes, grow->totals[ k ], grow->avail ) != 0 ) {
+			return -1;
+		}
+		i += 1;
+	}
+
+	return 0;
+}
+
+/*
+	build subtree of a node whose rows were gathered by a pass: it is trained in memory
+	on these rows alone, with attributes available at node, and takes place of node
+	returns 0 or -1 on memory error
+*/
+static int grow_subtree( grow_t *grow, long index )
+{
+	spill_t				*spill			= grow->spill;
+	snode_t				*snode			= grow->levels[ 1 ].nodes + index;
+	node_t				*node			= snode->node;
+	long				winvalue		= node->winvalue;
+	dataset_t			rows;
+	tree_t				subtree;
+	id3_params_t		params;
+	id3_stats_t			stats;
+	long				col;
+
+	// gathered rows are a dataset sharing catalogs and code widths of spill
+	memset( &rows, 0, sizeof( dataset_t ) );
+	rows.cols		= spill->ds.cols;
+	rows.rows		= node->tot_samples;
+	rows.max_rows	= node->tot_samples;
+	rows.dicts		= spill->ds.dicts;
+	rows.widths		= spill->ds.widths;
+	rows.columns	= grow->columns;
+	for( col = 0; col < spill->ds.cols; col++ ) {
+		grow->columns[ col ] = snode->rows + col * node->tot_samples;
+		spill_narrow_codes( grow->columns[ col ], spill->ds.widths[ col ], node->tot_samples );
+	}
+
+	memset( &stats, 0, sizeof( id3_stats_t ) );
+	params			= *grow->params;
+	params.threads	= 1;
+	params.stats	= ( grow->params->stats != NULL ) ? &stats : NULL;
+	// a node at depth limit is trained as a stump and cut: split root has majority class
+	if( params.max_depth > 0 ) {
+		params.max_depth = ( params.max_depth > grow->depth ) ? params.max_depth - grow->depth : 1;
+	}
+	if( tree_build( &subtree, &rows, grow->numbers, &params, grow->levels[ 1 ].avail + index * grow->tot_attrib ) != 0 ) {
+		return -1;
+	}
+	*node			= *subtree.root;
+	node->winvalue	= winvalue;
+	arena_merge( &grow->tree->arena, &subtree.arena );
+	if( grow->params->max_depth > 0 && grow->depth >= grow->params->max_depth && node->attrib >= 0 ) {
+		stats.nodes			-= node->tot_nodes;
+		stats.leaves		-= node->tot_nodes - 1;
+		stats.max_depth		= 0;
+		node->attrib		= -1;
+		node->threshold		= -1;
+		node->tot_nodes		= 0;
+		node->nodes			= NULL;
+	}
+
+	// node itself was counted by its parent
+	grow->stats.nodes			+= stats.nodes - 1;
+	grow->stats.leaves			+= stats.leaves;
+	grow->stats.gain_evals		+= stats.gain_evals;
+	grow->stats.samples_touched	+= stats.samples_touched;
+	if( grow->depth + stats.max_depth > grow->stats.max_depth ) {
+		grow->stats.max_depth = grow->depth + stats.max_depth;
+	}
+
+	return 0;
+}
+
+/*
+	memory a node takes in a pass: its rows if they are gathered, else its count tables;
+	gathered rows must leave room to train their subtree. Rows of workers are never
+	gathered
+	- scratch:	memory of training a subtree, 0 if node is counted
+*/
+static size_t grow_cost( const grow_t *grow, const node_t *node, size_t *scratch )
+{
+	const spill_t		*spill			= grow->spill;
+	size_t				rows			= sizeof( uint32_t ) * spill->ds.cols * node->tot_samples;
+
+	*scratch = ( size_t )spill->row_bytes * node->tot_samples;
+	if( *scratch > spill->batch_bytes || spill->dist != NULL ) {
+		*scratch = 0;
+		return sizeof( long ) * spill->tot_cells;
+	}
+	// rows stay aligned on count tables
+	return ( rows + sizeof( long ) - 1 ) / sizeof( long ) * sizeof( long );
+}
+
+/*
+	grow tree of a spilled dataset level by level: open nodes of a level get count tables
+	( or room for their rows ) in batches that fit memory budget, each batch is counted by
+	a pass over column files ( over shards by workers of distributed training ) and split
+	at once, children of a batch form next level. Tree is the one tree_build gives on the
+	same dataset; catalogs stay with spill
+	- numbers:	code -> number of each numeric attribute ( see numbers_parse ), NULL if
+				no attribute is numeric
+	returns 0, -1 on memory error or -2 on read or write error of temporary files ( or if
+	a worker fails )
+*/
+int spill_build( tree_t *tree, spill_t *spill, const double *const *numbers, const id3_params_t *params )
+{
+	grow_t				grow;
+	const dataset_t		*ds				= &spill->ds;
+	id3_stats_t			*stats			= params->stats;
+	level_t				level;
+	node_t				*root			= NULL;
+	double				wall			= 0;
+	double				cpu				= 0;
+	double				start			= 0;
+	snode_t				*snode			= NULL;
+	size_t				used			= 0;
+	size_t				max_used		= 0;
+	size_t				max_scratch		= 0;
+	size_t				cost, scratch;
+	long				tot_batch		= 0;
+	long				batch_first		= 0;
+	long				i, j;
+	int					result			= 0;
+
+	memset( tree, 0, sizeof( tree_t ) );
+	memset( &grow, 0, sizeof( grow_t ) );
+	arena_init( &tree->arena, 64 * 1024 );
+	grow.spill			= spill;
+	grow.tree			= tree;
+	grow.params			= params;
+	grow.numbers		= numbers;
+	grow.tot_attrib		= ds->cols - 1;
+	grow.tot_classes	= DS_VALUES( ds, ds->cols - 1 );
+	if( stats != NULL ) {
+		wall	= stats_wall();
+		cpu		= stats_cpu();
+	}
+
+	do {
+		// offsets of count tables and scratch of split choice, as planned by spill_plan
+		grow.voffset	= malloc( sizeof( long ) * ds->cols );
+		grow.totals		= malloc( sizeof( long ) * ( spill->tot_cells / ( grow.tot_classes ? grow.tot_classes : 1 ) + 2 ) );
+		grow.present	= malloc( sizeof( long ) * ( spill->tot_cells / ( grow.tot_classes ? grow.tot_classes : 1 ) + 2 ) );
+		grow.sides		= malloc( sizeof( long ) * ( 2 * grow.tot_classes + 1 ) );
+		grow.best_left	= malloc( sizeof( long ) * ( grow.tot_classes + 1 ) );
+		grow.attribs	= malloc( sizeof( long ) * ds->cols );
+		grow.avail		= malloc( ds->cols );
+		grow.gains		= malloc( sizeof( double ) * ds->cols );
+		grow.thresholds	= malloc( sizeof( long ) * ds->cols );
+		grow.columns	= malloc( sizeof( void* ) * ds->cols );
+		if( spill->assign_file ) {
+			grow.assign		= malloc( sizeof( int32_t ) * spill->chunk );
+			grow.assign_fp	= spill_file( spill );
+		} else if( spill->dist == NULL ) {
+			grow.assign		= malloc( sizeof( int32_t ) * ( ds->rows + 1 ) );
+		}
+		if( grow.voffset == NULL || grow.totals == NULL || grow.present == NULL || grow.sides == NULL ||
+			grow.best_left == NULL || grow.attribs == NULL || grow.avail == NULL || grow.gains == NULL ||
+			grow.thresholds == NULL || grow.columns == NULL || ( grow.assign == NULL && spill->dist == NULL ) ||
+			( spill->assign_file && grow.assign_fp == NULL ) ) {
+			result = ( spill->assign_file && grow.assign_fp == NULL ) ? -2 : -1;
+			break;
+		}
+		grow.voffset[ 0 ] = grow.tot_classes;
+		for( j = 1; j < ds->cols; j++ ) {
+			grow.voffset[ j ] = grow.voffset[ j - 1 ] + DS_VALUES( ds, j - 1 ) * grow.tot_classes;
+		}
+		if( grow_order( &grow ) != 0 ) {
+			result = -1;
+			break;
+		}
+
+		// root holds every row and every attribute
+		if( ( root = arena_alloc( &tree->arena, sizeof( node_t ) ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		root->winvalue		= -1;
+		root->attrib		= -1;
+		root->class_id		= -1;
+		root->threshold		= -1;
+		root->tot_samples	= ds->rows;
+		root->samples		= NULL;
+		root->tot_nodes		= 0;
+		root->nodes			= NULL;
+		tree->root			= root;
+		memset( grow.avail, 1, grow.tot_attrib );
+		if( level_add( grow.levels + 2, grow.tot_attrib, root, grow.avail, ds->rows > 0 ) < 0 ) {
+			result = -1;
+			break;
+		}
+
+		// children of a level become the level counted next, nodes of previous one
+		// tell where its rows go
+		for( grow.depth = 0; result == 0; grow.depth++ ) {
+			level				= grow.levels[ 0 ];
+			grow.levels[ 0 ]	= grow.levels[ 1 ];
+			grow.levels[ 1 ]	= grow.levels[ 2 ];
+			grow.levels[ 2 ]	= level;
+			grow.levels[ 2 ].tot_nodes = 0;
+			for( i = 0; i < grow.levels[ 1 ].tot_nodes && !grow.levels[ 1 ].nodes[ i ].open; i++ );
+			if( i == grow.levels[ 1 ].tot_nodes ) {
+				break;
+			}
+
+			for( batch_first = 0; result == 0 && batch_first < grow.levels[ 1 ].tot_nodes; batch_first = i ) {
+				// a batch takes at least a node, the largest subtree of a batch is trained
+				// while rows of the others are still there
+				for( i = batch_first, used = 0, max_scratch = 0, tot_batch = 0; i < grow.levels[ 1 ].tot_nodes; i++ ) {
+					if( !grow.levels[ 1 ].nodes[ i ].open ) {
+						continue;
+					}
+					cost = grow_cost( &grow, grow.levels[ 1 ].nodes[ i ].node, &scratch );
+					if( tot_batch > 0 && used + cost + ( scratch > max_scratch ? scratch : max_scratch ) > spill->batch_bytes ) {
+						break;
+					}
+					used		+= cost;
+					max_scratch	= ( scratch > max_scratch ) ? scratch : max_scratch;
+					tot_batch	+= 1;
+				}
+				// block grows up to the biggest batch
+				if( used > max_used ) {
+					free( grow.block );
+					if( ( grow.block = malloc( used ) ) == NULL ) {
+						result = -1;
+						break;
+					}
+					max_used = used;
+				}
+				for( j = batch_first, used = 0; j < i; j++ ) {
+					snode = grow.levels[ 1 ].nodes + j;
+					if( !snode->open ) {
+						continue;
+					}
+					cost = grow_cost( &grow, snode->node, &scratch );
+					if( scratch > 0 ) {
+						snode->rows		= ( uint32_t* )( grow.block + used / sizeof( long ) );
+						snode->gathered	= 0;
+					} else {
+						snode->counts	= grow.block + used / sizeof( long );
+						memset( snode->counts, 0, cost );
+					}
+					used += cost;
+				}
+				if( stats != NULL ) {
+					start = stats_wall();
+				}
+				if( tot_batch > 0 && grow_pass( &grow, batch_first == 0 ) != 0 ) {
+					result = -2;
+					break;
+				}
+				for( j = batch_first; result == 0 && j < i; j++ ) {
+					snode = grow.levels[ 1 ].nodes + j;
+					if( ( snode->counts != NULL && grow_split( &grow, j ) != 0 ) ||
+						( snode->rows != NULL && grow_subtree( &grow, j ) != 0 ) ) {
+						result = -1;
+					}
+					snode->counts	= NULL;
+					snode->rows		= NULL;
+				}
+				if( stats != NULL ) {
+					grow.stats.split_time += stats_wall() - start;
+				}
+			}
+		}
+	} while( 0 );
+
+	for( i = 0; i < 3; i++ ) {
+		free( grow.levels[ i ].nodes );
+		free( grow.levels[ i ].avail );
+	}
+	for( j = 0; grow.order != NULL && j < ds->cols; j++ ) {
+		free( grow.order[ j ] );
+	}
+	free( grow.order );
+	if( grow.assign_fp != NULL ) {
+		fclose( grow.assign_fp );
+	}
+	free( grow.assign );
+	free( grow.block );
+	free( grow.columns );
+	free( grow.voffset );
+	free( grow.totals );
+	free( grow.present );
+	free( grow.sides );
+	free( grow.best_left );
+	free( grow.attribs );
+	free( grow.avail );
+	free( grow.gains );
+	free( grow.thresholds );
+	if( stats != NULL ) {
+		grow.stats.bytes_allocated = spill->fixed + max_used;
+		stats_merge( stats, &grow.stats );
+		stats->nodes			+= ( tree->root != NULL );
+		stats->unique_rows		+= ds->rows;
+		stats->tree_bytes		= tree->arena.allocated;
+		stats->bytes_allocated	+= tree->arena.allocated;
+		stats->train_wall		+= stats_wall() - wall;
+		stats->train_cpu		+= stats_cpu() - cpu;
+	}
+	if( result != 0 ) {
+		tree_free( tree );
+	}
+
+	return result;
+}
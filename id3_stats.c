@@ -0,0 +1,90 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+/*
+	wall clock in seconds
+*/
+double stats_wall( void )
+{
+	struct timespec		ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+	processor time of process in seconds, all threads included
+*/
+double stats_cpu( void )
+{
+	return ( double )clock() / CLOCKS_PER_SEC;
+}
+
+/*
+	add statistics of a training thread to the ones of training
+*/
+void stats_merge( id3_stats_t *stats, const id3_stats_t *from )
+{
+	stats->split_time		+= from->split_time;
+	stats->partition_time	+= from->partition_time;
+	stats->nodes			+= from->nodes;
+	stats->leaves			+= from->leaves;
+	stats->gain_evals		+= from->gain_evals;
+	stats->samples_touched	+= from->samples_touched;
+	stats->bytes_allocated	+= from->bytes_allocated;
+	if( from->max_depth > stats->max_depth ) {
+		stats->max_depth = from->max_depth;
+	}
+}
+
+/*
+	write statistics as a JSON object
+	returns 0 or -2 on write error
+*/
+int id3_stats_json( const id3_stats_t *stats, FILE *fp )
+{
+	fprintf( fp, "{\"encode_wall\":%.6f,\"encode_cpu\":%.6f,", stats->encode_wall, stats->encode_cpu );
+	fprintf( fp, "\"train_wall\":%.6f,\"train_cpu\":%.6f,", stats->train_wall, stats->train_cpu );
+	fprintf( fp, "\"split_time\":%.6f,\"partition_time\":%.6f,", stats->split_time, stats->partition_time );
+	fprintf( fp, "\"compile_wall\":%.6f,", stats->compile_wall );
+	fprintf( fp, "\"rules_wall\":%.6f,\"rules_cpu\":%.6f,", stats->rules_wall, stats->rules_cpu );
+	fprintf( fp, "\"nodes\":%ld,\"leaves\":%ld,\"max_depth\":%ld,", stats->nodes, stats->leaves, stats->max_depth );
+	fprintf( fp, "\"gain_evals\":%ld,\"samples_touched\":%ld,\"unique_rows\":%ld,\"rules\":%ld,", stats->gain_evals,
+		stats->samples_touched, stats->unique_rows, stats->rules );
+	fprintf( fp, "\"bytes_allocated\":%lu,\"tree_bytes\":%lu,\"flat_bytes\":%lu}\n", ( unsigned long )stats->bytes_allocated,
+		( unsigned long )stats->tree_bytes, ( unsigned long )stats->flat_bytes );
+
+	return ferror( fp ) ? -2 : 0;
+}
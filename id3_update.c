@@ -0,0 +1,839 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3.h"
+#include "id3_int.h"
+
+/*
+	value x class count table of an attribute at an inner node
+*/
+typedef struct table_tag {
+	long				tot_values;		// values with room in table
+	long				*totals;		// samples of each value
+	long				*counts;		// samples of each value x class
+} table_t;
+
+/*
+	node of a tree that can be updated: inner nodes keep count tables of every attribute
+	available to them, terminal nodes the rows that reached them
+*/
+typedef struct unode_tag {
+	long				attrib;			// split attribute, -1 for terminal node
+	long				class_id;		// class of terminal node, -1 if it has none
+	long				tot_samples;
+	long				tot_classes;	// classes with room in count tables
+	long				*class_counts;	// samples of each class
+	table_t				*tables;		// count table of each attribute, inner nodes only
+	long				tot_nodes;		// values with room in nodes
+	struct unode_tag	**nodes;		// child of each value, NULL if value has no samples
+	long				*samples;		// rows of terminal node in increasing order
+	long				max_samples;
+} unode_t;
+
+struct update_tag {
+	dataset_t			ds;				// training rows; catalogs are the model's ones and
+										// their pointer is set at every call
+	unode_t				*root;
+	char				*avail;			// attributes available along current branch
+	long				*present;		// values found by a count table
+	long				max_present;
+	long				*sorted;		// samples of a node grouped by value
+	long				max_sorted;
+	flat_t				*flat;			// flat tree of model patched by an update, NULL if
+										// it is compiled again anyway
+	int					restructured;	// an update changed shape of tree
+	int					broken;			// an update failed while tree changed, no more update
+};
+
+/*
+	compare two rows for qsort
+*/
+static int cmp_row( const void *a, const void *b )
+{
+	long				x = *( const long* )a;
+	long				y = *( const long* )b;
+
+	return ( x > y ) - ( x < y );
+}
+
+// word of a value without a child of a sparse node, it has no word in flat tree
+#define	UNODE_NO_WORD		-2
+
+/*
+	majority class of a node, lowest class on ties as in training
+*/
+static long unode_majority( const unode_t *node )
+{
+	long				class_id		= 0;
+	long				j;
+
+	for( j = 1; j < node->tot_classes; j++ ) {
+		if( node->class_counts[ j ] > node->class_counts[ class_id ] ) {
+			class_id = j;
+		}
+	}
+
+	return class_id;
+}
+
+/*
+	release a node and its subtree
+*/
+static void unode_free( update_t *upd, unode_t *node )
+{
+	long				j;
+
+	if( node == NULL ) {
+		return;
+	}
+	for( j = 0; j < node->tot_nodes; j++ ) {
+		unode_free( upd, node->nodes[ j ] );
+	}
+	for( j = 0; node->tables != NULL && j < upd->ds.cols - 1; j++ ) {
+		free( node->tables[ j ].totals );
+		free( node->tables[ j ].counts );
+	}
+	free( node->tables );
+	free( node->nodes );
+	free( node->class_counts );
+	free( node->samples );
+	free( node );
+}
+
+/*
+	make room in count tables of a node for every class and value of catalogs, cells
+	are moved to their place in wider tables
+	returns 0 or -1 on memory error
+*/
+static int unode_grow( update_t *upd, unode_t *node )
+{
+	const dataset_t		*ds				= &upd->ds;
+	long				tot_classes		= DS_VALUES( ds, ds->cols - 1 );
+	table_t				*table			= NULL;
+	long				*totals			= NULL;
+	long				*counts			= NULL;
+	long				*ptr			= NULL;
+	long				tot_values, attrib, value;
+
+	if( node->tot_classes < tot_classes ) {
+		if( ( ptr = realloc( node->class_counts, sizeof( long ) * tot_classes ) ) == NULL ) {
+			return -1;
+		}
+		memset( ptr + node->tot_classes, 0, sizeof( long ) * ( tot_classes - node->tot_classes ) );
+		node->class_counts = ptr;
+	}
+	for( attrib = 0; node->tables != NULL && attrib < ds->cols - 1; attrib++ ) {
+		table		= node->tables + attrib;
+		tot_values	= DS_VALUES( ds, attrib );
+		if( table->counts == NULL || ( table->tot_values == tot_values && node->tot_classes == tot_classes ) ) {
+			continue;
+		}
+		totals = calloc( tot_values, sizeof( long ) );
+		counts = calloc( tot_values * tot_classes, sizeof( long ) );
+		if( totals == NULL || counts == NULL ) {
+			free( totals );
+			free( counts );
+			return -1;
+		}
+		for( value = 0; value < table->tot_values; value++ ) {
+			totals[ value ] = table->totals[ value ];
+			memcpy( counts + value * tot_classes, table->counts + value * node->tot_classes, sizeof( long ) * node->tot_classes );
+		}
+		free( table->totals );
+		free( table->counts );
+		table->totals		= totals;
+		table->counts		= counts;
+		table->tot_values	= tot_values;
+	}
+	node->tot_classes = tot_classes;
+
+	return 0;
+}
+
+/*
+	add samples to class counts of a node
+*/
+static void unode_classes( update_t *upd, unode_t *node, const long *samples, long tot_samples )
+{
+	long				classcol		= upd->ds.cols - 1;
+	long				i;
+
+	for( i = 0; i < tot_samples; i++ ) {
+		node->class_counts[ ds_code( &upd->ds, classcol, samples[ i ] ) ] += 1;
+	}
+	node->tot_samples += tot_samples;
+}
+
+/*
+	add samples to count tables of an inner node
+*/
+static void unode_count( update_t *upd, unode_t *node, const long *samples, long tot_samples )
+{
+	const dataset_t		*ds				= &upd->ds;
+	long				classcol		= ds->cols - 1;
+	table_t				*table			= NULL;
+	long				value, attrib, i;
+
+	for( attrib = 0; node->tables != NULL && attrib < classcol; attrib++ ) {
+		table = node->tables + attrib;
+		if( table->counts == NULL ) {
+			continue;
+		}
+		for( i = 0; i < tot_samples; i++ ) {
+			value								= ds_code( ds, attrib, samples[ i ] );
+			table->totals[ value ]				+= 1;
+			table->counts[ value * node->tot_classes + ds_code( ds, classcol, samples[ i ] ) ]	+= 1;
+		}
+	}
+}
+
+/*
+	attribute with highest info gain among count tables of an inner node, first one
+	wins if no gain is positive as in training
+	returns attribute or -1 on memory error
+*/
+static long unode_best( update_t *upd, const unode_t *node, double entropy_set )
+{
+	const table_t		*table			= NULL;
+	long				*ptr			= NULL;
+	double				max_gain		= 0;
+	long				max_gain_id		= -1;
+	double				gain			= 0;
+	long				tot_present, attrib, value;
+
+	for( attrib = 0; attrib < upd->ds.cols - 1; attrib++ ) {
+		table = node->tables + attrib;
+		if( table->counts == NULL ) {
+			continue;
+		}
+		if( max_gain_id < 0 ) {
+			max_gain_id = attrib;
+		}
+		if( table->tot_values > upd->max_present ) {
+			if( ( ptr = realloc( upd->present, sizeof( long ) * table->tot_values ) ) == NULL ) {
+				return -1;
+			}
+			upd->present		= ptr;
+			upd->max_present	= table->tot_values;
+		}
+		for( value = 0, tot_present = 0; value < table->tot_values; value++ ) {
+			if( table->totals[ value ] > 0 ) {
+				upd->present[ tot_present++ ] = value;
+			}
+		}
+		gain = entropy_set + calc_counts_gain( table->counts, table->totals, upd->present, tot_present,
+			node->tot_classes, node->tot_samples );
+		if( gain > max_gain ) {
+			max_gain	= gain;
+			max_gain_id = attrib;
+		}
+	}
+
+	return max_gain_id;
+}
+
+/*
+	build a subtree from its rows as training does, samples are in increasing order and
+	are moved around to group them by value of split attributes
+	returns 0 or -1 on memory error
+*/
+static int unode_build( update_t *upd, unode_t **slot, long *samples, long tot_samples )
+{
+	const dataset_t		*ds				= &upd->ds;
+	long				classcol		= ds->cols - 1;
+	unode_t				*node			= NULL;
+	table_t				*table			= NULL;
+	double				entropy_set		= 0;
+	long				tot_avattrib	= 0;
+	long				start			= 0;
+	long				*position		= NULL;
+	long				attrib, value, i;
+
+	if( ( node = calloc( 1, sizeof( unode_t ) ) ) == NULL ) {
+		return -1;
+	}
+	*slot			= node;
+	node->attrib	= -1;
+	node->class_id	= -1;
+	if( unode_grow( upd, node ) != 0 ) {
+		return -1;
+	}
+	unode_classes( upd, node, samples, tot_samples );
+	entropy_set = calc_entropy_set( node->class_counts, node->tot_classes, tot_samples );
+	for( attrib = 0; attrib < classcol; attrib++ ) {
+		tot_avattrib += upd->avail[ attrib ];
+	}
+
+	// terminal node keeps its rows, to be split when new rows make it impure
+	if( entropy_set == 0.000f || entropy_set == 1 || tot_avattrib == 0 ) {
+		if( entropy_set != 1 ) {
+			node->class_id = ds_code( ds, classcol, samples[ 0 ] );
+		}
+		if( ( node->samples = malloc( sizeof( long ) * tot_samples ) ) == NULL ) {
+			return -1;
+		}
+		memcpy( node->samples, samples, sizeof( long ) * tot_samples );
+		node->max_samples = tot_samples;
+		return 0;
+	}
+
+	// count tables of available attributes are kept by inner node
+	if( ( node->tables = calloc( classcol, sizeof( table_t ) ) ) == NULL ) {
+		return -1;
+	}
+	for( attrib = 0; attrib < classcol; attrib++ ) {
+		table = node->tables + attrib;
+		if( !upd->avail[ attrib ] ) {
+			continue;
+		}
+		table->tot_values	= DS_VALUES( ds, attrib );
+		table->totals		= calloc( table->tot_values, sizeof( long ) );
+		table->counts		= calloc( table->tot_values * node->tot_classes, sizeof( long ) );
+		if( table->totals == NULL || table->counts == NULL ) {
+			return -1;
+		}
+	}
+	unode_count( upd, node, samples, tot_samples );
+	if( ( node->attrib = unode_best( upd, node, entropy_set ) ) < 0 ) {
+		return -1;
+	}
+
+	// group samples by value keeping their order, then build every child with samples
+	node->tot_nodes = DS_VALUES( ds, node->attrib );
+	node->nodes		= calloc( node->tot_nodes, sizeof( unode_t* ) );
+	position		= calloc( node->tot_nodes, sizeof( long ) );
+	if( node->nodes == NULL || position == NULL ) {
+		free( position );
+		return -1;
+	}
+	table = node->tables + node->attrib;
+	for( value = 0; value < node->tot_nodes; value++ ) {
+		position[ value ]	= start;
+		start				+= table->totals[ value ];
+	}
+	for( i = 0; i < tot_samples; i++ ) {
+		upd->sorted[ position[ ds_code( ds, node->attrib, samples[ i ] ) ]++ ] = samples[ i ];
+	}
+	memcpy( samples, upd->sorted, sizeof( long ) * tot_samples );
+	free( position );
+
+	upd->avail[ node->attrib ] = 0;
+	for( value = 0, start = 0; value < node->tot_nodes; value++ ) {
+		if( table->totals[ value ] > 0 && unode_build( upd, node->nodes + value, samples + start, table->totals[ value ] ) != 0 ) {
+			upd->avail[ node->attrib ] = 1;
+			return -1;
+		}
+		start += table->totals[ value ];
+	}
+	upd->avail[ node->attrib ] = 1;
+
+	return 0;
+}
+
+/*
+	append rows of terminal nodes of a subtree
+*/
+static void unode_gather( const unode_t *node, long *samples, long *tot_samples )
+{
+	long				j;
+
+	if( node == NULL ) {
+		return;
+	}
+	if( node->attrib < 0 ) {
+		memcpy( samples + *tot_samples, node->samples, sizeof( long ) * node->tot_samples );
+		*tot_samples += node->tot_samples;
+	}
+	for( j = 0; j < node->tot_nodes; j++ ) {
+		unode_gather( node->nodes[ j ], samples, tot_samples );
+	}
+}
+
+/*
+	build again a subtree from all rows it holds and from new rows not yet passed to its
+	terminal nodes ( counted by its root )
+	returns 0 or -1 on memory error
+*/
+static int unode_rebuild( update_t *upd, unode_t **slot, const long *added, long tot_added )
+{
+	long				*samples		= NULL;
+	long				tot_samples		= 0;
+	int					result			= 0;
+
+	if( ( samples = malloc( sizeof( long ) * ( ( *slot )->tot_samples + 1 ) ) ) == NULL ) {
+		return -1;
+	}
+	upd->restructured = 1;
+	unode_gather( *slot, samples, &tot_samples );
+	if( tot_added > 0 ) {
+		memcpy( samples + tot_samples, added, sizeof( long ) * tot_added );
+		tot_samples += tot_added;
+	}
+	qsort( samples, tot_samples, sizeof( long ), cmp_row );
+	unode_free( upd, *slot );
+	*slot	= NULL;
+	result	= unode_build( upd, slot, samples, tot_samples );
+	free( samples );
+
+	return result;
+}
+
+/*
+	point a word of flat tree to the terminal node of a class, word -1 is the root; a
+	value without a word changes shape of tree. Flat tree is left alone once it is to be
+	compiled again
+*/
+static void unode_patch( update_t *upd, long word, long class_id )
+{
+	if( upd->flat == NULL || upd->restructured ) {
+		return;
+	}
+	if( word == UNODE_NO_WORD ) {
+		upd->restructured = 1;
+	} else if( word < 0 ) {
+		upd->flat->root = FLAT_LEAF( class_id );
+	} else {
+		upd->flat->nodes[ word ] = FLAT_LEAF( class_id );
+	}
+}
+
+/*
+	word of flat tree pointing to child of a value of inner node at offset pos, values
+	come in increasing order and next is the first child of a sparse node not passed yet
+	returns word or UNODE_NO_WORD
+*/
+static long unode_word( const update_t *upd, long pos, long value, long *next )
+{
+	const int32_t		*nodes			= upd->flat->nodes;
+
+	if( !( nodes[ pos ] & FLAT_SPARSE ) ) {
+		return ( value < nodes[ pos + 1 ] ) ? pos + 2 + value : UNODE_NO_WORD;
+	}
+	while( *next < nodes[ pos + 1 ] && FLAT_VALUE( nodes, pos, *next ) < value ) {
+		*next += 1;
+	}
+
+	return ( *next < nodes[ pos + 1 ] && FLAT_VALUE( nodes, pos, *next ) == value ) ? pos + 2 + *next : UNODE_NO_WORD;
+}
+
+/*
+	add new rows to a subtree: counts of nodes along their paths are updated and a
+	subtree is built again only when rows change the split of its root, so the result is
+	the tree training would build on all rows; samples are in increasing order and come
+	after every row already in tree. Flat tree is walked along: word is the one pointing
+	to subtree ( -1 for root ) and is patched when only the class of a terminal changes
+	returns 0 or -1 on memory error
+*/
+static int unode_insert( update_t *upd, unode_t **slot, long *samples, long tot_samples, long word )
+{
+	const dataset_t		*ds				= &upd->ds;
+	long				classcol		= ds->cols - 1;
+	unode_t				*node			= *slot;
+	unode_t				**nodes			= NULL;
+	long				*ptr			= NULL;
+	long				*totals			= NULL;
+	long				*position		= NULL;
+	double				entropy_set		= 0;
+	long				tot_values		= 0;
+	long				start			= 0;
+	long				pos				= 0;
+	long				next			= 0;
+	long				child_word		= UNODE_NO_WORD;
+	long				max_samples, attrib, value, majority, i;
+	int					result			= 0;
+
+	if( node == NULL ) {
+		if( unode_build( upd, slot, samples, tot_samples ) != 0 ) {
+			return -1;
+		}
+		if( ( *slot )->attrib < 0 ) {
+			unode_patch( upd, word, ( *slot )->class_id );
+		} else {
+			upd->restructured = 1;
+		}
+		return 0;
+	}
+	if( unode_grow( upd, node ) != 0 ) {
+		return -1;
+	}
+	majority = unode_majority( node );
+	unode_classes( upd, node, samples, tot_samples );
+	unode_count( upd, node, samples, tot_samples );
+	entropy_set = calc_entropy_set( node->class_counts, node->tot_classes, node->tot_samples );
+
+	// terminal node: rows are appended, node is split as soon as it is not pure
+	if( node->attrib < 0 ) {
+		if( node->tot_samples > node->max_samples ) {
+			max_samples = ( node->tot_samples > 2 * node->max_samples ) ? node->tot_samples : 2 * node->max_samples;
+			if( ( ptr = realloc( node->samples, sizeof( long ) * max_samples ) ) == NULL ) {
+				return -1;
+			}
+			node->samples		= ptr;
+			node->max_samples	= max_samples;
+		}
+		memcpy( node->samples + node->tot_samples - tot_samples, samples, sizeof( long ) * tot_samples );
+		for( attrib = 0; attrib < classcol && !upd->avail[ attrib ]; attrib++ );
+		if( entropy_set == 0.000f || entropy_set == 1 || attrib == classcol ) {
+			node->class_id = ( entropy_set != 1 ) ? ds_code( ds, classcol, node->samples[ 0 ] ) : -1;
+			unode_patch( upd, word, node->class_id );
+			return 0;
+		}
+		return unode_rebuild( upd, slot, NULL, 0 );
+	}
+
+	// inner node: same split sends rows down to children, otherwise subtree is built again
+	if( entropy_set == 1 ) {
+		return unode_rebuild( upd, slot, samples, tot_samples );
+	}
+	if( ( attrib = unode_best( upd, node, entropy_set ) ) < 0 ) {
+		return -1;
+	}
+	if( attrib != node->attrib ) {
+		return unode_rebuild( upd, slot, samples, tot_samples );
+	}
+	// default branch of node leads to its majority class
+	if( unode_majority( node ) != majority ) {
+		upd->restructured = 1;
+	}
+
+	tot_values = DS_VALUES( ds, attrib );
+	if( node->tot_nodes < tot_values ) {
+		if( ( nodes = realloc( node->nodes, sizeof( unode_t* ) * tot_values ) ) == NULL ) {
+			return -1;
+		}
+		memset( nodes + node->tot_nodes, 0, sizeof( unode_t* ) * ( tot_values - node->tot_nodes ) );
+		node->nodes		= nodes;
+		node->tot_nodes	= tot_values;
+	}
+	totals		= calloc( tot_values, sizeof( long ) );
+	position	= calloc( tot_values, sizeof( long ) );
+	if( totals == NULL || position == NULL ) {
+		free( totals );
+		free( position );
+		return -1;
+	}
+	for( i = 0; i < tot_samples; i++ ) {
+		totals[ ds_code( ds, attrib, samples[ i ] ) ] += 1;
+	}
+	for( value = 0; value < tot_values; value++ ) {
+		position[ value ]	= start;
+		start				+= totals[ value ];
+	}
+	for( i = 0; i < tot_samples; i++ ) {
+		upd->sorted[ position[ ds_code( ds, attrib, samples[ i ] ) ]++ ] = samples[ i ];
+	}
+	memcpy( samples, upd->sorted, sizeof( long ) * tot_samples );
+
+	// words of children follow attribute and number of values of node
+	if( word == UNODE_NO_WORD ) {
+		upd->restructured = 1;
+	}
+	if( upd->flat != NULL && !upd->restructured ) {
+		pos = ( word < 0 ) ? upd->flat->root : upd->flat->nodes[ word ];
+	}
+	upd->avail[ attrib ] = 0;
+	for( value = 0, start = 0; result == 0 && value < tot_values; value++ ) {
+		if( totals[ value ] > 0 ) {
+			child_word = ( upd->flat != NULL && !upd->restructured ) ? unode_word( upd, pos, value, &next ) : UNODE_NO_WORD;
+			result = unode_insert( upd, node->nodes + value, samples + start, totals[ value ], child_word );
+		}
+		start += totals[ value ];
+	}
+	upd->avail[ attrib ] = 1;
+	free( totals );
+	free( position );
+
+	return result;
+}
+
+/*
+	make room in scratch buffers for every row of dataset
+	returns 0 or -1 on memory error
+*/
+static int update_scratch( update_t *upd, long rows )
+{
+	long				*ptr			= NULL;
+
+	if( rows > upd->max_sorted ) {
+		if( ( ptr = realloc( upd->sorted, sizeof( long ) * upd->ds.max_rows ) ) == NULL ) {
+			return -1;
+		}
+		upd->sorted		= ptr;
+		upd->max_sorted	= upd->ds.max_rows;
+	}
+
+	return 0;
+}
+
+/*
+	copy a node into a tree for compilation, inner nodes get a child for every value with
+	samples and the majority class for the others, as in training
+	returns 0 or -1 on memory error
+*/
+static int unode_tree( const update_t *upd, const unode_t *unode, node_t *node, arena_t *arena, long depth, id3_stats_t *stats )
+{
+	node_t				*child			= NULL;
+	long				j;
+
+	node->attrib		= -1;
+	node->class_id		= ( unode != NULL ) ? unode->class_id : -1;
+	node->threshold		= -1;
+	node->tot_samples	= ( unode != NULL ) ? unode->tot_samples : 0;
+	node->samples		= NULL;
+	node->tot_nodes		= 0;
+	node->nodes			= NULL;
+	if( stats != NULL && unode != NULL && depth > stats->max_depth ) {
+		stats->max_depth = depth;
+	}
+	if( unode == NULL || unode->attrib < 0 ) {
+		if( stats != NULL ) {
+			stats->leaves += 1;
+		}
+		return 0;
+	}
+
+	node->attrib	= unode->attrib;
+	node->class_id	= unode_majority( unode );
+	for( j = 0; j < unode->tot_nodes; j++ ) {
+		node->tot_nodes += ( unode->nodes[ j ] != NULL );
+	}
+	if( ( node->nodes = arena_alloc( arena, sizeof( node_t ) * node->tot_nodes ) ) == NULL ) {
+		return -1;
+	}
+	if( stats != NULL ) {
+		stats->nodes += node->tot_nodes;
+	}
+	for( j = 0, child = node->nodes; j < unode->tot_nodes; j++ ) {
+		if( unode->nodes[ j ] == NULL ) {
+			continue;
+		}
+		child->winvalue = j;
+		if( unode_tree( upd, unode->nodes[ j ], child++, arena, depth + 1, stats ) != 0 ) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+	build tree of an encoded dataset keeping what is needed to add rows later: dataset
+	is copied ( but not its catalogs ) and every node keeps its counts
+	returns 0 or -1 on memory error
+*/
+int update_create( update_t **update, const dataset_t *ds )
+{
+	update_t			*upd			= NULL;
+	long				*samples		= NULL;
+	long				col, i;
+
+	*update = NULL;
+	do {
+		if( ( upd = calloc( 1, sizeof( update_t ) ) ) == NULL ) {
+			break;
+		}
+		upd->ds.cols		= ds->cols;
+		upd->ds.rows		= ds->rows;
+		upd->ds.max_rows	= ds->rows;
+		upd->ds.dicts		= ds->dicts;
+		upd->ds.widths		= malloc( sizeof( int ) * ds->cols );
+		upd->ds.columns		= calloc( ds->cols, sizeof( void* ) );
+		upd->avail			= malloc( ds->cols );
+		samples				= malloc( sizeof( long ) * ( ds->rows + 1 ) );
+		if( upd->ds.widths == NULL || upd->ds.columns == NULL || upd->avail == NULL || samples == NULL ) {
+			break;
+		}
+		for( col = 0; col < ds->cols; col++ ) {
+			upd->ds.widths[ col ] = ds->widths[ col ];
+			if( ( upd->ds.columns[ col ] = malloc( ( size_t )ds->widths[ col ] * ( ds->rows + 1 ) ) ) == NULL ) {
+				break;
+			}
+			memcpy( upd->ds.columns[ col ], ds->columns[ col ], ( size_t )ds->widths[ col ] * ds->rows );
+			upd->avail[ col ] = 1;
+		}
+		if( col < ds->cols || update_scratch( upd, ds->rows ) != 0 ) {
+			break;
+		}
+
+		for( i = 0; i < ds->rows; i++ ) {
+			samples[ i ] = i;
+		}
+		if( ds->rows > 0 && unode_build( upd, &upd->root, samples, ds->rows ) != 0 ) {
+			break;
+		}
+		free( samples );
+
+		*update = upd;
+		return 0;
+	} while( 0 );
+
+	free( samples );
+	update_free( upd );
+	return -1;
+}
+
+/*
+	compile tree that can be updated into a flat tree, statistics may be NULL
+	returns 0 or -1 on memory error
+*/
+int update_compile( update_t *upd, const dict_t *dicts, flat_t *flat, id3_stats_t *stats )
+{
+	tree_t				tree;
+	int					result			= 0;
+
+	upd->ds.dicts = ( dict_t* )dicts;
+	memset( &tree, 0, sizeof( tree_t ) );
+	arena_init( &tree.arena, 64 * 1024 );
+	if( stats != NULL ) {
+		stats->nodes += 1;
+	}
+	do {
+		if( ( tree.root = arena_alloc( &tree.arena, sizeof( node_t ) ) ) == NULL ) {
+			result = -1;
+			break;
+		}
+		tree.root->winvalue = -1;
+		if( unode_tree( upd, upd->root, tree.root, &tree.arena, 0, stats ) != 0 ||
+			flat_compile( flat, &tree, DS_VALUES( &upd->ds, upd->ds.cols - 1 ) ) != 0 ) {
+			result = -1;
+			break;
+		}
+	} while( 0 );
+	if( stats != NULL ) {
+		stats->tree_bytes = tree.arena.allocated;
+	}
+	tree_free( &tree );
+
+	return result;
+}
+
+/*
+	release state kept for updates, catalogs belong to model
+*/
+void update_free( update_t *upd )
+{
+	if( upd == NULL ) {
+		return;
+	}
+	unode_free( upd, upd->root );
+	upd->ds.dicts = NULL;
+	dataset_free( &upd->ds );
+	free( upd->avail );
+	free( upd->present );
+	free( upd->sorted );
+	free( upd );
+}
+
+/*
+	add rows to a model trained with update parameter
+*/
+int id3_update( id3_model_t *model, char **data, long rows )
+{
+	update_t			*upd			= NULL;
+	flat_t				flat;
+	long				*samples		= NULL;
+	long				*known			= NULL;
+	long				first			= 0;
+	long				tot_values		= 0;
+	long				cols, col, i;
+	int					result			= 0;
+
+	if( model == NULL || model->update == NULL || model->update->broken || ( data == NULL && rows > 0 ) || rows < 0 ) {
+		return -1;
+	}
+	upd				= model->update;
+	upd->ds.dicts	= model->dicts;
+	cols			= upd->ds.cols;
+	first			= upd->ds.rows;
+	if( ( known = malloc( sizeof( long ) * cols ) ) == NULL ) {
+		return -3;
+	}
+
+	// new values get the next codes of catalogs, as training on all rows would give them;
+	// rows are stored past the dataset and counted only once nothing can fail but the tree
+	for( col = 0; col < cols; col++ ) {
+		known[ col ]	= DS_VALUES( &upd->ds, col );
+		tot_values		+= known[ col ];
+	}
+	if( dataset_reserve( &upd->ds, first + rows ) != 0 ) {
+		result = -3;
+	}
+	for( i = 0; result == 0 && i < rows; i++ ) {
+		for( col = 0; col < cols; col++ ) {
+			if( dataset_set( &upd->ds, col, first + i, data[ i * cols + col ], strlen( data[ i * cols + col ] ) ) != 0 ) {
+				result = -3;
+				break;
+			}
+		}
+	}
+	if( result == 0 && ( update_scratch( upd, first + rows ) != 0 || ( samples = malloc( sizeof( long ) * ( rows + 1 ) ) ) == NULL ) ) {
+		result = -3;
+	}
+	// model is left as it was: values of rows are dropped from catalogs
+	if( result != 0 ) {
+		for( col = 0; col < cols; col++ ) {
+			dict_truncate( model->dicts + col, known[ col ] );
+		}
+		free( known );
+		return result;
+	}
+	free( known );
+	upd->ds.rows = first + rows;
+	for( i = 0; i < rows; i++ ) {
+		samples[ i ] = first + i;
+	}
+
+	// flat tree is patched in place unless new values change the number of children or
+	// the offset of inner nodes, or rows change shape of tree
+	for( col = 0; col < cols; col++ ) {
+		tot_values -= DS_VALUES( &upd->ds, col );
+	}
+	upd->flat			= ( tot_values == 0 ) ? &model->flat : NULL;
+	upd->restructured	= 0;
+	if( rows > 0 && unode_insert( upd, &upd->root, samples, rows, -1 ) != 0 ) {
+		free( samples );
+		upd->broken = 1;
+		return -4;
+	}
+	free( samples );
+	if( upd->flat != NULL && !upd->restructured ) {
+		return 0;
+	}
+
+	if( update_compile( upd, model->dicts, &flat, NULL ) != 0 ) {
+		upd->broken = 1;
+		return -5;
+	}
+	flat_free( &model->flat );
+	model->flat = flat;
+
+	return 0;
+}
@@ -29,6 +29,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "id3.h"
+
 // classified samples
 static char *data_set[] =
 {
@@ -50,10 +52,53 @@ static char *data_set[] =
 	NULL
 };
 
-int main()
+/*
+    print rules of a delimited text file, first line holds column names; with a memory
+    budget ( MB ) the file is trained out of core
+*/
+static int file_rules( const char *path, long class_col, long memory )
+{
+    id3_data_t *data = NULL;
+    id3_model_t *model = NULL;
+    id3_params_t params;
+    int result = 0;
+
+    if( memory > 0 ) {
+        id3_params_init( &params );
+        params.memory = ( size_t )memory * 1024 * 1024;
+        if( ( result = id3_train_file( &model, path, 0, class_col, &params ) ) != 0 ) {
+            printf( "Cannot train %s (%d)\n", path, result );
+            return 1;
+        }
+        id3_print_rules( model );
+        id3_destroy( model );
+        return 0;
+    }
+    if( ( result = id3_data_load( &data, path, 0, class_col ) ) != 0 ) {
+        printf( "Cannot load %s (%d)\n", path, result );
+        return 1;
+    }
+    printf( "Loaded %ld samples from %s\n", id3_data_rows( data ), path );
+    if( ( result = id3_train_data( &model, data, NULL ) ) == 0 ) {
+        id3_print_rules( model );
+        id3_destroy( model );
+    } else {
+        printf( "Error memory allocation (%d)\n", result );
+    }
+    id3_data_destroy( data );
+
+    return result != 0;
+}
+
+int main( int argc, char **argv )
 {
     int result = 0;
 
+    // rules of a CSV / TSV file: id3 file [class column [memory MB]]
+    if( argc > 1 ) {
+        return file_rules( argv[ 1 ], argc > 2 ? atol( argv[ 2 ] ) : -1, argc > 3 ? atol( argv[ 3 ] ) : 0 );
+    }
+
     // string array for column headers
     // ATTENTION! column name size (5 in this case) MUST BE the sum of total attributes (4) and the final classification column (1)
     char *column_names[ 5 ] = { '\0' };
@@ -78,5 +123,17 @@ int main()
     }
     printf( "\n" );
 
+    // a trained model can classify new samples without training again
+    id3_model_t *model = NULL;
+    char *new_day[ 4 ] = { "RAIN", "HOT", "HIGH", "STRONG" };   // attributes only, no class
+    long class_id = -1;
+
+    if( id3_train( &model, data_set, 5, 14, column_names, NULL ) == 0 ) {
+        class_id = id3_predict( model, new_day );
+        printf( "New day %s, %s, %s, %s : %s = %s\n", new_day[ 0 ], new_day[ 1 ], new_day[ 2 ], new_day[ 3 ],
+            column_names[ 4 ], class_id >= 0 ? id3_class_name( model, class_id ) : "no rule" );
+        id3_destroy( model );
+    }
+
     return 0;
 }
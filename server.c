@@ -0,0 +1,155 @@
+/*
+    ID3 algorighm Implementation in C
+
+    Copyright (c) 2009 Daniele Brunello
+    Email: daniele.brunello.dev@gmail.com
+
+    Permission is hereby granted, free of charge, to any person
+    obtaining a copy of this software and associated documentation
+    files (the "Software"), to deal in the Software without
+    restriction, including without limitation the rights to use,
+    copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the
+    Software is furnished to do so, subject to the following
+    conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+    OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	prediction daemon, build with
+
+	gcc -O2 server.c id3*.c -lm -lpthread -o id3_server
+
+	id3_server socket model [model ...] [batch=rows] [wait=ms] serves models saved by
+	id3_model_save on a Unix domain socket, model k goes to slot k. Knobs are
+		batch		rows scored in a batch, at most ( default 4096 )
+		wait		milliseconds a request may wait for others to fill its batch ( default 0 )
+	signals
+		SIGHUP		load every model file again, new versions replace the old ones while
+					requests go on
+		SIGUSR1		print counters
+		SIGINT		stop and print counters, as SIGTERM
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "id3.h"
+
+/*
+	thread serving requests while main thread waits for signals
+*/
+static void *server_thread( void *arg )
+{
+	static int			result;
+
+	result = id3_server_run( arg );
+
+	return &result;
+}
+
+/*
+	print counters of server
+*/
+static void server_print( id3_server_t *server )
+{
+	id3_server_stats_t	stats;
+
+	id3_server_stats( server, &stats );
+	printf( "uptime %.1f s, %ld clients, %ld requests ( %.1f / s ), %ld rows ( %.1f / s ), %ld batches, %ld errors, %ld reloads\n",
+		stats.uptime, stats.clients, stats.requests, stats.requests_rate, stats.rows, stats.rows_rate, stats.batches,
+		stats.errors, stats.reloads );
+	printf( "latency p50 %.1f us, p99 %.1f us\n", stats.latency_p50 * 1e6, stats.latency_p99 * 1e6 );
+	fflush( stdout );
+}
+
+int main( int argc, char **argv )
+{
+	id3_server_t		*server			= NULL;
+	const char			*models[ ID3_SERVER_SLOTS ];
+	long				tot_models		= 0;
+	long				batch			= 0;
+	long				wait			= 0;
+	pthread_t			thread;
+	sigset_t			signals;
+	void				*status			= NULL;
+	int					sig				= 0;
+	int					result			= 0;
+	long				i;
+
+	for( i = 2; i < argc; i++ ) {
+		if( !strncmp( argv[ i ], "batch=", 6 ) ) {
+			batch = atol( argv[ i ] + 6 );
+		} else if( !strncmp( argv[ i ], "wait=", 5 ) ) {
+			wait = atol( argv[ i ] + 5 );
+		} else if( tot_models < ID3_SERVER_SLOTS ) {
+			models[ tot_models++ ] = argv[ i ];
+		}
+	}
+	if( argc < 3 || tot_models == 0 ) {
+		printf( "Usage: %s socket model [model ...] [batch=rows] [wait=ms]\n", argv[ 0 ] );
+		return 1;
+	}
+
+	// signals are taken by main thread alone, server thread inherits the mask
+	sigemptyset( &signals );
+	sigaddset( &signals, SIGHUP );
+	sigaddset( &signals, SIGUSR1 );
+	sigaddset( &signals, SIGINT );
+	sigaddset( &signals, SIGTERM );
+	pthread_sigmask( SIG_BLOCK, &signals, NULL );
+
+	if( ( result = id3_server_create( &server, argv[ 1 ], batch, wait ) ) != 0 ) {
+		printf( "Cannot listen on %s (%d)\n", argv[ 1 ], result );
+		return 1;
+	}
+	for( i = 0; i < tot_models; i++ ) {
+		if( ( result = id3_server_load( server, i, models[ i ] ) ) != 0 ) {
+			printf( "Cannot load model %s (%d)\n", models[ i ], result );
+			id3_server_destroy( server );
+			return 1;
+		}
+	}
+	if( pthread_create( &thread, NULL, server_thread, server ) != 0 ) {
+		id3_server_destroy( server );
+		return 1;
+	}
+	printf( "Serving %ld models on %s\n", tot_models, argv[ 1 ] );
+	fflush( stdout );
+
+	while( sigwait( &signals, &sig ) == 0 && sig != SIGINT && sig != SIGTERM ) {
+		if( sig == SIGUSR1 ) {
+			server_print( server );
+			continue;
+		}
+		// a model that cannot be loaded keeps its previous version
+		for( i = 0; i < tot_models; i++ ) {
+			if( ( result = id3_server_load( server, i, models[ i ] ) ) != 0 ) {
+				printf( "Cannot reload model %s (%d)\n", models[ i ], result );
+			}
+		}
+		fflush( stdout );
+	}
+
+	id3_server_stop( server );
+	pthread_join( thread, &status );
+	server_print( server );
+	result = *( int* )status;
+	id3_server_destroy( server );
+
+	return result != 0;
+}